@@ -53,6 +53,13 @@ ulong sandbox_clk_query_rate(struct udevice *dev, int id);
  * @return:	The rate of the clock.
  */
 int sandbox_clk_query_enable(struct udevice *dev, int id);
+/**
+ * sandbox_clk_query_get_rate_count - Query how often a rate has been read
+ *
+ * @dev:	The sandbox clock provider device.
+ * @return:	The number of calls to the driver's get_rate() method.
+ */
+int sandbox_clk_query_get_rate_count(struct udevice *dev);
 
 /**
  * sandbox_clk_test_get - Ask the sandbox clock test device to request its
@@ -90,6 +90,16 @@ long sandbox_i2c_rtc_get_set_base_time(struct udevice *dev, long base_time);
 
 int sandbox_usb_keyb_add_string(struct udevice *dev, const char *str);
 
+/**
+ * sandbox_uas_fail_next_data() - Make the next UAS data phase fail
+ *
+ * The queued commands stay on the emulated device until the host aborts
+ * them with a LOGICAL UNIT RESET.
+ *
+ * @dev:	UAS emulator device
+ */
+void sandbox_uas_fail_next_data(struct udevice *dev);
+
 /**
  * sandbox_osd_get_mem() - get the internal memory of a sandbox OSD
  *
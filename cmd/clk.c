@@ -16,6 +16,7 @@ int __weak soc_clk_dump(void)
 	struct udevice *dev;
 	struct uclass *uc;
 	struct clk clk;
+	ulong start, rate;
 	int ret;
 
 	/* Device addresses start at 1 */
@@ -37,7 +38,11 @@ int __weak soc_clk_dump(void)
 			continue;
 		}
 
-		printf("%-30.30s : %lu Hz\n", dev->name, clk_get_rate(&clk));
+		/* Time the driver, which the rate cache avoids calling */
+		start = timer_get_us();
+		rate = clk_get_rate(&clk);
+		printf("%-30.30s : %lu Hz (%lu us)\n", dev->name, rate,
+		       timer_get_us() - start);
 
 		clk_free(&clk);
 	}
@@ -323,6 +323,14 @@ static lbaint_t mmc_sparse_reserve(struct sparse_storage *info,
 	return blkcnt;
 }
 
+static lbaint_t mmc_sparse_write_zeroes(struct sparse_storage *info,
+					lbaint_t blk, lbaint_t blkcnt)
+{
+	struct blk_desc *dev_desc = info->priv;
+
+	return blk_dwrite_zeroes(dev_desc, blk, blkcnt);
+}
+
 static int do_mmc_sparse_write(cmd_tbl_t *cmdtp, int flag,
 			       int argc, char * const argv[])
 {
@@ -363,6 +371,7 @@ static int do_mmc_sparse_write(cmd_tbl_t *cmdtp, int flag,
 	sparse.size = dev_desc->lba - blk;
 	sparse.write = mmc_sparse_write;
 	sparse.reserve = mmc_sparse_reserve;
+	sparse.write_zeroes = mmc_sparse_write_zeroes;
 	sparse.mssg = NULL;
 	sprintf(dest, "0x" LBAF, sparse.start * sparse.blksz);
 
@@ -432,6 +441,28 @@ static int do_mmc_erase(cmd_tbl_t *cmdtp, int flag,
 
 	return (n == cnt) ? CMD_RET_SUCCESS : CMD_RET_FAILURE;
 }
+
+static int do_mmc_sanitize(cmd_tbl_t *cmdtp, int flag,
+			   int argc, char * const argv[])
+{
+	struct mmc *mmc;
+	int ret;
+
+	mmc = init_mmc_device(curr_device, false);
+	if (!mmc)
+		return CMD_RET_FAILURE;
+
+	if (mmc_getwp(mmc) == 1) {
+		printf("Error: card is write protected!\n");
+		return CMD_RET_FAILURE;
+	}
+
+	printf("\nMMC sanitize: dev # %d ... ", curr_device);
+	ret = mmc_sanitize(mmc);
+	printf("%s\n", ret ? "ERROR" : "OK");
+
+	return ret ? CMD_RET_FAILURE : CMD_RET_SUCCESS;
+}
 #endif
 
 static int do_mmc_rescan(cmd_tbl_t *cmdtp, int flag,
@@ -869,6 +900,7 @@ static cmd_tbl_t cmd_mmc[] = {
 #if CONFIG_IS_ENABLED(MMC_WRITE)
 	U_BOOT_CMD_MKENT(write, 4, 0, do_mmc_write, "", ""),
 	U_BOOT_CMD_MKENT(erase, 3, 0, do_mmc_erase, "", ""),
+	U_BOOT_CMD_MKENT(sanitize, 1, 0, do_mmc_sanitize, "", ""),
 #endif
 #if CONFIG_IS_ENABLED(CMD_MMC_SWRITE)
 	U_BOOT_CMD_MKENT(swrite, 3, 0, do_mmc_sparse_write, "", ""),
@@ -931,6 +963,7 @@ U_BOOT_CMD(
 	"mmc swrite addr blk#\n"
 #endif
 	"mmc erase blk# cnt\n"
+	"mmc sanitize - purge unmapped data from the current eMMC device\n"
 	"mmc rescan\n"
 	"mmc part - lists available partition on current mmc device\n"
 	"mmc dev [dev] [part] - show or set current mmc device [partition]\n"
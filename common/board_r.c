@@ -38,6 +38,7 @@
 #include <serial.h>
 #include <spi.h>
 #include <stdio_dev.h>
+#include <thread.h>
 #include <timer.h>
 #include <trace.h>
 #include <watchdog.h>
@@ -46,6 +47,7 @@
 #endif
 #include <asm/sections.h>
 #include <dm/root.h>
+#include <dm/util.h>
 #include <linux/compiler.h>
 #include <linux/err.h>
 #include <efi_loader.h>
@@ -282,6 +284,7 @@ static int initr_dm(void)
 	/* Save the pre-reloc driver model and start a new one */
 	gd->dm_root_f = gd->dm_root;
 	gd->dm_root = NULL;
+	gd->uclass_table = NULL;
 #ifdef CONFIG_TIMER
 	gd->timer = NULL;
 #endif
@@ -635,6 +638,38 @@ static int initr_bedbug(void)
 }
 #endif
 
+#ifdef CONFIG_DM_PROBE_ASYNC
+static int initr_dm_probe_async(void)
+{
+	int ret;
+
+	ret = dm_probe_async(CONFIG_DM_PROBE_ASYNC_UCLASSES);
+	if (ret)
+		debug("%s: Cannot start threads (err=%d)\n", __func__, ret);
+
+	return 0;
+}
+#endif
+
+#if CONFIG_IS_ENABLED(THREAD)
+static int initr_thread_join(void)
+{
+	/* Errors are reported by whatever uses the device */
+	thread_join_all();
+
+	return 0;
+}
+#endif
+
+#ifdef CONFIG_DM_TIMING_BOOTSTAGE
+static int initr_dm_timing(void)
+{
+	dm_timing_add_bootstage(CONFIG_DM_TIMING_BOOTSTAGE);
+
+	return 0;
+}
+#endif
+
 static int run_main_loop(void)
 {
 #ifdef CONFIG_SANDBOX
@@ -735,6 +770,10 @@ static init_fnc_t init_sequence_r[] = {
 	arch_early_init_r,
 #endif
 	power_init_board,
+#ifdef CONFIG_DM_PROBE_ASYNC
+	/* Let slow devices start up while the rest of init runs */
+	initr_dm_probe_async,
+#endif
 #ifdef CONFIG_MTD_NOR_FLASH
 	initr_flash,
 #endif
@@ -843,6 +882,13 @@ static init_fnc_t init_sequence_r[] = {
 #endif
 #if defined(CONFIG_PRAM)
 	initr_mem,
+#endif
+#if CONFIG_IS_ENABLED(THREAD)
+	/* Finish probing devices and starting cards and PHYs */
+	initr_thread_join,
+#endif
+#ifdef CONFIG_DM_TIMING_BOOTSTAGE
+	initr_dm_timing,
 #endif
 	run_main_loop,
 };
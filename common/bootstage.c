@@ -195,6 +195,20 @@ uint32_t bootstage_accum(enum bootstage_id id)
 	return duration;
 }
 
+uint32_t bootstage_add_accum(const char *name, uint32_t duration)
+{
+	struct bootstage_data *data = gd->bootstage;
+	struct bootstage_record *rec = ensure_id(data, data->next_id++);
+
+	if (!rec)
+		return 0;
+	rec->start_us = timer_get_boot_us();
+	rec->time_us = duration;
+	rec->name = name;
+
+	return duration;
+}
+
 /**
  * Get a record name as a printable string
  *
@@ -246,7 +246,9 @@ int miiphy_read(const char *devname, unsigned char addr, unsigned char reg,
 	if (!bus)
 		return 1;
 
+	thread_claim(bus);
 	ret = bus->read(bus, addr, MDIO_DEVAD_NONE, reg);
+	thread_release(bus);
 	if (ret < 0)
 		return 1;
 
@@ -268,12 +270,17 @@ int miiphy_write(const char *devname, unsigned char addr, unsigned char reg,
 		  unsigned short value)
 {
 	struct mii_dev *bus;
+	int ret;
 
 	bus = miiphy_get_active_dev(devname);
-	if (bus)
-		return bus->write(bus, addr, MDIO_DEVAD_NONE, reg, value);
+	if (!bus)
+		return 1;
 
-	return 1;
+	thread_claim(bus);
+	ret = bus->write(bus, addr, MDIO_DEVAD_NONE, reg, value);
+	thread_release(bus);
+
+	return ret;
 }
 
 /*****************************************************************************
@@ -0,0 +1,337 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Cooperative threads
+ *
+ * The main thread and any created threads form a ring. At each wait point
+ * the current thread saves its context with setjmp() and switches to the
+ * next one in the ring. The main thread only switches when it waits for a
+ * thread or for something a thread has claimed, and between init steps. A
+ * new thread starts on its own stack and is freed by thread_join() once its
+ * function returns.
+ */
+
+#include <common.h>
+#include <malloc.h>
+#include <thread.h>
+#include <watchdog.h>
+#include <asm/setjmp.h>
+#include <linux/list.h>
+
+DECLARE_GLOBAL_DATA_PTR;
+
+/* Depth of nested claims recorded for each thread */
+#define THREAD_CLAIM_DEPTH	16
+
+/* Written to the bottom of each stack to detect overflow */
+#define THREAD_STACK_MAGIC	0x7a5ca1ab
+
+/**
+ * struct thread - a cooperative thread
+ *
+ * @ctx:	Saved context, when the thread is not running
+ * @name:	Name of the thread
+ * @func:	Function to run
+ * @arg:	Argument to pass to @func
+ * @stack:	Stack, or NULL for the main thread
+ * @ret:	Value returned by @func
+ * @started:	true once the thread has first run
+ * @done:	true once @func has returned
+ * @claimed:	Objects this thread has claimed, outermost first
+ * @claim_depth: Number of nested claims, which may exceed the number
+ *	recorded in @claimed
+ * @waiting_for: Object claimed by another thread, which this thread is
+ *	waiting for, else NULL
+ * @node:	Node in the ring of runnable threads
+ * @all_node:	Node in the list of threads not yet joined
+ */
+struct thread {
+	struct jmp_buf_data ctx;
+	const char *name;
+	int (*func)(void *arg);
+	void *arg;
+	void *stack;
+	int ret;
+	bool started;
+	bool done;
+	const void *claimed[THREAD_CLAIM_DEPTH];
+	int claim_depth;
+	const void *waiting_for;
+	struct list_head node;
+	struct list_head all_node;
+};
+
+static struct thread thread_main = {
+	.name	= "main",
+	.started = true,
+};
+
+/* Thread which is running now */
+static struct thread *thread_cur = &thread_main;
+
+/* Runnable threads, including the main thread while any others exist */
+static LIST_HEAD(thread_ring);
+
+/* Created threads which have not been joined */
+static LIST_HEAD(thread_all);
+
+static bool thread_active(void)
+{
+	/* Static data cannot be used before relocation */
+	if (!(gd->flags & GD_FLG_RELOC))
+		return false;
+
+	return !list_empty(&thread_ring);
+}
+
+static struct thread *thread_next(void)
+{
+	struct list_head *next = thread_cur->node.next;
+
+	if (next == &thread_ring)
+		next = next->next;
+
+	return list_entry(next, struct thread, node);
+}
+
+static __noreturn void thread_entry(void);
+
+/* Switch to @sp and call thread_entry(), which never returns */
+static __noreturn void thread_start(void *sp)
+{
+#if defined(__x86_64__)
+	asm volatile("mov %0, %%rsp\n\tcall *%1"
+		     : : "r" (sp), "r" (thread_entry) : "memory");
+#elif defined(__i386__)
+	asm volatile("mov %0, %%esp\n\tcall *%1"
+		     : : "r" (sp), "r" (thread_entry) : "memory");
+#elif defined(__aarch64__)
+	asm volatile("mov sp, %0\n\tblr %1"
+		     : : "r" (sp), "r" (thread_entry) : "memory");
+#elif defined(__arm__)
+	asm volatile("mov sp, %0\n\tblx %1"
+		     : : "r" (sp), "r" (thread_entry) : "memory");
+#elif defined(__riscv)
+	asm volatile("mv sp, %0\n\tjalr %1"
+		     : : "r" (sp), "r" (thread_entry) : "memory");
+#else
+#error "Threads are not supported on this architecture"
+#endif
+	unreachable();
+}
+
+static void thread_switch(struct thread *next)
+{
+	struct thread *prev = thread_cur;
+
+	if (next == prev)
+		return;
+	thread_cur = next;
+	/* A finished thread is never resumed, so need not be saved */
+	if (!prev->done && setjmp(&prev->ctx))
+		return;
+	if (next->started)
+		longjmp(&next->ctx, 1);
+	next->started = true;
+	thread_start(next->stack + CONFIG_THREAD_STACK_SIZE);
+}
+
+static __noreturn void thread_entry(void)
+{
+	struct thread *thread = thread_cur;
+	struct thread *next;
+
+	thread->ret = thread->func(thread->arg);
+	debug("Thread '%s' returned %d\n", thread->name, thread->ret);
+	next = thread_next();
+	thread->done = true;
+	list_del(&thread->node);
+
+	/* The main thread leaves the ring when it is the only one left */
+	if (list_is_singular(&thread_ring)) {
+		list_del_init(&thread_main.node);
+		thread_main.claim_depth = 0;
+	}
+	thread_switch(next);
+	unreachable();
+}
+
+struct thread *thread_create(const char *name, int (*func)(void *arg),
+			     void *arg)
+{
+	struct thread *thread;
+
+	if (!(gd->flags & GD_FLG_RELOC))
+		return NULL;
+	thread = calloc(1, sizeof(*thread));
+	if (!thread)
+		return NULL;
+	/* Keep the stack aligned as the ABIs require */
+	thread->stack = memalign(16, CONFIG_THREAD_STACK_SIZE);
+	if (!thread->stack) {
+		free(thread);
+		return NULL;
+	}
+	*(u32 *)thread->stack = THREAD_STACK_MAGIC;
+	thread->name = name;
+	thread->func = func;
+	thread->arg = arg;
+
+	if (list_empty(&thread_ring)) {
+		list_add_tail(&thread_main.node, &thread_ring);
+		thread_main.claim_depth = 0;
+	}
+	list_add_tail(&thread->node, &thread_ring);
+	list_add_tail(&thread->all_node, &thread_all);
+
+	return thread;
+}
+
+void thread_run_others(void)
+{
+	if (thread_active())
+		thread_switch(thread_next());
+}
+
+void thread_yield(void)
+{
+	/* The rest of init does not expect its own delays to run other code */
+	if (thread_cur != &thread_main)
+		thread_run_others();
+}
+
+ulong thread_wait_us(ulong usec)
+{
+	ulong start, elapsed;
+
+	if (usec < THREAD_WAIT_MIN_US || thread_cur == &thread_main ||
+	    !thread_active())
+		return usec;
+	start = timer_get_us();
+	do {
+		WATCHDOG_RESET();
+		thread_yield();
+		elapsed = timer_get_us() - start;
+	} while (elapsed < usec && thread_active());
+
+	return usec - min(elapsed, usec);
+}
+
+int thread_join(struct thread *thread)
+{
+	int ret;
+
+	while (!thread->done)
+		thread_run_others();
+	if (*(u32 *)thread->stack != THREAD_STACK_MAGIC)
+		printf("Thread '%s' overflowed its stack\n", thread->name);
+	ret = thread->ret;
+	list_del(&thread->all_node);
+	free(thread->stack);
+	free(thread);
+
+	return ret;
+}
+
+int thread_join_all(void)
+{
+	int first = 0;
+
+	while (!list_empty(&thread_all)) {
+		struct thread *thread;
+		int ret;
+
+		thread = list_first_entry(&thread_all, struct thread, all_node);
+		ret = thread_join(thread);
+		if (ret && !first)
+			first = ret;
+	}
+
+	return first;
+}
+
+/* Find another thread which has claimed @obj */
+static struct thread *thread_claimed_by(const void *obj,
+					struct thread *except)
+{
+	struct thread *thread;
+	int i;
+
+	list_for_each_entry(thread, &thread_ring, node) {
+		int depth = min(thread->claim_depth, THREAD_CLAIM_DEPTH);
+
+		if (thread == except)
+			continue;
+		for (i = 0; i < depth; i++) {
+			if (thread->claimed[i] == obj)
+				return thread;
+		}
+	}
+
+	return NULL;
+}
+
+/*
+ * Check whether waiting for @owner would deadlock, because it is waiting,
+ * perhaps indirectly, for something which the current thread has claimed. In
+ * that case the current thread carries on, as it would without threads.
+ */
+static bool thread_would_deadlock(struct thread *owner)
+{
+	int count;
+
+	/* Give up if the chain of waits loops without reaching us */
+	for (count = 0; owner && count < 100; count++) {
+		if (owner == thread_cur)
+			return true;
+		if (!owner->waiting_for)
+			return false;
+		owner = thread_claimed_by(owner->waiting_for, owner);
+	}
+
+	return false;
+}
+
+void thread_claim(const void *obj)
+{
+	struct thread *owner;
+
+	if (!thread_active())
+		return;
+	while ((owner = thread_claimed_by(obj, thread_cur)) &&
+	       !thread_would_deadlock(owner)) {
+		thread_cur->waiting_for = obj;
+		thread_run_others();
+	}
+	thread_cur->waiting_for = NULL;
+
+	/* The main thread may have left the ring while we were waiting */
+	if (!thread_active())
+		return;
+	if (thread_cur->claim_depth < THREAD_CLAIM_DEPTH)
+		thread_cur->claimed[thread_cur->claim_depth] = obj;
+	thread_cur->claim_depth++;
+}
+
+void thread_release(const void *obj)
+{
+	struct thread *thread = thread_cur;
+	int i;
+
+	if (!thread_active() || !thread->claim_depth)
+		return;
+	if (thread->claim_depth > THREAD_CLAIM_DEPTH) {
+		thread->claim_depth--;
+		return;
+	}
+
+	/* Claims are not always released in order, e.g. a bus by a driver */
+	for (i = thread->claim_depth - 1; i >= 0; i--) {
+		if (thread->claimed[i] == obj) {
+			memmove(&thread->claimed[i], &thread->claimed[i + 1],
+				(thread->claim_depth - i - 1) *
+				sizeof(thread->claimed[0]));
+			thread->claim_depth--;
+			break;
+		}
+	}
+}
@@ -281,6 +281,79 @@ int usb_bulk_msg(struct usb_device *dev, unsigned int pipe,
 		return -EIO;
 }
 
+#if CONFIG_IS_ENABLED(DM_USB)
+/*-------------------------------------------------------------------
+ * submits a bulk message on a stream and waits for completion
+ */
+int usb_bulk_stream_msg(struct usb_device *dev, unsigned int pipe,
+			unsigned int stream_id, void *data, int len,
+			int *actual_length, int timeout)
+{
+	int ret;
+
+	if (len < 0)
+		return -EINVAL;
+	dev->status = USB_ST_NOT_PROC; /*not yet processed */
+	ret = submit_bulk_stream_msg(dev, pipe, stream_id, data, len);
+	if (ret < 0)
+		return ret == -ENOSYS ? ret : -EIO;
+	while (timeout--) {
+		if (!((volatile unsigned long)dev->status & USB_ST_NOT_PROC))
+			break;
+		mdelay(1);
+	}
+	*actual_length = dev->act_len;
+	if (dev->status == 0)
+		return 0;
+	else
+		return -EIO;
+}
+
+/*-------------------------------------------------------------------
+ * submits a batch of bulk messages and waits for all of them
+ */
+int usb_bulk_batch(struct usb_device *dev, struct usb_bulk_req *reqs,
+		   int count, int timeout)
+{
+	struct usb_bulk_req *req;
+	int ret, i;
+
+	ret = submit_bulk_batch(dev, reqs, count);
+	if (ret == -ENOSYS) {
+		/* The HCD takes one at a time */
+		for (i = 0; i < count; i++) {
+			reqs[i].status = USB_ST_NOT_PROC;
+			reqs[i].act_len = 0;
+		}
+		for (i = 0, ret = 0; i < count && !ret; i++) {
+			req = &reqs[i];
+			if (req->stream_id)
+				ret = usb_bulk_stream_msg(dev, req->pipe,
+							  req->stream_id,
+							  req->buffer,
+							  req->length,
+							  &req->act_len,
+							  timeout);
+			else
+				ret = usb_bulk_msg(dev, req->pipe, req->buffer,
+						   req->length, &req->act_len,
+						   timeout);
+			req->status = dev->status;
+		}
+		return ret;
+	}
+	if (ret < 0)
+		return ret;
+
+	for (i = 0; i < count; i++) {
+		if (reqs[i].status)
+			return -EIO;
+	}
+
+	return 0;
+}
+#endif
+
 
 /*-------------------------------------------------------------------
  * Max Packet stuff
@@ -371,13 +444,14 @@ static int usb_parse_config(struct usb_device *dev,
 			unsigned char *buffer, int cfgno)
 {
 	struct usb_descriptor_header *head;
-	int index, ifno, epno, curr_if_num;
+	int index, ifno, epno, curr_if_num, curr_alt;
 	u16 ep_wMaxPacketSize;
 	struct usb_interface *if_desc = NULL;
 
 	ifno = -1;
 	epno = -1;
 	curr_if_num = -1;
+	curr_alt = 0;
 
 	dev->configno = cfgno;
 	head = (struct usb_descriptor_header *) &buffer[0];
@@ -410,6 +484,8 @@ static int usb_parse_config(struct usb_device *dev,
 				puts("USB IF descriptor overflowed buffer!\n");
 				break;
 			}
+			curr_alt = ((struct usb_interface_descriptor *)
+				    head)->bAlternateSetting;
 			if (((struct usb_interface_descriptor *) \
 			     head)->bInterfaceNumber != curr_if_num) {
 				/* this is a new interface, copy new desc */
@@ -425,6 +501,7 @@ static int usb_parse_config(struct usb_device *dev,
 					USB_DT_INTERFACE_SIZE);
 				if_desc->no_of_ep = 0;
 				if_desc->num_altsetting = 1;
+				if_desc->act_altsetting = 0;
 				curr_if_num =
 				     if_desc->desc.bInterfaceNumber;
 			} else {
@@ -462,6 +539,7 @@ static int usb_parse_config(struct usb_device *dev,
 			if_desc->no_of_ep++;
 			memcpy(&if_desc->ep_desc[epno], head,
 				USB_DT_ENDPOINT_SIZE);
+			if_desc->ep_altsetting[epno] = curr_alt;
 			ep_wMaxPacketSize = get_unaligned(&dev->config.\
 							if_desc[ifno].\
 							ep_desc[epno].\
@@ -647,6 +725,7 @@ int usb_set_interface(struct usb_device *dev, int interface, int alternate)
 				USB_CNTL_TIMEOUT * 5);
 	if (ret < 0)
 		return ret;
+	if_face->act_altsetting = alternate;
 
 	return 0;
 }
@@ -54,6 +54,12 @@ struct usb_device_scan {
 
 static LIST_HEAD(usb_scan_list);
 
+/*
+ * While this is set, hubs which get configured only power up their ports and
+ * put them on the scan list. usb_hub_scan_finish() then scans them all.
+ */
+static bool usb_scan_deferred;
+
 __weak void usb_hub_reset_devices(struct usb_hub_device *hub, int port)
 {
 	return;
@@ -565,11 +571,14 @@ static int usb_device_list_scan(void)
 {
 	struct usb_device_scan *usb_scan;
 	struct usb_device_scan *tmp;
+	struct usb_hub_device *hub;
 	static int running;
+	ulong query_delay;
+	ulong now;
 	int ret = 0;
 
 	/* Only run this loop once for each controller */
-	if (running)
+	if (running || usb_scan_deferred)
 		return 0;
 
 	running = 1;
@@ -579,6 +588,23 @@ static int usb_device_list_scan(void)
 		if (list_empty(&usb_scan_list))
 			goto out;
 
+		/*
+		 * The hubs on the list were powered up together, so share one
+		 * power-good delay: wait for the last of them before looking
+		 * at any port. The ports which have a device by then get it
+		 * set up in list order, i.e. by controller, hub and port, no
+		 * matter which hub was ready first. That keeps the device
+		 * numbering the same from one boot to the next.
+		 */
+		query_delay = 0;
+		list_for_each_entry(usb_scan, &usb_scan_list, list) {
+			hub = usb_scan->hub;
+			query_delay = max(query_delay, hub->query_delay);
+		}
+		now = get_timer(0);
+		if (now < query_delay)
+			mdelay(query_delay - now);
+
 		list_for_each_entry_safe(usb_scan, tmp, &usb_scan_list, list) {
 			int ret;
 
@@ -600,6 +626,18 @@ out:
 	return ret;
 }
 
+void usb_hub_scan_start(void)
+{
+	usb_scan_deferred = true;
+}
+
+int usb_hub_scan_finish(void)
+{
+	usb_scan_deferred = false;
+
+	return usb_device_list_scan();
+}
+
 static struct usb_hub_device *usb_get_hub_device(struct usb_device *dev)
 {
 	struct usb_hub_device *hub;
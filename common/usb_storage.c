@@ -97,6 +97,13 @@ struct us_data {
 	trans_reset	transport_reset;	/* reset routine */
 	trans_cmnd	transport;		/* transport routine */
 	unsigned short	max_xfer_blk;		/* maximum transfer blocks */
+#ifdef CONFIG_USB_UAS
+	unsigned char	ep_cmd;			/* UAS command pipe */
+	unsigned char	ep_status;		/* UAS status pipe */
+	int		uas_depth;		/* commands queued at once */
+	int		uas_streams;		/* streams, 0 if not used */
+	unsigned char	uas_sense[18];		/* sense of failed command */
+#endif
 };
 
 #if !CONFIG_IS_ENABLED(BLK)
@@ -107,6 +114,10 @@ static struct us_data usb_stor[USB_MAX_STOR_DEV];
 #define USB_STOR_TRANSPORT_FAILED -1
 #define USB_STOR_TRANSPORT_ERROR  -2
 
+#ifdef CONFIG_USB_UAS
+static struct scsi_cmd uas_ccb[CONFIG_USB_UAS_QUEUE_DEPTH];
+#endif
+
 int usb_stor_get_info(struct usb_device *dev, struct us_data *us,
 		      struct blk_desc *dev_desc);
 int usb_storage_probe(struct usb_device *dev, unsigned int ifnum,
@@ -206,7 +217,8 @@ static int usb_stor_probe_device(struct usb_device *udev)
 	data = dev_get_platdata(udev->dev);
 	if (!usb_storage_probe(udev, 0, data))
 		return 0;
-	max_lun = usb_get_max_lun(data);
+	/* UAS has no GET MAX LUN request, only LUN 0 is used */
+	max_lun = data->protocol == US_PR_UAS ? 0 : usb_get_max_lun(data);
 	for (lun = 0; lun <= max_lun; lun++) {
 		struct blk_desc *blkdev;
 		struct udevice *dev;
@@ -253,7 +265,10 @@ static int usb_stor_probe_device(struct usb_device *udev)
 	 */
 	start = usb_max_devs;
 
-	max_lun = usb_get_max_lun(&usb_stor[usb_max_devs]);
+	if (usb_stor[usb_max_devs].protocol == US_PR_UAS)
+		max_lun = 0;
+	else
+		max_lun = usb_get_max_lun(&usb_stor[usb_max_devs]);
 	for (lun = 0; lun <= max_lun && usb_max_devs < USB_MAX_STOR_DEV;
 	     lun++) {
 		struct blk_desc *blkdev;
@@ -935,6 +950,301 @@ do_retry:
 	return USB_STOR_TRANSPORT_FAILED;
 }
 
+#ifdef CONFIG_USB_UAS
+/*
+ * USB Attached SCSI
+ *
+ * Each SCSI command is sent as a command IU on the command pipe, with a tag
+ * so that several commands can be queued on the device. With bulk streams
+ * (USB 3.0) the data and the sense IU of a command travel on the stream
+ * whose ID is the tag. Without streams the device tells us on the status
+ * pipe which command it wants to move data for next (read/write ready IU)
+ * and completes each command with a sense IU, in any order it likes.
+ */
+static unsigned int usb_stor_UAS_data_pipe(struct us_data *us,
+					   struct scsi_cmd *srb)
+{
+	if (US_DIRECTION(srb->cmd[0]))
+		return usb_rcvbulkpipe(us->pusb_dev, us->ep_in);
+
+	return usb_sndbulkpipe(us->pusb_dev, us->ep_out);
+}
+
+static int usb_stor_UAS_data(struct us_data *us, struct scsi_cmd *srb)
+{
+	unsigned int pipe = usb_stor_UAS_data_pipe(us, srb);
+	int actlen, ret;
+
+	ret = usb_bulk_msg(us->pusb_dev, pipe, srb->pdata, srb->datalen,
+			   &actlen, USB_CNTL_TIMEOUT * 5);
+	debug("UAS: data %s len %lu, actlen %d, ret %d\n",
+	      usb_pipein(pipe) ? "in" : "out", srb->datalen, actlen, ret);
+
+	return ret;
+}
+
+static int usb_stor_UAS_check_iu(struct uas_sense_iu *iu, int actlen)
+{
+	if (actlen < sizeof(struct uas_iu) ||
+	    (iu->iu_id == UAS_IU_ID_STATUS && actlen < UAS_SENSE_IU_HDR_SIZE))
+		return -EPROTO;
+	debug("UAS: IU %x tag %d\n", iu->iu_id, be16_to_cpu(iu->tag));
+
+	return 0;
+}
+
+static int usb_stor_UAS_get_iu(struct us_data *us, struct uas_sense_iu *iu)
+{
+	int actlen, ret;
+
+	ret = usb_bulk_msg(us->pusb_dev,
+			   usb_rcvbulkpipe(us->pusb_dev, us->ep_status),
+			   iu, sizeof(*iu), &actlen, USB_CNTL_TIMEOUT * 5);
+	if (ret)
+		return ret;
+
+	return usb_stor_UAS_check_iu(iu, actlen);
+}
+
+/*
+ * Abort the commands still queued on the device with a LOGICAL UNIT RESET,
+ * so that their tags can be used again. Returns 0 if the device confirmed it.
+ * Commands use tags 1 to uas_depth, so the task management IU uses the next
+ * one, which with streams has a stream of its own.
+ */
+static int usb_stor_UAS_abort(struct us_data *us)
+{
+	ALLOC_CACHE_ALIGN_BUFFER(struct uas_task_mgmt_iu, tm, 1);
+	ALLOC_CACHE_ALIGN_BUFFER(struct uas_sense_iu, iu, 1);
+	struct uas_response_iu *resp = (struct uas_response_iu *)iu;
+	struct usb_device *udev = us->pusb_dev;
+	int tag = us->uas_depth + 1;
+	int actlen, ret, i;
+
+	memset(tm, '\0', sizeof(*tm));
+	tm->iu_id = UAS_IU_ID_TASK_MGMT;
+	tm->tag = cpu_to_be16(tag);
+	tm->function = UAS_TMF_LUN_RESET;
+	ret = usb_bulk_msg(udev, usb_sndbulkpipe(udev, us->ep_cmd), tm,
+			   sizeof(*tm), &actlen, USB_CNTL_TIMEOUT * 5);
+	if (ret)
+		return ret;
+
+	/* Without streams, IUs of aborted commands may come first */
+	for (i = 0; i <= us->uas_depth; i++) {
+		if (us->uas_streams) {
+			ret = usb_bulk_stream_msg(udev,
+					usb_rcvbulkpipe(udev, us->ep_status),
+					tag, iu, sizeof(*iu), &actlen,
+					USB_CNTL_TIMEOUT * 5);
+			if (!ret)
+				ret = usb_stor_UAS_check_iu(iu, actlen);
+		} else {
+			ret = usb_stor_UAS_get_iu(us, iu);
+		}
+		if (ret)
+			return ret;
+		if (resp->iu_id == UAS_IU_ID_RESPONSE &&
+		    be16_to_cpu(resp->tag) == tag)
+			break;
+		if (us->uas_streams)
+			return -EPROTO;
+	}
+	if (i > us->uas_depth)
+		return -EPROTO;
+	debug("UAS: LUN reset response %x\n", resp->response_code);
+	if (resp->response_code != UAS_RC_TMF_COMPLETE &&
+	    resp->response_code != UAS_RC_TMF_SUCCEEDED)
+		return -EIO;
+
+	return 0;
+}
+
+static int usb_stor_UAS_reset(struct us_data *us)
+{
+	struct usb_device *udev = us->pusb_dev;
+	int ret;
+
+	debug("UAS: reset\n");
+	usb_clear_halt(udev, usb_sndbulkpipe(udev, us->ep_cmd));
+	usb_clear_halt(udev, usb_rcvbulkpipe(udev, us->ep_status));
+	ret = usb_stor_UAS_abort(us);
+	if (ret)
+		debug("UAS: abort failed (err=%d)\n", ret);
+	usb_clear_halt(udev, usb_rcvbulkpipe(udev, us->ep_in));
+	usb_clear_halt(udev, usb_sndbulkpipe(udev, us->ep_out));
+
+	return ret;
+}
+
+/* Return the transport status for a sense IU, keeping its sense data */
+static int usb_stor_UAS_status(struct us_data *us, struct uas_sense_iu *iu)
+{
+	int len;
+
+	if (!iu->status)
+		return USB_STOR_TRANSPORT_GOOD;
+
+	len = min_t(int, be16_to_cpu(iu->len), sizeof(us->uas_sense));
+	memset(us->uas_sense, '\0', sizeof(us->uas_sense));
+	memcpy(us->uas_sense, iu->sense, len);
+	debug("UAS: tag %d status %x sense %02X %02X %02X\n",
+	      be16_to_cpu(iu->tag), iu->status, us->uas_sense[2],
+	      us->uas_sense[12], us->uas_sense[13]);
+
+	return USB_STOR_TRANSPORT_FAILED;
+}
+
+/*
+ * With streams everything for a command comes on its own stream, so the data
+ * and the sense IU of all the commands are queued at once. Each command's data
+ * comes before its sense IU, which is the order they must be sent in when the
+ * HCD takes one request at a time.
+ */
+static int usb_stor_UAS_streams(struct us_data *us, struct scsi_cmd *srb,
+				int count, int *result)
+{
+	ALLOC_CACHE_ALIGN_BUFFER(struct uas_sense_iu, iu,
+				 CONFIG_USB_UAS_QUEUE_DEPTH);
+	struct usb_bulk_req reqs[2 * CONFIG_USB_UAS_QUEUE_DEPTH];
+	int sense[CONFIG_USB_UAS_QUEUE_DEPTH];
+	struct usb_device *udev = us->pusb_dev;
+	int n = 0;
+	int ret, i;
+
+	memset(reqs, '\0', sizeof(reqs));
+	for (i = 0; i < count; i++) {
+		if (srb[i].datalen) {
+			reqs[n].pipe = usb_stor_UAS_data_pipe(us, &srb[i]);
+			reqs[n].stream_id = i + 1;
+			reqs[n].buffer = srb[i].pdata;
+			reqs[n].length = srb[i].datalen;
+			n++;
+		}
+		sense[i] = n;
+		reqs[n].pipe = usb_rcvbulkpipe(udev, us->ep_status);
+		reqs[n].stream_id = i + 1;
+		reqs[n].buffer = &iu[i];
+		reqs[n].length = sizeof(*iu);
+		n++;
+	}
+
+	ret = usb_bulk_batch(udev, reqs, n, USB_CNTL_TIMEOUT * 5);
+	if (ret)
+		return ret;
+
+	for (i = 0; i < count; i++) {
+		ret = usb_stor_UAS_check_iu(&iu[i], reqs[sense[i]].act_len);
+		if (ret)
+			return ret;
+		if (iu[i].iu_id != UAS_IU_ID_STATUS ||
+		    be16_to_cpu(iu[i].tag) != i + 1)
+			return -EPROTO;
+		result[i] = usb_stor_UAS_status(us, &iu[i]);
+	}
+
+	return 0;
+}
+
+/*
+ * Queue @count commands on the device, using tags 1 to @count, and wait for
+ * all of them. The transport status of each command is put in @result.
+ * Returns 0 if all commands completed, -ve on a transport error, in which
+ * case the commands without a result are left as USB_STOR_TRANSPORT_ERROR.
+ */
+static int usb_stor_UAS_queue(struct us_data *us, struct scsi_cmd *srb,
+			      int count, int *result)
+{
+	ALLOC_CACHE_ALIGN_BUFFER(struct uas_command_iu, cmd, 1);
+	ALLOC_CACHE_ALIGN_BUFFER(struct uas_sense_iu, iu, 1);
+	struct usb_device *udev = us->pusb_dev;
+	int pending, actlen, tag, ret, i;
+	bool dir_in;
+
+	for (i = 0; i < count; i++)
+		result[i] = USB_STOR_TRANSPORT_ERROR;
+
+	for (i = 0; i < count; i++) {
+		memset(cmd, '\0', sizeof(*cmd));
+		cmd->iu_id = UAS_IU_ID_COMMAND;
+		cmd->tag = cpu_to_be16(i + 1);
+		cmd->prio_attr = UAS_SIMPLE_TAG;
+		cmd->lun[1] = srb[i].lun;
+		memcpy(cmd->cdb, srb[i].cmd,
+		       min_t(int, srb[i].cmdlen, sizeof(cmd->cdb)));
+		ret = usb_bulk_msg(udev, usb_sndbulkpipe(udev, us->ep_cmd),
+				   cmd, sizeof(*cmd), &actlen,
+				   USB_CNTL_TIMEOUT * 5);
+		if (ret)
+			goto err;
+	}
+
+	if (us->uas_streams) {
+		ret = usb_stor_UAS_streams(us, srb, count, result);
+		if (ret)
+			goto err;
+
+		return 0;
+	}
+
+	for (pending = count; pending;) {
+		ret = usb_stor_UAS_get_iu(us, iu);
+		if (ret)
+			goto err;
+		tag = be16_to_cpu(iu->tag);
+		ret = -EPROTO;
+		if (tag < 1 || tag > count ||
+		    result[tag - 1] != USB_STOR_TRANSPORT_ERROR)
+			goto err;
+
+		switch (iu->iu_id) {
+		case UAS_IU_ID_READ_READY:
+		case UAS_IU_ID_WRITE_READY:
+			dir_in = iu->iu_id == UAS_IU_ID_READ_READY;
+			if (!srb[tag - 1].datalen ||
+			    dir_in != US_DIRECTION(srb[tag - 1].cmd[0]))
+				goto err;
+			ret = usb_stor_UAS_data(us, &srb[tag - 1]);
+			if (ret)
+				goto err;
+			break;
+		case UAS_IU_ID_STATUS:
+			result[tag - 1] = usb_stor_UAS_status(us, iu);
+			pending--;
+			break;
+		default:
+			goto err;
+		}
+	}
+
+	return 0;
+err:
+	debug("UAS: transport error %d\n", ret);
+	us->transport_reset(us);
+
+	return ret;
+}
+
+static int usb_stor_UAS_transport(struct scsi_cmd *srb, struct us_data *us)
+{
+	int result;
+
+	/* The sense data came with the status of the failed command */
+	if (srb->cmd[0] == SCSI_REQ_SENSE) {
+		memcpy(srb->pdata, us->uas_sense,
+		       min_t(unsigned long, srb->datalen,
+			     sizeof(us->uas_sense)));
+		memset(us->uas_sense, '\0', sizeof(us->uas_sense));
+		return USB_STOR_TRANSPORT_GOOD;
+	}
+
+	if (usb_stor_UAS_queue(us, srb, 1, &result))
+		return USB_STOR_TRANSPORT_ERROR;
+
+	return result;
+}
+#endif /* CONFIG_USB_UAS */
+
 static void usb_stor_set_max_xfer_blk(struct usb_device *udev,
 				      struct us_data *us)
 {
@@ -1061,11 +1371,11 @@ static int usb_read_capacity(struct scsi_cmd *srb, struct us_data *ss)
 	return -1;
 }
 
-static int usb_read_10(struct scsi_cmd *srb, struct us_data *ss,
-		       unsigned long start, unsigned short blocks)
+static void usb_setup_rw_10(struct scsi_cmd *srb, unsigned char opcode,
+			    unsigned long start, unsigned short blocks)
 {
 	memset(&srb->cmd[0], 0, 12);
-	srb->cmd[0] = SCSI_READ10;
+	srb->cmd[0] = opcode;
 	srb->cmd[1] = srb->lun << 5;
 	srb->cmd[2] = ((unsigned char) (start >> 24)) & 0xff;
 	srb->cmd[3] = ((unsigned char) (start >> 16)) & 0xff;
@@ -1074,6 +1384,12 @@ static int usb_read_10(struct scsi_cmd *srb, struct us_data *ss,
 	srb->cmd[7] = ((unsigned char) (blocks >> 8)) & 0xff;
 	srb->cmd[8] = (unsigned char) blocks & 0xff;
 	srb->cmdlen = 12;
+}
+
+static int usb_read_10(struct scsi_cmd *srb, struct us_data *ss,
+		       unsigned long start, unsigned short blocks)
+{
+	usb_setup_rw_10(srb, SCSI_READ10, start, blocks);
 	debug("read10: start %lx blocks %x\n", start, blocks);
 	return ss->transport(srb, ss);
 }
@@ -1081,16 +1397,7 @@ static int usb_read_10(struct scsi_cmd *srb, struct us_data *ss,
 static int usb_write_10(struct scsi_cmd *srb, struct us_data *ss,
 			unsigned long start, unsigned short blocks)
 {
-	memset(&srb->cmd[0], 0, 12);
-	srb->cmd[0] = SCSI_WRITE10;
-	srb->cmd[1] = srb->lun << 5;
-	srb->cmd[2] = ((unsigned char) (start >> 24)) & 0xff;
-	srb->cmd[3] = ((unsigned char) (start >> 16)) & 0xff;
-	srb->cmd[4] = ((unsigned char) (start >> 8)) & 0xff;
-	srb->cmd[5] = ((unsigned char) (start)) & 0xff;
-	srb->cmd[7] = ((unsigned char) (blocks >> 8)) & 0xff;
-	srb->cmd[8] = (unsigned char) blocks & 0xff;
-	srb->cmdlen = 12;
+	usb_setup_rw_10(srb, SCSI_WRITE10, start, blocks);
 	debug("write10: start %lx blocks %x\n", start, blocks);
 	return ss->transport(srb, ss);
 }
@@ -1119,6 +1426,62 @@ static void usb_bin_fixup(struct usb_device_descriptor descriptor,
 }
 #endif /* CONFIG_USB_BIN_FIXUP */
 
+#ifdef CONFIG_USB_UAS
+/*
+ * Read or write through UAS. The request is split into READ(10)/WRITE(10)
+ * commands of up to max_xfer_blk blocks and up to uas_depth of them are
+ * queued on the device at a time. Returns the number of blocks transferred
+ * before the first failed command.
+ */
+static unsigned long usb_stor_UAS_rw(struct us_data *ss,
+				     struct blk_desc *block_dev,
+				     lbaint_t blknr, lbaint_t blkcnt,
+				     void *buffer, bool write)
+{
+	int result[CONFIG_USB_UAS_QUEUE_DEPTH];
+	lbaint_t done, start, blks;
+	unsigned short smallblks;
+	uintptr_t buf_addr;
+	struct scsi_cmd *srb;
+	int retry = 2;
+	int count, i;
+
+	usb_disable_asynch(1); /* asynch transfer not allowed */
+	for (done = 0; done < blkcnt;) {
+		start = blknr + done;
+		blks = blkcnt - done;
+		buf_addr = (uintptr_t)buffer + done * block_dev->blksz;
+		for (count = 0; count < ss->uas_depth && blks; count++) {
+			srb = &uas_ccb[count];
+			smallblks = min_t(lbaint_t, blks, ss->max_xfer_blk);
+			srb->lun = block_dev->lun;
+			srb->pdata = (unsigned char *)buf_addr;
+			srb->datalen = block_dev->blksz * smallblks;
+			usb_setup_rw_10(srb, write ? SCSI_WRITE10 : SCSI_READ10,
+					start, smallblks);
+			start += smallblks;
+			blks -= smallblks;
+			buf_addr += srb->datalen;
+		}
+		usb_show_progress();
+
+		usb_stor_UAS_queue(ss, uas_ccb, count, result);
+		for (i = 0; i < count && result[i] == USB_STOR_TRANSPORT_GOOD;
+		     i++)
+			done += uas_ccb[i].datalen / block_dev->blksz;
+		if (i < count) {
+			debug("UAS: %s ERROR\n", write ? "Write" : "Read");
+			if (!retry--)
+				break;
+		}
+	}
+	ss->flags &= ~USB_READY;
+	usb_disable_asynch(0); /* asynch transfer allowed */
+
+	return done;
+}
+#endif
+
 #if CONFIG_IS_ENABLED(BLK)
 static unsigned long usb_stor_read(struct udevice *dev, lbaint_t blknr,
 				   lbaint_t blkcnt, void *buffer)
@@ -1154,6 +1517,11 @@ static unsigned long usb_stor_read(struct blk_desc *block_dev, lbaint_t blknr,
 	}
 #endif
 	ss = (struct us_data *)udev->privptr;
+#ifdef CONFIG_USB_UAS
+	if (ss->protocol == US_PR_UAS)
+		return usb_stor_UAS_rw(ss, block_dev, blknr, blkcnt, buffer,
+				       false);
+#endif
 
 	usb_disable_asynch(1); /* asynch transfer not allowed */
 	srb->lun = block_dev->lun;
@@ -1236,6 +1604,11 @@ static unsigned long usb_stor_write(struct blk_desc *block_dev, lbaint_t blknr,
 	}
 #endif
 	ss = (struct us_data *)udev->privptr;
+#ifdef CONFIG_USB_UAS
+	if (ss->protocol == US_PR_UAS)
+		return usb_stor_UAS_rw(ss, block_dev, blknr, blkcnt,
+				       (void *)buffer, true);
+#endif
 
 	usb_disable_asynch(1); /* asynch transfer not allowed */
 
@@ -1286,6 +1659,114 @@ retry_it:
 
 }
 
+#ifdef CONFIG_USB_UAS
+/*
+ * Look for a UAS alternate setting of the interface and switch to it. Its
+ * endpoints are told apart by the pipe usage descriptor following each one,
+ * which usb_parse_config() does not keep, so read the configuration again.
+ * Returns 1 if the device is to be driven through UAS, 0 if not.
+ */
+static int usb_stor_UAS_probe(struct usb_device *dev,
+			      struct usb_interface *iface, struct us_data *ss)
+{
+	unsigned char eps[UAS_DATA_OUT_PIPE_ID + 1] = { 0 };
+	struct usb_interface_descriptor *if_desc;
+	struct usb_pipe_usage_descriptor *usage;
+	struct usb_descriptor_header *head;
+	unsigned char *buffer, ep = 0;
+	int len, pos, ret, i, ifnum;
+	int alt = -1;
+
+	len = usb_get_configuration_len(dev, 0);
+	if (len < 0)
+		return 0;
+	buffer = malloc_cache_aligned(len);
+	if (!buffer)
+		return 0;
+	len = usb_get_configuration_no(dev, 0, buffer, len);
+
+	for (pos = 0; pos + sizeof(*head) <= len; pos += head->bLength) {
+		head = (struct usb_descriptor_header *)&buffer[pos];
+		if (!head->bLength || pos + head->bLength > len)
+			break;
+		switch (head->bDescriptorType) {
+		case USB_DT_INTERFACE:
+			/* Any following interface or alt ends the UAS one */
+			if (alt >= 0)
+				goto done;
+			if_desc = (struct usb_interface_descriptor *)head;
+			if (if_desc->bInterfaceNumber ==
+			    iface->desc.bInterfaceNumber &&
+			    if_desc->bInterfaceClass ==
+			    USB_CLASS_MASS_STORAGE &&
+			    if_desc->bInterfaceSubClass == US_SC_SCSI &&
+			    if_desc->bInterfaceProtocol == US_PR_UAS)
+				alt = if_desc->bAlternateSetting;
+			break;
+		case USB_DT_ENDPOINT:
+			ep = ((struct usb_endpoint_descriptor *)head)->
+				bEndpointAddress & USB_ENDPOINT_NUMBER_MASK;
+			break;
+		case USB_DT_PIPE_USAGE:
+			usage = (struct usb_pipe_usage_descriptor *)head;
+			if (alt >= 0 && usage->bPipeID < ARRAY_SIZE(eps))
+				eps[usage->bPipeID] = ep;
+			break;
+		}
+	}
+done:
+	free(buffer);
+
+	if (alt < 0)
+		return 0;
+	for (i = UAS_CMD_PIPE_ID; i <= UAS_DATA_OUT_PIPE_ID; i++) {
+		if (!eps[i]) {
+			debug("UAS: pipe %d missing\n", i);
+			return 0;
+		}
+	}
+	ss->ep_cmd = eps[UAS_CMD_PIPE_ID];
+	ss->ep_status = eps[UAS_STATUS_PIPE_ID];
+	ss->ep_in = eps[UAS_DATA_IN_PIPE_ID];
+	ss->ep_out = eps[UAS_DATA_OUT_PIPE_ID];
+	debug("UAS: alt %d, endpoints Cmd %d Status %d In %d Out %d\n", alt,
+	      ss->ep_cmd, ss->ep_status, ss->ep_in, ss->ep_out);
+
+	ifnum = iface->desc.bInterfaceNumber;
+	if (usb_set_interface(dev, ifnum, alt))
+		return 0;
+
+	ss->uas_depth = CONFIG_USB_UAS_QUEUE_DEPTH;
+	if (dev->speed >= USB_SPEED_SUPER) {
+		/* SuperSpeed UAS requires streams, one per tag */
+		unsigned long pipes[] = {
+			usb_rcvbulkpipe(dev, ss->ep_status),
+			usb_rcvbulkpipe(dev, ss->ep_in),
+			usb_sndbulkpipe(dev, ss->ep_out),
+		};
+
+		/* One more stream for the task management IU of a reset */
+		ret = usb_alloc_streams(dev, pipes, ARRAY_SIZE(pipes),
+					ss->uas_depth + 1);
+		if (ret < 2) {
+			debug("UAS: cannot allocate streams (%d)\n", ret);
+			/* Go back to the BOT alternate setting */
+			usb_set_interface(dev, ifnum, 0);
+			return 0;
+		}
+		ss->uas_streams = ret;
+		ss->uas_depth = min(ss->uas_depth, ret - 1);
+	}
+
+	ss->subclass = US_SC_SCSI;
+	ss->protocol = US_PR_UAS;
+	ss->transport = usb_stor_UAS_transport;
+	ss->transport_reset = usb_stor_UAS_reset;
+
+	return 1;
+}
+#endif
+
 /* Probe to see if a new device is actually a Storage device */
 int usb_storage_probe(struct usb_device *dev, unsigned int ifnum,
 		      struct us_data *ss)
@@ -1320,6 +1801,18 @@ int usb_storage_probe(struct usb_device *dev, unsigned int ifnum,
 	ss->subclass = iface->desc.bInterfaceSubClass;
 	ss->protocol = iface->desc.bInterfaceProtocol;
 
+#ifdef CONFIG_USB_UAS
+	if (usb_stor_UAS_probe(dev, iface, ss)) {
+		debug("Transport: USB Attached SCSI\n");
+		usb_stor_set_max_xfer_blk(dev, ss);
+		dev->privptr = (void *)ss;
+		return 1;
+	}
+	/* Anything left over from a UAS alt we could not use */
+	ss->ep_in = 0;
+	ss->ep_out = 0;
+#endif
+
 	/* set the handler pointers based on the protocol */
 	debug("Transport: ");
 	switch (ss->protocol) {
@@ -98,7 +98,20 @@ static void ahci_dcache_invalidate_range(unsigned long begin, unsigned long len)
 static void ahci_dcache_flush_sata_cmd(struct ahci_ioports *pp)
 {
 	ahci_dcache_flush_range((unsigned long)pp->cmd_slot,
-				AHCI_PORT_PRIV_DMA_SZ);
+				AHCI_CMD_LIST_SZ + AHCI_RX_FIS_SZ +
+				pp->n_slots * AHCI_CMD_TBL_SZ);
+}
+
+/* Command table of a command slot, holding the FIS and the PRDT */
+static ulong ahci_cmd_tbl(struct ahci_ioports *pp, int slot)
+{
+	return pp->cmd_tbl + slot * AHCI_CMD_TBL_SZ;
+}
+
+/* Scatter-gather table (PRDT) in the command table of a command slot */
+static struct ahci_sg *ahci_cmd_tbl_sg(struct ahci_ioports *pp, int slot)
+{
+	return (struct ahci_sg *)(ahci_cmd_tbl(pp, slot) + AHCI_CMD_TBL_HDR);
 }
 
 static int waiting_for_cmd_completed(void __iomem *offset,
@@ -500,11 +513,11 @@ static int ahci_init_one(struct ahci_uc_priv *uc_priv, pci_dev_t dev)
 
 #define MAX_DATA_BYTE_COUNT  (4*1024*1024)
 
-static int ahci_fill_sg(struct ahci_uc_priv *uc_priv, u8 port,
+static int ahci_fill_sg(struct ahci_uc_priv *uc_priv, u8 port, int slot,
 			unsigned char *buf, int buf_len)
 {
 	struct ahci_ioports *pp = &(uc_priv->port[port]);
-	struct ahci_sg *ahci_sg = pp->cmd_tbl_sg;
+	struct ahci_sg *ahci_sg;
 	u32 sg_count;
 	int i;
 
@@ -514,6 +527,8 @@ static int ahci_fill_sg(struct ahci_uc_priv *uc_priv, u8 port,
 		return -1;
 	}
 
+	ahci_sg = ahci_cmd_tbl_sg(pp, slot);
+
 	for (i = 0; i < sg_count; i++) {
 		ahci_sg->addr =
 		    cpu_to_le32((unsigned long) buf + i * MAX_DATA_BYTE_COUNT);
@@ -530,14 +545,16 @@ static int ahci_fill_sg(struct ahci_uc_priv *uc_priv, u8 port,
 }
 
 
-static void ahci_fill_cmd_slot(struct ahci_ioports *pp, u32 opts)
+static void ahci_fill_cmd_slot(struct ahci_ioports *pp, int slot, u32 opts)
 {
-	pp->cmd_slot->opts = cpu_to_le32(opts);
-	pp->cmd_slot->status = 0;
-	pp->cmd_slot->tbl_addr = cpu_to_le32((u32)pp->cmd_tbl & 0xffffffff);
+	struct ahci_cmd_hdr *cmd_hdr = &pp->cmd_slot[slot];
+	ulong cmd_tbl = ahci_cmd_tbl(pp, slot);
+
+	cmd_hdr->opts = cpu_to_le32(opts);
+	cmd_hdr->status = 0;
+	cmd_hdr->tbl_addr = cpu_to_le32((u32)cmd_tbl & 0xffffffff);
 #ifdef CONFIG_PHYS_64BIT
-	pp->cmd_slot->tbl_addr_hi =
-	    cpu_to_le32((u32)(((pp->cmd_tbl) >> 16) >> 16));
+	cmd_hdr->tbl_addr_hi = cpu_to_le32((u32)(((cmd_tbl) >> 16) >> 16));
 #endif
 }
 
@@ -571,16 +588,24 @@ static int ahci_port_start(struct ahci_uc_priv *uc_priv, u8 port)
 		return -1;
 	}
 
-	mem = malloc(AHCI_PORT_PRIV_DMA_SZ + 2048);
+	/*
+	 * Each command slot gets its own command table when NCQ can keep
+	 * several commands in flight, otherwise only slot 0 is used.
+	 */
+	if (IS_ENABLED(CONFIG_SCSI_AHCI_NCQ) && (uc_priv->cap & HOST_CAP_NCQ))
+		pp->n_slots = ((uc_priv->cap >> 8) & 0x1f) + 1;
+	else
+		pp->n_slots = 1;
+
+	/* Aligned to 2048-bytes */
+	mem = memalign(2048, AHCI_CMD_LIST_SZ + AHCI_RX_FIS_SZ +
+		       pp->n_slots * AHCI_CMD_TBL_SZ);
 	if (!mem) {
-		free(pp);
 		printf("%s: No mem for table!\n", __func__);
 		return -ENOMEM;
 	}
-
-	/* Aligned to 2048-bytes */
-	mem = memalign(2048, AHCI_PORT_PRIV_DMA_SZ);
-	memset(mem, 0, AHCI_PORT_PRIV_DMA_SZ);
+	memset(mem, 0, AHCI_CMD_LIST_SZ + AHCI_RX_FIS_SZ +
+	       pp->n_slots * AHCI_CMD_TBL_SZ);
 
 	/*
 	 * First item in chunk of DMA memory: 32-slot command table,
@@ -589,7 +614,7 @@ static int ahci_port_start(struct ahci_uc_priv *uc_priv, u8 port)
 	pp->cmd_slot =
 		(struct ahci_cmd_hdr *)(uintptr_t)virt_to_phys((void *)mem);
 	debug("cmd_slot = %p\n", pp->cmd_slot);
-	mem += (AHCI_CMD_SLOT_SZ + 224);
+	mem += AHCI_CMD_LIST_SZ;
 
 	/*
 	 * Second item: Received-FIS area
@@ -598,15 +623,12 @@ static int ahci_port_start(struct ahci_uc_priv *uc_priv, u8 port)
 	mem += AHCI_RX_FIS_SZ;
 
 	/*
-	 * Third item: data area for storing a single command
-	 * and its scatter-gather table
+	 * Third item: data area for storing the command and scatter-gather
+	 * table of each slot
 	 */
 	pp->cmd_tbl = virt_to_phys((void *)mem);
 	debug("cmd_tbl_dma = %lx\n", pp->cmd_tbl);
-
-	mem += AHCI_CMD_TBL_HDR;
-	pp->cmd_tbl_sg =
-			(struct ahci_sg *)(uintptr_t)virt_to_phys((void *)mem);
+	pp->cmd_tbl_sg = ahci_cmd_tbl_sg(pp, 0);
 
 	writel_with_flush((unsigned long)pp->cmd_slot,
 			  port_mmio + PORT_LST_ADDR);
@@ -654,11 +676,11 @@ static int ahci_device_data_io(struct ahci_uc_priv *uc_priv, u8 port, u8 *fis,
 		return -1;
 	}
 
-	memcpy((unsigned char *)pp->cmd_tbl, fis, fis_len);
+	memcpy((unsigned char *)ahci_cmd_tbl(pp, 0), fis, fis_len);
 
-	sg_count = ahci_fill_sg(uc_priv, port, buf, buf_len);
+	sg_count = ahci_fill_sg(uc_priv, port, 0, buf, buf_len);
 	opts = (fis_len >> 2) | (sg_count << 16) | (is_write << 6);
-	ahci_fill_cmd_slot(pp, opts);
+	ahci_fill_cmd_slot(pp, 0, opts);
 
 	ahci_dcache_flush_sata_cmd(pp);
 	ahci_dcache_flush_range((unsigned long)buf, (unsigned long)buf_len);
@@ -679,6 +701,155 @@ static int ahci_device_data_io(struct ahci_uc_priv *uc_priv, u8 port, u8 *fis,
 }
 
 
+/*
+ * After a failed NCQ command the port stops processing its command list, and
+ * the drive aborts every command until the NCQ error log has been read. Get
+ * both going again so that the following commands can be issued.
+ */
+static void ahci_ncq_recover(struct ahci_uc_priv *uc_priv, u8 port)
+{
+	struct ahci_ioports *pp = &(uc_priv->port[port]);
+	void __iomem *port_mmio = pp->port_mmio;
+	ALLOC_CACHE_ALIGN_BUFFER(u8, log, ATA_SECT_SIZE);
+	u8 fis[20];
+	u32 tmp;
+
+	tmp = readl(port_mmio + PORT_CMD) & ~PORT_CMD_START;
+	writel_with_flush(tmp, port_mmio + PORT_CMD);
+	if (waiting_for_cmd_completed(port_mmio + PORT_CMD, 500,
+				      PORT_CMD_LIST_ON))
+		debug("%s: port %d command list still running\n", __func__,
+		      port);
+
+	writel(readl(port_mmio + PORT_SCR_ERR), port_mmio + PORT_SCR_ERR);
+	writel(readl(port_mmio + PORT_IRQ_STAT), port_mmio + PORT_IRQ_STAT);
+
+	if ((readl(port_mmio + PORT_TFDATA) & (ATA_BUSY | ATA_DRQ)) &&
+	    (uc_priv->cap & HOST_CAP_CLO)) {
+		writel_with_flush(tmp | PORT_CMD_CLO, port_mmio + PORT_CMD);
+		waiting_for_cmd_completed(port_mmio + PORT_CMD, 500,
+					  PORT_CMD_CLO);
+	}
+	writel_with_flush(tmp | PORT_CMD_START, port_mmio + PORT_CMD);
+
+	memset(fis, 0, sizeof(fis));
+	fis[0] = 0x27;		/* Host to device FIS. */
+	fis[1] = 1 << 7;	/* Command FIS. */
+	fis[2] = ATA_CMD_READ_LOG_EXT;
+	fis[4] = ATA_LOG_SATA_NCQ;
+	fis[12] = 1;		/* one sector */
+	if (ahci_device_data_io(uc_priv, port, fis, sizeof(fis), log,
+				ATA_SECT_SIZE, 0))
+		debug("%s: cannot read NCQ error log on port %d\n", __func__,
+		      port);
+	else
+		debug("%s: port %d tag %d failed, status %#x error %#x\n",
+		      __func__, port, log[0] & 0x1f, log[2], log[3]);
+}
+
+/**
+ * ahci_ncq_data_io() - Read or write blocks with queued commands
+ *
+ * The transfer is split into commands of up to MAX_SATA_BLOCKS_READ_WRITE
+ * blocks, each in its own command slot. As many of them as the drive's queue
+ * depth allows are issued together, then waited for, until all are done.
+ *
+ * @uc_priv:	Controller
+ * @port:	Port of the drive
+ * @lba:	First block
+ * @blocks:	Number of blocks
+ * @buf:	Data buffer
+ * @is_write:	1 to write, 0 to read
+ * @return 0 if OK, -EIO on error or timeout
+ */
+static int ahci_ncq_data_io(struct ahci_uc_priv *uc_priv, u8 port,
+			    lbaint_t lba, u32 blocks, u8 *buf, u8 is_write)
+{
+	struct ahci_ioports *pp = &(uc_priv->port[port]);
+	void __iomem *port_mmio = pp->port_mmio;
+	u8 *batch_buf;
+	u32 batch_len;
+	u32 tags;
+	u32 opts;
+	ulong start;
+	u8 *fis;
+	int sg_count;
+	int tag;
+
+	while (blocks) {
+		batch_buf = buf;
+		tags = 0;
+		for (tag = 0; tag < pp->ncq_depth && blocks; tag++) {
+			u32 now_blocks = min((u32)MAX_SATA_BLOCKS_READ_WRITE,
+					     blocks);
+
+			fis = (u8 *)ahci_cmd_tbl(pp, tag);
+			memset(fis, 0, 20);
+			fis[0] = 0x27;		/* Host to device FIS. */
+			fis[1] = 1 << 7;	/* Command FIS. */
+			fis[2] = is_write ? ATA_CMD_FPDMA_WRITE :
+					    ATA_CMD_FPDMA_READ;
+			/* Block count goes in the features register */
+			fis[3] = (now_blocks >> 0) & 0xff;
+			fis[11] = (now_blocks >> 8) & 0xff;
+			fis[4] = (lba >> 0) & 0xff;
+			fis[5] = (lba >> 8) & 0xff;
+			fis[6] = (lba >> 16) & 0xff;
+			/* device reg: set LBA mode, and FUA if wanted */
+			fis[7] = 1 << 6;
+			if (is_write && pp->fua)
+				fis[7] |= 1 << 7;
+			fis[8] = (lba >> 24) & 0xff;
+#ifdef CONFIG_SYS_64BIT_LBA
+			fis[9] = (lba >> 32) & 0xff;
+			fis[10] = (lba >> 40) & 0xff;
+#endif
+			fis[12] = tag << 3;	/* NCQ tag */
+
+			sg_count = ahci_fill_sg(uc_priv, port, tag, buf,
+						now_blocks * ATA_SECT_SIZE);
+			opts = 5 | (sg_count << 16) | (is_write << 6);
+			ahci_fill_cmd_slot(pp, tag, opts);
+
+			tags |= 1 << tag;
+			buf += now_blocks * ATA_SECT_SIZE;
+			blocks -= now_blocks;
+			lba += now_blocks;
+		}
+		batch_len = buf - batch_buf;
+
+		ahci_dcache_flush_sata_cmd(pp);
+		ahci_dcache_flush_range((unsigned long)batch_buf, batch_len);
+
+		writel(readl(port_mmio + PORT_IRQ_STAT),
+		       port_mmio + PORT_IRQ_STAT);
+		writel_with_flush(tags, port_mmio + PORT_SCR_ACT);
+		writel_with_flush(tags, port_mmio + PORT_CMD_ISSUE);
+
+		/* The drive clears the SActive bit of each finished command */
+		start = get_timer(0);
+		while (readl(port_mmio + PORT_SCR_ACT) & tags) {
+			if (readl(port_mmio + PORT_IRQ_STAT) & PORT_IRQ_FATAL) {
+				printf("NCQ %s error on port %d\n",
+				       is_write ? "write" : "read", port);
+				ahci_ncq_recover(uc_priv, port);
+				return -EIO;
+			}
+			if (get_timer(start) > WAIT_MS_DATAIO) {
+				printf("timeout exit!\n");
+				ahci_ncq_recover(uc_priv, port);
+				return -EIO;
+			}
+		}
+
+		ahci_dcache_invalidate_range((unsigned long)batch_buf,
+					     batch_len);
+	}
+
+	return 0;
+}
+
+
 static char *ata_id_strcpy(u16 *target, u16 *src, int len)
 {
 	int i;
@@ -703,6 +874,7 @@ static int ata_scsiop_inquiry(struct ahci_uc_priv *uc_priv,
 	u8 fis[20];
 	u16 *idbuf;
 	ALLOC_CACHE_ALIGN_BUFFER(u16, tmpid, ATA_ID_WORDS);
+	struct ahci_ioports *pp;
 	u8 port;
 
 	/* Clean ccb data buffer */
@@ -741,6 +913,17 @@ static int ata_scsiop_inquiry(struct ahci_uc_priv *uc_priv,
 	memcpy(idbuf, tmpid, ATA_ID_WORDS * 2);
 	ata_swap_buf_le16(idbuf, ATA_ID_WORDS);
 
+	pp = &uc_priv->port[port];
+	if (IS_ENABLED(CONFIG_SCSI_AHCI_NCQ) && (uc_priv->cap & HOST_CAP_NCQ) &&
+	    ata_id_has_ncq(idbuf)) {
+		pp->ncq_depth = min(ata_id_queue_depth(idbuf), pp->n_slots);
+		pp->fua = IS_ENABLED(CONFIG_SCSI_AHCI_FUA) &&
+			  ata_id_has_fua(idbuf);
+	} else {
+		pp->ncq_depth = 0;
+		pp->fua = false;
+	}
+
 	memcpy(&pccb->pdata[8], "ATA     ", 8);
 	ata_id_strcpy((u16 *)&pccb->pdata[16], &idbuf[ATA_ID_PROD], 16);
 	ata_id_strcpy((u16 *)&pccb->pdata[32], &idbuf[ATA_ID_FW_REV], 4);
@@ -793,6 +976,25 @@ static int ata_scsiop_read_write(struct ahci_uc_priv *uc_priv,
 	debug("scsi_ahci: %s %u blocks starting from lba 0x" LBAFU "\n",
 	      is_write ?  "write" : "read", blocks, lba);
 
+	if (uc_priv->port[pccb->target].ncq_depth) {
+		if (ATA_SECT_SIZE * blocks > user_buffer_size) {
+			printf("scsi_ahci: Error: buffer too small.\n");
+			return -EIO;
+		}
+		if (ahci_ncq_data_io(uc_priv, pccb->target, lba, blocks,
+				     user_buffer, is_write)) {
+			debug("scsi_ahci: SCSI %s10 command failure.\n",
+			      is_write ? "WRITE" : "READ");
+			return -EIO;
+		}
+
+		/* One flush for the whole request, unless FUA made it moot */
+		if (is_write && !uc_priv->port[pccb->target].fua)
+			return ata_io_flush(uc_priv, pccb->target);
+
+		return 0;
+	}
+
 	/* Preset the FIS */
 	memset(fis, 0, sizeof(fis));
 	fis[0] = 0x27;		 /* Host to device FIS. */
@@ -1124,8 +1326,8 @@ static int ata_io_flush(struct ahci_uc_priv *uc_priv, u8 port)
 	fis[1] = 1 << 7;	 /* Command FIS. */
 	fis[2] = ATA_CMD_FLUSH_EXT;
 
-	memcpy((unsigned char *)pp->cmd_tbl, fis, 20);
-	ahci_fill_cmd_slot(pp, cmd_fis_len);
+	memcpy((unsigned char *)ahci_cmd_tbl(pp, 0), fis, 20);
+	ahci_fill_cmd_slot(pp, 0, cmd_fis_len);
 	ahci_dcache_flush_sata_cmd(pp);
 	writel_with_flush(1, port_mmio + PORT_CMD_ISSUE);
 
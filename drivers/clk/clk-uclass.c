@@ -13,12 +13,118 @@
 #include <dm/read.h>
 #include <dt-structs.h>
 #include <errno.h>
+#include <malloc.h>
+#include <linux/err.h>
+
+DECLARE_GLOBAL_DATA_PTR;
 
 static inline const struct clk_ops *clk_dev_ops(struct udevice *dev)
 {
 	return (const struct clk_ops *)dev->driver->ops;
 }
 
+#if CONFIG_IS_ENABLED(CLK_RATE_CACHE)
+/**
+ * struct clk_rate - The cached rate of a clock
+ *
+ * @id:		Clock ID within the provider
+ * @data:	Clock data, as set up by of_xlate
+ * @rate:	Rate in Hz
+ */
+struct clk_rate {
+	unsigned long id;
+	unsigned long data;
+	ulong rate;
+};
+
+/**
+ * struct clk_uc_priv - Information the uclass keeps for each clock provider
+ *
+ * @rates:	Cached rates
+ * @count:	Number of valid entries in @rates
+ * @size:	Number of entries allocated in @rates
+ */
+struct clk_uc_priv {
+	struct clk_rate *rates;
+	int count;
+	int size;
+};
+
+static bool clk_find_rate(struct clk *clk, ulong *ratep)
+{
+	struct clk_uc_priv *priv = dev_get_uclass_priv(clk->dev);
+	int i;
+
+	if (!priv)
+		return false;
+	for (i = 0; i < priv->count; i++) {
+		struct clk_rate *entry = &priv->rates[i];
+
+		if (entry->id == clk->id && entry->data == clk->data) {
+			*ratep = entry->rate;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+static void clk_cache_rate(struct clk *clk, ulong rate)
+{
+	struct clk_uc_priv *priv = dev_get_uclass_priv(clk->dev);
+	struct clk_rate *entry;
+
+	/* Keep the small pre-relocation malloc() area for devices */
+	if (!priv || !(gd->flags & GD_FLG_RELOC))
+		return;
+	if (priv->count == priv->size) {
+		entry = realloc(priv->rates,
+				(priv->size + 4) * sizeof(*priv->rates));
+		if (!entry)
+			return;
+		priv->rates = entry;
+		priv->size += 4;
+	}
+	entry = &priv->rates[priv->count++];
+	entry->id = clk->id;
+	entry->data = clk->data;
+	entry->rate = rate;
+}
+
+void clk_invalidate_rates(void)
+{
+	struct udevice *dev;
+	struct uclass *uc;
+
+	if (uclass_get(UCLASS_CLK, &uc))
+		return;
+	uclass_foreach_dev(dev, uc) {
+		struct clk_uc_priv *priv = dev_get_uclass_priv(dev);
+
+		if (priv)
+			priv->count = 0;
+	}
+}
+
+static int clk_uclass_pre_remove(struct udevice *dev)
+{
+	struct clk_uc_priv *priv = dev_get_uclass_priv(dev);
+
+	free(priv->rates);
+
+	return 0;
+}
+#else
+static inline bool clk_find_rate(struct clk *clk, ulong *ratep)
+{
+	return false;
+}
+
+static inline void clk_cache_rate(struct clk *clk, ulong rate)
+{
+}
+#endif
+
 #if CONFIG_IS_ENABLED(OF_CONTROL)
 # if CONFIG_IS_ENABLED(OF_PLATDATA)
 int clk_get_by_index_platdata(struct udevice *dev, int index,
@@ -327,49 +433,69 @@ int clk_free(struct clk *clk)
 ulong clk_get_rate(struct clk *clk)
 {
 	const struct clk_ops *ops = clk_dev_ops(clk->dev);
+	ulong rate;
 
 	debug("%s(clk=%p)\n", __func__, clk);
 
 	if (!ops->get_rate)
 		return -ENOSYS;
 
-	return ops->get_rate(clk);
+	if (clk_find_rate(clk, &rate))
+		return rate;
+	rate = ops->get_rate(clk);
+	if (!IS_ERR_VALUE(rate))
+		clk_cache_rate(clk, rate);
+
+	return rate;
 }
 
 ulong clk_set_rate(struct clk *clk, ulong rate)
 {
 	const struct clk_ops *ops = clk_dev_ops(clk->dev);
+	ulong ret;
 
 	debug("%s(clk=%p, rate=%lu)\n", __func__, clk, rate);
 
 	if (!ops->set_rate)
 		return -ENOSYS;
 
-	return ops->set_rate(clk, rate);
+	ret = ops->set_rate(clk, rate);
+	/* The driver may have read rates, now stale, while making the change */
+	clk_invalidate_rates();
+
+	return ret;
 }
 
 int clk_set_parent(struct clk *clk, struct clk *parent)
 {
 	const struct clk_ops *ops = clk_dev_ops(clk->dev);
+	int ret;
 
 	debug("%s(clk=%p, parent=%p)\n", __func__, clk, parent);
 
 	if (!ops->set_parent)
 		return -ENOSYS;
 
-	return ops->set_parent(clk, parent);
+	ret = ops->set_parent(clk, parent);
+	clk_invalidate_rates();
+
+	return ret;
 }
 
 int clk_enable(struct clk *clk)
 {
 	const struct clk_ops *ops = clk_dev_ops(clk->dev);
+	int ret;
 
 	debug("%s(clk=%p)\n", __func__, clk);
 
 	if (!ops->enable)
 		return -ENOSYS;
 
-	return ops->enable(clk);
+	ret = ops->enable(clk);
+	clk_invalidate_rates();
+
+	return ret;
 }
 
 int clk_enable_bulk(struct clk_bulk *bulk)
@@ -388,13 +514,17 @@ int clk_enable_bulk(struct clk_bulk *bulk)
 int clk_disable(struct clk *clk)
 {
 	const struct clk_ops *ops = clk_dev_ops(clk->dev);
+	int ret;
 
 	debug("%s(clk=%p)\n", __func__, clk);
 
 	if (!ops->disable)
 		return -ENOSYS;
 
-	return ops->disable(clk);
+	ret = ops->disable(clk);
+	clk_invalidate_rates();
+
+	return ret;
 }
 
 int clk_disable_bulk(struct clk_bulk *bulk)
@@ -413,4 +543,8 @@ int clk_disable_bulk(struct clk_bulk *bulk)
 UCLASS_DRIVER(clk) = {
 	.id		= UCLASS_CLK,
 	.name		= "clk",
+#if CONFIG_IS_ENABLED(CLK_RATE_CACHE)
+	.pre_remove	= clk_uclass_pre_remove,
+	.per_device_auto_alloc_size = sizeof(struct clk_uc_priv),
+#endif
 };
@@ -12,6 +12,7 @@
 struct sandbox_clk_priv {
 	ulong rate[SANDBOX_CLK_ID_COUNT];
 	bool enabled[SANDBOX_CLK_ID_COUNT];
+	int get_rate_count;
 };
 
 static ulong sandbox_clk_get_rate(struct clk *clk)
@@ -20,6 +21,7 @@ static ulong sandbox_clk_get_rate(struct clk *clk)
 
 	if (clk->id >= SANDBOX_CLK_ID_COUNT)
 		return -EINVAL;
+	priv->get_rate_count++;
 
 	return priv->rate[clk->id];
 }
@@ -35,7 +37,8 @@ static ulong sandbox_clk_set_rate(struct clk *clk, ulong rate)
 	if (!rate)
 		return -EINVAL;
 
-	old_rate = priv->rate[clk->id];
+	/* Go through the uclass, as drivers working out dividers often do */
+	old_rate = clk_get_rate(clk);
 	priv->rate[clk->id] = rate;
 
 	return old_rate;
@@ -95,6 +98,13 @@ ulong sandbox_clk_query_rate(struct udevice *dev, int id)
 	return priv->rate[id];
 }
 
+int sandbox_clk_query_get_rate_count(struct udevice *dev)
+{
+	struct sandbox_clk_priv *priv = dev_get_priv(dev);
+
+	return priv->get_rate_count;
+}
+
 int sandbox_clk_query_enable(struct udevice *dev, int id)
 {
 	struct sandbox_clk_priv *priv = dev_get_priv(dev);
@@ -106,7 +106,14 @@ int device_unbind(struct udevice *dev)
 
 	if (dev->flags & DM_FLAG_NAME_ALLOCED)
 		free((char *)dev->name);
-	free(dev);
+#if CONFIG_IS_ENABLED(DM_TIMING)
+	free(dev->timing);
+#endif
+	/* A device instantiated at build time can be bound again later */
+	if (dev->flags & DM_FLAG_INST)
+		dev->flags &= ~DM_FLAG_BOUND;
+	else
+		free(dev);
 
 	return 0;
 }
@@ -154,6 +161,7 @@ static bool flags_remove(uint flags, uint drv_flags)
 
 int device_remove(struct udevice *dev, uint flags)
 {
+	struct dm_timing_mark mark;
 	const struct driver *drv;
 	int ret;
 
@@ -165,10 +173,13 @@ int device_remove(struct udevice *dev, uint flags)
 
 	drv = dev->driver;
 	assert(drv);
+	dm_timing_start(&mark);
 
 	ret = uclass_pre_remove_device(dev);
-	if (ret)
+	if (ret) {
+		dm_timing_end(dev, DM_TIMING_REMOVE, &mark);
 		return ret;
+	}
 
 	ret = device_chld_remove(dev, NULL, flags);
 	if (ret)
@@ -198,6 +209,7 @@ int device_remove(struct udevice *dev, uint flags)
 		dev->seq = -1;
 		dev->flags &= ~DM_FLAG_ACTIVATED;
 	}
+	dm_timing_end(dev, DM_TIMING_REMOVE, &mark);
 
 	return ret;
 
@@ -211,6 +223,7 @@ err:
 		dm_warn("%s: Device '%s' failed to post_probe on error path\n",
 			__func__, dev->name);
 	}
+	dm_timing_end(dev, DM_TIMING_REMOVE, &mark);
 
 	return ret;
 }
@@ -14,6 +14,7 @@
 #include <fdtdec.h>
 #include <fdt_support.h>
 #include <malloc.h>
+#include <thread.h>
 #include <dm/device.h>
 #include <dm/device-internal.h>
 #include <dm/lists.h>
@@ -33,8 +34,10 @@ DECLARE_GLOBAL_DATA_PTR;
 static int device_bind_common(struct udevice *parent, const struct driver *drv,
 			      const char *name, void *platdata,
 			      ulong driver_data, ofnode node,
-			      uint of_platdata_size, struct udevice **devp)
+			      uint of_platdata_size, struct udevice *inst,
+			      struct udevice **devp)
 {
+	struct dm_timing_mark mark;
 	struct udevice *dev;
 	struct uclass *uc;
 	int size, ret = 0;
@@ -44,15 +47,24 @@ static int device_bind_common(struct udevice *parent, const struct driver *drv,
 	if (!name)
 		return -EINVAL;
 
-	ret = uclass_get(drv->id, &uc);
+	/* Binding a device must not bind deferred nodes of its uclass too */
+	ret = uclass_find_or_add(drv->id, &uc);
 	if (ret) {
 		debug("Missing uclass for driver %s\n", drv->name);
 		return ret;
 	}
 
-	dev = calloc(1, sizeof(struct udevice));
-	if (!dev)
-		return -ENOMEM;
+	if (inst) {
+		/* Storage was provided at build time, so it is never freed */
+		dev = inst;
+		memset(dev, '\0', sizeof(*dev));
+		dev->flags = DM_FLAG_INST;
+	} else {
+		dev = calloc(1, sizeof(struct udevice));
+		if (!dev)
+			return -ENOMEM;
+	}
+	dm_timing_start(&mark);
 
 	INIT_LIST_HEAD(&dev->sibling_node);
 	INIT_LIST_HEAD(&dev->child_head);
@@ -168,6 +180,7 @@ static int device_bind_common(struct udevice *parent, const struct driver *drv,
 		*devp = dev;
 
 	dev->flags |= DM_FLAG_BOUND;
+	dm_timing_end(dev, DM_TIMING_BIND, &mark);
 
 	return 0;
 
@@ -208,8 +221,10 @@ fail_alloc2:
 	}
 fail_alloc1:
 	devres_release_all(dev);
+	dm_timing_end(NULL, DM_TIMING_BIND, &mark);
 
-	free(dev);
+	if (!inst)
+		free(dev);
 
 	return ret;
 }
@@ -220,7 +235,7 @@ int device_bind_with_driver_data(struct udevice *parent,
 				 struct udevice **devp)
 {
 	return device_bind_common(parent, drv, name, NULL, driver_data, node,
-				  0, devp);
+				  0, NULL, devp);
 }
 
 int device_bind(struct udevice *parent, const struct driver *drv,
@@ -228,7 +243,7 @@ int device_bind(struct udevice *parent, const struct driver *drv,
 		struct udevice **devp)
 {
 	return device_bind_common(parent, drv, name, platdata, 0,
-				  offset_to_ofnode(of_offset), 0, devp);
+				  offset_to_ofnode(of_offset), 0, NULL, devp);
 }
 
 int device_bind_ofnode(struct udevice *parent, const struct driver *drv,
@@ -236,14 +251,16 @@ int device_bind_ofnode(struct udevice *parent, const struct driver *drv,
 		       struct udevice **devp)
 {
 	return device_bind_common(parent, drv, name, platdata, 0, node, 0,
-				  devp);
+				  NULL, devp);
 }
 
 int device_bind_by_name(struct udevice *parent, bool pre_reloc_only,
 			const struct driver_info *info, struct udevice **devp)
 {
+	struct udevice *inst = NULL;
 	struct driver *drv;
 	uint platdata_size = 0;
+	int ret;
 
 	drv = lists_driver_lookup_name(info->name);
 	if (!drv)
@@ -254,9 +271,20 @@ int device_bind_by_name(struct udevice *parent, bool pre_reloc_only,
 #if CONFIG_IS_ENABLED(OF_PLATDATA)
 	platdata_size = info->platdata_size;
 #endif
-	return device_bind_common(parent, drv, info->name,
+#if CONFIG_IS_ENABLED(OF_PLATDATA_INST)
+	/* Before relocation the storage is read-only, so allocate as usual */
+	if (gd->flags & GD_FLG_RELOC)
+		inst = info->dev;
+#endif
+	ret = device_bind_common(parent, drv, info->name,
 			(void *)info->platdata, 0, ofnode_null(), platdata_size,
-			devp);
+			inst, devp);
+#if CONFIG_IS_ENABLED(OF_PLATDATA_INST)
+	if (!ret && inst)
+		inst->req_seq = info->req_seq;
+#endif
+
+	return ret;
 }
 
 static void *alloc_priv(int size, uint flags)
@@ -305,6 +333,7 @@ static void *alloc_priv(int size, uint flags)
 
 int device_probe(struct udevice *dev)
 {
+	struct dm_timing_mark mark;
 	struct power_domain pd;
 	const struct driver *drv;
 	int size = 0;
@@ -314,11 +343,16 @@ int device_probe(struct udevice *dev)
 	if (!dev)
 		return -EINVAL;
 
-	if (dev->flags & DM_FLAG_ACTIVATED)
+	/* Wait if another thread is probing this device */
+	thread_probe_start(dev);
+	if (dev->flags & DM_FLAG_ACTIVATED) {
+		thread_probe_end(dev);
 		return 0;
+	}
 
 	drv = dev->driver;
 	assert(drv);
+	dm_timing_start(&mark);
 
 	/* Allocate private data if requested and not reentered */
 	if (drv->priv_auto_alloc_size && !dev->priv) {
@@ -364,16 +398,22 @@ int device_probe(struct udevice *dev)
 		 * (e.g. PCI bridge devices). Test the flags again
 		 * so that we don't mess up the device.
 		 */
-		if (dev->flags & DM_FLAG_ACTIVATED)
+		if (dev->flags & DM_FLAG_ACTIVATED) {
+			dm_timing_end(NULL, DM_TIMING_PROBE, &mark);
+			thread_probe_end(dev);
 			return 0;
+		}
 	}
 
-	seq = uclass_resolve_seq(dev);
-	if (seq < 0) {
-		ret = seq;
-		goto fail;
+	/* dm_probe_async() works out the sequence number in advance */
+	if (dev->seq == -1) {
+		seq = uclass_resolve_seq(dev);
+		if (seq < 0) {
+			ret = seq;
+			goto fail;
+		}
+		dev->seq = seq;
 	}
-	dev->seq = seq;
 
 	dev->flags |= DM_FLAG_ACTIVATED;
 
@@ -426,6 +466,8 @@ int device_probe(struct udevice *dev)
 
 	if (dev->parent && device_get_uclass_id(dev) == UCLASS_PINCTRL)
 		pinctrl_select_state(dev, "default");
+	dm_timing_end(dev, DM_TIMING_PROBE, &mark);
+	thread_probe_end(dev);
 
 	return 0;
 fail_uclass:
@@ -438,6 +480,8 @@ fail:
 
 	dev->seq = -1;
 	device_free(dev);
+	dm_timing_end(dev, DM_TIMING_PROBE, &mark);
+	thread_probe_end(dev);
 
 	return ret;
 }
@@ -641,6 +685,9 @@ static struct udevice *_device_find_global_by_ofnode(struct udevice *parent,
 
 int device_find_global_by_ofnode(ofnode ofnode, struct udevice **devp)
 {
+	/* This does not go through uclass_get(), so bind the node here */
+	if (CONFIG_IS_ENABLED(DM_DEFERRED_BIND))
+		lists_bind_deferred_node(ofnode);
 	*devp = _device_find_global_by_ofnode(gd->dm_root, ofnode);
 
 	return *devp ? 0 : -ENOENT;
@@ -650,6 +697,8 @@ int device_get_global_by_ofnode(ofnode ofnode, struct udevice **devp)
 {
 	struct udevice *dev;
 
+	if (CONFIG_IS_ENABLED(DM_DEFERRED_BIND))
+		lists_bind_deferred_node(ofnode);
 	dev = _device_find_global_by_ofnode(gd->dm_root, ofnode);
 	return device_get_device_tail(dev, dev ? 0 : -ENOENT, devp);
 }
@@ -8,6 +8,7 @@
 
 #include <common.h>
 #include <errno.h>
+#include <malloc.h>
 #include <dm/device.h>
 #include <dm/device-internal.h>
 #include <dm/lists.h>
@@ -16,6 +17,9 @@
 #include <dm/util.h>
 #include <fdtdec.h>
 #include <linux/compiler.h>
+#include <linux/log2.h>
+
+DECLARE_GLOBAL_DATA_PTR;
 
 struct driver *lists_driver_lookup_name(const char *name)
 {
@@ -48,6 +52,46 @@ struct uclass_driver *lists_uclass_lookup(enum uclass_id id)
 	return NULL;
 }
 
+#if CONFIG_IS_ENABLED(OF_PLATDATA_INST)
+/**
+ * bind_inst() - Bind a device instantiated at build time
+ *
+ * The device's parent is bound first, if needed, so that the tree built by
+ * dtoc is reproduced. Devices without a parent are children of @root. A
+ * device whose parent cannot be bound is not bound either, since its parent
+ * may be what sets up its per-child data. A device which fails to bind is not
+ * tried again, so a failing parent is tried once rather than once per child.
+ *
+ * @root:		Device to use as the parent of top-level devices
+ * @pre_reloc_only:	Only bind drivers with DM_FLAG_PRE_RELOC set
+ * @info:		Device to bind
+ * @return 0 if OK (or already bound), -ve on error
+ */
+static int bind_inst(struct udevice *root, bool pre_reloc_only,
+		     const struct driver_info *info)
+{
+	struct udevice *parent = root;
+	int ret;
+
+	if (info->dev->flags & DM_FLAG_BOUND)
+		return 0;
+	if (info->dev->flags & DM_FLAG_INST_FAILED)
+		return -ENOENT;
+	if (info->parent) {
+		ret = bind_inst(root, pre_reloc_only, info->parent);
+		if (ret)
+			return ret;
+		parent = info->parent->dev;
+	}
+
+	ret = device_bind_by_name(parent, pre_reloc_only, info, NULL);
+	if (ret && ret != -EPERM)
+		info->dev->flags |= DM_FLAG_INST_FAILED;
+
+	return ret;
+}
+#endif
+
 int lists_bind_drivers(struct udevice *parent, bool pre_reloc_only)
 {
 	struct driver_info *info =
@@ -59,7 +103,13 @@ int lists_bind_drivers(struct udevice *parent, bool pre_reloc_only)
 	int ret;
 
 	for (entry = info; entry != info + n_ents; entry++) {
-		ret = device_bind_by_name(parent, pre_reloc_only, entry, &dev);
+#if CONFIG_IS_ENABLED(OF_PLATDATA_INST)
+		if (entry->dev && (gd->flags & GD_FLG_RELOC))
+			ret = bind_inst(parent, pre_reloc_only, entry);
+		else
+#endif
+			ret = device_bind_by_name(parent, pre_reloc_only, entry,
+						  &dev);
 		if (ret && ret != -EPERM) {
 			dm_warn("No match for driver '%s'\n", entry->name);
 			if (!result || ret != -ENOENT)
@@ -122,11 +172,350 @@ static int driver_check_compatible(const struct udevice_id *of_match,
 	return -ENOENT;
 }
 
-int lists_bind_fdt(struct udevice *parent, ofnode node, struct udevice **devp,
-		   bool pre_reloc_only)
+/**
+ * struct compat_slot - entry in the compatible-string hash table
+ *
+ * @of_id:	Match entry holding the compatible string, NULL if slot is free
+ * @drv:	Driver the match entry belongs to
+ */
+struct compat_slot {
+	const struct udevice_id *of_id;
+	struct driver *drv;
+};
+
+/*
+ * Hash table of the compatible strings of all drivers, with a power-of-two
+ * number of slots and linear probing. It is built on the first bind after
+ * relocation, since it is too big for the pre-relocation malloc() area, and
+ * BSS cannot be used before relocation anyway.
+ */
+static struct compat_slot *compat_table;
+static uint compat_mask;
+
+static uint compat_hash(const char *compat)
+{
+	uint hash = 2166136261U;	/* FNV-1a */
+
+	while (*compat) {
+		hash ^= (u8)*compat++;
+		hash *= 16777619;
+	}
+
+	return hash;
+}
+
+static void compat_table_build(void)
+{
+	struct driver *driver = ll_entry_start(struct driver, driver);
+	const int n_ents = ll_entry_count(struct driver, driver);
+	const struct udevice_id *of_id;
+	struct driver *entry;
+	uint count = 0;
+	uint slot;
+
+	for (entry = driver; entry != driver + n_ents; entry++) {
+		for (of_id = entry->of_match; of_id && of_id->compatible;
+		     of_id++)
+			count++;
+	}
+
+	/* Keep the table at most half full */
+	compat_mask = roundup_pow_of_two(count * 2 + 1) - 1;
+	compat_table = calloc(compat_mask + 1, sizeof(*compat_table));
+	if (!compat_table)
+		return;
+
+	/*
+	 * Only the first driver with a compatible string goes in the table,
+	 * which is the one a linear search of the drivers finds.
+	 */
+	for (entry = driver; entry != driver + n_ents; entry++) {
+		for (of_id = entry->of_match; of_id && of_id->compatible;
+		     of_id++) {
+			slot = compat_hash(of_id->compatible) & compat_mask;
+			while (compat_table[slot].of_id &&
+			       strcmp(compat_table[slot].of_id->compatible,
+				      of_id->compatible))
+				slot = (slot + 1) & compat_mask;
+			if (compat_table[slot].of_id)
+				continue;
+			compat_table[slot].of_id = of_id;
+			compat_table[slot].drv = entry;
+		}
+	}
+	debug("%s: %u compatible strings, %u slots\n", __func__, count,
+	      compat_mask + 1);
+}
+
+static struct driver *compat_table_find(const char *compat,
+					const struct udevice_id **of_idp)
+{
+	uint slot;
+
+	for (slot = compat_hash(compat) & compat_mask;
+	     compat_table[slot].of_id;
+	     slot = (slot + 1) & compat_mask) {
+		if (!strcmp(compat_table[slot].of_id->compatible, compat)) {
+			*of_idp = compat_table[slot].of_id;
+			return compat_table[slot].drv;
+		}
+	}
+
+	return NULL;
+}
+
+struct driver *lists_driver_lookup_compat(const char *compat,
+					  const struct udevice_id **of_idp)
 {
 	struct driver *driver = ll_entry_start(struct driver, driver);
 	const int n_ents = ll_entry_count(struct driver, driver);
+	struct driver *entry;
+
+	if (gd->flags & GD_FLG_RELOC) {
+		if (!compat_table)
+			compat_table_build();
+		if (compat_table)
+			return compat_table_find(compat, of_idp);
+	}
+
+	for (entry = driver; entry != driver + n_ents; entry++) {
+		if (!driver_check_compatible(entry->of_match, of_idp, compat))
+			return entry;
+	}
+
+	return NULL;
+}
+
+/* Number of words in a bitmap of uclass IDs */
+#define DEFERRED_ID_WORDS	DIV_ROUND_UP(UCLASS_COUNT, 32)
+
+/**
+ * struct deferred_bind - device tree node waiting to be bound
+ *
+ * @sibling_node:	Node in the list of deferred nodes
+ * @parent:		Parent device to bind the node to
+ * @node:		Device tree node
+ * @ids:		Bitmap of the uclasses of the drivers for the node and
+ *			its enabled subnodes, i.e. the uclasses which binding
+ *			the node may add devices to
+ */
+struct deferred_bind {
+	struct list_head sibling_node;
+	struct udevice *parent;
+	ofnode node;
+	u32 ids[DEFERRED_ID_WORDS];
+};
+
+/* Nodes noted by lists_defer_bind_fdt(), only used after relocation */
+static LIST_HEAD(deferred_binds);
+
+/* Uclasses of all the nodes in deferred_binds, so others need no search */
+static u32 deferred_ids[DEFERRED_ID_WORDS];
+
+/*
+ * Uclasses with a driver which is bound by name, by another driver, rather
+ * than from the device tree, such as block devices or PMIC regulators. These
+ * may have devices under any node.
+ */
+static u32 deferred_code_ids[DEFERRED_ID_WORDS];
+static bool deferred_code_ids_valid;
+
+static bool deferred_has_id(const u32 *ids, enum uclass_id id)
+{
+	return ids[id / 32] & BIT(id % 32);
+}
+
+static void deferred_set_id(u32 *ids, enum uclass_id id)
+{
+	ids[id / 32] |= BIT(id % 32);
+}
+
+static void deferred_find_code_ids(void)
+{
+	struct driver *driver = ll_entry_start(struct driver, driver);
+	const int n_ents = ll_entry_count(struct driver, driver);
+	struct driver *entry;
+
+	for (entry = driver; entry != driver + n_ents; entry++) {
+		if (!entry->of_match && entry->id >= 0 &&
+		    entry->id < UCLASS_COUNT)
+			deferred_set_id(deferred_code_ids, entry->id);
+	}
+	deferred_code_ids_valid = true;
+}
+
+/* Work out deferred_ids again, after nodes are taken off the list */
+static void deferred_update_ids(void)
+{
+	struct deferred_bind *entry;
+	int i;
+
+	memset(deferred_ids, '\0', sizeof(deferred_ids));
+	list_for_each_entry(entry, &deferred_binds, sibling_node) {
+		for (i = 0; i < DEFERRED_ID_WORDS; i++)
+			deferred_ids[i] |= entry->ids[i];
+	}
+}
+
+/* Find the driver which lists_bind_fdt() would most likely bind a node to */
+static struct driver *deferred_find_driver(ofnode node)
+{
+	const char *compat_list, *compat;
+	const struct udevice_id *of_id;
+	struct driver *drv = NULL;
+	int compat_length, i;
+
+	compat_list = ofnode_get_property(node, "compatible", &compat_length);
+	if (!compat_list)
+		return NULL;
+
+	/*
+	 * If this driver refuses to bind, lists_bind_fdt() moves on to the
+	 * next compatible string. That is rare enough not to worry about here.
+	 */
+	for (i = 0; i < compat_length && !drv; i += strlen(compat) + 1) {
+		compat = compat_list + i;
+		drv = lists_driver_lookup_compat(compat, &of_id);
+	}
+
+	return drv;
+}
+
+/*
+ * Note the uclasses of the drivers for the enabled subnodes of @node, all the
+ * way down, since they are bound along with it if their parent's driver scans
+ * its subnodes
+ */
+static void deferred_note_subnodes(struct deferred_bind *entry, ofnode node)
+{
+	struct driver *drv;
+	ofnode subnode;
+
+	ofnode_for_each_subnode(subnode, node) {
+		if (!ofnode_is_available(subnode))
+			continue;
+		drv = deferred_find_driver(subnode);
+		if (drv)
+			deferred_set_id(entry->ids, drv->id);
+		deferred_note_subnodes(entry, subnode);
+	}
+}
+
+int lists_defer_bind_fdt(struct udevice *parent, ofnode node)
+{
+	struct deferred_bind *entry;
+	struct driver *drv;
+	int i;
+
+	if (!ofnode_get_property(node, "compatible", NULL))
+		return lists_bind_fdt(parent, node, NULL, false);
+
+	drv = deferred_find_driver(node);
+	if (!drv) {
+		pr_debug("No match for node '%s'\n", ofnode_get_name(node));
+		return 0;
+	}
+
+	if (!deferred_code_ids_valid)
+		deferred_find_code_ids();
+	entry = calloc(1, sizeof(*entry));
+	if (!entry)
+		return -ENOMEM;
+	entry->parent = parent;
+	entry->node = node;
+	deferred_set_id(entry->ids, drv->id);
+	deferred_note_subnodes(entry, node);
+	list_add_tail(&entry->sibling_node, &deferred_binds);
+	for (i = 0; i < DEFERRED_ID_WORDS; i++)
+		deferred_ids[i] |= entry->ids[i];
+	pr_debug("   - deferred binding '%s'\n", ofnode_get_name(node));
+
+	return 0;
+}
+
+/* Bind the nodes on @binds, which are already off the deferred list */
+static int deferred_bind_list(struct list_head *binds)
+{
+	struct deferred_bind *entry, *next;
+	int ret = 0;
+	int err;
+
+	list_for_each_entry_safe(entry, next, binds, sibling_node) {
+		err = lists_bind_fdt(entry->parent, entry->node, NULL, false);
+		if (err && !ret)
+			ret = err;
+		list_del(&entry->sibling_node);
+		free(entry);
+	}
+
+	return ret;
+}
+
+int lists_bind_deferred(enum uclass_id id)
+{
+	struct deferred_bind *entry, *next;
+	LIST_HEAD(binds);
+
+	/* This is called by every uclass_get(), so be quick if nothing to do */
+	if (list_empty(&deferred_binds) ||
+	    (id != UCLASS_INVALID && (id < 0 || id >= UCLASS_COUNT)))
+		return 0;
+	if (id != UCLASS_INVALID && !deferred_has_id(deferred_ids, id)) {
+		if (!deferred_has_id(deferred_code_ids, id))
+			return 0;
+		id = UCLASS_INVALID;
+	}
+
+	/*
+	 * Take the nodes off the list first, since binding them looks up their
+	 * uclass, which comes back here
+	 */
+	list_for_each_entry_safe(entry, next, &deferred_binds, sibling_node) {
+		if (id == UCLASS_INVALID || deferred_has_id(entry->ids, id))
+			list_move_tail(&entry->sibling_node, &binds);
+	}
+	deferred_update_ids();
+
+	return deferred_bind_list(&binds);
+}
+
+int lists_bind_deferred_node(ofnode node)
+{
+	struct deferred_bind *entry;
+	LIST_HEAD(binds);
+
+	if (list_empty(&deferred_binds))
+		return 0;
+
+	/* Deferred nodes are near the top, so look from @node upwards */
+	for (; ofnode_valid(node); node = ofnode_get_parent(node)) {
+		list_for_each_entry(entry, &deferred_binds, sibling_node) {
+			if (ofnode_equal(entry->node, node)) {
+				list_move_tail(&entry->sibling_node, &binds);
+				deferred_update_ids();
+
+				return deferred_bind_list(&binds);
+			}
+		}
+	}
+
+	return 0;
+}
+
+void lists_drop_deferred(void)
+{
+	struct deferred_bind *entry, *next;
+
+	list_for_each_entry_safe(entry, next, &deferred_binds, sibling_node) {
+		list_del(&entry->sibling_node);
+		free(entry);
+	}
+	memset(deferred_ids, '\0', sizeof(deferred_ids));
+}
+
+int lists_bind_fdt(struct udevice *parent, ofnode node, struct udevice **devp,
+		   bool pre_reloc_only)
+{
 	const struct udevice_id *id;
 	struct driver *entry;
 	struct udevice *dev;
@@ -163,13 +552,8 @@ int lists_bind_fdt(struct udevice *parent, ofnode node, struct udevice **devp,
 		pr_debug("   - attempt to match compatible string '%s'\n",
 			 compat);
 
-		for (entry = driver; entry != driver + n_ents; entry++) {
-			ret = driver_check_compatible(entry->of_match, &id,
-						      compat);
-			if (!ret)
-				break;
-		}
-		if (entry == driver + n_ents)
+		entry = lists_driver_lookup_compat(compat, &id);
+		if (!entry)
 			continue;
 
 		if (pre_reloc_only) {
@@ -20,11 +20,13 @@
  */
 
 #include <common.h>
+#include <malloc.h>
 #include <linux/libfdt.h>
 #include <dm/of_access.h>
 #include <linux/ctype.h>
 #include <linux/err.h>
 #include <linux/ioport.h>
+#include <linux/log2.h>
 
 DECLARE_GLOBAL_DATA_PTR;
 
@@ -43,6 +45,11 @@ static struct device_node *of_stdout;
 /* pointer to options given after the alias (separated by :) or NULL if none */
 static const char *of_stdout_options;
 
+/* nodes indexed by phandle & phandle_cache_mask, for phandle_cache_root */
+static struct device_node **phandle_cache;
+static struct device_node *phandle_cache_root;
+static uint phandle_cache_mask;
+
 /**
  * struct alias_prop - Alias property in 'aliases' node
  *
@@ -410,6 +417,12 @@ struct device_node *of_find_node_by_phandle(phandle handle)
 	if (!handle)
 		return NULL;
 
+	if (phandle_cache && phandle_cache_root == gd->of_root) {
+		np = phandle_cache[handle & phandle_cache_mask];
+		if (np && np->phandle == handle)
+			return of_node_get(np);
+	}
+
 	for_each_of_allnodes(np)
 		if (np->phandle == handle)
 			break;
@@ -418,6 +431,43 @@ struct device_node *of_find_node_by_phandle(phandle handle)
 	return np;
 }
 
+int of_phandle_cache_build(struct device_node *root)
+{
+	struct device_node *np;
+	uint count = 0;
+
+	free(phandle_cache);
+	phandle_cache = NULL;
+	phandle_cache_root = NULL;
+
+	for (np = root; np; np = of_find_all_nodes(np)) {
+		if (np->phandle)
+			count++;
+	}
+	if (!count)
+		return 0;
+
+	/*
+	 * With the usual phandles numbered from 1, each node gets its own
+	 * slot. Any others sharing a slot are found by searching the tree.
+	 */
+	phandle_cache_mask = roundup_pow_of_two(count + 1) - 1;
+	phandle_cache = calloc(phandle_cache_mask + 1, sizeof(*phandle_cache));
+	if (!phandle_cache)
+		return -ENOMEM;
+	phandle_cache_root = root;
+
+	for (np = root; np; np = of_find_all_nodes(np)) {
+		if (np->phandle &&
+		    !phandle_cache[np->phandle & phandle_cache_mask])
+			phandle_cache[np->phandle & phandle_cache_mask] = np;
+	}
+	debug("%s: %u phandles, %u slots\n", __func__, count,
+	      phandle_cache_mask + 1);
+
+	return 0;
+}
+
 /**
  * of_find_property_value_of_size() - find property of given size
  *
@@ -17,6 +17,30 @@
 
 DECLARE_GLOBAL_DATA_PTR;
 
+/* The cached value is valid */
+#define REGMAP_CACHE_VALID	(1 << 0)
+/* The cached value has not been written to the hardware yet */
+#define REGMAP_CACHE_DIRTY	(1 << 1)
+
+/**
+ * struct regmap_cache - cache of the 32-bit registers in a regmap's first range
+ *
+ * @count:	Number of registers cached
+ * @vals:	Cached value of each register
+ * @state:	REGMAP_CACHE_... flags for each register
+ * @vol:	Ranges of volatile registers
+ * @vol_count:	Number of volatile ranges
+ * @cache_only:	true to hold back writes until regmap_cache_sync()
+ */
+struct regmap_cache {
+	uint count;
+	uint *vals;
+	u8 *state;
+	const struct regmap_volatile *vol;
+	int vol_count;
+	bool cache_only;
+};
+
 /**
  * regmap_alloc() - Allocate a regmap with a given number of ranges.
  *
@@ -31,10 +55,174 @@ static struct regmap *regmap_alloc(int count)
 	if (!map)
 		return NULL;
 	map->range_count = count;
+#if CONFIG_IS_ENABLED(REGMAP_CACHE)
+	map->cache = NULL;
+#endif
 
 	return map;
 }
 
+#if CONFIG_IS_ENABLED(REGMAP_CACHE)
+/**
+ * regmap_cache_reg() - Find the cache slot for a register
+ *
+ * @map:	Regmap to check
+ * @offset:	Offset of the 32-bit register
+ * Return: index of the register in the cache, or -1 if it is not cached
+ */
+static int regmap_cache_reg(struct regmap *map, uint offset)
+{
+	struct regmap_cache *cache = map->cache;
+	int i;
+
+	if (!cache || offset % REGMAP_SIZE_32 ||
+	    offset / REGMAP_SIZE_32 >= cache->count)
+		return -1;
+	for (i = 0; i < cache->vol_count; i++) {
+		const struct regmap_volatile *vol = &cache->vol[i];
+
+		if (offset >= vol->start && offset - vol->start < vol->size)
+			return -1;
+	}
+
+	return offset / REGMAP_SIZE_32;
+}
+
+/* Get a cached value, returning false if there is none */
+static bool regmap_cache_get(struct regmap *map, int reg, uint *valp)
+{
+	if (!(map->cache->state[reg] & REGMAP_CACHE_VALID))
+		return false;
+	*valp = map->cache->vals[reg];
+
+	return true;
+}
+
+/*
+ * Update a cached value. For a write, if writes are being held back this
+ * returns true and marks the register dirty. Otherwise the caller must write
+ * the value out.
+ */
+static bool regmap_cache_set(struct regmap *map, int reg, uint val,
+			     bool write)
+{
+	struct regmap_cache *cache = map->cache;
+
+	cache->vals[reg] = val;
+	cache->state[reg] = REGMAP_CACHE_VALID;
+	if (!write || !cache->cache_only)
+		return false;
+	cache->state[reg] |= REGMAP_CACHE_DIRTY;
+
+	return true;
+}
+
+/* Drop any cached registers which overlap a write made without the cache */
+static void regmap_cache_invalidate(struct regmap *map, uint offset,
+				    size_t len)
+{
+	struct regmap_cache *cache = map->cache;
+	uint reg;
+
+	if (!cache)
+		return;
+	for (reg = offset / REGMAP_SIZE_32;
+	     reg * REGMAP_SIZE_32 < offset + len && reg < cache->count; reg++)
+		cache->state[reg] = 0;
+}
+
+static void regmap_cache_free(struct regmap_cache *cache)
+{
+	if (cache) {
+		free(cache->vals);
+		free(cache->state);
+		free(cache);
+	}
+}
+
+int regmap_cache_init(struct regmap *map, uint size,
+		      const struct regmap_volatile *vol, int vol_count)
+{
+	struct regmap_cache *cache;
+
+	if (!map->range_count)
+		return -EINVAL;
+	if (!size || size > map->ranges[0].size)
+		size = map->ranges[0].size;
+	cache = calloc(1, sizeof(*cache));
+	if (!cache)
+		return -ENOMEM;
+	cache->count = size / REGMAP_SIZE_32;
+	cache->vals = calloc(cache->count, sizeof(*cache->vals));
+	cache->state = calloc(cache->count, sizeof(*cache->state));
+	if (!cache->vals || !cache->state) {
+		regmap_cache_free(cache);
+		return -ENOMEM;
+	}
+	cache->vol = vol;
+	cache->vol_count = vol_count;
+	regmap_cache_free(map->cache);
+	map->cache = cache;
+
+	return 0;
+}
+
+void regmap_cache_only(struct regmap *map, bool enable)
+{
+	if (map->cache)
+		map->cache->cache_only = enable;
+}
+
+int regmap_cache_sync(struct regmap *map)
+{
+	struct regmap_cache *cache = map->cache;
+	uint reg;
+	int ret;
+
+	if (!cache)
+		return 0;
+	for (reg = 0; reg < cache->count; reg++) {
+		if (!(cache->state[reg] & REGMAP_CACHE_DIRTY))
+			continue;
+		ret = regmap_raw_write(map, reg * REGMAP_SIZE_32,
+				       &cache->vals[reg], REGMAP_SIZE_32);
+		if (ret)
+			return ret;
+		/* The raw write drops the register from the cache */
+		cache->state[reg] = REGMAP_CACHE_VALID;
+	}
+
+	return 0;
+}
+
+void regmap_cache_drop(struct regmap *map)
+{
+	if (map->cache)
+		memset(map->cache->state, '\0', map->cache->count);
+}
+#else
+static inline int regmap_cache_reg(struct regmap *map, uint offset)
+{
+	return -1;
+}
+
+static inline bool regmap_cache_get(struct regmap *map, int reg, uint *valp)
+{
+	return false;
+}
+
+static inline bool regmap_cache_set(struct regmap *map, int reg, uint val,
+				    bool write)
+{
+	return false;
+}
+
+static inline void regmap_cache_invalidate(struct regmap *map, uint offset,
+					   size_t len)
+{
+}
+#endif
+
 #if CONFIG_IS_ENABLED(OF_PLATDATA)
 int regmap_init_mem_platdata(struct udevice *dev, fdt_val_t *reg, int count,
 			     struct regmap **mapp)
@@ -192,6 +380,9 @@ void *regmap_get_range(struct regmap *map, unsigned int range_num)
 
 int regmap_uninit(struct regmap *map)
 {
+#if CONFIG_IS_ENABLED(REGMAP_CACHE)
+	regmap_cache_free(map->cache);
+#endif
 	free(map);
 
 	return 0;
@@ -296,7 +487,18 @@ int regmap_raw_read(struct regmap *map, uint offset, void *valp, size_t val_len)
 
 int regmap_read(struct regmap *map, uint offset, uint *valp)
 {
-	return regmap_raw_read(map, offset, valp, REGMAP_SIZE_32);
+	int reg = regmap_cache_reg(map, offset);
+	int ret;
+
+	if (reg >= 0 && regmap_cache_get(map, reg, valp))
+		return 0;
+	ret = regmap_raw_read(map, offset, valp, REGMAP_SIZE_32);
+	if (ret)
+		return ret;
+	if (reg >= 0)
+		regmap_cache_set(map, reg, *valp, false);
+
+	return 0;
 }
 
 static inline void __write_8(u8 *addr, const u8 *val,
@@ -374,6 +576,8 @@ int regmap_raw_write_range(struct regmap *map, uint range_num, uint offset,
 		debug("%s: offset/size combination invalid\n", __func__);
 		return -ERANGE;
 	}
+	if (!range_num)
+		regmap_cache_invalidate(map, offset, val_len);
 
 	switch (val_len) {
 	case REGMAP_SIZE_8:
@@ -406,19 +610,57 @@ int regmap_raw_write(struct regmap *map, uint offset, const void *val,
 
 int regmap_write(struct regmap *map, uint offset, uint val)
 {
-	return regmap_raw_write(map, offset, &val, REGMAP_SIZE_32);
+	int reg = regmap_cache_reg(map, offset);
+	int ret;
+
+	if (reg < 0)
+		return regmap_raw_write(map, offset, &val, REGMAP_SIZE_32);
+	if (regmap_cache_set(map, reg, val, true))
+		return 0;
+	ret = regmap_raw_write(map, offset, &val, REGMAP_SIZE_32);
+	if (ret)
+		return ret;
+	/* The raw write dropped the register, so put it back */
+	regmap_cache_set(map, reg, val, false);
+
+	return 0;
+}
+
+int regmap_bulk_write(struct regmap *map, uint offset, const uint *vals,
+		      uint count)
+{
+	uint i, cur;
+	int reg, ret;
+
+	for (i = 0; i < count; i++, offset += REGMAP_SIZE_32) {
+		reg = regmap_cache_reg(map, offset);
+		if (reg >= 0 && regmap_cache_get(map, reg, &cur) &&
+		    cur == vals[i])
+			continue;
+		ret = regmap_write(map, offset, vals[i]);
+		if (ret)
+			return ret;
+	}
+
+	return 0;
 }
 
 int regmap_update_bits(struct regmap *map, uint offset, uint mask, uint val)
 {
-	uint reg;
+	uint reg, orig;
 	int ret;
 
 	ret = regmap_read(map, offset, &reg);
 	if (ret)
 		return ret;
 
+	orig = reg;
 	reg &= ~mask;
+	reg |= val;
+
+	/* The register is not volatile, so writing the same value is useless */
+	if (reg == orig && regmap_cache_reg(map, offset) >= 0)
+		return 0;
 
-	return regmap_write(map, offset, reg | val);
+	return regmap_write(map, offset, reg);
 }
@@ -10,6 +10,7 @@
 #include <errno.h>
 #include <fdtdec.h>
 #include <malloc.h>
+#include <thread.h>
 #include <linux/libfdt.h>
 #include <dm/device.h>
 #include <dm/device-internal.h>
@@ -20,6 +21,7 @@
 #include <dm/read.h>
 #include <dm/root.h>
 #include <dm/uclass.h>
+#include <dm/uclass-internal.h>
 #include <dm/util.h>
 #include <linux/list.h>
 
@@ -158,6 +160,23 @@ int dm_init(bool of_live)
 		return -EINVAL;
 	}
 	INIT_LIST_HEAD(&DM_UCLASS_ROOT_NON_CONST);
+	if (CONFIG_IS_ENABLED(DM_DEFERRED_BIND))
+		lists_drop_deferred();
+#if CONFIG_IS_ENABLED(DM_UCLASS_TABLE)
+	/*
+	 * Before relocation there are few uclasses and the malloc() area is
+	 * small, so the list is searched instead.
+	 */
+	if (gd->uclass_table) {
+		memset(gd->uclass_table, '\0',
+		       UCLASS_COUNT * sizeof(*gd->uclass_table));
+	} else if (gd->flags & GD_FLG_RELOC) {
+		gd->uclass_table = calloc(UCLASS_COUNT,
+					  sizeof(*gd->uclass_table));
+		if (!gd->uclass_table)
+			return -ENOMEM;
+	}
+#endif
 
 #if defined(CONFIG_NEEDS_MANUAL_RELOC)
 	fix_drivers();
@@ -213,6 +232,32 @@ int dm_scan_platdata(bool pre_reloc_only)
 	return ret;
 }
 
+#if CONFIG_IS_ENABLED(OF_CONTROL) && !CONFIG_IS_ENABLED(OF_PLATDATA)
+/**
+ * dm_scan_fdt_bind() - Bind a device tree node, now or when it is needed
+ *
+ * With CONFIG_DM_DEFERRED_BIND, top-level nodes found after relocation are
+ * only bound when their uclass is first used, unless they have the
+ * 'u-boot,dm-eager' property. Their subnodes are bound with them.
+ *
+ * @parent: Parent device for the device that will be created
+ * @node: Node to bind
+ * @pre_reloc_only: If true, bind only drivers with the DM_FLAG_PRE_RELOC
+ * flag. If false bind all drivers.
+ * @return 0 if OK, -ve on error
+ */
+static int dm_scan_fdt_bind(struct udevice *parent, ofnode node,
+			    bool pre_reloc_only)
+{
+	if (CONFIG_IS_ENABLED(DM_DEFERRED_BIND) && !pre_reloc_only &&
+	    parent == gd->dm_root &&
+	    !ofnode_read_bool(node, "u-boot,dm-eager"))
+		return lists_defer_bind_fdt(parent, node);
+
+	return lists_bind_fdt(parent, node, NULL, pre_reloc_only);
+}
+#endif
+
 #if CONFIG_IS_ENABLED(OF_LIVE)
 static int dm_scan_fdt_live(struct udevice *parent,
 			    const struct device_node *node_parent,
@@ -236,8 +281,8 @@ static int dm_scan_fdt_live(struct udevice *parent,
 			pr_debug("   - ignoring disabled device\n");
 			continue;
 		}
-		err = lists_bind_fdt(parent, np_to_ofnode(np), NULL,
-				     pre_reloc_only);
+		err = dm_scan_fdt_bind(parent, np_to_ofnode(np),
+				       pre_reloc_only);
 		if (err && !ret) {
 			ret = err;
 			debug("%s: ret=%d\n", np->name, ret);
@@ -294,8 +339,8 @@ static int dm_scan_fdt_node(struct udevice *parent, const void *blob,
 			pr_debug("   - ignoring disabled device\n");
 			continue;
 		}
-		err = lists_bind_fdt(parent, offset_to_ofnode(offset), NULL,
-				     pre_reloc_only);
+		err = dm_scan_fdt_bind(parent, offset_to_ofnode(offset),
+				       pre_reloc_only);
 		if (err && !ret) {
 			ret = err;
 			debug("%s: ret=%d\n", node_name, ret);
@@ -339,6 +384,17 @@ static int dm_scan_fdt_node(struct udevice *parent, const void *blob,
 {
 	return 0;
 }
+
+/* Without a device tree to scan, devices come only from U_BOOT_DEVICE() */
+int dm_scan_fdt_dev(struct udevice *dev)
+{
+	return 0;
+}
+
+int dm_scan_fdt(const void *blob, bool pre_reloc_only)
+{
+	return 0;
+}
 #endif
 
 static int dm_scan_fdt_ofnode_path(const char *path, bool pre_reloc_only)
@@ -387,6 +443,7 @@ __weak int dm_scan_other(bool pre_reloc_only)
 
 int dm_init_and_scan(bool pre_reloc_only)
 {
+	enum bootstage_id bind_id;
 	int ret;
 
 	ret = dm_init(IS_ENABLED(CONFIG_OF_LIVE));
@@ -394,26 +451,190 @@ int dm_init_and_scan(bool pre_reloc_only)
 		debug("dm_init() failed: %d\n", ret);
 		return ret;
 	}
+
+	/* Record the time taken to bind devices */
+	bind_id = pre_reloc_only ? BOOTSTAGE_ID_ACCUM_DM_BIND_F :
+		  BOOTSTAGE_ID_ACCUM_DM_BIND_R;
+	bootstage_start(bind_id, pre_reloc_only ? "dm_bind_f" : "dm_bind_r");
 	ret = dm_scan_platdata(pre_reloc_only);
 	if (ret) {
 		debug("dm_scan_platdata() failed: %d\n", ret);
-		return ret;
+		goto out;
 	}
 
 	if (CONFIG_IS_ENABLED(OF_CONTROL) && !CONFIG_IS_ENABLED(OF_PLATDATA)) {
 		ret = dm_extended_scan_fdt(gd->fdt_blob, pre_reloc_only);
 		if (ret) {
 			debug("dm_extended_scan_dt() failed: %d\n", ret);
-			return ret;
+			goto out;
 		}
 	}
 
 	ret = dm_scan_other(pre_reloc_only);
-	if (ret)
-		return ret;
+out:
+	bootstage_accum(bind_id);
 
-	return 0;
+	return ret;
+}
+
+#if CONFIG_IS_ENABLED(THREAD)
+/**
+ * struct dm_probe_group - Devices probed one after another by one thread
+ *
+ * @count:	Number of devices in @devs
+ * @devs:	Devices to probe, in order
+ */
+struct dm_probe_group {
+	int count;
+	struct udevice *devs[];
+};
+
+static int dm_probe_thread(void *arg)
+{
+	struct dm_probe_group *group = arg;
+	int ret = 0;
+	int err, i;
+
+	for (i = 0; i < group->count; i++) {
+		err = device_probe(group->devs[i]);
+		if (err && !ret)
+			ret = err;
+	}
+	free(group);
+
+	return ret;
+}
+
+/*
+ * Check whether @dev is on a bus such as I2C or MDIO, where transfers for
+ * different devices cannot overlap. Devices under the root or a simple bus
+ * are memory-mapped and can be probed at the same time.
+ */
+static bool dm_probe_on_bus(struct udevice *dev)
+{
+	struct udevice *parent = dev->parent;
+
+	return parent && parent != dm_root() &&
+	       device_get_uclass_id(parent) != UCLASS_SIMPLE_BUS;
+}
+
+/*
+ * Give @dev, and any parents which are not yet probed, their sequence
+ * numbers now, so that they do not depend on the order the threads run in.
+ * With @req_only, only give out requested numbers which are free, so that
+ * a device without an alias cannot take one which a later device asks for.
+ */
+static void dm_probe_resolve_seq(struct udevice *dev, bool req_only)
+{
+	struct udevice *dup;
+	int seq;
+
+	if (dev->parent)
+		dm_probe_resolve_seq(dev->parent, req_only);
+	if (device_active(dev) || dev->seq != -1)
+		return;
+	if (req_only) {
+		if (dev->req_seq != -1 &&
+		    uclass_find_device_by_seq(device_get_uclass_id(dev),
+					      dev->req_seq, false,
+					      &dup) == -ENODEV)
+			dev->seq = dev->req_seq;
+		return;
+	}
+	seq = uclass_resolve_seq(dev);
+	if (seq >= 0)
+		dev->seq = seq;
+}
+
+/*
+ * Collect the inactive devices in the listed uclasses into @devs, if not
+ * NULL, and return how many there are
+ */
+static int dm_probe_find(const char *uclasses, struct udevice **devs)
+{
+	char *list, *str, *name;
+	int count = 0;
+
+	list = strdup(uclasses);
+	if (!list)
+		return -ENOMEM;
+	str = list;
+	while ((name = strsep(&str, " "))) {
+		struct udevice *dev;
+		struct uclass *uc;
+		enum uclass_id id;
+
+		if (!*name)
+			continue;
+		/* Uclasses which are not built in are ignored */
+		id = uclass_get_by_name(name);
+		if (id == UCLASS_INVALID || uclass_get(id, &uc)) {
+			debug("%s: No uclass '%s'\n", __func__, name);
+			continue;
+		}
+		uclass_foreach_dev(dev, uc) {
+			if (device_active(dev))
+				continue;
+			if (devs)
+				devs[count] = dev;
+			count++;
+		}
+	}
+	free(list);
+
+	return count;
+}
+
+int dm_probe_async(const char *uclasses)
+{
+	struct dm_probe_group *group;
+	struct udevice **devs;
+	int count, i, j;
+	int ret = 0;
+
+	count = dm_probe_find(uclasses, NULL);
+	if (count <= 0)
+		return count;
+	devs = calloc(count, sizeof(*devs));
+	if (!devs)
+		return -ENOMEM;
+	dm_probe_find(uclasses, devs);
+	for (i = 0; i < count; i++)
+		dm_probe_resolve_seq(devs[i], true);
+	for (i = 0; i < count; i++)
+		dm_probe_resolve_seq(devs[i], false);
+
+	/* One thread for each device, or for all the devices on a bus */
+	for (i = 0; i < count; i++) {
+		if (!devs[i])
+			continue;
+		group = malloc(sizeof(*group) + count * sizeof(*devs));
+		if (!group) {
+			ret = -ENOMEM;
+			break;
+		}
+		group->devs[0] = devs[i];
+		group->count = 1;
+		for (j = i + 1; j < count && dm_probe_on_bus(devs[i]); j++) {
+			if (devs[j] && devs[j]->parent == devs[i]->parent) {
+				group->devs[group->count++] = devs[j];
+				devs[j] = NULL;
+			}
+		}
+		if (!thread_create(devs[i]->name, dm_probe_thread, group)) {
+			free(group);
+			ret = -ENOMEM;
+			break;
+		}
+	}
+	free(devs);
+
+	/* Let each thread get as far as its first hardware wait */
+	thread_run_others();
+
+	return ret;
 }
+#endif
 
 /* This is the root driver - all drivers are children of this */
 U_BOOT_DRIVER(root_driver) = {
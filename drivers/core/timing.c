@@ -0,0 +1,169 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Time spent binding, probing and removing devices
+ */
+
+#include <common.h>
+#include <dm.h>
+#include <malloc.h>
+#include <dm/device-internal.h>
+#include <dm/root.h>
+#include <dm/util.h>
+
+DECLARE_GLOBAL_DATA_PTR;
+
+/* Time taken by operations nested inside the one currently being timed */
+static ulong nested_us;
+
+static bool dm_timing_ready(void)
+{
+	/* Static data cannot be written before relocation */
+	if (!(gd->flags & GD_FLG_RELOC))
+		return false;
+#if defined(CONFIG_TIMER) && !defined(CONFIG_TIMER_EARLY)
+	/* Reading the time would probe the timer, perhaps from its own probe */
+	if (!gd->timer)
+		return false;
+#endif
+
+	return true;
+}
+
+void dm_timing_start(struct dm_timing_mark *mark)
+{
+	mark->valid = dm_timing_ready();
+	if (!mark->valid)
+		return;
+	mark->outer_us = nested_us;
+	nested_us = 0;
+	mark->start_us = timer_get_us();
+}
+
+void dm_timing_end(struct udevice *dev, int op,
+		   struct dm_timing_mark *mark)
+{
+	ulong elapsed;
+
+	if (!mark->valid)
+		return;
+	elapsed = timer_get_us() - mark->start_us;
+	/* Allocate here so that devices bound before relocation stay small */
+	if (dev && !dev->timing)
+		dev->timing = calloc(1, sizeof(*dev->timing));
+	if (dev && dev->timing) {
+		dev->timing->time_us[op] += elapsed - min(nested_us, elapsed);
+		dev->timing->count[op]++;
+	}
+	nested_us = mark->outer_us + elapsed;
+}
+
+static ulong dm_timing_total(struct udevice *dev)
+{
+	ulong total = 0;
+	int op;
+
+	for (op = 0; op < DM_TIMING_COUNT; op++)
+		total += dev->timing->time_us[op];
+
+	return total;
+}
+
+static int dm_timing_collect(struct udevice *dev, struct udevice **list,
+			     int count)
+{
+	struct udevice *child;
+
+	if (dev->timing) {
+		if (list)
+			list[count] = dev;
+		count++;
+	}
+	list_for_each_entry(child, &dev->child_head, sibling_node)
+		count = dm_timing_collect(child, list, count);
+
+	return count;
+}
+
+static int h_compare_timing(const void *p1, const void *p2)
+{
+	ulong total1 = dm_timing_total(*(struct udevice **)p1);
+	ulong total2 = dm_timing_total(*(struct udevice **)p2);
+
+	if (total1 == total2)
+		return 0;
+
+	return total1 < total2 ? 1 : -1;
+}
+
+/**
+ * dm_timing_sorted() - Get a list of the timed devices, slowest first
+ *
+ * @countp:	Returns the number of devices in the list
+ * @return list of devices, which the caller must free, or NULL if none
+ */
+static struct udevice **dm_timing_sorted(int *countp)
+{
+	struct udevice **list;
+	int count;
+
+	*countp = 0;
+	if (!dm_root())
+		return NULL;
+	count = dm_timing_collect(dm_root(), NULL, 0);
+	if (!count)
+		return NULL;
+	list = malloc(count * sizeof(*list));
+	if (!list)
+		return NULL;
+	dm_timing_collect(dm_root(), list, 0);
+	qsort(list, count, sizeof(*list), h_compare_timing);
+	*countp = count;
+
+	return list;
+}
+
+void dm_dump_timing(void)
+{
+	struct udevice **list;
+	ulong total = 0;
+	int count;
+	int i;
+
+	list = dm_timing_sorted(&count);
+	printf("Time in microseconds:\n");
+	printf("%10s%10s%10s%4s%10s%4s  %-10s  %s\n", "Total", "Bind", "Probe",
+	       "#", "Remove", "#", "Class", "Name");
+	for (i = 0; i < count; i++) {
+		struct udevice *dev = list[i];
+		struct dm_timing *timing = dev->timing;
+
+		printf("%10lu%10lu%10lu%4u%10lu%4u  %-10.10s  %s\n",
+		       dm_timing_total(dev), timing->time_us[DM_TIMING_BIND],
+		       timing->time_us[DM_TIMING_PROBE],
+		       timing->count[DM_TIMING_PROBE],
+		       timing->time_us[DM_TIMING_REMOVE],
+		       timing->count[DM_TIMING_REMOVE],
+		       dev->uclass->uc_drv->name, dev->name);
+		total += dm_timing_total(dev);
+	}
+	printf("%10lu  total for %d devices\n", total, count);
+	free(list);
+}
+
+void dm_timing_add_bootstage(int count)
+{
+	struct udevice **list;
+	char name[40];
+	int i, n;
+
+	list = dm_timing_sorted(&n);
+	for (i = 0; i < n && i < count; i++) {
+		ulong total = dm_timing_total(list[i]);
+
+		if (!total)
+			break;
+		snprintf(name, sizeof(name), "dm_%s", list[i]->name);
+		bootstage_add_accum(strdup(name), total);
+	}
+	free(list);
+}
@@ -25,11 +25,12 @@ struct uclass *uclass_find(enum uclass_id key)
 
 	if (!gd->dm_root)
 		return NULL;
-	/*
-	 * TODO(sjg@chromium.org): Optimise this, perhaps moving the found
-	 * node to the start of the list, or creating a linear array mapping
-	 * id to node.
-	 */
+	if (gd->uclass_table) {
+		if ((unsigned int)key >= UCLASS_COUNT)
+			return NULL;
+		return gd->uclass_table[key];
+	}
+
 	list_for_each_entry(uc, &gd->uclass_root, sibling_node) {
 		if (uc->uc_drv->id == key)
 			return uc;
@@ -79,6 +80,8 @@ static int uclass_add(enum uclass_id id, struct uclass **ucp)
 	INIT_LIST_HEAD(&uc->sibling_node);
 	INIT_LIST_HEAD(&uc->dev_head);
 	list_add(&uc->sibling_node, &DM_UCLASS_ROOT_NON_CONST);
+	if (gd->uclass_table)
+		gd->uclass_table[id] = uc;
 
 	if (uc_drv->init) {
 		ret = uc_drv->init(uc);
@@ -95,6 +98,8 @@ fail:
 		uc->priv = NULL;
 	}
 	list_del(&uc->sibling_node);
+	if (gd->uclass_table)
+		gd->uclass_table[id] = NULL;
 fail_mem:
 	free(uc);
 
@@ -128,6 +133,8 @@ int uclass_destroy(struct uclass *uc)
 	if (uc_drv->destroy)
 		uc_drv->destroy(uc);
 	list_del(&uc->sibling_node);
+	if (gd->uclass_table)
+		gd->uclass_table[uc_drv->id] = NULL;
 	if (uc_drv->priv_auto_alloc_size)
 		free(uc->priv);
 	free(uc);
@@ -135,7 +142,7 @@ int uclass_destroy(struct uclass *uc)
 	return 0;
 }
 
-int uclass_get(enum uclass_id id, struct uclass **ucp)
+int uclass_find_or_add(enum uclass_id id, struct uclass **ucp)
 {
 	struct uclass *uc;
 
@@ -148,6 +155,15 @@ int uclass_get(enum uclass_id id, struct uclass **ucp)
 	return 0;
 }
 
+int uclass_get(enum uclass_id id, struct uclass **ucp)
+{
+	/* Errors are reported as they are when binding at start-up */
+	if (CONFIG_IS_ENABLED(DM_DEFERRED_BIND))
+		lists_bind_deferred(id);
+
+	return uclass_find_or_add(id, ucp);
+}
+
 const char *uclass_get_name(enum uclass_id id)
 {
 	struct uclass *uc;
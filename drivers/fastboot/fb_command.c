@@ -8,6 +8,7 @@
 #include <fastboot-internal.h>
 #include <fb_mmc.h>
 #include <fb_nand.h>
+#include <image-sparse.h>
 #include <part.h>
 #include <stdlib.h>
 
@@ -26,6 +27,39 @@ static u32 fastboot_bytes_received;
  */
 static u32 fastboot_bytes_expected;
 
+#if CONFIG_IS_ENABLED(FASTBOOT_FLASH_STREAM)
+/**
+ * stream_part - partition downloads are streamed to, empty if none
+ */
+static char stream_part[32];
+
+/**
+ * stream_active - the current download is being streamed to stream_part
+ */
+static bool stream_active;
+
+/**
+ * stream_done - the last download was streamed and stream_response holds
+ * the result to report to the following "flash" command
+ */
+static bool stream_done;
+
+/**
+ * stream_failed - writing the current download failed, further data is
+ * dropped and stream_response holds the error
+ */
+static bool stream_failed;
+
+/**
+ * stream_fill - number of bytes staged at fastboot_buf_addr
+ */
+static u32 stream_fill;
+
+static char stream_response[FASTBOOT_RESPONSE_LEN];
+static struct sparse_storage stream_storage;
+static struct sparse_stream stream;
+#endif
+
 static void okay(char *, char *);
 static void getvar(char *, char *);
 static void download(char *, char *);
@@ -37,6 +71,9 @@ static void reboot_bootloader(char *, char *);
 #if CONFIG_IS_ENABLED(FASTBOOT_CMD_OEM_FORMAT)
 static void oem_format(char *, char *);
 #endif
+#if CONFIG_IS_ENABLED(FASTBOOT_FLASH_STREAM)
+static void oem_stream(char *, char *);
+#endif
 
 static const struct {
 	const char *command;
@@ -86,6 +123,12 @@ static const struct {
 		.dispatch = oem_format,
 	},
 #endif
+#if CONFIG_IS_ENABLED(FASTBOOT_FLASH_STREAM)
+	[FASTBOOT_COMMAND_OEM_STREAM] = {
+		.command = "oem stream",
+		.dispatch = oem_stream,
+	},
+#endif
 };
 
 /**
@@ -147,6 +190,132 @@ static void getvar(char *cmd_parameter, char *response)
 	fastboot_getvar(cmd_parameter, response);
 }
 
+#if CONFIG_IS_ENABLED(FASTBOOT_FLASH_STREAM)
+/**
+ * stream_start() - Start streaming the next download to stream_part
+ *
+ * @response: Pointer to fastboot response buffer
+ *
+ * Return: 0 on success, or negative error code (response is then set)
+ */
+static int stream_start(char *response)
+{
+	int ret = -ENOSYS;
+
+#if CONFIG_IS_ENABLED(FASTBOOT_FLASH_MMC)
+	ret = fastboot_mmc_stream_start(stream_part, &stream_storage,
+					response);
+#endif
+#if CONFIG_IS_ENABLED(FASTBOOT_FLASH_NAND)
+	ret = fastboot_nand_stream_start(stream_part, &stream_storage,
+					 response);
+#endif
+	if (ret)
+		return ret;
+
+	sparse_stream_init(&stream, &stream_storage);
+	stream_active = true;
+	stream_failed = false;
+	stream_fill = 0;
+
+	return 0;
+}
+
+/**
+ * stream_flush() - Write out the data staged in the download buffer
+ *
+ * @last: The staged data ends with the end of the image
+ *
+ * Whatever cannot be written yet (partial block or header) is moved to the
+ * start of the buffer. Errors are recorded in stream_response.
+ */
+static void stream_flush(bool last)
+{
+	long consumed;
+
+	consumed = sparse_stream_write(&stream, fastboot_buf_addr, stream_fill,
+				       last, stream_response);
+	if (consumed < 0) {
+		stream_failed = true;
+		return;
+	}
+	if (!consumed && !last) {
+		/* a header or block does not even fit in the buffer */
+		fastboot_fail("stream buffer too small", stream_response);
+		stream_failed = true;
+		return;
+	}
+
+	stream_fill -= consumed;
+	memmove(fastboot_buf_addr, fastboot_buf_addr + consumed, stream_fill);
+}
+
+/**
+ * stream_data() - Stage received data and write it out in large pieces
+ *
+ * @data: Pointer to received fastboot data
+ * @len: Length of received fastboot data
+ */
+static void stream_data(const void *data, unsigned int len)
+{
+	u32 size = min_t(u32, CONFIG_FASTBOOT_FLASH_STREAM_SIZE,
+			 fastboot_buf_size);
+	unsigned int n;
+
+	while (len && !stream_failed) {
+		n = min_t(u32, len, size - stream_fill);
+		memcpy(fastboot_buf_addr + stream_fill, data, n);
+		stream_fill += n;
+		data += n;
+		len -= n;
+		if (stream_fill == size)
+			stream_flush(false);
+	}
+}
+
+/**
+ * stream_complete() - Write the end of a streamed download
+ *
+ * @response: Pointer to fastboot response buffer
+ *
+ * Return: 0 on success, or -1 if the image could not be written (response
+ * is then set)
+ */
+static int stream_complete(char *response)
+{
+	stream_active = false;
+	stream_done = true;
+
+	if (!stream_failed)
+		stream_flush(true);
+	if (!stream_failed &&
+	    sparse_stream_finish(&stream, stream_part, stream_response))
+		stream_failed = true;
+
+	if (stream_failed) {
+		strlcpy(response, stream_response, FASTBOOT_RESPONSE_LEN);
+		return -1;
+	}
+	fastboot_okay(NULL, stream_response);
+
+	return 0;
+}
+#endif
+
+/**
+ * fastboot_stream_armed() - Check whether downloads are streamed to flash
+ *
+ * Return: true if 'oem stream' selected a partition for the next downloads
+ */
+bool fastboot_stream_armed(void)
+{
+#if CONFIG_IS_ENABLED(FASTBOOT_FLASH_STREAM)
+	return stream_part[0];
+#else
+	return false;
+#endif
+}
+
 /**
  * fastboot_download() - Start a download transfer from the client
  *
@@ -167,6 +336,19 @@ static void download(char *cmd_parameter, char *response)
 		fastboot_fail("Expected nonzero image size", response);
 		return;
 	}
+#if CONFIG_IS_ENABLED(FASTBOOT_FLASH_STREAM)
+	stream_active = false;
+	stream_done = false;
+	if (stream_part[0]) {
+		/* no need for the image to fit in the buffer */
+		if (stream_start(response))
+			return;
+		printf("Starting download of %d bytes to '%s'\n",
+		       fastboot_bytes_expected, stream_part);
+		fastboot_response("DATA", response, "%s", cmd_parameter);
+		return;
+	}
+#endif
 	/*
 	 * Nothing to download yet. Response is of the form:
 	 * [DATA|FAIL]$cmd_parameter
@@ -220,9 +402,14 @@ void fastboot_data_download(const void *fastboot_data,
 			      response);
 		return;
 	}
-	/* Download data to fastboot_buf_addr */
-	memcpy(fastboot_buf_addr + fastboot_bytes_received,
-	       fastboot_data, fastboot_data_len);
+	/* Download data to fastboot_buf_addr, or stream it to flash */
+#if CONFIG_IS_ENABLED(FASTBOOT_FLASH_STREAM)
+	if (stream_active)
+		stream_data(fastboot_data, fastboot_data_len);
+	else
+#endif
+		memcpy(fastboot_buf_addr + fastboot_bytes_received,
+		       fastboot_data, fastboot_data_len);
 
 	pre_dot_num = fastboot_bytes_received / BYTES_PER_DOT;
 	fastboot_bytes_received += fastboot_data_len;
@@ -241,10 +428,23 @@ void fastboot_data_download(const void *fastboot_data,
  *
  * @response: Pointer to fastboot response buffer
  *
- * Set image_size and ${filesize} to the total size of the downloaded image.
+ * Set image_size and ${filesize} to the total size of the downloaded image,
+ * or to 0 if it was streamed to flash rather than kept in the buffer.
  */
 void fastboot_data_complete(char *response)
 {
+#if CONFIG_IS_ENABLED(FASTBOOT_FLASH_STREAM)
+	if (stream_active) {
+		/* The buffer only holds the last part, so there is no image */
+		if (!stream_complete(response))
+			fastboot_okay(NULL, response);
+		image_size = 0;
+		env_set_hex("filesize", 0);
+		fastboot_bytes_expected = 0;
+		fastboot_bytes_received = 0;
+		return;
+	}
+#endif
 	/* Download complete. Respond with "OKAY" */
 	fastboot_okay(NULL, response);
 	printf("\ndownloading of %d bytes finished\n", fastboot_bytes_received);
@@ -266,6 +466,19 @@ void fastboot_data_complete(char *response)
  */
 static void flash(char *cmd_parameter, char *response)
 {
+#if CONFIG_IS_ENABLED(FASTBOOT_FLASH_STREAM)
+	/* the image has already been written while it was downloaded */
+	if (stream_done) {
+		stream_done = false;
+		if (!cmd_parameter || strcmp(cmd_parameter, stream_part))
+			fastboot_fail("image was streamed to another partition",
+				      response);
+		else
+			strlcpy(response, stream_response,
+				FASTBOOT_RESPONSE_LEN);
+		return;
+	}
+#endif
 #if CONFIG_IS_ENABLED(FASTBOOT_FLASH_MMC)
 	fastboot_mmc_flash_write(cmd_parameter, fastboot_buf_addr, image_size,
 				 response);
@@ -333,3 +546,28 @@ static void oem_format(char *cmd_parameter, char *response)
 	}
 }
 #endif
+
+#if CONFIG_IS_ENABLED(FASTBOOT_FLASH_STREAM)
+/**
+ * oem_stream() - Select the partition downloads are streamed to
+ *
+ * @cmd_parameter: Pointer to partition name, or NULL to stop streaming
+ * @response: Pointer to fastboot response buffer
+ */
+static void oem_stream(char *cmd_parameter, char *response)
+{
+	if (!cmd_parameter || !*cmd_parameter) {
+		stream_part[0] = '\0';
+		fastboot_okay(NULL, response);
+		return;
+	}
+
+	if (strlen(cmd_parameter) >= sizeof(stream_part)) {
+		fastboot_fail("partition name too long", response);
+		return;
+	}
+
+	strcpy(stream_part, cmd_parameter);
+	fastboot_okay(NULL, response);
+}
+#endif
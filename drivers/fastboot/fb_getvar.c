@@ -89,7 +89,12 @@ static void getvar_bootloader_version(char *var_parameter, char *response)
 
 static void getvar_downloadsize(char *var_parameter, char *response)
 {
-	fastboot_response("OKAY", response, "0x%08x", fastboot_buf_size);
+	/* streamed downloads are not limited by the buffer */
+	if (fastboot_stream_armed())
+		fastboot_response("OKAY", response, "0x%08x", U32_MAX);
+	else
+		fastboot_response("OKAY", response, "0x%08x",
+				  fastboot_buf_size);
 }
 
 static void getvar_serialno(char *var_parameter, char *response)
@@ -93,9 +93,39 @@ static lbaint_t fb_mmc_sparse_write(struct sparse_storage *info,
 static lbaint_t fb_mmc_sparse_reserve(struct sparse_storage *info,
 		lbaint_t blk, lbaint_t blkcnt)
 {
+	struct fb_mmc_sparse *sparse = info->priv;
+
+	/* Don't-care blocks: let the card unmap them, but it is optional */
+	blk_ddiscard(sparse->dev_desc, blk, blkcnt);
+
 	return blkcnt;
 }
 
+static lbaint_t fb_mmc_sparse_write_zeroes(struct sparse_storage *info,
+		lbaint_t blk, lbaint_t blkcnt)
+{
+	struct fb_mmc_sparse *sparse = info->priv;
+
+	return blk_dwrite_zeroes(sparse->dev_desc, blk, blkcnt);
+}
+
+static void fb_mmc_init_sparse(struct sparse_storage *sparse,
+			       struct fb_mmc_sparse *sparse_priv,
+			       struct blk_desc *dev_desc,
+			       disk_partition_t *info)
+{
+	sparse_priv->dev_desc = dev_desc;
+
+	sparse->blksz = info->blksz;
+	sparse->start = info->start;
+	sparse->size = info->size;
+	sparse->write = fb_mmc_sparse_write;
+	sparse->reserve = fb_mmc_sparse_reserve;
+	sparse->write_zeroes = fb_mmc_sparse_write_zeroes;
+	sparse->mssg = fastboot_fail;
+	sparse->priv = sparse_priv;
+}
+
 static void write_raw_image(struct blk_desc *dev_desc, disk_partition_t *info,
 		const char *part_name, void *buffer,
 		u32 download_bytes, char *response)
@@ -405,19 +435,11 @@ void fastboot_mmc_flash_write(const char *cmd, void *download_buffer,
 		struct sparse_storage sparse;
 		int err;
 
-		sparse_priv.dev_desc = dev_desc;
-
-		sparse.blksz = info.blksz;
-		sparse.start = info.start;
-		sparse.size = info.size;
-		sparse.write = fb_mmc_sparse_write;
-		sparse.reserve = fb_mmc_sparse_reserve;
-		sparse.mssg = fastboot_fail;
+		fb_mmc_init_sparse(&sparse, &sparse_priv, dev_desc, &info);
 
 		printf("Flashing sparse image at offset " LBAFU "\n",
 		       sparse.start);
 
-		sparse.priv = &sparse_priv;
 		err = write_sparse_image(&sparse, cmd, download_buffer,
 					 response);
 		if (!err)
@@ -428,6 +450,44 @@ void fastboot_mmc_flash_write(const char *cmd, void *download_buffer,
 	}
 }
 
+#if CONFIG_IS_ENABLED(FASTBOOT_FLASH_STREAM)
+/**
+ * fastboot_mmc_stream_start() - Prepare streaming an image to eMMC
+ *
+ * @cmd: Named partition to write image to
+ * @sparse: Storage description to fill in for sparse_stream_init()
+ * @response: Pointer to fastboot response buffer
+ *
+ * Return: 0 on success, or negative error code (response is then set)
+ */
+int fastboot_mmc_stream_start(const char *cmd, struct sparse_storage *sparse,
+			      char *response)
+{
+	static struct fb_mmc_sparse sparse_priv;
+	struct blk_desc *dev_desc;
+	disk_partition_t info;
+
+	dev_desc = blk_get_dev("mmc", CONFIG_FASTBOOT_FLASH_MMC_DEV);
+	if (!dev_desc || dev_desc->type == DEV_TYPE_UNKNOWN) {
+		pr_err("invalid mmc device\n");
+		fastboot_fail("invalid mmc device", response);
+		return -ENODEV;
+	}
+
+	if (part_get_info_by_name_or_alias(dev_desc, cmd, &info) < 0) {
+		pr_err("cannot find partition: '%s'\n", cmd);
+		fastboot_fail("cannot find partition", response);
+		return -ENOENT;
+	}
+
+	fb_mmc_init_sparse(sparse, &sparse_priv, dev_desc, &info);
+	printf("Streaming image to '%s' at offset " LBAFU "\n", cmd,
+	       sparse->start);
+
+	return 0;
+}
+#endif
+
 /**
  * fastboot_mmc_flash_erase() - Erase eMMC for fastboot
  *
@@ -462,6 +522,15 @@ void fastboot_mmc_erase(const char *cmd, char *response)
 		return;
 	}
 
+	/* Zero exactly the partition if the card can, without any alignment */
+	blks = blk_dwrite_zeroes(dev_desc, info.start, info.size);
+	if (blks == info.size) {
+		printf("........ erased " LBAFU " bytes from '%s'\n",
+		       info.size * info.blksz, cmd);
+		fastboot_okay(NULL, response);
+		return;
+	}
+
 	/* Align blocks to erase group size to avoid erasing other partitions */
 	grp_size = mmc->erase_grp_size;
 	blks_start = (info.start + grp_size - 1) & ~(grp_size - 1);
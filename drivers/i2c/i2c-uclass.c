@@ -8,6 +8,7 @@
 #include <errno.h>
 #include <i2c.h>
 #include <malloc.h>
+#include <thread.h>
 #include <dm/device-internal.h>
 #include <dm/lists.h>
 #include <dm/pinctrl.h>
@@ -68,12 +69,26 @@ static int i2c_setup_offset(struct dm_i2c_chip *chip, uint offset,
 	return 0;
 }
 
+/*
+ * Run a transfer with the bus claimed, so that a thread which is part-way
+ * through a transfer on this bus is not interrupted by another one
+ */
+static int i2c_bus_xfer(struct udevice *bus, struct i2c_msg *msg, int nmsgs)
+{
+	int ret;
+
+	thread_claim(bus);
+	ret = i2c_get_ops(bus)->xfer(bus, msg, nmsgs);
+	thread_release(bus);
+
+	return ret;
+}
+
 static int i2c_read_bytewise(struct udevice *dev, uint offset,
 			     uint8_t *buffer, int len)
 {
 	struct dm_i2c_chip *chip = dev_get_parent_platdata(dev);
 	struct udevice *bus = dev_get_parent(dev);
-	struct dm_i2c_ops *ops = i2c_get_ops(bus);
 	struct i2c_msg msg[2], *ptr;
 	uint8_t offset_buf[I2C_MAX_OFFSET_LEN];
 	int ret;
@@ -89,7 +104,7 @@ static int i2c_read_bytewise(struct udevice *dev, uint offset,
 		ptr->buf = &buffer[i];
 		ptr++;
 
-		ret = ops->xfer(bus, msg, ptr - msg);
+		ret = i2c_bus_xfer(bus, msg, ptr - msg);
 		if (ret)
 			return ret;
 	}
@@ -102,7 +117,6 @@ static int i2c_write_bytewise(struct udevice *dev, uint offset,
 {
 	struct dm_i2c_chip *chip = dev_get_parent_platdata(dev);
 	struct udevice *bus = dev_get_parent(dev);
-	struct dm_i2c_ops *ops = i2c_get_ops(bus);
 	struct i2c_msg msg[1];
 	uint8_t buf[I2C_MAX_OFFSET_LEN + 1];
 	int ret;
@@ -113,7 +127,7 @@ static int i2c_write_bytewise(struct udevice *dev, uint offset,
 			return -EINVAL;
 		buf[msg->len++] = buffer[i];
 
-		ret = ops->xfer(bus, msg, 1);
+		ret = i2c_bus_xfer(bus, msg, 1);
 		if (ret)
 			return ret;
 	}
@@ -148,7 +162,7 @@ int dm_i2c_read(struct udevice *dev, uint offset, uint8_t *buffer, int len)
 	}
 	msg_count = ptr - msg;
 
-	return ops->xfer(bus, msg, msg_count);
+	return i2c_bus_xfer(bus, msg, msg_count);
 }
 
 int dm_i2c_write(struct udevice *dev, uint offset, const uint8_t *buffer,
@@ -189,7 +203,7 @@ int dm_i2c_write(struct udevice *dev, uint offset, const uint8_t *buffer,
 		msg->len += len;
 		memcpy(buf + chip->offset_len, buffer, len);
 
-		return ops->xfer(bus, msg, 1);
+		return i2c_bus_xfer(bus, msg, 1);
 	} else {
 		uint8_t *buf;
 		int ret;
@@ -201,7 +215,7 @@ int dm_i2c_write(struct udevice *dev, uint offset, const uint8_t *buffer,
 		msg->len += len;
 		memcpy(buf + chip->offset_len, buffer, len);
 
-		ret = ops->xfer(bus, msg, 1);
+		ret = i2c_bus_xfer(bus, msg, 1);
 		free(buf);
 		return ret;
 	}
@@ -215,7 +229,7 @@ int dm_i2c_xfer(struct udevice *dev, struct i2c_msg *msg, int nmsgs)
 	if (!ops->xfer)
 		return -ENOSYS;
 
-	return ops->xfer(bus, msg, nmsgs);
+	return i2c_bus_xfer(bus, msg, nmsgs);
 }
 
 int dm_i2c_reg_read(struct udevice *dev, uint offset)
@@ -254,7 +268,9 @@ static int i2c_probe_chip(struct udevice *bus, uint chip_addr,
 	int ret;
 
 	if (ops->probe_chip) {
+		thread_claim(bus);
 		ret = ops->probe_chip(bus, chip_addr, chip_flags);
+		thread_release(bus);
 		if (!ret || ret != -ENOSYS)
 			return ret;
 	}
@@ -268,7 +284,7 @@ static int i2c_probe_chip(struct udevice *bus, uint chip_addr,
 	msg->len = 0;
 	msg->buf = NULL;
 
-	return ops->xfer(bus, msg, 1);
+	return i2c_bus_xfer(bus, msg, 1);
 }
 
 static int i2c_bind_driver(struct udevice *bus, uint chip_addr, uint offset_len,
@@ -241,6 +241,10 @@ void mmc_do_preinit(void)
 			continue;
 #ifdef CONFIG_FSL_ESDHC_ADAPTER_IDENT
 		mmc_set_preinit(m, 1);
+#endif
+#if CONFIG_IS_ENABLED(MMC_INIT_ASYNC)
+		if (!mmc_init_async(m))
+			continue;
 #endif
 		if (m->preinit)
 			mmc_start_init(m);
@@ -369,6 +373,8 @@ static const struct blk_ops mmc_blk_ops = {
 #if CONFIG_IS_ENABLED(MMC_WRITE)
 	.write	= mmc_bwrite,
 	.erase	= mmc_berase,
+	.discard	= mmc_bdiscard,
+	.write_zeroes	= mmc_bwrite_zeroes,
 #endif
 	.select_hwpart	= mmc_select_hwpart,
 };
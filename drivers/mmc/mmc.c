@@ -8,6 +8,7 @@
 
 #include <config.h>
 #include <common.h>
+#include <bloblist.h>
 #include <command.h>
 #include <dm.h>
 #include <dm/device-internal.h>
@@ -16,6 +17,7 @@
 #include <part.h>
 #include <power/regulator.h>
 #include <malloc.h>
+#include <thread.h>
 #include <memalign.h>
 #include <linux/list.h>
 #include <div64.h>
@@ -353,11 +355,29 @@ int mmc_send_tuning(struct mmc *mmc, u32 opcode, int *cmd_error)
 }
 #endif
 
+int mmc_set_blockcount(struct mmc *mmc, unsigned int blockcount,
+		       bool is_rel_write)
+{
+	struct mmc_cmd cmd = {0};
+
+	cmd.cmdidx = MMC_CMD_SET_BLOCK_COUNT;
+	cmd.cmdarg = blockcount & 0x0000FFFF;
+	if (is_rel_write)
+		cmd.cmdarg |= 1 << 31;
+	cmd.resp_type = MMC_RSP_R1;
+
+	return mmc_send_cmd(mmc, &cmd, NULL);
+}
+
 static int mmc_read_blocks(struct mmc *mmc, void *dst, lbaint_t start,
 			   lbaint_t blkcnt)
 {
 	struct mmc_cmd cmd;
 	struct mmc_data data;
+	bool sbc = mmc_use_cmd23(mmc, blkcnt);
+
+	if (sbc && mmc_set_blockcount(mmc, blkcnt, false))
+		return 0;
 
 	if (blkcnt > 1)
 		cmd.cmdidx = MMC_CMD_READ_MULTIPLE_BLOCK;
@@ -379,7 +399,7 @@ static int mmc_read_blocks(struct mmc *mmc, void *dst, lbaint_t start,
 	if (mmc_send_cmd(mmc, &cmd, &data))
 		return 0;
 
-	if (blkcnt > 1) {
+	if (blkcnt > 1 && !sbc) {
 		cmd.cmdidx = MMC_CMD_STOP_TRANSMISSION;
 		cmd.cmdarg = 0;
 		cmd.resp_type = MMC_RSP_R1b;
@@ -812,6 +832,10 @@ static int mmc_get_capabilities(struct mmc *mmc)
 	if (mmc_host_is_spi(mmc))
 		return 0;
 
+	/* SET_BLOCK_COUNT was introduced with version 3.1 */
+	if (mmc->version >= MMC_VERSION_3)
+		mmc->card_caps |= MMC_CAP_CMD23;
+
 	/* Only version 4 supports high-speed */
 	if (mmc->version < MMC_VERSION_4)
 		return 0;
@@ -896,9 +920,15 @@ static int mmc_boot_part_access_chk(struct mmc *mmc, unsigned int part_num)
 		change = true;
 	}
 
-	if (change)
-		return mmc_select_mode_and_width(mmc,
-						 mmc->card_caps & ~forbidden);
+	if (change) {
+		int err;
+
+		err = mmc_select_mode_and_width(mmc,
+						mmc->card_caps & ~forbidden);
+		if (err)
+			pr_err("unable to select a mode\n");
+		return err;
+	}
 
 	return 0;
 }
@@ -1240,6 +1270,9 @@ retry_scr:
 	if (mmc->scr[0] & SD_DATA_4BIT)
 		mmc->card_caps |= MMC_MODE_4BIT;
 
+	if (mmc->scr[0] & SD_CMD23_SUPPORT)
+		mmc->card_caps |= MMC_CAP_CMD23;
+
 	/* Version 1.0 doesn't support switching */
 	if (mmc->version == SD_VERSION_1_0)
 		return 0;
@@ -1702,7 +1735,7 @@ error:
 		}
 	}
 
-	pr_err("unable to select a mode\n");
+	pr_debug("unable to select a mode\n");
 	return -ENOTSUPP;
 }
 
@@ -1998,7 +2031,7 @@ error:
 		}
 	}
 
-	pr_err("unable to select a mode\n");
+	pr_debug("unable to select a mode\n");
 
 	return -ENOTSUPP;
 }
@@ -2206,6 +2239,103 @@ error:
 	return err;
 }
 
+#if defined(CONFIG_MMC_MODE_CACHE) && !CONFIG_IS_ENABLED(MMC_TINY)
+/* Number of cards SPL can tell U-Boot proper about */
+#define MMC_MODE_CACHE_HANDOFF	4
+
+static struct mmc_mode_cache *mmc_mode_cache_find(struct mmc *mmc)
+{
+	struct mmc_mode_cache *cache = &mmc->mode_cache;
+	int i;
+
+	if (cache->bus_width &&
+	    !memcmp(cache->cid, mmc->cid, sizeof(mmc->cid)))
+		return cache;
+
+	if (!CONFIG_IS_ENABLED(BLOBLIST))
+		return NULL;
+	cache = bloblist_find(BLOBLISTT_MMC_MODES,
+			      sizeof(*cache) * MMC_MODE_CACHE_HANDOFF);
+	for (i = 0; cache && i < MMC_MODE_CACHE_HANDOFF; i++) {
+		if (cache[i].bus_width &&
+		    !memcmp(cache[i].cid, mmc->cid, sizeof(mmc->cid)))
+			return &cache[i];
+	}
+
+	return NULL;
+}
+
+/*
+ * Try the bus mode and width that last worked for this card, skipping the
+ * search through the faster modes that did not. Returns 0 on success.
+ */
+static int mmc_select_cached_mode(struct mmc *mmc)
+{
+	struct mmc_mode_cache *cache = mmc_mode_cache_find(mmc);
+	uint caps;
+
+	if (!cache)
+		return -ENOENT;
+
+	caps = MMC_CAP(cache->mode);
+	if (cache->bus_width == 8)
+		caps |= MMC_MODE_8BIT;
+	else if (cache->bus_width == 4)
+		caps |= MMC_MODE_4BIT;
+	else
+		caps |= MMC_MODE_1BIT;
+	if ((mmc->card_caps & caps) != caps)
+		return -EINVAL;
+
+	pr_debug("trying cached mode %s width %d\n",
+		 mmc_mode_name(cache->mode), cache->bus_width);
+	if (IS_SD(mmc))
+		return sd_select_mode_and_width(mmc, caps);
+
+	return mmc_select_mode_and_width(mmc, caps);
+}
+
+static void mmc_mode_cache_save(struct mmc *mmc)
+{
+	struct mmc_mode_cache *cache = &mmc->mode_cache;
+	struct mmc_mode_cache *handoff;
+	int i;
+
+	memcpy(cache->cid, mmc->cid, sizeof(cache->cid));
+	cache->mode = mmc->selected_mode;
+	cache->bus_width = mmc->bus_width;
+
+	/* Pass it on to the next phase */
+	if (!CONFIG_IS_ENABLED(BLOBLIST) || !IS_ENABLED(CONFIG_SPL_BUILD))
+		return;
+	handoff = bloblist_find(BLOBLISTT_MMC_MODES,
+				sizeof(*cache) * MMC_MODE_CACHE_HANDOFF);
+	if (!handoff) {
+		handoff = bloblist_add(BLOBLISTT_MMC_MODES,
+				       sizeof(*cache) * MMC_MODE_CACHE_HANDOFF);
+		if (!handoff)
+			return;
+		memset(handoff, '\0', sizeof(*cache) * MMC_MODE_CACHE_HANDOFF);
+	}
+	for (i = 0; i < MMC_MODE_CACHE_HANDOFF; i++) {
+		if (!handoff[i].bus_width ||
+		    !memcmp(handoff[i].cid, cache->cid, sizeof(cache->cid))) {
+			handoff[i] = *cache;
+			break;
+		}
+	}
+}
+#else
+static inline int mmc_select_cached_mode(struct mmc *mmc)
+{
+	return -ENOENT;
+}
+
+static inline void mmc_mode_cache_save(struct mmc *mmc)
+{
+}
+#endif
+
 static int mmc_startup(struct mmc *mmc)
 {
 	int err, i;
@@ -2398,18 +2528,25 @@ static int mmc_startup(struct mmc *mmc)
 		err = sd_get_capabilities(mmc);
 		if (err)
 			return err;
-		err = sd_select_mode_and_width(mmc, mmc->card_caps);
+		if (mmc_select_cached_mode(mmc)) {
+			err = sd_select_mode_and_width(mmc, mmc->card_caps);
+			if (err)
+				pr_err("unable to select a mode\n");
+		}
 	} else {
 		err = mmc_get_capabilities(mmc);
 		if (err)
 			return err;
-		mmc_select_mode_and_width(mmc, mmc->card_caps);
+		if (mmc_select_cached_mode(mmc) &&
+		    mmc_select_mode_and_width(mmc, mmc->card_caps))
+			pr_err("unable to select a mode\n");
 	}
 #endif
 	if (err)
 		return err;
 
 	mmc->best_mode = mmc->selected_mode;
+	mmc_mode_cache_save(mmc);
 
 	/* Fix the block length for DDR mode */
 	if (mmc->ddr_mode) {
@@ -2721,6 +2858,11 @@ int mmc_init(struct mmc *mmc)
 	if (mmc->has_init)
 		return 0;
 
+	/* Wait for any thread which is initialising the card already */
+	thread_claim(mmc);
+	if (mmc->has_init)
+		goto out;
+
 	start = get_timer(0);
 
 	if (!mmc->init_in_progress)
@@ -2730,10 +2872,30 @@ int mmc_init(struct mmc *mmc)
 		err = mmc_complete_init(mmc);
 	if (err)
 		pr_info("%s: %d, time %lu\n", __func__, err, get_timer(start));
+out:
+	thread_release(mmc);
 
 	return err;
 }
 
+#if CONFIG_IS_ENABLED(MMC_INIT_ASYNC)
+static int mmc_init_thread(void *arg)
+{
+	mmc_init(arg);
+
+	/* A failure is reported again when the card is next used */
+	return 0;
+}
+
+int mmc_init_async(struct mmc *mmc)
+{
+	if (!thread_create(mmc->cfg->name, mmc_init_thread, mmc))
+		return -ENOMEM;
+
+	return 0;
+}
+#endif
+
 int mmc_set_dsr(struct mmc *mmc, u16 val)
 {
 	mmc->dsr = val;
@@ -15,6 +15,18 @@ extern int mmc_send_cmd(struct mmc *mmc, struct mmc_cmd *cmd,
 			struct mmc_data *data);
 extern int mmc_send_status(struct mmc *mmc, int timeout);
 extern int mmc_set_blocklen(struct mmc *mmc, int len);
+int mmc_set_blockcount(struct mmc *mmc, unsigned int blockcount,
+		       bool is_rel_write);
+
+/*
+ * Whether a multi-block transfer of @blkcnt blocks can be announced with
+ * SET_BLOCK_COUNT, so that no STOP_TRANSMISSION is needed after it
+ */
+static inline bool mmc_use_cmd23(struct mmc *mmc, lbaint_t blkcnt)
+{
+	return (mmc->card_caps & mmc->host_caps & MMC_CAP_CMD23) &&
+	       blkcnt > 1 && blkcnt <= 0xffff;
+}
 #ifdef CONFIG_FSL_ESDHC_ADAPTER_IDENT
 void mmc_adapter_card_type_ident(void);
 #endif
@@ -33,6 +45,8 @@ ulong mmc_bread(struct blk_desc *block_dev, lbaint_t start, lbaint_t blkcnt,
 ulong mmc_bwrite(struct udevice *dev, lbaint_t start, lbaint_t blkcnt,
 		 const void *src);
 ulong mmc_berase(struct udevice *dev, lbaint_t start, lbaint_t blkcnt);
+ulong mmc_bdiscard(struct udevice *dev, lbaint_t start, lbaint_t blkcnt);
+ulong mmc_bwrite_zeroes(struct udevice *dev, lbaint_t start, lbaint_t blkcnt);
 #else
 ulong mmc_bwrite(struct blk_desc *block_dev, lbaint_t start, lbaint_t blkcnt,
 		 const void *src);
@@ -14,7 +14,11 @@
 #include <linux/math64.h>
 #include "mmc_private.h"
 
-static ulong mmc_erase_t(struct mmc *mmc, ulong start, lbaint_t blkcnt)
+/* Allow a card this long to purge its unmapped blocks, in ms */
+#define MMC_SANITIZE_TIMEOUT	240000
+
+static ulong mmc_erase_t(struct mmc *mmc, ulong start, lbaint_t blkcnt,
+			 u32 arg)
 {
 	struct mmc_cmd cmd;
 	ulong end;
@@ -51,7 +55,7 @@ static ulong mmc_erase_t(struct mmc *mmc, ulong start, lbaint_t blkcnt)
 		goto err_out;
 
 	cmd.cmdidx = MMC_CMD_ERASE;
-	cmd.cmdarg = MMC_ERASE_ARG;
+	cmd.cmdarg = arg;
 	cmd.resp_type = MMC_RSP_R1b;
 
 	err = mmc_send_cmd(mmc, &cmd, NULL);
@@ -65,6 +69,35 @@ err_out:
 	return err;
 }
 
+static ulong mmc_erase_blocks(struct mmc *mmc, lbaint_t start,
+			      lbaint_t blkcnt, u32 arg)
+{
+	lbaint_t blk = 0, blk_r = 0;
+	int timeout = 1000;
+	int err;
+
+	while (blk < blkcnt) {
+		if (IS_SD(mmc) && mmc->ssr.au) {
+			blk_r = ((blkcnt - blk) > mmc->ssr.au) ?
+				mmc->ssr.au : (blkcnt - blk);
+		} else {
+			blk_r = ((blkcnt - blk) > mmc->erase_grp_size) ?
+				mmc->erase_grp_size : (blkcnt - blk);
+		}
+		err = mmc_erase_t(mmc, start + blk, blk_r, arg);
+		if (err)
+			break;
+
+		blk += blk_r;
+
+		/* Waiting for the ready status */
+		if (mmc_send_status(mmc, timeout))
+			return 0;
+	}
+
+	return blk;
+}
+
 #ifdef CONFIG_BLK
 ulong mmc_berase(struct udevice *dev, lbaint_t start, lbaint_t blkcnt)
 #else
@@ -78,8 +111,6 @@ ulong mmc_berase(struct blk_desc *block_dev, lbaint_t start, lbaint_t blkcnt)
 	int err = 0;
 	u32 start_rem, blkcnt_rem;
 	struct mmc *mmc = find_mmc_device(dev_num);
-	lbaint_t blk = 0, blk_r = 0;
-	int timeout = 1000;
 
 	if (!mmc)
 		return -1;
@@ -104,26 +135,111 @@ ulong mmc_berase(struct blk_desc *block_dev, lbaint_t start, lbaint_t blkcnt)
 		       ((start + blkcnt + mmc->erase_grp_size)
 		       & ~(mmc->erase_grp_size - 1)) - 1);
 
-	while (blk < blkcnt) {
-		if (IS_SD(mmc) && mmc->ssr.au) {
-			blk_r = ((blkcnt - blk) > mmc->ssr.au) ?
-				mmc->ssr.au : (blkcnt - blk);
-		} else {
-			blk_r = ((blkcnt - blk) > mmc->erase_grp_size) ?
-				mmc->erase_grp_size : (blkcnt - blk);
-		}
-		err = mmc_erase_t(mmc, start + blk, blk_r);
-		if (err)
-			break;
+	return mmc_erase_blocks(mmc, start, blkcnt, MMC_ERASE_ARG);
+}
 
-		blk += blk_r;
+#if CONFIG_IS_ENABLED(BLK)
+/* Whether the card accepts TRIM, which works on write blocks, not groups */
+static bool mmc_can_trim(struct mmc *mmc)
+{
+	return IS_MMC(mmc) && mmc->ext_csd &&
+	       (mmc->ext_csd[EXT_CSD_SEC_FEATURE_SUPPORT] &
+		EXT_CSD_SEC_GB_CL_EN);
+}
 
-		/* Waiting for the ready status */
-		if (mmc_send_status(mmc, timeout))
-			return 0;
-	}
+/* Whether blocks erased or trimmed by the card are guaranteed to read as 0 */
+static bool mmc_erase_reads_zero(struct mmc *mmc)
+{
+	if (IS_SD(mmc))
+		return !(mmc->scr[0] & SD_DATA_STAT_AFTER_ERASE);
 
-	return blk;
+	return mmc->ext_csd && !mmc->ext_csd[EXT_CSD_ERASED_MEM_CONT];
+}
+
+static struct mmc *mmc_erase_select(struct udevice *dev)
+{
+	struct blk_desc *block_dev = dev_get_uclass_platdata(dev);
+	struct mmc *mmc = find_mmc_device(block_dev->devnum);
+
+	if (!mmc)
+		return NULL;
+
+	if (blk_select_hwpart_devnum(IF_TYPE_MMC, block_dev->devnum,
+				     block_dev->hwpart) < 0)
+		return NULL;
+
+	return mmc;
+}
+
+ulong mmc_bdiscard(struct udevice *dev, lbaint_t start, lbaint_t blkcnt)
+{
+	struct mmc *mmc = mmc_erase_select(dev);
+	u32 arg;
+
+	if (!mmc)
+		return -ENODEV;
+
+	/*
+	 * SD cards erase individual write blocks. eMMC ERASE works on whole
+	 * erase groups, so only use TRIM/DISCARD there, which do not.
+	 */
+	if (IS_SD(mmc))
+		arg = MMC_ERASE_ARG;
+	else if (mmc_can_trim(mmc) && mmc->version >= MMC_VERSION_4_5)
+		arg = MMC_DISCARD_ARG;
+	else if (mmc_can_trim(mmc))
+		arg = MMC_TRIM_ARG;
+	else
+		return -EOPNOTSUPP;
+
+	return mmc_erase_blocks(mmc, start, blkcnt, arg);
+}
+
+ulong mmc_bwrite_zeroes(struct udevice *dev, lbaint_t start, lbaint_t blkcnt)
+{
+	struct mmc *mmc = mmc_erase_select(dev);
+	u32 arg;
+
+	if (!mmc)
+		return -ENODEV;
+
+	/* DISCARD leaves the contents undefined, so only ERASE or TRIM */
+	if (!mmc_erase_reads_zero(mmc))
+		return -EOPNOTSUPP;
+	if (IS_SD(mmc))
+		arg = MMC_ERASE_ARG;
+	else if (mmc_can_trim(mmc))
+		arg = MMC_TRIM_ARG;
+	else
+		return -EOPNOTSUPP;
+
+	return mmc_erase_blocks(mmc, start, blkcnt, arg);
+}
+#endif
+
+int mmc_sanitize(struct mmc *mmc)
+{
+	struct mmc_cmd cmd;
+	int err;
+
+	if (!IS_MMC(mmc) || !mmc->ext_csd ||
+	    !(mmc->ext_csd[EXT_CSD_SEC_FEATURE_SUPPORT] & EXT_CSD_SEC_SANITIZE))
+		return -EOPNOTSUPP;
+
+	/*
+	 * Sanitizing can keep the card busy for minutes, far longer than
+	 * hosts wait on an R1b response, so poll the status instead.
+	 */
+	cmd.cmdidx = MMC_CMD_SWITCH;
+	cmd.resp_type = MMC_RSP_R1;
+	cmd.cmdarg = (MMC_SWITCH_MODE_WRITE_BYTE << 24) |
+		     (EXT_CSD_SANITIZE_START << 16) | (1 << 8);
+
+	err = mmc_send_cmd(mmc, &cmd, NULL);
+	if (err)
+		return err;
+
+	return mmc_send_status(mmc, MMC_SANITIZE_TIMEOUT);
 }
 
 static ulong mmc_write_blocks(struct mmc *mmc, lbaint_t start,
@@ -132,6 +248,7 @@ static ulong mmc_write_blocks(struct mmc *mmc, lbaint_t start,
 	struct mmc_cmd cmd;
 	struct mmc_data data;
 	int timeout = 1000;
+	bool sbc = !mmc_host_is_spi(mmc) && mmc_use_cmd23(mmc, blkcnt);
 
 	if ((start + blkcnt) > mmc_get_blk_desc(mmc)->lba) {
 		printf("MMC: block number 0x" LBAF " exceeds max(0x" LBAF ")\n",
@@ -139,6 +256,11 @@ static ulong mmc_write_blocks(struct mmc *mmc, lbaint_t start,
 		return 0;
 	}
 
+	if (sbc && mmc_set_blockcount(mmc, blkcnt, false)) {
+		printf("mmc fail to set block count\n");
+		return 0;
+	}
+
 	if (blkcnt == 0)
 		return 0;
 	else if (blkcnt == 1)
@@ -166,7 +288,7 @@ static ulong mmc_write_blocks(struct mmc *mmc, lbaint_t start,
 	/* SPI multiblock writes terminate using a special
 	 * token, not a STOP_TRANSMISSION request.
 	 */
-	if (!mmc_host_is_spi(mmc) && blkcnt > 1) {
+	if (!mmc_host_is_spi(mmc) && blkcnt > 1 && !sbc) {
 		cmd.cmdidx = MMC_CMD_STOP_TRANSMISSION;
 		cmd.cmdarg = 0;
 		cmd.resp_type = MMC_RSP_R1b;
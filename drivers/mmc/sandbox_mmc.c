@@ -14,19 +14,38 @@
 struct sandbox_mmc_plat {
 	struct mmc_config cfg;
 	struct mmc mmc;
+	uint sbc;		/* block count set by CMD23, 0 if none */
+	bool stopped;		/* last transfer needs no CMD12 */
+	uint erase_start;	/* first block of the erase range */
+	uint erase_end;		/* last block of the erase range */
 };
 
 /**
  * sandbox_mmc_send_cmd() - Emulate SD commands
  *
  * This emulate an SD card version 2. Single-block reads result in zero data.
- * Multiple-block reads return a test string.
+ * Multiple-block reads return a test string. Multiple-block transfers must
+ * be either open-ended or announced by CMD23, but not both. Erases must set
+ * up a valid range first.
  */
 static int sandbox_mmc_send_cmd(struct udevice *dev, struct mmc_cmd *cmd,
 				struct mmc_data *data)
 {
+	struct sandbox_mmc_plat *plat = dev_get_platdata(dev);
+
+	if (data && data->blocks > 1) {
+		if (plat->sbc && plat->sbc != data->blocks)
+			return -EIO;
+		plat->stopped = plat->sbc;
+		plat->sbc = 0;
+	}
+
 	switch (cmd->cmdidx) {
 	case MMC_CMD_ALL_SEND_CID:
+		cmd->response[0] = 0x1b534d53;	/* SM, "S */
+		cmd->response[1] = 0x414e4442;	/* ANDB */
+		cmd->response[2] = 0x10000000;
+		cmd->response[3] = 0x00012000;
 		break;
 	case SD_CMD_SEND_RELATIVE_ADDR:
 		cmd->response[0] = 0 << 16; /* mmc->rca */
@@ -48,9 +67,10 @@ static int sandbox_mmc_send_cmd(struct udevice *dev, struct mmc_cmd *cmd,
 		if (!data)
 			break;
 		u32 *resp = (u32 *)data->dest;
+		memset(resp, '\0', 64);
+		resp[3] = cpu_to_be32(SD_HIGHSPEED_SUPPORTED);
+		resp[4] = cpu_to_be32((cmd->cmdarg & 0xF) << 24);
 		resp[7] = cpu_to_be32(SD_HIGHSPEED_BUSY);
-		if ((cmd->cmdarg & 0xF) == UHS_SDR12_BUS_SPEED)
-			resp[4] = (cmd->cmdarg & 0xF) << 24;
 		break;
 	}
 	case MMC_CMD_READ_SINGLE_BLOCK:
@@ -60,6 +80,22 @@ static int sandbox_mmc_send_cmd(struct udevice *dev, struct mmc_cmd *cmd,
 		strcpy(data->dest, "this is a test");
 		break;
 	case MMC_CMD_STOP_TRANSMISSION:
+		if (plat->stopped)
+			return -EILSEQ;
+		break;
+	case SD_CMD_ERASE_WR_BLK_START:
+		plat->erase_start = cmd->cmdarg;
+		break;
+	case SD_CMD_ERASE_WR_BLK_END:
+		plat->erase_end = cmd->cmdarg;
+		break;
+	case MMC_CMD_ERASE:
+		if (cmd->cmdarg != MMC_ERASE_ARG ||
+		    plat->erase_end < plat->erase_start)
+			return -EIO;
+		break;
+	case MMC_CMD_SET_BLOCK_COUNT:
+		plat->sbc = cmd->cmdarg & 0xffff;
 		break;
 	case SD_CMD_APP_SEND_OP_COND:
 		cmd->response[0] = OCR_BUSY | OCR_HCS;
@@ -74,7 +110,9 @@ static int sandbox_mmc_send_cmd(struct udevice *dev, struct mmc_cmd *cmd,
 	case SD_CMD_APP_SEND_SCR: {
 		u32 *scr = (u32 *)data->dest;
 
-		scr[0] = cpu_to_be32(2 << 24 | 1 << 15);  /* SD version 3 */
+		/* SD version 3 */
+		scr[0] = cpu_to_be32(2 << 24 | 1 << 15 | SD_DATA_4BIT |
+				     SD_CMD23_SUPPORT);
 		break;
 	}
 	default:
@@ -114,7 +152,8 @@ int sandbox_mmc_bind(struct udevice *dev)
 	struct mmc_config *cfg = &plat->cfg;
 
 	cfg->name = dev->name;
-	cfg->host_caps = MMC_MODE_HS_52MHz | MMC_MODE_HS | MMC_MODE_8BIT;
+	cfg->host_caps = MMC_MODE_HS_52MHz | MMC_MODE_HS | MMC_MODE_4BIT |
+			 MMC_MODE_8BIT | MMC_CAP_CMD23;
 	cfg->voltages = MMC_VDD_165_195 | MMC_VDD_32_33 | MMC_VDD_33_34;
 	cfg->f_min = 1000000;
 	cfg->f_max = 52000000;
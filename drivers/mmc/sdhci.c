@@ -72,12 +72,6 @@ static int sdhci_transfer_data(struct sdhci_host *host, struct mmc_data *data,
 {
 	unsigned int stat, rdy, mask, timeout, block = 0;
 	bool transfer_done = false;
-#ifdef CONFIG_MMC_SDHCI_SDMA
-	unsigned char ctrl;
-	ctrl = sdhci_readb(host, SDHCI_HOST_CONTROL);
-	ctrl &= ~SDHCI_CTRL_DMA_MASK;
-	sdhci_writeb(host, ctrl, SDHCI_HOST_CONTROL);
-#endif
 
 	timeout = 1000000;
 	rdy = SDHCI_INT_SPACE_AVAIL | SDHCI_INT_DATA_AVAIL;
@@ -105,7 +99,8 @@ static int sdhci_transfer_data(struct sdhci_host *host, struct mmc_data *data,
 			}
 		}
 #ifdef CONFIG_MMC_SDHCI_SDMA
-		if (!transfer_done && (stat & SDHCI_INT_DMA_END)) {
+		if (!transfer_done && (host->flags & USE_SDMA) &&
+		    (stat & SDHCI_INT_DMA_END)) {
 			sdhci_writel(host, SDHCI_INT_DMA_END, SDHCI_INT_STATUS);
 			start_addr &= ~(SDHCI_DEFAULT_BOUNDARY_SIZE - 1);
 			start_addr += SDHCI_DEFAULT_BOUNDARY_SIZE;
@@ -122,6 +117,121 @@ static int sdhci_transfer_data(struct sdhci_host *host, struct mmc_data *data,
 	return 0;
 }
 
+#ifdef CONFIG_MMC_SDHCI_ADMA
+/*
+ * Describe @len bytes at @addr to the controller, in as few descriptors
+ * as possible. Returns false if the table is too small for them.
+ */
+static bool sdhci_prepare_adma_table(struct sdhci_host *host, ulong addr,
+				     unsigned int len)
+{
+	unsigned int desc_len = host->flags & USE_ADMA64 ? ADMA64_DESC_LEN :
+							   ADMA32_DESC_LEN;
+	void *desc = host->adma_desc_table;
+	struct sdhci_adma_desc *d;
+	unsigned int n;
+
+	if (DIV_ROUND_UP(len, ADMA_MAX_LEN) > ADMA_TABLE_NO_ENTRIES)
+		return false;
+
+	do {
+		n = min_t(unsigned int, len, ADMA_MAX_LEN);
+		len -= n;
+		d = desc;
+		d->attr = cpu_to_le16(ADMA_DESC_ATTR_VALID |
+				      ADMA_DESC_TRANSFER_DATA |
+				      (len ? 0 : ADMA_DESC_ATTR_END));
+		d->len = cpu_to_le16(n);
+		d->addr_lo = cpu_to_le32(lower_32_bits(addr));
+		if (host->flags & USE_ADMA64)
+			d->addr_hi = cpu_to_le32(upper_32_bits(addr));
+		addr += n;
+		desc += desc_len;
+	} while (len);
+
+	flush_cache((ulong)host->adma_desc_table,
+		    ALIGN(desc - host->adma_desc_table, ARCH_DMA_MINALIGN));
+
+	sdhci_writel(host, lower_32_bits((ulong)host->adma_desc_table),
+		     SDHCI_ADMA_ADDRESS);
+	if (host->flags & USE_ADMA64)
+		sdhci_writel(host, upper_32_bits((ulong)host->adma_desc_table),
+			     SDHCI_ADMA_ADDRESS_HI);
+
+	return true;
+}
+#endif
+
+#if defined(CONFIG_MMC_SDHCI_SDMA) || defined(CONFIG_MMC_SDHCI_ADMA)
+/*
+ * Set the controller up to move the data of @data by DMA. Returns false if
+ * the transfer has to be done by PIO instead.
+ */
+static bool sdhci_prepare_dma(struct sdhci_host *host, struct mmc_data *data,
+			      int *is_aligned, int trans_bytes,
+			      unsigned int *start_addr)
+{
+	unsigned char ctrl;
+	ulong addr;
+
+	if (!(host->flags & USE_DMA))
+		return false;
+
+	if (data->flags == MMC_DATA_READ)
+		addr = (ulong)data->dest;
+	else
+		addr = (ulong)data->src;
+
+#ifdef CONFIG_MMC_SDHCI_ADMA
+	if (host->flags & (USE_ADMA | USE_ADMA64)) {
+		/* ADMA2 needs 4-byte (8-byte for 64-bit) aligned data */
+		if (addr & (host->flags & USE_ADMA64 ? 0x7 : 0x3))
+			return false;
+		if (!(host->flags & USE_ADMA64) && upper_32_bits(addr))
+			return false;
+		if (!sdhci_prepare_adma_table(host, addr, trans_bytes))
+			return false;
+	}
+#endif
+
+	ctrl = sdhci_readb(host, SDHCI_HOST_CONTROL);
+	ctrl &= ~SDHCI_CTRL_DMA_MASK;
+	if (host->flags & USE_ADMA64)
+		ctrl |= SDHCI_CTRL_ADMA64;
+	else if (host->flags & USE_ADMA)
+		ctrl |= SDHCI_CTRL_ADMA32;
+	sdhci_writeb(host, ctrl, SDHCI_HOST_CONTROL);
+
+	if (host->flags & USE_SDMA) {
+		if ((host->quirks & SDHCI_QUIRK_32BIT_DMA_ADDR) &&
+		    (addr & 0x7) != 0x0) {
+			*is_aligned = 0;
+			addr = (ulong)aligned_buffer;
+			if (data->flags != MMC_DATA_READ)
+				memcpy(aligned_buffer, data->src, trans_bytes);
+		}
+
+#if defined(CONFIG_FIXED_SDHCI_ALIGNED_BUFFER)
+		/*
+		 * Always use this bounce-buffer when
+		 * CONFIG_FIXED_SDHCI_ALIGNED_BUFFER is defined
+		 */
+		*is_aligned = 0;
+		addr = (ulong)aligned_buffer;
+		if (data->flags != MMC_DATA_READ)
+			memcpy(aligned_buffer, data->src, trans_bytes);
+#endif
+
+		sdhci_writel(host, addr, SDHCI_DMA_ADDRESS);
+	}
+
+	*start_addr = addr;
+	flush_cache(addr, ALIGN(trans_bytes, CONFIG_SYS_CACHELINE_SIZE));
+
+	return true;
+}
+#endif
+
 /*
  * No command will be sent by driver if card is busy, so driver must wait
  * for card ready state.
@@ -156,6 +266,28 @@ static int sdhci_send_command(struct mmc *mmc, struct mmc_cmd *cmd,
 	/* Timeout unit - ms */
 	static unsigned int cmd_timeout = SDHCI_CMD_DEFAULT_TIMEOUT;
 
+	if (cmd->cmdidx == MMC_CMD_SET_BLOCK_COUNT) {
+		/*
+		 * Auto CMD23 sends it along with the transfer. It only carries
+		 * a block count, so anything else, such as the reliable-write
+		 * flag used by RPMB, goes to the card as it is.
+		 */
+		if ((host->flags & USE_AUTO_CMD23) &&
+		    !(cmd->cmdarg & ~0xffff) && cmd->cmdarg > 1) {
+			host->sbc = SDHCI_SBC_AUTO;
+			host->sbc_arg = cmd->cmdarg;
+			cmd->response[0] = 0;
+			return 0;
+		}
+		host->sbc = SDHCI_SBC_SENT;
+	} else if (cmd->cmdidx == MMC_CMD_STOP_TRANSMISSION &&
+		   host->auto_cmd12) {
+		/* Auto CMD12 already stopped the transfer */
+		host->auto_cmd12 = false;
+		cmd->response[0] = sdhci_readl(host, SDHCI_RESPONSE + 12);
+		return 0;
+	}
+
 	mask = SDHCI_CMD_INHIBIT | SDHCI_DATA_INHIBIT;
 
 	/* We shouldn't wait for data inihibit for stop commands, even
@@ -212,39 +344,31 @@ static int sdhci_send_command(struct mmc *mmc, struct mmc_cmd *cmd,
 		sdhci_writeb(host, 0xe, SDHCI_TIMEOUT_CONTROL);
 		mode = SDHCI_TRNS_BLK_CNT_EN;
 		trans_bytes = data->blocks * data->blocksize;
-		if (data->blocks > 1)
+		host->auto_cmd12 = false;
+		/* A held-back CMD23 is always used by the next transfer */
+		if (host->sbc == SDHCI_SBC_AUTO) {
+			mode |= SDHCI_TRNS_MULTI | SDHCI_TRNS_AUTO_CMD23;
+		} else if (data->blocks > 1) {
 			mode |= SDHCI_TRNS_MULTI;
+			if (host->sbc == SDHCI_SBC_NONE &&
+			    (host->flags & USE_AUTO_CMD12)) {
+				mode |= SDHCI_TRNS_ACMD12;
+				host->auto_cmd12 = true;
+			}
+		}
 
 		if (data->flags == MMC_DATA_READ)
 			mode |= SDHCI_TRNS_READ;
 
-#ifdef CONFIG_MMC_SDHCI_SDMA
-		if (data->flags == MMC_DATA_READ)
-			start_addr = (unsigned long)data->dest;
-		else
-			start_addr = (unsigned long)data->src;
-		if ((host->quirks & SDHCI_QUIRK_32BIT_DMA_ADDR) &&
-				(start_addr & 0x7) != 0x0) {
-			is_aligned = 0;
-			start_addr = (unsigned long)aligned_buffer;
-			if (data->flags != MMC_DATA_READ)
-				memcpy(aligned_buffer, data->src, trans_bytes);
-		}
-
-#if defined(CONFIG_FIXED_SDHCI_ALIGNED_BUFFER)
-		/*
-		 * Always use this bounce-buffer when
-		 * CONFIG_FIXED_SDHCI_ALIGNED_BUFFER is defined
-		 */
-		is_aligned = 0;
-		start_addr = (unsigned long)aligned_buffer;
-		if (data->flags != MMC_DATA_READ)
-			memcpy(aligned_buffer, data->src, trans_bytes);
-#endif
-
-		sdhci_writel(host, start_addr, SDHCI_DMA_ADDRESS);
-		mode |= SDHCI_TRNS_DMA;
+#if defined(CONFIG_MMC_SDHCI_SDMA) || defined(CONFIG_MMC_SDHCI_ADMA)
+		if (sdhci_prepare_dma(host, data, &is_aligned, trans_bytes,
+				      &start_addr))
+			mode |= SDHCI_TRNS_DMA;
 #endif
+		/* SDMA is never used with Auto CMD23, see sdhci_setup_cfg() */
+		if (mode & SDHCI_TRNS_AUTO_CMD23)
+			sdhci_writel(host, host->sbc_arg, SDHCI_ARGUMENT2);
+		host->sbc = SDHCI_SBC_NONE;
 		sdhci_writew(host, SDHCI_MAKE_BLKSZ(SDHCI_DEFAULT_BOUNDARY_ARG,
 				data->blocksize),
 				SDHCI_BLOCK_SIZE);
@@ -255,12 +379,6 @@ static int sdhci_send_command(struct mmc *mmc, struct mmc_cmd *cmd,
 	}
 
 	sdhci_writel(host, cmd->cmdarg, SDHCI_ARGUMENT);
-#ifdef CONFIG_MMC_SDHCI_SDMA
-	if (data) {
-		trans_bytes = ALIGN(trans_bytes, CONFIG_SYS_CACHELINE_SIZE);
-		flush_cache(start_addr, trans_bytes);
-	}
-#endif
 	sdhci_writew(host, SDHCI_MAKE_CMD(cmd->cmdidx, flags), SDHCI_COMMAND);
 	start = get_timer(0);
 	do {
@@ -274,6 +392,8 @@ static int sdhci_send_command(struct mmc *mmc, struct mmc_cmd *cmd,
 			} else {
 				printf("%s: Timeout for status update!\n",
 				       __func__);
+				host->auto_cmd12 = false;
+				host->sbc = SDHCI_SBC_NONE;
 				return -ETIMEDOUT;
 			}
 		}
@@ -300,6 +420,9 @@ static int sdhci_send_command(struct mmc *mmc, struct mmc_cmd *cmd,
 		return 0;
 	}
 
+	/* The core sends its own CMD12 after a failed transfer */
+	host->auto_cmd12 = false;
+	host->sbc = SDHCI_SBC_NONE;
 	sdhci_reset(host, SDHCI_RESET_CMD);
 	sdhci_reset(host, SDHCI_RESET_DATA);
 	if (stat & SDHCI_INT_TIMEOUT)
@@ -520,6 +643,18 @@ static int sdhci_init(struct mmc *mmc)
 		}
 	}
 
+#ifdef CONFIG_MMC_SDHCI_ADMA
+	if ((host->flags & (USE_ADMA | USE_ADMA64)) &&
+	    !host->adma_desc_table) {
+		host->adma_desc_table = memalign(ARCH_DMA_MINALIGN,
+						 ADMA_TABLE_SZ);
+		if (!host->adma_desc_table) {
+			printf("%s: ADMA table alloc failed!!!\n", __func__);
+			return -ENOMEM;
+		}
+	}
+#endif
+
 	sdhci_set_power(host, fls(mmc->cfg->voltages) - 1);
 
 	if (host->ops && host->ops->get_cd)
@@ -564,11 +699,23 @@ int sdhci_setup_cfg(struct mmc_config *cfg, struct sdhci_host *host,
 
 	caps = sdhci_readl(host, SDHCI_CAPABILITIES);
 
+	host->flags &= ~(USE_DMA | USE_AUTO_CMD12 | USE_AUTO_CMD23);
+#ifdef CONFIG_MMC_SDHCI_ADMA
+	if (caps & SDHCI_CAN_DO_ADMA2) {
+		host->flags |= USE_ADMA;
+		if (IS_ENABLED(CONFIG_DMA_ADDR_T_64BIT) &&
+		    (caps & SDHCI_CAN_64BIT))
+			host->flags |= USE_ADMA64;
+	}
+#endif
 #ifdef CONFIG_MMC_SDHCI_SDMA
-	if (!(caps & SDHCI_CAN_DO_SDMA)) {
-		printf("%s: Your controller doesn't support SDMA!!\n",
-		       __func__);
-		return -EINVAL;
+	if (!(host->flags & USE_DMA)) {
+		if (!(caps & SDHCI_CAN_DO_SDMA)) {
+			printf("%s: Your controller doesn't support SDMA!!\n",
+			       __func__);
+			return -EINVAL;
+		}
+		host->flags |= USE_SDMA;
 	}
 #endif
 	if (host->quirks & SDHCI_QUIRK_REG32_RW)
@@ -670,7 +817,33 @@ int sdhci_setup_cfg(struct mmc_config *cfg, struct sdhci_host *host,
 	if (host->host_caps)
 		cfg->host_caps |= host->host_caps;
 
+	/*
+	 * As in Linux, v3.00 hosts use CMD23 when the card supports it. The
+	 * Auto CMD23 argument shares its register with SDMA.
+	 */
+	if (SDHCI_GET_VERSION(host) >= SDHCI_SPEC_300 &&
+	    !(host->quirks & SDHCI_QUIRK_BROKEN_CMD23)) {
+		cfg->host_caps |= MMC_CAP_CMD23;
+		if (!(host->flags & USE_SDMA))
+			host->flags |= USE_AUTO_CMD23;
+	}
+	if (host->quirks & SDHCI_QUIRK_BROKEN_CMD23)
+		cfg->host_caps &= ~MMC_CAP_CMD23;
+	if (host->quirks & SDHCI_QUIRK_USE_AUTO_CMD12)
+		host->flags |= USE_AUTO_CMD12;
+
+	/*
+	 * The block count register is 16 bits wide. PIO and SDMA (which
+	 * stops at each boundary) can move that many blocks at once, and
+	 * the ADMA table is sized for it.
+	 */
 	cfg->b_max = CONFIG_SYS_MMC_MAX_BLK_COUNT;
+	/* SDMA bounces misaligned buffers through aligned_buffer */
+	if ((host->flags & USE_SDMA) &&
+	    (host->quirks & SDHCI_QUIRK_32BIT_DMA_ADDR))
+		cfg->b_max = min_t(uint, cfg->b_max,
+				   SDHCI_DEFAULT_BOUNDARY_SIZE /
+				   MMC_MAX_BLOCK_LEN);
 
 	return 0;
 }
@@ -126,8 +126,10 @@ void nc_start(void)
 		pkt = (uchar *)net_tx_packet + net_eth_hdr_size() +
 			IP_UDP_HDR_SIZE;
 		memcpy(pkt, output_packet, output_packet_len);
-		net_send_udp_packet(nc_ether, nc_ip, nc_out_port, nc_in_port,
-				    output_packet_len);
+		if (!net_send_udp_packet(nc_ether, nc_ip, nc_out_port,
+					 nc_in_port, output_packet_len))
+			/* MAC came from the ARP cache, no reply to wait for */
+			net_set_state(NETLOOP_SUCCESS);
 	}
 }
 
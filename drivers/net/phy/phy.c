@@ -678,7 +678,9 @@ int __weak get_phy_id(struct mii_dev *bus, int addr, int devad, u32 *phy_id)
 	 * Grab the bits from PHYIR1, and put them
 	 * in the upper half
 	 */
+	thread_claim(bus);
 	phy_reg = bus->read(bus, addr, devad, MII_PHYSID1);
+	thread_release(bus);
 
 	if (phy_reg < 0)
 		return -EIO;
@@ -686,7 +688,9 @@ int __weak get_phy_id(struct mii_dev *bus, int addr, int devad, u32 *phy_id)
 	*phy_id = (phy_reg & 0xffff) << 16;
 
 	/* Grab the bits from PHYIR2, and put them in the lower half */
+	thread_claim(bus);
 	phy_reg = bus->read(bus, addr, devad, MII_PHYSID2);
+	thread_release(bus);
 
 	if (phy_reg < 0)
 		return -EIO;
@@ -916,12 +920,39 @@ struct phy_device *phy_connect(struct mii_dev *bus, int addr,
  */
 int phy_startup(struct phy_device *phydev)
 {
+	int ret = 0;
+
+	/* Wait for any thread which is starting the PHY already */
+	thread_claim(phydev);
 	if (phydev->drv->startup)
-		return phydev->drv->startup(phydev);
+		ret = phydev->drv->startup(phydev);
+	thread_release(phydev);
+
+	return ret;
+}
+
+#if CONFIG_IS_ENABLED(PHY_STARTUP_ASYNC)
+static int phy_startup_thread(void *arg)
+{
+	phy_startup(arg);
 
+	/* The link is checked again when the network is first used */
 	return 0;
 }
 
+/*
+ * Start the PHY in a new thread, so that waiting for autonegotiation
+ * overlaps with other work. Returns 0 on success, or -ENOMEM.
+ */
+int phy_startup_async(struct phy_device *phydev)
+{
+	if (!thread_create(phydev->drv->name, phy_startup_thread, phydev))
+		return -ENOMEM;
+
+	return 0;
+}
+#endif
+
 __weak int board_phy_config(struct phy_device *phydev)
 {
 	if (phydev->drv->config)
@@ -931,14 +962,25 @@ __weak int board_phy_config(struct phy_device *phydev)
 
 int phy_config(struct phy_device *phydev)
 {
+	int ret;
+
 	/* Invoke an optional board-specific helper */
-	return board_phy_config(phydev);
+	ret = board_phy_config(phydev);
+#if CONFIG_IS_ENABLED(PHY_STARTUP_ASYNC)
+	if (!ret && phy_startup_async(phydev))
+		debug("%s: Cannot start thread\n", __func__);
+#endif
+
+	return ret;
 }
 
 int phy_shutdown(struct phy_device *phydev)
 {
+	/* Do not shut down a PHY which a thread is still starting */
+	thread_claim(phydev);
 	if (phydev->drv->shutdown)
 		phydev->drv->shutdown(phydev);
+	thread_release(phydev);
 
 	return 0;
 }
@@ -12,13 +12,18 @@
 #include <dm/device-internal.h>
 #include "nvme.h"
 
-#define NVME_Q_DEPTH		2
+#define NVME_Q_DEPTH		CONFIG_NVME_QUEUE_DEPTH
 #define NVME_AQ_DEPTH		2
 #define NVME_SQ_SIZE(depth)	(depth * sizeof(struct nvme_command))
 #define NVME_CQ_SIZE(depth)	(depth * sizeof(struct nvme_completion))
 #define ADMIN_TIMEOUT		60
 #define IO_TIMEOUT		30
-#define MAX_PRP_POOL		512
+/*
+ * Largest transfer per I/O command. Several of these are kept in flight,
+ * so there is little to gain from more, and it keeps each PRP list within
+ * a single page.
+ */
+#define MAX_TRANSFER_SHIFT	20
 
 enum nvme_queue_id {
 	NVME_ADMIN_Q,
@@ -65,12 +70,21 @@ static int nvme_wait_ready(struct nvme_dev *dev, bool enabled)
 	return -ETIME;
 }
 
+/**
+ * nvme_setup_prps() - describe a buffer with a PRP list
+ *
+ * @dev:	NVMe device
+ * @prp2:	Returns the value for the PRP2 field of the command
+ * @total_len:	Length of the buffer in bytes
+ * @dma_addr:	Address of the buffer, which goes into PRP1
+ * @prp_list:	Page to build the PRP list in, if one is needed
+ * @return 0 if OK, -EINVAL if the buffer does not fit in one PRP list
+ */
 static int nvme_setup_prps(struct nvme_dev *dev, u64 *prp2,
-			   int total_len, u64 dma_addr)
+			   int total_len, u64 dma_addr, u64 *prp_list)
 {
 	u32 page_size = dev->page_size;
 	int offset = dma_addr & (page_size - 1);
-	u64 *prp_pool;
 	int length = total_len;
 	int i, nprps;
 	length -= (page_size - offset);
@@ -89,31 +103,15 @@ static int nvme_setup_prps(struct nvme_dev *dev, u64 *prp2,
 	}
 
 	nprps = DIV_ROUND_UP(length, page_size);
+	if (nprps > page_size >> 3)
+		return -EINVAL;
 
-	if (nprps > dev->prp_entry_num) {
-		free(dev->prp_pool);
-		dev->prp_pool = malloc(nprps << 3);
-		if (!dev->prp_pool) {
-			printf("Error: malloc prp_pool fail\n");
-			return -ENOMEM;
-		}
-		dev->prp_entry_num = nprps;
-	}
-
-	prp_pool = dev->prp_pool;
-	i = 0;
-	while (nprps) {
-		if (i == ((page_size >> 3) - 1)) {
-			*(prp_pool + i) = cpu_to_le64((ulong)prp_pool +
-					page_size);
-			i = 0;
-			prp_pool += page_size;
-		}
-		*(prp_pool + i++) = cpu_to_le64(dma_addr);
+	for (i = 0; i < nprps; i++) {
+		prp_list[i] = cpu_to_le64(dma_addr);
 		dma_addr += page_size;
-		nprps--;
 	}
-	*prp2 = (ulong)dev->prp_pool;
+	flush_dcache_range((ulong)prp_list, (ulong)prp_list + page_size);
+	*prp2 = (ulong)prp_list;
 
 	return 0;
 }
@@ -155,9 +153,18 @@ static void nvme_submit_cmd(struct nvme_queue *nvmeq, struct nvme_command *cmd)
 	nvmeq->sq_tail = tail;
 }
 
-static int nvme_submit_sync_cmd(struct nvme_queue *nvmeq,
-				struct nvme_command *cmd,
-				u32 *result, unsigned timeout)
+/**
+ * nvme_wait_cmd() - wait for the next completion on a queue and consume it
+ *
+ * @nvmeq:	The queue to use
+ * @cmdid:	Returns the ID of the completed command, if not NULL
+ * @result:	Returns the command-specific result, if not NULL
+ * @timeout:	Timeout in units of 100ms, 0 to wait forever
+ * @return 0 if the command succeeded, -EIO if it failed, -ETIMEDOUT if no
+ * command completed in time
+ */
+static int nvme_wait_cmd(struct nvme_queue *nvmeq, u16 *cmdid, u32 *result,
+			 unsigned int timeout)
 {
 	u16 head = nvmeq->cq_head;
 	u16 phase = nvmeq->cq_phase;
@@ -165,9 +172,6 @@ static int nvme_submit_sync_cmd(struct nvme_queue *nvmeq,
 	ulong start_time;
 	ulong timeout_us = timeout * 100000;
 
-	cmd->common.command_id = nvme_get_cmd_id();
-	nvme_submit_cmd(nvmeq, cmd);
-
 	start_time = timer_get_us();
 
 	for (;;) {
@@ -179,6 +183,9 @@ static int nvme_submit_sync_cmd(struct nvme_queue *nvmeq,
 			return -ETIMEDOUT;
 	}
 
+	if (cmdid)
+		*cmdid = le16_to_cpu(readw(&nvmeq->cqes[head].command_id));
+
 	status >>= 1;
 	if (status) {
 		printf("ERROR: status = %x, phase = %d, head = %d\n",
@@ -209,6 +216,16 @@ static int nvme_submit_sync_cmd(struct nvme_queue *nvmeq,
 	return status;
 }
 
+static int nvme_submit_sync_cmd(struct nvme_queue *nvmeq,
+				struct nvme_command *cmd,
+				u32 *result, unsigned timeout)
+{
+	cmd->common.command_id = nvme_get_cmd_id();
+	nvme_submit_cmd(nvmeq, cmd);
+
+	return nvme_wait_cmd(nvmeq, NULL, result, timeout);
+}
+
 static int nvme_submit_admin_cmd(struct nvme_dev *dev, struct nvme_command *cmd,
 				 u32 *result)
 {
@@ -597,18 +614,13 @@ static int nvme_get_info_from_identify(struct nvme_dev *dev)
 		 * and is reported as a power of two (2^n).
 		 *
 		 * The spec also says: a value of 0h indicates no restrictions
-		 * on transfer size. But in nvme_blk_read/write() below we have
-		 * the following algorithm for maximum number of logic blocks
-		 * per transfer:
-		 *
-		 * u16 lbas = 1 << (dev->max_transfer_shift - ns->lba_shift);
-		 *
-		 * In order for lbas not to overflow, the maximum number is 15
-		 * which means dev->max_transfer_shift = 15 + 9 (ns->lba_shift).
-		 * Let's use 20 which provides 1MB size.
+		 * on transfer size. Transfers are capped at MAX_TRANSFER_SHIFT
+		 * anyway, so use 20 which provides 1MB size.
 		 */
 		dev->max_transfer_shift = 20;
 	}
+	dev->max_transfer_shift = min(dev->max_transfer_shift,
+				      (u32)MAX_TRANSFER_SHIFT);
 
 	return 0;
 }
@@ -673,60 +685,90 @@ static ulong nvme_blk_rw(struct udevice *udev, lbaint_t blknr,
 {
 	struct nvme_ns *ns = dev_get_priv(udev);
 	struct nvme_dev *dev = ns->dev;
+	struct nvme_queue *nvmeq = dev->queues[NVME_IO_Q];
 	struct nvme_command c;
 	struct blk_desc *desc = dev_get_uclass_platdata(udev);
-	int status;
-	u64 prp2;
 	u64 total_len = blkcnt << desc->log2blksz;
-	u64 temp_len = total_len;
-
+	u64 prp2;
+	void *buf = buffer;
 	u64 slba = blknr;
-	u16 lbas = 1 << (dev->max_transfer_shift - ns->lba_shift);
+	u32 lbas = 1 << (dev->max_transfer_shift - ns->lba_shift);
 	u64 total_lbas = blkcnt;
+	u64 failed = blknr + blkcnt;
+	u64 tag_slba[NVME_Q_DEPTH];
+	u16 free_tags[NVME_Q_DEPTH];
+	int nfree, inflight = 0;
+	u16 tag;
+	int ret;
 
 	if (!read)
 		flush_dcache_range((unsigned long)buffer,
 				   (unsigned long)buffer + total_len);
 
+	memset(&c, 0, sizeof(c));
 	c.rw.opcode = read ? nvme_cmd_read : nvme_cmd_write;
-	c.rw.flags = 0;
 	c.rw.nsid = cpu_to_le32(ns->ns_id);
-	c.rw.control = 0;
-	c.rw.dsmgmt = 0;
-	c.rw.reftag = 0;
-	c.rw.apptag = 0;
-	c.rw.appmask = 0;
-	c.rw.metadata = 0;
-
-	while (total_lbas) {
-		if (total_lbas < lbas) {
-			lbas = (u16)total_lbas;
-			total_lbas = 0;
-		} else {
+
+	/*
+	 * An SQ of depth n holds n - 1 commands. Each command in flight owns
+	 * a tag, used as its command ID and to pick its page of the PRP pool.
+	 */
+	for (nfree = 0; nfree < nvmeq->q_depth - 1; nfree++)
+		free_tags[nfree] = nfree;
+
+	while (total_lbas || inflight) {
+		/* Keep the queue full while there is anything left to do */
+		if (total_lbas && nfree && failed == blknr + blkcnt) {
+			if (total_lbas < lbas)
+				lbas = total_lbas;
+			tag = free_tags[--nfree];
+			if (nvme_setup_prps(dev, &prp2, lbas << ns->lba_shift,
+					    (ulong)buf, dev->prp_pool +
+					    (tag * dev->page_size >> 3))) {
+				failed = slba;
+				free_tags[nfree++] = tag;
+				continue;
+			}
+			c.rw.command_id = cpu_to_le16(tag);
+			c.rw.slba = cpu_to_le64(slba);
+			c.rw.length = cpu_to_le16(lbas - 1);
+			c.rw.prp1 = cpu_to_le64((ulong)buf);
+			c.rw.prp2 = cpu_to_le64(prp2);
+			nvme_submit_cmd(nvmeq, &c);
+			tag_slba[tag] = slba;
+			inflight++;
+
+			slba += lbas;
 			total_lbas -= lbas;
+			buf += lbas << ns->lba_shift;
+			continue;
 		}
 
-		if (nvme_setup_prps(dev, &prp2,
-				    lbas << ns->lba_shift, (ulong)buffer))
-			return -EIO;
-		c.rw.slba = cpu_to_le64(slba);
-		slba += lbas;
-		c.rw.length = cpu_to_le16(lbas - 1);
-		c.rw.prp1 = cpu_to_le64((ulong)buffer);
-		c.rw.prp2 = cpu_to_le64(prp2);
-		status = nvme_submit_sync_cmd(dev->queues[NVME_IO_Q],
-				&c, NULL, IO_TIMEOUT);
-		if (status)
+		if (!inflight)
+			break;
+
+		ret = nvme_wait_cmd(nvmeq, &tag, NULL, IO_TIMEOUT);
+		if (ret == -ETIMEDOUT) {
+			/* Nothing more can be trusted to have completed */
+			failed = blknr;
+			break;
+		}
+		if (tag >= nvmeq->q_depth - 1) {
+			failed = blknr;
 			break;
-		temp_len -= (u32)lbas << ns->lba_shift;
-		buffer += lbas << ns->lba_shift;
+		}
+		if (ret)
+			failed = min(failed, tag_slba[tag]);
+		free_tags[nfree++] = tag;
+		inflight--;
 	}
 
 	if (read)
 		invalidate_dcache_range((unsigned long)buffer,
 					(unsigned long)buffer + total_len);
 
-	return (total_len - temp_len) >> desc->log2blksz;
+	/* Blocks are only reported up to the first one that failed */
+	return min(failed, slba) - blknr;
 }
 
 static ulong nvme_blk_read(struct udevice *udev, lbaint_t blknr,
@@ -788,14 +830,6 @@ static int nvme_probe(struct udevice *udev)
 	}
 	memset(ndev->queues, 0, NVME_Q_NUM * sizeof(struct nvme_queue *));
 
-	ndev->prp_pool = malloc(MAX_PRP_POOL);
-	if (!ndev->prp_pool) {
-		ret = -ENOMEM;
-		printf("Error: %s: Out of memory!\n", udev->name);
-		goto free_nvme;
-	}
-	ndev->prp_entry_num = MAX_PRP_POOL >> 3;
-
 	ndev->cap = nvme_readq(&ndev->bar->cap);
 	ndev->q_depth = min_t(int, NVME_CAP_MQES(ndev->cap) + 1, NVME_Q_DEPTH);
 	ndev->db_stride = 1 << NVME_CAP_STRIDE(ndev->cap);
@@ -811,6 +845,15 @@ static int nvme_probe(struct udevice *udev)
 
 	nvme_get_info_from_identify(ndev);
 
+	/* One page of PRP list for each command that can be in flight */
+	ndev->prp_pool = memalign(ndev->page_size,
+				  ndev->q_depth * ndev->page_size);
+	if (!ndev->prp_pool) {
+		ret = -ENOMEM;
+		printf("Error: %s: Out of memory!\n", udev->name);
+		goto free_queue;
+	}
+
 	return 0;
 
 free_queue:
@@ -8,6 +8,7 @@
 #include <errno.h>
 #include <malloc.h>
 #include <spi.h>
+#include <thread.h>
 #include <dm/device-internal.h>
 #include <dm/uclass-internal.h>
 #include <dm/lists.h>
@@ -51,7 +52,10 @@ int dm_spi_claim_bus(struct udevice *dev)
 	struct dm_spi_bus *spi = dev_get_uclass_priv(bus);
 	struct spi_slave *slave = dev_get_parent_priv(dev);
 	int speed;
+	int ret;
 
+	/* Keep out other threads until dm_spi_release_bus() */
+	thread_claim(bus);
 	speed = slave->max_hz;
 	if (spi->max_hz) {
 		if (speed)
@@ -62,14 +66,21 @@ int dm_spi_claim_bus(struct udevice *dev)
 	if (!speed)
 		speed = SPI_DEFAULT_SPEED_HZ;
 	if (speed != slave->speed) {
-		int ret = spi_set_speed_mode(bus, speed, slave->mode);
-
+		ret = spi_set_speed_mode(bus, speed, slave->mode);
 		if (ret)
-			return log_ret(ret);
+			goto err;
 		slave->speed = speed;
 	}
 
-	return log_ret(ops->claim_bus ? ops->claim_bus(dev) : 0);
+	ret = ops->claim_bus ? ops->claim_bus(dev) : 0;
+	if (ret)
+		goto err;
+
+	return 0;
+err:
+	thread_release(bus);
+
+	return log_ret(ret);
 }
 
 void dm_spi_release_bus(struct udevice *dev)
@@ -79,6 +90,7 @@ void dm_spi_release_bus(struct udevice *dev)
 
 	if (ops->release_bus)
 		ops->release_bus(dev);
+	thread_release(bus);
 }
 
 int dm_spi_xfer(struct udevice *dev, unsigned int bitlen,
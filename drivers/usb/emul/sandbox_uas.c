@@ -0,0 +1,612 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Sandbox emulation of a USB Attached SCSI (UAS) disk
+ *
+ * Based on sandbox_flash.c
+ */
+
+#include <common.h>
+#include <dm.h>
+#include <os.h>
+#include <scsi.h>
+#include <usb.h>
+#include <asm/test.h>
+
+/*
+ * This driver emulates a disk using the UAS protocol without streams, as on
+ * a high-speed bus. Commands are queued as they arrive on the command pipe
+ * and are serviced newest first, so that the host has to match the tags of
+ * the read/write ready and sense IUs to its commands. Clearing a halt keeps
+ * the queued commands; only a LOGICAL UNIT RESET task management IU aborts
+ * them. It supports only a single logical unit number (LUN 0).
+ */
+
+enum {
+	SANDBOX_UAS_EP_CMD		= 1,	/* endpoints */
+	SANDBOX_UAS_EP_STATUS		= 2,
+	SANDBOX_UAS_EP_IN		= 3,
+	SANDBOX_UAS_EP_OUT		= 4,
+	SANDBOX_UAS_BLOCK_LEN		= 512,
+	SANDBOX_UAS_MAX_CMDS		= 32,
+};
+
+enum {
+	STRINGID_MANUFACTURER = 1,
+	STRINGID_PRODUCT,
+	STRINGID_SERIAL,
+
+	STRINGID_COUNT,
+};
+
+/**
+ * struct sandbox_uas_cmd - a command queued on the device
+ *
+ * @used:	true if this slot holds a command
+ * @seq:	Order in which the command arrived
+ * @tag:	Tag from the command IU
+ * @cdb:	SCSI command block
+ * @data_done:	true once the data phase has completed
+ * @status:	SCSI status to report
+ * @asc:	Additional sense code to report if @status is not GOOD
+ */
+struct sandbox_uas_cmd {
+	bool used;
+	uint seq;
+	u16 tag;
+	u8 cdb[16];
+	bool data_done;
+	u8 status;
+	u8 asc;
+};
+
+/**
+ * struct sandbox_uas_priv - private state for this driver
+ *
+ * @error:	true if there is an error condition
+ * @fd:		File descriptor of backing file
+ * @file_size:	Size of file in bytes
+ * @seq:	Sequence number for the next command
+ * @cmds:	Queued commands
+ * @data_cmd:	Command which the host was told to move data for, or NULL
+ * @buff_used:	Number of bytes in @buff to send back for @data_cmd
+ * @buff:	Data buffer for small responses
+ * @tm_tag:	Tag of the task management IU to respond to, 0 if none
+ * @fail_data:	true to fail the next data phase, for testing
+ */
+struct sandbox_uas_priv {
+	bool error;
+	int fd;
+	loff_t file_size;
+	uint seq;
+	struct sandbox_uas_cmd cmds[SANDBOX_UAS_MAX_CMDS];
+	struct sandbox_uas_cmd *data_cmd;
+	int buff_used;
+	u8 buff[64];
+	u16 tm_tag;
+	bool fail_data;
+};
+
+struct sandbox_uas_plat {
+	const char *pathname;
+	struct usb_string uas_strings[STRINGID_COUNT];
+};
+
+struct scsi_inquiry_resp {
+	u8 type;
+	u8 flags;
+	u8 version;
+	u8 data_format;
+	u8 additional_len;
+	u8 spare[3];
+	char vendor[8];
+	char product[16];
+	char revision[4];
+};
+
+struct scsi_read_capacity_resp {
+	u32 last_block_addr;
+	u32 block_len;
+};
+
+struct __packed scsi_rw10_req {
+	u8 cmd;
+	u8 lun_flags;
+	u32 lba;
+	u8 spare;
+	u16 transfer_len;
+	u8 spare2[3];
+};
+
+static struct usb_device_descriptor uas_device_desc = {
+	.bLength =		sizeof(uas_device_desc),
+	.bDescriptorType =	USB_DT_DEVICE,
+
+	.bcdUSB =		__constant_cpu_to_le16(0x0200),
+
+	.bDeviceClass =		0,
+	.bDeviceSubClass =	0,
+	.bDeviceProtocol =	0,
+
+	.idVendor =		__constant_cpu_to_le16(0x1234),
+	.idProduct =		__constant_cpu_to_le16(0x5679),
+	.iManufacturer =	STRINGID_MANUFACTURER,
+	.iProduct =		STRINGID_PRODUCT,
+	.iSerialNumber =	STRINGID_SERIAL,
+	.bNumConfigurations =	1,
+};
+
+static struct usb_config_descriptor uas_config0 = {
+	.bLength		= sizeof(uas_config0),
+	.bDescriptorType	= USB_DT_CONFIG,
+
+	/* wTotalLength is set up by usb-emul-uclass */
+	.bNumInterfaces		= 1,
+	.bConfigurationValue	= 0,
+	.iConfiguration		= 0,
+	.bmAttributes		= 1 << 7,
+	.bMaxPower		= 50,
+};
+
+static struct usb_interface_descriptor uas_interface0 = {
+	.bLength		= sizeof(uas_interface0),
+	.bDescriptorType	= USB_DT_INTERFACE,
+
+	.bInterfaceNumber	= 0,
+	.bAlternateSetting	= 0,
+	.bNumEndpoints		= 4,
+	.bInterfaceClass	= USB_CLASS_MASS_STORAGE,
+	.bInterfaceSubClass	= US_SC_SCSI,
+	.bInterfaceProtocol	= US_PR_UAS,
+	.iInterface		= 0,
+};
+
+static struct usb_endpoint_descriptor uas_endpoint_cmd = {
+	.bLength		= USB_DT_ENDPOINT_SIZE,
+	.bDescriptorType	= USB_DT_ENDPOINT,
+
+	.bEndpointAddress	= SANDBOX_UAS_EP_CMD,
+	.bmAttributes		= USB_ENDPOINT_XFER_BULK,
+	.wMaxPacketSize		= __constant_cpu_to_le16(512),
+	.bInterval		= 0,
+};
+
+static struct usb_pipe_usage_descriptor uas_pipe_cmd = {
+	.bLength		= sizeof(uas_pipe_cmd),
+	.bDescriptorType	= USB_DT_PIPE_USAGE,
+	.bPipeID		= UAS_CMD_PIPE_ID,
+};
+
+static struct usb_endpoint_descriptor uas_endpoint_status = {
+	.bLength		= USB_DT_ENDPOINT_SIZE,
+	.bDescriptorType	= USB_DT_ENDPOINT,
+
+	.bEndpointAddress	= SANDBOX_UAS_EP_STATUS | USB_ENDPOINT_DIR_MASK,
+	.bmAttributes		= USB_ENDPOINT_XFER_BULK,
+	.wMaxPacketSize		= __constant_cpu_to_le16(512),
+	.bInterval		= 0,
+};
+
+static struct usb_pipe_usage_descriptor uas_pipe_status = {
+	.bLength		= sizeof(uas_pipe_status),
+	.bDescriptorType	= USB_DT_PIPE_USAGE,
+	.bPipeID		= UAS_STATUS_PIPE_ID,
+};
+
+static struct usb_endpoint_descriptor uas_endpoint_data_in = {
+	.bLength		= USB_DT_ENDPOINT_SIZE,
+	.bDescriptorType	= USB_DT_ENDPOINT,
+
+	.bEndpointAddress	= SANDBOX_UAS_EP_IN | USB_ENDPOINT_DIR_MASK,
+	.bmAttributes		= USB_ENDPOINT_XFER_BULK,
+	.wMaxPacketSize		= __constant_cpu_to_le16(512),
+	.bInterval		= 0,
+};
+
+static struct usb_pipe_usage_descriptor uas_pipe_data_in = {
+	.bLength		= sizeof(uas_pipe_data_in),
+	.bDescriptorType	= USB_DT_PIPE_USAGE,
+	.bPipeID		= UAS_DATA_IN_PIPE_ID,
+};
+
+static struct usb_endpoint_descriptor uas_endpoint_data_out = {
+	.bLength		= USB_DT_ENDPOINT_SIZE,
+	.bDescriptorType	= USB_DT_ENDPOINT,
+
+	.bEndpointAddress	= SANDBOX_UAS_EP_OUT,
+	.bmAttributes		= USB_ENDPOINT_XFER_BULK,
+	.wMaxPacketSize		= __constant_cpu_to_le16(512),
+	.bInterval		= 0,
+};
+
+static struct usb_pipe_usage_descriptor uas_pipe_data_out = {
+	.bLength		= sizeof(uas_pipe_data_out),
+	.bDescriptorType	= USB_DT_PIPE_USAGE,
+	.bPipeID		= UAS_DATA_OUT_PIPE_ID,
+};
+
+static void *uas_desc_list[] = {
+	&uas_device_desc,
+	&uas_config0,
+	&uas_interface0,
+	&uas_endpoint_cmd,
+	&uas_pipe_cmd,
+	&uas_endpoint_status,
+	&uas_pipe_status,
+	&uas_endpoint_data_in,
+	&uas_pipe_data_in,
+	&uas_endpoint_data_out,
+	&uas_pipe_data_out,
+	NULL,
+};
+
+static void sandbox_uas_abort(struct sandbox_uas_priv *priv)
+{
+	memset(priv->cmds, '\0', sizeof(priv->cmds));
+	priv->data_cmd = NULL;
+	priv->error = false;
+}
+
+static int sandbox_uas_control(struct udevice *dev, struct usb_device *udev,
+			       unsigned long pipe, void *buff, int len,
+			       struct devrequest *setup)
+{
+	struct sandbox_uas_priv *priv = dev_get_priv(dev);
+
+	if (pipe == usb_sndctrlpipe(udev, 0)) {
+		switch (setup->request) {
+		case USB_REQ_CLEAR_FEATURE:
+			/* Queued commands stay until a LOGICAL UNIT RESET */
+			priv->error = false;
+			return 0;
+		default:
+			debug("request=%x\n", setup->request);
+			break;
+		}
+	}
+	debug("pipe=%lx\n", pipe);
+
+	return -EIO;
+}
+
+static int sandbox_uas_task_mgmt(struct sandbox_uas_priv *priv,
+				 struct uas_task_mgmt_iu *tm, int len)
+{
+	int i;
+
+	if (len != sizeof(*tm) || tm->function != UAS_TMF_LUN_RESET ||
+	    priv->tm_tag)
+		return -EIO;
+	for (i = 0; i < SANDBOX_UAS_MAX_CMDS; i++) {
+		if (priv->cmds[i].used &&
+		    priv->cmds[i].tag == be16_to_cpu(tm->tag)) {
+			debug("%s: overlapped tag %d\n", __func__,
+			      priv->cmds[i].tag);
+			return -EIO;
+		}
+	}
+	sandbox_uas_abort(priv);
+	priv->tm_tag = be16_to_cpu(tm->tag);
+	debug("%s: LUN reset, tag %d\n", __func__, priv->tm_tag);
+
+	return len;
+}
+
+static int sandbox_uas_queue_cmd(struct sandbox_uas_priv *priv,
+				 struct uas_command_iu *iu, int len)
+{
+	struct sandbox_uas_cmd *cmd, *slot = NULL;
+	int i;
+
+	if (!priv->error && iu->iu_id == UAS_IU_ID_TASK_MGMT)
+		return sandbox_uas_task_mgmt(priv, (void *)iu, len);
+	if (priv->error || len != sizeof(*iu) ||
+	    iu->iu_id != UAS_IU_ID_COMMAND || iu->lun[1] || iu->len)
+		return -EIO;
+	for (i = 0; i < SANDBOX_UAS_MAX_CMDS; i++) {
+		cmd = &priv->cmds[i];
+		if (!cmd->used) {
+			slot = slot ? slot : cmd;
+		} else if (cmd->tag == be16_to_cpu(iu->tag)) {
+			debug("%s: overlapped tag %d\n", __func__, cmd->tag);
+			return -EIO;
+		}
+	}
+	if (!slot)
+		return -EIO;
+
+	memset(slot, '\0', sizeof(*slot));
+	slot->used = true;
+	slot->seq = priv->seq++;
+	slot->tag = be16_to_cpu(iu->tag);
+	memcpy(slot->cdb, iu->cdb, sizeof(slot->cdb));
+	debug("%s: tag %d, cmd %x\n", __func__, slot->tag, slot->cdb[0]);
+
+	return len;
+}
+
+static void sandbox_uas_fail(struct sandbox_uas_cmd *cmd, u8 asc)
+{
+	cmd->status = S_CHECK_COND;
+	cmd->asc = asc;
+}
+
+/**
+ * sandbox_uas_start() - start processing a command
+ *
+ * @plat:	Platform data
+ * @priv:	Private data
+ * @cmd:	Command to start
+ * @return data direction: 1 for in, 0 for out, -1 if the command has no data
+ * phase (or has already failed)
+ */
+static int sandbox_uas_start(struct sandbox_uas_plat *plat,
+			     struct sandbox_uas_priv *priv,
+			     struct sandbox_uas_cmd *cmd)
+{
+	struct scsi_rw10_req *req = (void *)cmd->cdb;
+	ulong lba, blocks;
+
+	priv->buff_used = 0;
+	switch (cmd->cdb[0]) {
+	case SCSI_INQUIRY: {
+		struct scsi_inquiry_resp *resp = (void *)priv->buff;
+
+		memset(resp, '\0', sizeof(*resp));
+		resp->data_format = 1;
+		resp->additional_len = 0x1f;
+		strncpy(resp->vendor,
+			plat->uas_strings[STRINGID_MANUFACTURER - 1].s,
+			sizeof(resp->vendor));
+		strncpy(resp->product,
+			plat->uas_strings[STRINGID_PRODUCT - 1].s,
+			sizeof(resp->product));
+		strncpy(resp->revision, "1.0", sizeof(resp->revision));
+		priv->buff_used = min_t(int, sizeof(*resp), cmd->cdb[4]);
+		return 1;
+	}
+	case SCSI_TST_U_RDY:
+		if (priv->fd == -1)
+			sandbox_uas_fail(cmd, 0x3a);	/* medium not present */
+		return -1;
+	case SCSI_RD_CAPAC: {
+		struct scsi_read_capacity_resp *resp = (void *)priv->buff;
+		uint blocks;
+
+		if (priv->file_size)
+			blocks = priv->file_size / SANDBOX_UAS_BLOCK_LEN - 1;
+		else
+			blocks = 0;
+		resp->last_block_addr = cpu_to_be32(blocks);
+		resp->block_len = cpu_to_be32(SANDBOX_UAS_BLOCK_LEN);
+		priv->buff_used = sizeof(*resp);
+		return 1;
+	}
+	case SCSI_READ10:
+	case SCSI_WRITE10:
+		lba = be32_to_cpu(req->lba);
+		blocks = be16_to_cpu(req->transfer_len);
+		if (priv->fd == -1 ||
+		    (lba + blocks) * SANDBOX_UAS_BLOCK_LEN > priv->file_size) {
+			sandbox_uas_fail(cmd, 0x21);	/* LBA out of range */
+			return -1;
+		}
+		if (!blocks)
+			return -1;
+		os_lseek(priv->fd, lba * SANDBOX_UAS_BLOCK_LEN, OS_SEEK_SET);
+		return cmd->cdb[0] == SCSI_READ10;
+	default:
+		debug("Command not supported: %x\n", cmd->cdb[0]);
+		sandbox_uas_fail(cmd, 0x20);	/* invalid command opcode */
+		return -1;
+	}
+}
+
+static int sandbox_uas_status(struct sandbox_uas_plat *plat,
+			      struct sandbox_uas_priv *priv, void *buff,
+			      int len)
+{
+	struct sandbox_uas_cmd *cmd = NULL;
+	struct uas_sense_iu *sense = buff;
+	struct uas_iu *iu = buff;
+	int i, dir;
+
+	if (priv->tm_tag) {
+		struct uas_response_iu *resp = buff;
+
+		if (len < sizeof(*resp))
+			return -EIO;
+		memset(resp, '\0', sizeof(*resp));
+		resp->iu_id = UAS_IU_ID_RESPONSE;
+		resp->tag = cpu_to_be16(priv->tm_tag);
+		resp->response_code = UAS_RC_TMF_COMPLETE;
+		priv->tm_tag = 0;
+		return sizeof(*resp);
+	}
+
+	if (priv->data_cmd) {
+		/* The host must move the data before it gets the status */
+		if (!priv->data_cmd->data_done)
+			return -EIO;
+		cmd = priv->data_cmd;
+		priv->data_cmd = NULL;
+	} else {
+		for (i = 0; i < SANDBOX_UAS_MAX_CMDS; i++) {
+			if (priv->cmds[i].used &&
+			    (!cmd || priv->cmds[i].seq > cmd->seq))
+				cmd = &priv->cmds[i];
+		}
+		if (!cmd)
+			return -EIO;
+		dir = sandbox_uas_start(plat, priv, cmd);
+		if (dir >= 0) {
+			if (len < sizeof(*iu))
+				return -EIO;
+			memset(iu, '\0', sizeof(*iu));
+			iu->iu_id = dir ? UAS_IU_ID_READ_READY :
+				UAS_IU_ID_WRITE_READY;
+			iu->tag = cpu_to_be16(cmd->tag);
+			priv->data_cmd = cmd;
+			return sizeof(*iu);
+		}
+	}
+
+	if (len < UAS_SENSE_IU_HDR_SIZE + 18)
+		return -EIO;
+	memset(sense, '\0', UAS_SENSE_IU_HDR_SIZE + 18);
+	sense->iu_id = UAS_IU_ID_STATUS;
+	sense->tag = cpu_to_be16(cmd->tag);
+	sense->status = cmd->status;
+	if (cmd->status) {
+		sense->len = cpu_to_be16(18);
+		sense->sense[0] = 0x70;
+		sense->sense[2] = cmd->asc == 0x3a ? 0x02 : 0x05;
+		sense->sense[7] = 10;
+		sense->sense[12] = cmd->asc;
+	}
+	cmd->used = false;
+
+	return UAS_SENSE_IU_HDR_SIZE + be16_to_cpu(sense->len);
+}
+
+static int sandbox_uas_data(struct sandbox_uas_priv *priv, bool dir_in,
+			    void *buff, int len)
+{
+	struct sandbox_uas_cmd *cmd = priv->data_cmd;
+	struct scsi_rw10_req *req;
+	int expect;
+
+	if (!cmd || cmd->data_done ||
+	    dir_in != (cmd->cdb[0] != SCSI_WRITE10) || priv->fail_data) {
+		priv->fail_data = false;
+		return -EIO;
+	}
+	cmd->data_done = true;
+	if (cmd->cdb[0] != SCSI_READ10 && cmd->cdb[0] != SCSI_WRITE10) {
+		len = min(len, priv->buff_used);
+		memcpy(buff, priv->buff, len);
+		return len;
+	}
+
+	req = (void *)cmd->cdb;
+	expect = be16_to_cpu(req->transfer_len) * SANDBOX_UAS_BLOCK_LEN;
+	if (len != expect)
+		return -EIO;
+	if (dir_in)
+		return os_read(priv->fd, buff, len) == len ? len : -EIO;
+
+	return os_write(priv->fd, buff, len) == len ? len : -EIO;
+}
+
+static int sandbox_uas_bulk(struct udevice *dev, struct usb_device *udev,
+			    unsigned long pipe, void *buff, int len)
+{
+	struct sandbox_uas_plat *plat = dev_get_platdata(dev);
+	struct sandbox_uas_priv *priv = dev_get_priv(dev);
+	int ep = usb_pipeendpoint(pipe);
+	int ret;
+
+	debug("%s: dev=%s, pipe=%lx, ep=%x, len=%x\n", __func__, dev->name,
+	      pipe, ep, len);
+	if (priv->error)
+		return -EIO;
+	switch (ep) {
+	case SANDBOX_UAS_EP_CMD:
+		ret = sandbox_uas_queue_cmd(priv, buff, len);
+		break;
+	case SANDBOX_UAS_EP_STATUS:
+		ret = sandbox_uas_status(plat, priv, buff, len);
+		break;
+	case SANDBOX_UAS_EP_IN:
+		ret = sandbox_uas_data(priv, true, buff, len);
+		break;
+	case SANDBOX_UAS_EP_OUT:
+		ret = sandbox_uas_data(priv, false, buff, len);
+		break;
+	default:
+		ret = -EIO;
+		break;
+	}
+	if (ret < 0) {
+		priv->error = true;
+		debug("%s: Detected transfer error\n", __func__);
+	}
+
+	return ret;
+}
+
+void sandbox_uas_fail_next_data(struct udevice *dev)
+{
+	struct sandbox_uas_priv *priv = dev_get_priv(dev);
+
+	priv->fail_data = true;
+}
+
+static int sandbox_uas_ofdata_to_platdata(struct udevice *dev)
+{
+	struct sandbox_uas_plat *plat = dev_get_platdata(dev);
+
+	plat->pathname = dev_read_string(dev, "sandbox,filepath");
+
+	return 0;
+}
+
+static int sandbox_uas_bind(struct udevice *dev)
+{
+	struct sandbox_uas_plat *plat = dev_get_platdata(dev);
+	struct usb_string *fs;
+
+	fs = plat->uas_strings;
+	fs[0].id = STRINGID_MANUFACTURER;
+	fs[0].s = "sandbox";
+	fs[1].id = STRINGID_PRODUCT;
+	fs[1].s = "uas";
+	fs[2].id = STRINGID_SERIAL;
+	fs[2].s = dev->name;
+
+	return usb_emul_setup_device(dev, plat->uas_strings, uas_desc_list);
+}
+
+static int sandbox_uas_probe(struct udevice *dev)
+{
+	struct sandbox_uas_plat *plat = dev_get_platdata(dev);
+	struct sandbox_uas_priv *priv = dev_get_priv(dev);
+
+	priv->fd = os_open(plat->pathname, OS_O_RDWR);
+	if (priv->fd != -1)
+		return os_get_filesize(plat->pathname, &priv->file_size);
+
+	return 0;
+}
+
+static int sandbox_uas_remove(struct udevice *dev)
+{
+	struct sandbox_uas_priv *priv = dev_get_priv(dev);
+
+	if (priv->fd != -1)
+		os_close(priv->fd);
+
+	return 0;
+}
+
+static const struct dm_usb_ops sandbox_usb_uas_ops = {
+	.control	= sandbox_uas_control,
+	.bulk		= sandbox_uas_bulk,
+};
+
+static const struct udevice_id sandbox_usb_uas_ids[] = {
+	{ .compatible = "sandbox,usb-uas" },
+	{ }
+};
+
+U_BOOT_DRIVER(usb_sandbox_uas) = {
+	.name	= "usb_sandbox_uas",
+	.id	= UCLASS_USB_EMUL,
+	.of_match = sandbox_usb_uas_ids,
+	.bind	= sandbox_uas_bind,
+	.probe	= sandbox_uas_probe,
+	.remove	= sandbox_uas_remove,
+	.ofdata_to_platdata = sandbox_uas_ofdata_to_platdata,
+	.ops	= &sandbox_usb_uas_ops,
+	.priv_auto_alloc_size = sizeof(struct sandbox_uas_priv),
+	.platdata_auto_alloc_size = sizeof(struct sandbox_uas_plat),
+};
@@ -209,6 +209,9 @@ static int ehci_shutdown(struct ehci_ctrl *ctrl)
 	uint32_t cmd, reg;
 	int max_ports = HCS_N_PORTS(ehci_readl(&ctrl->hccr->cr_hcsparams));
 
+#ifdef CONFIG_USB_EHCI_KEEP_ASYNC
+	ctrl->async_running = false;
+#endif
 	cmd = ehci_readl(&ctrl->hcor->or_usbcmd);
 	/* If not run, directly return */
 	if (!(cmd & CMD_RUN))
@@ -296,6 +299,563 @@ static void ehci_update_endpt2_dev_n_port(struct usb_device *udev,
 				     QH_ENDPT2_HUBADDR(hubaddr));
 }
 
+#ifdef CONFIG_USB_EHCI_KEEP_ASYNC
+/*
+ * The async schedule is left running between transfers, with a few QHs
+ * linked in behind the reclamation list head, each set up for the endpoint
+ * it was last used with. A transfer to one of these endpoints only has to
+ * hand its qTDs to the QH, instead of linking in a new QH and starting and
+ * stopping the schedule around every transfer. The endpoint of a QH is only
+ * ever changed while the schedule is stopped.
+ *
+ * As in Linux, the qTD chain of each QH ends with an inactive dummy qTD, so
+ * the overlay of a QH in the running schedule is never written. A transfer
+ * fills in the dummy as its first qTD and ends with the QH's other dummy,
+ * and the controller moves on to it once it is made active.
+ */
+static int ehci_enable_async(struct ehci_ctrl *ctrl)
+{
+	uint32_t cmd, usbsts;
+	int ret;
+
+	if (ctrl->async_running)
+		return 0;
+
+	/* Set async. queue head pointer. */
+	ehci_writel(&ctrl->hcor->or_asynclistaddr,
+		    virt_to_phys(&ctrl->qh_list));
+
+	usbsts = ehci_readl(&ctrl->hcor->or_usbsts);
+	ehci_writel(&ctrl->hcor->or_usbsts, (usbsts & 0x3f));
+
+	/* Enable async. schedule. */
+	cmd = ehci_readl(&ctrl->hcor->or_usbcmd);
+	cmd |= CMD_ASE;
+	ehci_writel(&ctrl->hcor->or_usbcmd, cmd);
+
+	ret = handshake((uint32_t *)&ctrl->hcor->or_usbsts, STS_ASS, STS_ASS,
+			100 * 1000);
+	if (ret < 0) {
+		printf("EHCI fail timeout STS_ASS set\n");
+		return ret;
+	}
+	ctrl->async_running = true;
+
+	return 0;
+}
+
+static int ehci_disable_async(struct ehci_ctrl *ctrl)
+{
+	uint32_t cmd;
+	int ret;
+
+	if (!ctrl->async_running)
+		return 0;
+
+	/* Disable async schedule. */
+	cmd = ehci_readl(&ctrl->hcor->or_usbcmd);
+	cmd &= ~CMD_ASE;
+	ehci_writel(&ctrl->hcor->or_usbcmd, cmd);
+
+	ret = handshake((uint32_t *)&ctrl->hcor->or_usbsts, STS_ASS, 0,
+			100 * 1000);
+	if (ret < 0) {
+		printf("EHCI fail timeout STS_ASS reset\n");
+		return ret;
+	}
+	ctrl->async_running = false;
+
+	return 0;
+}
+
+/* Set up a qTD which ends a chain without being processed */
+static void ehci_init_dummy(struct qTD *dummy)
+{
+	memset(dummy, 0, sizeof(*dummy));
+	dummy->qt_next = cpu_to_hc32(QT_NEXT_TERMINATE);
+	dummy->qt_altnext = cpu_to_hc32(QT_NEXT_TERMINATE);
+}
+
+/**
+ * ehci_get_async_qh() - Get an idle QH in the async schedule for an endpoint
+ *
+ * A QH already set up for the endpoint is reused as it is, unless it halted
+ * or was left with active qTDs. Otherwise a QH not linked in yet is set up,
+ * or failing that the next one in turn, with the schedule stopped.
+ *
+ * @ctrl:	Controller
+ * @endpt1:	Endpoint characteristics (qh_endpt1, in controller byte order)
+ * @endpt2:	Endpoint capabilities (qh_endpt2, in controller byte order)
+ * @return the QH, or NULL if the async schedule could not be stopped
+ */
+static struct QH *ehci_get_async_qh(struct ehci_ctrl *ctrl, uint32_t endpt1,
+				    uint32_t endpt2)
+{
+	struct QH *qh = NULL;
+	struct qTD *dummy;
+	bool link = false;
+	uint32_t token;
+	int i;
+
+	invalidate_dcache_range((unsigned long)ctrl->async_qh,
+		ALIGN_END_ADDR(struct QH, ctrl->async_qh, EHCI_ASYNC_QHS));
+
+	for (i = 0; i < ctrl->async_qhs; i++) {
+		if (ctrl->async_qh[i].qh_endpt1 != endpt1 ||
+		    ctrl->async_qh[i].qh_endpt2 != endpt2)
+			continue;
+		qh = &ctrl->async_qh[i];
+		token = hc32_to_cpu(qh->qh_overlay.qt_token);
+		if (!(QT_TOKEN_GET_STATUS(token) &
+		      (QT_TOKEN_STATUS_ACTIVE | QT_TOKEN_STATUS_HALTED)))
+			return qh;
+		break;
+	}
+
+	if (!qh) {
+		if (ctrl->async_qhs < EHCI_ASYNC_QHS) {
+			qh = &ctrl->async_qh[ctrl->async_qhs++];
+			link = true;
+		} else {
+			qh = &ctrl->async_qh[ctrl->async_qh_next];
+			ctrl->async_qh_next = (ctrl->async_qh_next + 1) %
+					      EHCI_ASYNC_QHS;
+		}
+	}
+
+	/* A QH not linked in yet is not seen by the controller */
+	if (!link && ehci_disable_async(ctrl))
+		return NULL;
+
+	/*
+	 * Setup QH (3.6 in ehci-r10.pdf)
+	 *
+	 *   qh_link ................. 03-00 H
+	 *   qh_endpt1 ............... 07-04 H
+	 *   qh_endpt2 ............... 0B-08 H
+	 * - qh_curtd
+	 *   qh_overlay.qt_next ...... 13-10 H
+	 * - qh_overlay.qt_altnext
+	 */
+	i = qh - ctrl->async_qh;
+	dummy = &ctrl->async_dummy[i][ctrl->async_dummy_cur[i]];
+	ehci_init_dummy(dummy);
+	qh->qh_endpt1 = endpt1;
+	qh->qh_endpt2 = endpt2;
+	qh->qh_curtd = 0;
+	memset(&qh->qh_overlay, 0, sizeof(qh->qh_overlay));
+	qh->qh_overlay.qt_next = cpu_to_hc32(virt_to_phys(dummy));
+	qh->qh_overlay.qt_altnext = cpu_to_hc32(QT_NEXT_TERMINATE);
+	if (link)
+		qh->qh_link = ctrl->qh_list.qh_link;
+
+	flush_dcache_range((unsigned long)ctrl->async_dummy,
+		ALIGN_END_ADDR(struct qTD, ctrl->async_dummy,
+			       2 * EHCI_ASYNC_QHS));
+	flush_dcache_range((unsigned long)ctrl->async_qh,
+		ALIGN_END_ADDR(struct QH, ctrl->async_qh, EHCI_ASYNC_QHS));
+
+	if (link) {
+		ctrl->qh_list.qh_link = cpu_to_hc32(virt_to_phys(qh) |
+						    QH_LINK_TYPE_QH);
+		flush_dcache_range((unsigned long)&ctrl->qh_list,
+			ALIGN_END_ADDR(struct QH, &ctrl->qh_list, 1));
+	}
+
+	return qh;
+}
+
+/* Get room for @count qTDs, which the controller no longer looks at */
+static struct qTD *ehci_get_qtds(struct ehci_ctrl *ctrl, int count)
+{
+	if (count > ctrl->qtd_pool_count) {
+		free(ctrl->qtd_pool);
+		ctrl->qtd_pool = memalign(USB_DMA_MINALIGN,
+					  count * sizeof(struct qTD));
+		ctrl->qtd_pool_count = ctrl->qtd_pool ? count : 0;
+		if (!ctrl->qtd_pool)
+			return NULL;
+	}
+	memset(ctrl->qtd_pool, 0, count * sizeof(struct qTD));
+
+	return ctrl->qtd_pool;
+}
+
+static int
+ehci_submit_async(struct usb_device *dev, unsigned long pipe, void *buffer,
+		   int length, struct devrequest *req)
+{
+	struct QH tmpl, *qh;
+	struct qTD *qtd, *dummy, *next_dummy;
+	int qtd_count = 0;
+	int qtd_counter = 0;
+	volatile struct qTD *vtd;
+	unsigned long ts;
+	uint32_t *tdp;
+	uint32_t first_td;
+	uint32_t endpt, endpt1, maxpacket, token;
+	uint32_t c, toggle;
+	int timeout;
+	int ret = 0;
+	int i;
+	struct ehci_ctrl *ctrl = ehci_get_ctrl(dev);
+
+	debug("dev=%p, pipe=%lx, buffer=%p, length=%d, req=%p\n", dev, pipe,
+	      buffer, length, req);
+	if (req != NULL)
+		debug("req=%u (%#x), type=%u (%#x), value=%u (%#x), index=%u\n",
+		      req->request, req->request,
+		      req->requesttype, req->requesttype,
+		      le16_to_cpu(req->value), le16_to_cpu(req->value),
+		      le16_to_cpu(req->index));
+
+#define PKT_ALIGN	512
+	/*
+	 * The USB transfer is split into qTD transfers. Eeach qTD transfer is
+	 * described by a transfer descriptor (the qTD). The qTDs form a linked
+	 * list with a queue head (QH).
+	 *
+	 * Each qTD transfer starts with a new USB packet, i.e. a packet cannot
+	 * have its beginning in a qTD transfer and its end in the following
+	 * one, so the qTD transfer lengths have to be chosen accordingly.
+	 *
+	 * Each qTD transfer uses up to QT_BUFFER_CNT data buffers, mapped to
+	 * single pages. The first data buffer can start at any offset within a
+	 * page (not considering the cache-line alignment issues), while the
+	 * following buffers must be page-aligned. There is no alignment
+	 * constraint on the size of a qTD transfer.
+	 */
+	if (req != NULL)
+		/* 1 qTD will be needed for SETUP, and 1 for ACK. */
+		qtd_count += 1 + 1;
+	if (length > 0 || req == NULL) {
+		/*
+		 * Determine the qTD transfer size that will be used for the
+		 * data payload (not considering the first qTD transfer, which
+		 * may be longer or shorter, and the final one, which may be
+		 * shorter).
+		 *
+		 * In order to keep each packet within a qTD transfer, the qTD
+		 * transfer size is aligned to PKT_ALIGN, which is a multiple of
+		 * wMaxPacketSize (except in some cases for interrupt transfers,
+		 * see comment in submit_int_msg()).
+		 *
+		 * By default, i.e. if the input buffer is aligned to PKT_ALIGN,
+		 * QT_BUFFER_CNT full pages will be used.
+		 */
+		int xfr_sz = QT_BUFFER_CNT;
+		/*
+		 * However, if the input buffer is not aligned to PKT_ALIGN, the
+		 * qTD transfer size will be one page shorter, and the first qTD
+		 * data buffer of each transfer will be page-unaligned.
+		 */
+		if ((unsigned long)buffer & (PKT_ALIGN - 1))
+			xfr_sz--;
+		/* Convert the qTD transfer size to bytes. */
+		xfr_sz *= EHCI_PAGE_SIZE;
+		/*
+		 * Approximate by excess the number of qTDs that will be
+		 * required for the data payload. The exact formula is way more
+		 * complicated and saves at most 2 qTDs, i.e. a total of 128
+		 * bytes.
+		 */
+		qtd_count += 2 + length / xfr_sz;
+	}
+/*
+ * Threshold value based on the worst-case total size of the allocated qTDs for
+ * a mass-storage transfer of 65535 blocks of 512 bytes.
+ */
+#if CONFIG_SYS_MALLOC_LEN <= 64 + 128 * 1024
+#warning CONFIG_SYS_MALLOC_LEN may be too small for EHCI
+#endif
+	qtd = ehci_get_qtds(ctrl, qtd_count);
+	if (qtd == NULL) {
+		printf("unable to allocate TDs\n");
+		return -1;
+	}
+
+	toggle = usb_gettoggle(dev, usb_pipeendpoint(pipe), usb_pipeout(pipe));
+
+	c = (dev->speed != USB_SPEED_HIGH) && !usb_pipeendpoint(pipe);
+	maxpacket = usb_maxpacket(dev, pipe);
+	endpt1 = QH_ENDPT1_RL(8) | QH_ENDPT1_C(c) |
+		 QH_ENDPT1_MAXPKTLEN(maxpacket) | QH_ENDPT1_H(0) |
+		 QH_ENDPT1_DTC(QH_ENDPT1_DTC_DT_FROM_QTD) |
+		 QH_ENDPT1_ENDPT(usb_pipeendpoint(pipe)) | QH_ENDPT1_I(0) |
+		 QH_ENDPT1_DEVADDR(usb_pipedevice(pipe));
+
+	/* Force FS for fsl HS quirk */
+	if (!ctrl->has_fsl_erratum_a005275)
+		endpt1 |= QH_ENDPT1_EPS(ehci_encode_speed(dev->speed));
+	else
+		endpt1 |= QH_ENDPT1_EPS(ehci_encode_speed(QH_FULL_SPEED));
+
+	endpt = QH_ENDPT2_MULT(1) | QH_ENDPT2_UFCMASK(0) | QH_ENDPT2_UFSMASK(0);
+	tmpl.qh_endpt2 = cpu_to_hc32(endpt);
+	ehci_update_endpt2_dev_n_port(dev, &tmpl);
+
+	qh = ehci_get_async_qh(ctrl, cpu_to_hc32(endpt1), tmpl.qh_endpt2);
+	if (!qh)
+		return -1;
+
+	/* The first qTD goes in the QH's dummy once they are all set up */
+	first_td = cpu_to_hc32(QT_NEXT_TERMINATE);
+	tdp = &first_td;
+	if (req != NULL) {
+		/*
+		 * Setup request qTD (3.5 in ehci-r10.pdf)
+		 *
+		 *   qt_next ................ 03-00 H
+		 *   qt_altnext ............. 07-04 H
+		 *   qt_token ............... 0B-08 H
+		 *
+		 *   [ buffer, buffer_hi ] loaded with "req".
+		 */
+		qtd[qtd_counter].qt_next = cpu_to_hc32(QT_NEXT_TERMINATE);
+		qtd[qtd_counter].qt_altnext = cpu_to_hc32(QT_NEXT_TERMINATE);
+		token = QT_TOKEN_DT(0) | QT_TOKEN_TOTALBYTES(sizeof(*req)) |
+			QT_TOKEN_IOC(0) | QT_TOKEN_CPAGE(0) | QT_TOKEN_CERR(3) |
+			QT_TOKEN_PID(QT_TOKEN_PID_SETUP) |
+			QT_TOKEN_STATUS(QT_TOKEN_STATUS_ACTIVE);
+		qtd[qtd_counter].qt_token = cpu_to_hc32(token);
+		if (ehci_td_buffer(&qtd[qtd_counter], req, sizeof(*req))) {
+			printf("unable to construct SETUP TD\n");
+			goto fail;
+		}
+		/* Update previous qTD! */
+		*tdp = cpu_to_hc32(virt_to_phys(&qtd[qtd_counter]));
+		tdp = &qtd[qtd_counter++].qt_next;
+		toggle = 1;
+	}
+
+	if (length > 0 || req == NULL) {
+		uint8_t *buf_ptr = buffer;
+		int left_length = length;
+
+		do {
+			/*
+			 * Determine the size of this qTD transfer. By default,
+			 * QT_BUFFER_CNT full pages can be used.
+			 */
+			int xfr_bytes = QT_BUFFER_CNT * EHCI_PAGE_SIZE;
+			/*
+			 * However, if the input buffer is not page-aligned, the
+			 * portion of the first page before the buffer start
+			 * offset within that page is unusable.
+			 */
+			xfr_bytes -= (unsigned long)buf_ptr & (EHCI_PAGE_SIZE - 1);
+			/*
+			 * In order to keep each packet within a qTD transfer,
+			 * align the qTD transfer size to PKT_ALIGN.
+			 */
+			xfr_bytes &= ~(PKT_ALIGN - 1);
+			/*
+			 * This transfer may be shorter than the available qTD
+			 * transfer size that has just been computed.
+			 */
+			xfr_bytes = min(xfr_bytes, left_length);
+
+			/*
+			 * Setup request qTD (3.5 in ehci-r10.pdf)
+			 *
+			 *   qt_next ................ 03-00 H
+			 *   qt_altnext ............. 07-04 H
+			 *   qt_token ............... 0B-08 H
+			 *
+			 *   [ buffer, buffer_hi ] loaded with "buffer".
+			 */
+			qtd[qtd_counter].qt_next =
+					cpu_to_hc32(QT_NEXT_TERMINATE);
+			qtd[qtd_counter].qt_altnext =
+					cpu_to_hc32(QT_NEXT_TERMINATE);
+			token = QT_TOKEN_DT(toggle) |
+				QT_TOKEN_TOTALBYTES(xfr_bytes) |
+				QT_TOKEN_IOC(req == NULL) | QT_TOKEN_CPAGE(0) |
+				QT_TOKEN_CERR(3) |
+				QT_TOKEN_PID(usb_pipein(pipe) ?
+					QT_TOKEN_PID_IN : QT_TOKEN_PID_OUT) |
+				QT_TOKEN_STATUS(QT_TOKEN_STATUS_ACTIVE);
+			qtd[qtd_counter].qt_token = cpu_to_hc32(token);
+			if (ehci_td_buffer(&qtd[qtd_counter], buf_ptr,
+						xfr_bytes)) {
+				printf("unable to construct DATA TD\n");
+				goto fail;
+			}
+			/* Update previous qTD! */
+			*tdp = cpu_to_hc32(virt_to_phys(&qtd[qtd_counter]));
+			tdp = &qtd[qtd_counter++].qt_next;
+			/*
+			 * Data toggle has to be adjusted since the qTD transfer
+			 * size is not always an even multiple of
+			 * wMaxPacketSize.
+			 */
+			if ((xfr_bytes / maxpacket) & 1)
+				toggle ^= 1;
+			buf_ptr += xfr_bytes;
+			left_length -= xfr_bytes;
+		} while (left_length > 0);
+	}
+
+	if (req != NULL) {
+		/*
+		 * Setup request qTD (3.5 in ehci-r10.pdf)
+		 *
+		 *   qt_next ................ 03-00 H
+		 *   qt_altnext ............. 07-04 H
+		 *   qt_token ............... 0B-08 H
+		 */
+		qtd[qtd_counter].qt_next = cpu_to_hc32(QT_NEXT_TERMINATE);
+		qtd[qtd_counter].qt_altnext = cpu_to_hc32(QT_NEXT_TERMINATE);
+		token = QT_TOKEN_DT(1) | QT_TOKEN_TOTALBYTES(0) |
+			QT_TOKEN_IOC(1) | QT_TOKEN_CPAGE(0) | QT_TOKEN_CERR(3) |
+			QT_TOKEN_PID(usb_pipein(pipe) ?
+				QT_TOKEN_PID_OUT : QT_TOKEN_PID_IN) |
+			QT_TOKEN_STATUS(QT_TOKEN_STATUS_ACTIVE);
+		qtd[qtd_counter].qt_token = cpu_to_hc32(token);
+		/* Update previous qTD! */
+		*tdp = cpu_to_hc32(virt_to_phys(&qtd[qtd_counter]));
+		tdp = &qtd[qtd_counter++].qt_next;
+	}
+
+	/* End the chain with the QH's other dummy */
+	i = qh - ctrl->async_qh;
+	dummy = &ctrl->async_dummy[i][ctrl->async_dummy_cur[i]];
+	next_dummy = &ctrl->async_dummy[i][!ctrl->async_dummy_cur[i]];
+	ehci_init_dummy(next_dummy);
+	*tdp = cpu_to_hc32(virt_to_phys(next_dummy));
+
+	/*
+	 * The QH is idle, i.e. its overlay is neither active nor halted, and
+	 * points to the dummy. Fill in the dummy as the first qTD and only then
+	 * make it active, so the controller never sees it half written.
+	 */
+	dummy->qt_next = qtd[0].qt_next;
+	dummy->qt_altnext = qtd[0].qt_altnext;
+	memcpy(dummy->qt_buffer, qtd[0].qt_buffer, sizeof(dummy->qt_buffer));
+	memcpy(dummy->qt_buffer_hi, qtd[0].qt_buffer_hi,
+	       sizeof(dummy->qt_buffer_hi));
+
+	/* Flush dcache */
+	flush_dcache_range((unsigned long)qtd,
+			   ALIGN_END_ADDR(struct qTD, qtd, qtd_count));
+	flush_dcache_range((unsigned long)ctrl->async_dummy,
+		ALIGN_END_ADDR(struct qTD, ctrl->async_dummy,
+			       2 * EHCI_ASYNC_QHS));
+
+	dummy->qt_token = qtd[0].qt_token;
+	flush_dcache_range((unsigned long)ctrl->async_dummy,
+		ALIGN_END_ADDR(struct qTD, ctrl->async_dummy,
+			       2 * EHCI_ASYNC_QHS));
+	ctrl->async_dummy_cur[i] = !ctrl->async_dummy_cur[i];
+
+	ret = ehci_enable_async(ctrl);
+	if (ret < 0)
+		goto fail;
+
+	/* Wait for TDs to be processed. */
+	ts = get_timer(0);
+	vtd = qtd_counter > 1 ? &qtd[qtd_counter - 1] : dummy;
+	timeout = USB_TIMEOUT_MS(pipe);
+	do {
+		/* Invalidate dcache */
+		invalidate_dcache_range((unsigned long)ctrl->async_qh,
+			ALIGN_END_ADDR(struct QH, ctrl->async_qh,
+				       EHCI_ASYNC_QHS));
+		invalidate_dcache_range((unsigned long)ctrl->async_dummy,
+			ALIGN_END_ADDR(struct qTD, ctrl->async_dummy,
+				       2 * EHCI_ASYNC_QHS));
+		invalidate_dcache_range((unsigned long)qtd,
+			ALIGN_END_ADDR(struct qTD, qtd, qtd_count));
+
+		token = hc32_to_cpu(vtd->qt_token);
+		if (!(QT_TOKEN_GET_STATUS(token) & QT_TOKEN_STATUS_ACTIVE))
+			break;
+		/* On errors the QH halts, leaving the following qTDs active */
+		if (QT_TOKEN_GET_STATUS(hc32_to_cpu(qh->qh_overlay.qt_token)) &
+		    QT_TOKEN_STATUS_HALTED)
+			break;
+		WATCHDOG_RESET();
+	} while (get_timer(ts) < timeout);
+
+	/*
+	 * Invalidate the memory area occupied by buffer
+	 * Don't try to fix the buffer alignment, if it isn't properly
+	 * aligned it's upper layer's fault so let invalidate_dcache_range()
+	 * vow about it. But we have to fix the length as it's actual
+	 * transfer length and can be unaligned. This is potentially
+	 * dangerous operation, it's responsibility of the calling
+	 * code to make sure enough space is reserved.
+	 */
+	if (buffer != NULL && length > 0)
+		invalidate_dcache_range((unsigned long)buffer,
+			ALIGN((unsigned long)buffer + length, ARCH_DMA_MINALIGN));
+
+	/*
+	 * Check that the TD processing happened. If not, stop the controller
+	 * working on the qTDs; the QH is set up afresh when next used.
+	 */
+	if ((QT_TOKEN_GET_STATUS(token) & QT_TOKEN_STATUS_ACTIVE) &&
+	    !(QT_TOKEN_GET_STATUS(hc32_to_cpu(qh->qh_overlay.qt_token)) &
+	      QT_TOKEN_STATUS_HALTED)) {
+		printf("EHCI timed out on TD - token=%#x\n", token);
+		ret = ehci_disable_async(ctrl);
+		if (ret < 0)
+			goto fail;
+		invalidate_dcache_range((unsigned long)ctrl->async_qh,
+			ALIGN_END_ADDR(struct QH, ctrl->async_qh,
+				       EHCI_ASYNC_QHS));
+		/* Its overlay may be idle between two qTDs of the chain */
+		qh->qh_endpt1 = 0;
+		flush_dcache_range((unsigned long)ctrl->async_qh,
+			ALIGN_END_ADDR(struct QH, ctrl->async_qh,
+				       EHCI_ASYNC_QHS));
+	}
+
+	token = hc32_to_cpu(qh->qh_overlay.qt_token);
+	if (!(QT_TOKEN_GET_STATUS(token) & QT_TOKEN_STATUS_ACTIVE)) {
+		debug("TOKEN=%#x\n", token);
+		switch (QT_TOKEN_GET_STATUS(token) &
+			~(QT_TOKEN_STATUS_SPLITXSTATE | QT_TOKEN_STATUS_PERR)) {
+		case 0:
+			toggle = QT_TOKEN_GET_DT(token);
+			usb_settoggle(dev, usb_pipeendpoint(pipe),
+				       usb_pipeout(pipe), toggle);
+			dev->status = 0;
+			break;
+		case QT_TOKEN_STATUS_HALTED:
+			dev->status = USB_ST_STALLED;
+			break;
+		case QT_TOKEN_STATUS_ACTIVE | QT_TOKEN_STATUS_DATBUFERR:
+		case QT_TOKEN_STATUS_DATBUFERR:
+			dev->status = USB_ST_BUF_ERR;
+			break;
+		case QT_TOKEN_STATUS_HALTED | QT_TOKEN_STATUS_BABBLEDET:
+		case QT_TOKEN_STATUS_BABBLEDET:
+			dev->status = USB_ST_BABBLE_DET;
+			break;
+		default:
+			dev->status = USB_ST_CRC_ERR;
+			if (QT_TOKEN_GET_STATUS(token) & QT_TOKEN_STATUS_HALTED)
+				dev->status |= USB_ST_STALLED;
+			break;
+		}
+		dev->act_len = length - QT_TOKEN_GET_TOTALBYTES(token);
+	} else {
+		dev->act_len = 0;
+#ifndef CONFIG_USB_EHCI_FARADAY
+		debug("dev=%u, usbsts=%#x, p[1]=%#x, p[2]=%#x\n",
+		      dev->devnum, ehci_readl(&ctrl->hcor->or_usbsts),
+		      ehci_readl(&ctrl->hcor->or_portsc[0]),
+		      ehci_readl(&ctrl->hcor->or_portsc[1]));
+#endif
+	}
+
+	return (dev->status != USB_ST_NOT_PROC) ? 0 : -1;
+
+fail:
+	return -1;
+}
+#else
 static int
 ehci_submit_async(struct usb_device *dev, unsigned long pipe, void *buffer,
 		   int length, struct devrequest *req)
@@ -663,6 +1223,7 @@ fail:
 	free(qtd);
 	return -1;
 }
+#endif
 
 static int ehci_submit_root(struct usb_device *dev, unsigned long pipe,
 			    void *buffer, int length, struct devrequest *req)
@@ -1014,6 +1575,12 @@ static int ehci_common_init(struct ehci_ctrl *ctrl, uint tweaks)
 
 	flush_dcache_range((unsigned long)qh_list,
 			   ALIGN_END_ADDR(struct QH, qh_list, 1));
+#ifdef CONFIG_USB_EHCI_KEEP_ASYNC
+	ctrl->async_qhs = 0;
+	ctrl->async_qh_next = 0;
+	ctrl->async_running = false;
+	memset(ctrl->async_dummy_cur, 0, sizeof(ctrl->async_dummy_cur));
+#endif
 
 	/* Set async. queue head pointer. */
 	ehci_writel(&ctrl->hcor->or_asynclistaddr, virt_to_phys(qh_list));
@@ -1101,6 +1668,11 @@ static int ehci_common_init(struct ehci_ctrl *ctrl, uint tweaks)
 int usb_lowlevel_stop(int index)
 {
 	ehci_shutdown(&ehcic[index]);
+#ifdef CONFIG_USB_EHCI_KEEP_ASYNC
+	free(ehcic[index].qtd_pool);
+	ehcic[index].qtd_pool = NULL;
+	ehcic[index].qtd_pool_count = 0;
+#endif
 	return ehci_hcd_stop(index);
 }
 
@@ -1670,6 +2242,11 @@ int ehci_deregister(struct udevice *dev)
 		return 0;
 
 	ehci_shutdown(ctrl);
+#ifdef CONFIG_USB_EHCI_KEEP_ASYNC
+	free(ctrl->qtd_pool);
+	ctrl->qtd_pool = NULL;
+	ctrl->qtd_pool_count = 0;
+#endif
 
 	return 0;
 }
@@ -243,6 +243,16 @@ struct ehci_ops {
 	int (*init_after_reset)(struct ehci_ctrl *ctrl);
 };
 
+#ifdef CONFIG_USB_EHCI_KEEP_ASYNC
+/*
+ * Number of QHs kept in the async schedule between transfers, each for the
+ * endpoint it was last used with. Mass storage needs three (control, bulk in
+ * and bulk out). A multiple of 4 keeps the array a whole number of cache
+ * lines.
+ */
+#define EHCI_ASYNC_QHS		4
+#endif
+
 struct ehci_ctrl {
 	enum usb_init_type init;
 	struct ehci_hccr *hccr;	/* R/O registers, not need for volatile */
@@ -250,10 +260,24 @@ struct ehci_ctrl {
 	int rootdev;
 	uint16_t portreset;
 	struct QH qh_list __aligned(USB_DMA_MINALIGN);
+#ifdef CONFIG_USB_EHCI_KEEP_ASYNC
+	struct QH async_qh[EHCI_ASYNC_QHS] __aligned(USB_DMA_MINALIGN);
+	/* Inactive qTDs which end the qTD chain of each async_qh */
+	struct qTD async_dummy[EHCI_ASYNC_QHS][2] __aligned(USB_DMA_MINALIGN);
+#endif
 	struct QH periodic_queue __aligned(USB_DMA_MINALIGN);
 	uint32_t *periodic_list;
 	int periodic_schedules;
 	int ntds;
+#ifdef CONFIG_USB_EHCI_KEEP_ASYNC
+	int async_qhs;		/* number of async_qh linked in */
+	int async_qh_next;	/* next async_qh to give to a new endpoint */
+	bool async_running;	/* async schedule is enabled */
+	/* async_dummy each async_qh's chain currently ends with */
+	int async_dummy_cur[EHCI_ASYNC_QHS];
+	struct qTD *qtd_pool;	/* qTDs of the current async transfer */
+	int qtd_pool_count;
+#endif
 	bool has_fsl_erratum_a005275;	/* Freescale HS silicon quirk */
 	struct ehci_ops ops;
 	void *priv;	/* client's private data */
@@ -9,7 +9,9 @@
 #include <common.h>
 #include <dm.h>
 #include <errno.h>
+#include <malloc.h>
 #include <memalign.h>
+#include <thread.h>
 #include <usb.h>
 #include <dm/device-internal.h>
 #include <dm/lists.h>
@@ -158,6 +160,42 @@ int usb_get_max_xfer_size(struct usb_device *udev, size_t *size)
 	return ops->get_max_xfer_size(bus, size);
 }
 
+int usb_alloc_streams(struct usb_device *udev, unsigned long *pipes,
+		      int num_pipes, int num_streams)
+{
+	struct udevice *bus = udev->controller_dev;
+	struct dm_usb_ops *ops = usb_get_ops(bus);
+
+	if (!ops->alloc_streams)
+		return -ENOSYS;
+
+	return ops->alloc_streams(bus, udev, pipes, num_pipes, num_streams);
+}
+
+int submit_bulk_stream_msg(struct usb_device *udev, unsigned long pipe,
+			   unsigned int stream_id, void *buffer, int length)
+{
+	struct udevice *bus = udev->controller_dev;
+	struct dm_usb_ops *ops = usb_get_ops(bus);
+
+	if (!ops->bulk_stream)
+		return -ENOSYS;
+
+	return ops->bulk_stream(bus, udev, pipe, stream_id, buffer, length);
+}
+
+int submit_bulk_batch(struct usb_device *udev, struct usb_bulk_req *reqs,
+		      int count)
+{
+	struct udevice *bus = udev->controller_dev;
+	struct dm_usb_ops *ops = usb_get_ops(bus);
+
+	if (!ops->bulk_batch)
+		return -ENOSYS;
+
+	return ops->bulk_batch(bus, udev, reqs, count);
+}
+
 int usb_stop(void)
 {
 	struct udevice *bus;
@@ -204,21 +242,54 @@ static void usb_scan_bus(struct udevice *bus, bool recurse)
 {
 	struct usb_bus_priv *priv;
 	struct udevice *dev;
-	int ret;
 
 	priv = dev_get_uclass_priv(bus);
 
 	assert(recurse);	/* TODO: Support non-recusive */
 
-	printf("scanning bus %d for devices... ", bus->seq);
-	debug("\n");
-	ret = usb_scan_device(bus, 0, USB_SPEED_FULL, &dev);
+	debug("scanning bus %d\n", bus->seq);
+	priv->scan_ret = usb_scan_device(bus, 0, USB_SPEED_FULL, &dev);
+}
+
+/*
+ * Scan the root hubs of all primary controllers (or all companions), then
+ * the ports of all of them together so that they share the power-good delay
+ */
+static void usb_scan_buses(struct uclass *uc, bool companion)
+{
+	struct usb_bus_priv *priv;
+	struct udevice *bus;
+	int ret;
+
+	usb_hub_scan_start();
+	uclass_foreach_dev(bus, uc) {
+		if (!device_active(bus))
+			continue;
+
+		priv = dev_get_uclass_priv(bus);
+		if (priv->companion == companion)
+			usb_scan_bus(bus, true);
+	}
+	ret = usb_hub_scan_finish();
 	if (ret)
-		printf("failed, error %d\n", ret);
-	else if (priv->next_addr == 0)
-		printf("No USB Device found\n");
-	else
-		printf("%d USB Device(s) found\n", priv->next_addr);
+		debug("%s: port scan failed (err=%d)\n", __func__, ret);
+
+	uclass_foreach_dev(bus, uc) {
+		if (!device_active(bus))
+			continue;
+
+		priv = dev_get_uclass_priv(bus);
+		if (priv->companion != companion)
+			continue;
+
+		printf("scanning bus %d for devices... ", bus->seq);
+		if (priv->scan_ret)
+			printf("failed, error %d\n", priv->scan_ret);
+		else if (priv->next_addr == 0)
+			printf("No USB Device found\n");
+		else
+			printf("%d USB Device(s) found\n", priv->next_addr);
+	}
 }
 
 static void remove_inactive_children(struct uclass *uc, struct udevice *bus)
@@ -235,11 +306,78 @@ static void remove_inactive_children(struct uclass *uc, struct udevice *bus)
 	}
 }
 
+#if CONFIG_IS_ENABLED(USB_INIT_ASYNC)
+static int usb_probe_thread(void *arg)
+{
+	return device_probe(arg);
+}
+
+/*
+ * Start probing each controller in its own thread, so that their PHY and
+ * VBUS waits overlap. Returns the threads in uclass order, with NULL for a
+ * controller which is to be probed as usual, or NULL if out of memory.
+ */
+static struct thread **usb_probe_start(struct uclass *uc)
+{
+	struct thread **threads;
+	struct udevice *bus;
+	int count = 0;
+
+	uclass_foreach_dev(bus, uc)
+		count++;
+	threads = calloc(count, sizeof(*threads));
+	if (!threads)
+		return NULL;
+
+	count = 0;
+	uclass_foreach_dev(bus, uc) {
+		if (!device_active(bus))
+			threads[count] = thread_create(bus->name,
+						       usb_probe_thread, bus);
+		count++;
+	}
+
+	/* Let each thread get as far as its first hardware wait */
+	thread_run_others();
+
+	return threads;
+}
+
+/* Wait for any threads not yet joined, and free @threads */
+static void usb_probe_finish(struct thread **threads, int count)
+{
+	int i;
+
+	if (!threads)
+		return;
+	for (i = 0; i < count; i++) {
+		if (threads[i])
+			thread_join(threads[i]);
+	}
+	free(threads);
+}
+#endif
+
+/* Probe controller @i, or wait for the thread in @threads which probes it */
+static int usb_probe_bus(struct udevice *bus, struct thread **threads, int i)
+{
+#if CONFIG_IS_ENABLED(USB_INIT_ASYNC)
+	struct thread *thread = threads ? threads[i] : NULL;
+
+	if (thread) {
+		threads[i] = NULL;
+		return thread_join(thread);
+	}
+#endif
+
+	return device_probe(bus);
+}
+
 int usb_init(void)
 {
 	int controllers_initialized = 0;
 	struct usb_uclass_priv *uc_priv;
-	struct usb_bus_priv *priv;
+	struct thread **threads = NULL;
 	struct udevice *bus;
 	struct uclass *uc;
 	int count = 0;
@@ -253,6 +391,9 @@ int usb_init(void)
 
 	uc_priv = uc->priv;
 
+#if CONFIG_IS_ENABLED(USB_INIT_ASYNC)
+	threads = usb_probe_start(uc);
+#endif
 	uclass_foreach_dev(bus, uc) {
 		/* init low_level USB */
 		printf("USB%d:   ", count);
@@ -272,7 +413,7 @@ int usb_init(void)
 		}
 #endif
 
-		ret = device_probe(bus);
+		ret = usb_probe_bus(bus, threads, count - 1);
 		if (ret == -ENODEV) {	/* No such device. */
 			puts("Port not available.\n");
 			controllers_initialized++;
@@ -286,35 +427,23 @@ int usb_init(void)
 		controllers_initialized++;
 		usb_started = true;
 	}
+#if CONFIG_IS_ENABLED(USB_INIT_ASYNC)
+	usb_probe_finish(threads, count);
+#endif
 
 	/*
 	 * lowlevel init done, now scan the bus for devices i.e. search HUBs
 	 * and configure them, first scan primary controllers.
 	 */
-	uclass_foreach_dev(bus, uc) {
-		if (!device_active(bus))
-			continue;
-
-		priv = dev_get_uclass_priv(bus);
-		if (!priv->companion)
-			usb_scan_bus(bus, true);
-	}
+	usb_scan_buses(uc, false);
 
 	/*
 	 * Now that the primary controllers have been scanned and have handed
 	 * over any devices they do not understand to their companions, scan
 	 * the companions if necessary.
 	 */
-	if (uc_priv->companion_device_count) {
-		uclass_foreach_dev(bus, uc) {
-			if (!device_active(bus))
-				continue;
-
-			priv = dev_get_uclass_priv(bus);
-			if (priv->companion)
-				usb_scan_bus(bus, true);
-		}
-	}
+	if (uc_priv->companion_device_count)
+		usb_scan_buses(uc, true);
 
 	debug("scan end\n");
 
@@ -148,9 +148,11 @@ static void xhci_free_virt_devices(struct xhci_ctrl *ctrl)
 
 		ctrl->dcbaa->dev_context_ptrs[slot_id] = 0;
 
-		for (i = 0; i < 31; ++i)
+		for (i = 0; i < 31; ++i) {
 			if (virt_dev->eps[i].ring)
 				xhci_ring_free(virt_dev->eps[i].ring);
+			xhci_free_stream_info(&virt_dev->eps[i]);
+		}
 
 		if (virt_dev->in_ctx)
 			xhci_free_container_ctx(virt_dev->in_ctx);
@@ -313,6 +315,7 @@ struct xhci_ring *xhci_ring_alloc(unsigned int num_segs, bool link_trbs)
 	ring->first_seg = xhci_segment_alloc();
 	BUG_ON(!ring->first_seg);
 
+	ring->num_segs = num_segs;
 	num_segs--;
 
 	prev = ring->first_seg;
@@ -338,6 +341,133 @@ struct xhci_ring *xhci_ring_alloc(unsigned int num_segs, bool link_trbs)
 	return ring;
 }
 
+#ifdef CONFIG_USB_XHCI_BULK_BATCH
+/**
+ * Makes room for a number of TRBs on an idle transfer ring, i.e. one whose
+ * TDs have all been completed or thrown away, so that the xHC dequeue
+ * pointer is at our enqueue pointer. New segments are linked in right after
+ * the enqueue segment, which is where the xHC goes next, so they need not be
+ * known to it beforehand.
+ *
+ * @param ring		transfer ring to grow
+ * @param num_trbs	number of TRBs to make room for, not counting link TRBs
+ * @return none
+ */
+void xhci_ring_expand(struct xhci_ring *ring, unsigned int num_trbs)
+{
+	struct xhci_segment *first = NULL;
+	struct xhci_segment *last = NULL;
+	struct xhci_segment *seg;
+	unsigned int num_segs;
+	u32 toggle;
+	int i;
+
+	/* One TRB is left free so that a full ring never looks empty */
+	num_segs = DIV_ROUND_UP(num_trbs + 1, TRBS_PER_SEGMENT - 1);
+	if (num_segs <= ring->num_segs)
+		return;
+	num_segs -= ring->num_segs;
+	ring->num_segs += num_segs;
+
+	while (num_segs--) {
+		seg = xhci_segment_alloc();
+		/*
+		 * The TRBs must not be taken for valid ones in the current pass
+		 * over the ring, so give them the other cycle state.
+		 */
+		if (!ring->cycle_state) {
+			for (i = 0; i < TRBS_PER_SEGMENT; i++)
+				seg->trbs[i].link.control |=
+						cpu_to_le32(TRB_CYCLE);
+		}
+		if (last)
+			xhci_link_segments(last, seg, true);
+		else
+			first = seg;
+		last = seg;
+	}
+
+	xhci_link_segments(last, ring->enq_seg->next, true);
+	xhci_link_segments(ring->enq_seg, first, true);
+
+	/* The toggle moves along if we grew the ring at its end */
+	toggle = ring->enq_seg->trbs[TRBS_PER_SEGMENT - 1].link.control &
+		 cpu_to_le32(LINK_TOGGLE);
+	ring->enq_seg->trbs[TRBS_PER_SEGMENT - 1].link.control &= ~toggle;
+	last->trbs[TRBS_PER_SEGMENT - 1].link.control |= toggle;
+
+	for (seg = first; seg != last->next; seg = seg->next)
+		xhci_flush_cache((uintptr_t)seg->trbs, SEGMENT_SIZE);
+	xhci_flush_cache((uintptr_t)&ring->enq_seg->trbs[TRBS_PER_SEGMENT - 1],
+			 sizeof(union xhci_trb));
+}
+#endif
+
+/**
+ * Allocates a linear primary stream context array for an endpoint, along
+ * with one transfer ring for each stream ID. Stream ID 0 is reserved, so its
+ * context is left empty.
+ *
+ * @param ep		endpoint to set up
+ * @param num_streams	size of the stream context array (a power of two)
+ * @return 0 on success, -ENOMEM if a ring could not be allocated
+ */
+int xhci_alloc_stream_info(struct xhci_virt_ep *ep, unsigned int num_streams)
+{
+	unsigned int i;
+	u64 val_64;
+
+	xhci_free_stream_info(ep);
+
+	ep->stream_ctx = xhci_malloc(num_streams *
+				     sizeof(struct xhci_stream_ctx));
+	ep->stream_rings = calloc(num_streams, sizeof(struct xhci_ring *));
+	if (!ep->stream_rings)
+		goto err;
+	ep->num_streams = num_streams;
+
+	for (i = 1; i < num_streams; i++) {
+		ep->stream_rings[i] = xhci_ring_alloc(1, true);
+		if (!ep->stream_rings[i])
+			goto err;
+		val_64 = (uintptr_t)ep->stream_rings[i]->enqueue;
+		ep->stream_ctx[i].stream_ring = cpu_to_le64(val_64 |
+				SCT_FOR_CTX(SCT_PRI_TR) |
+				ep->stream_rings[i]->cycle_state);
+	}
+	xhci_flush_cache((uintptr_t)ep->stream_ctx,
+			 num_streams * sizeof(struct xhci_stream_ctx));
+
+	return 0;
+err:
+	xhci_free_stream_info(ep);
+
+	return -ENOMEM;
+}
+
+/**
+ * Frees the stream context array and stream rings of an endpoint, if any
+ *
+ * @param ep	endpoint to clean up
+ * @return none
+ */
+void xhci_free_stream_info(struct xhci_virt_ep *ep)
+{
+	unsigned int i;
+
+	if (ep->stream_rings) {
+		for (i = 1; i < ep->num_streams; i++)
+			if (ep->stream_rings[i])
+				xhci_ring_free(ep->stream_rings[i]);
+		free(ep->stream_rings);
+	}
+	free(ep->stream_ctx);
+	ep->stream_rings = NULL;
+	ep->stream_ctx = NULL;
+	ep->num_streams = 0;
+	ep->ep_state &= ~EP_HAS_STREAMS;
+}
+
 /**
  * Set up the scratchpad buffer array and scratchpad buffers
  *
@@ -14,6 +14,7 @@
  */
 
 #include <common.h>
+#include <malloc.h>
 #include <asm/byteorder.h>
 #include <usb.h>
 #include <asm/unaligned.h>
@@ -265,11 +266,13 @@ static int prepare_ring(struct xhci_ctrl *ctrl, struct xhci_ring *ep_ring,
  * @param ptr		Pointer address to write in the first two fields (opt.)
  * @param slot_id	Slot ID to encode in the flags field (opt.)
  * @param ep_index	Endpoint index to encode in the flags field (opt.)
+ * @param stream_id	Stream ID to encode in the status field (opt.)
  * @param cmd		Command type to enqueue
  * @return none
  */
-void xhci_queue_command(struct xhci_ctrl *ctrl, u8 *ptr, u32 slot_id,
-			u32 ep_index, trb_type cmd)
+static void xhci_queue_stream_command(struct xhci_ctrl *ctrl, u8 *ptr,
+				      u32 slot_id, u32 ep_index,
+				      u32 stream_id, trb_type cmd)
 {
 	u32 fields[4];
 	u64 val_64 = (uintptr_t)ptr;
@@ -278,7 +281,7 @@ void xhci_queue_command(struct xhci_ctrl *ctrl, u8 *ptr, u32 slot_id,
 
 	fields[0] = lower_32_bits(val_64);
 	fields[1] = upper_32_bits(val_64);
-	fields[2] = 0;
+	fields[2] = STREAM_ID_FOR_TRB(stream_id);
 	fields[3] = TRB_TYPE(cmd) | SLOT_ID_FOR_TRB(slot_id) |
 		    ctrl->cmd_ring->cycle_state;
 
@@ -295,6 +298,23 @@ void xhci_queue_command(struct xhci_ctrl *ctrl, u8 *ptr, u32 slot_id,
 	xhci_writel(&ctrl->dba->doorbell[0], DB_VALUE_HOST);
 }
 
+/**
+ * Queues a command TRB which does not refer to a stream, see
+ * xhci_queue_stream_command().
+ *
+ * @param ctrl		Host controller data structure
+ * @param ptr		Pointer address to write in the first two fields (opt.)
+ * @param slot_id	Slot ID to encode in the flags field (opt.)
+ * @param ep_index	Endpoint index to encode in the flags field (opt.)
+ * @param cmd		Command type to enqueue
+ * @return none
+ */
+void xhci_queue_command(struct xhci_ctrl *ctrl, u8 *ptr, u32 slot_id,
+			u32 ep_index, trb_type cmd)
+{
+	xhci_queue_stream_command(ctrl, ptr, slot_id, ep_index, 0, cmd);
+}
+
 /**
  * The TD size is the number of bytes remaining in the TD (including this TRB),
  * right shifted by 10.
@@ -351,12 +371,13 @@ static u32 xhci_v1_0_td_remainder(int running_total,
  *
  * @param udev		pointer to the USB device structure
  * @param ep_index	index of the endpoint
+ * @param stream_id	stream ID of the ring the TRBs were queued on, or 0
  * @param start_cycle	cycle flag of the first TRB
  * @param start_trb	pionter to the first TRB
  * @return none
  */
 static void giveback_first_trb(struct usb_device *udev, int ep_index,
-				int start_cycle,
+				unsigned int stream_id, int start_cycle,
 				struct xhci_generic_trb *start_trb)
 {
 	struct xhci_ctrl *ctrl = xhci_get_ctrl(udev);
@@ -374,7 +395,7 @@ static void giveback_first_trb(struct usb_device *udev, int ep_index,
 
 	/* Ringing EP doorbell here */
 	xhci_writel(&ctrl->dba->doorbell[udev->slot_id],
-				DB_VALUE(ep_index, 0));
+				DB_VALUE(ep_index, stream_id));
 
 	return;
 }
@@ -473,6 +494,35 @@ union xhci_trb *xhci_wait_for_event(struct xhci_ctrl *ctrl, trb_type expected)
 	BUG();
 }
 
+/*
+ * Throws away all unprocessed TRBs on a stopped endpoint by setting the xHC's
+ * dequeue pointer to our enqueue pointer. On an endpoint with streams only
+ * the ring of @stream_id is moved on.
+ */
+static void set_tr_deq(struct usb_device *udev, int ep_index,
+		       unsigned int stream_id)
+{
+	struct xhci_ctrl *ctrl = xhci_get_ctrl(udev);
+	struct xhci_virt_ep *ep = &ctrl->devs[udev->slot_id]->eps[ep_index];
+	struct xhci_ring *ring = ep->ring;
+	uintptr_t deq;
+	union xhci_trb *event;
+
+	if (stream_id)
+		ring = ep->stream_rings[stream_id];
+
+	deq = (uintptr_t)ring->enqueue | ring->cycle_state;
+	if (stream_id)
+		deq |= SCT_FOR_CTX(SCT_PRI_TR);
+	xhci_queue_stream_command(ctrl, (void *)deq, udev->slot_id, ep_index,
+				  stream_id, TRB_SET_DEQ);
+	event = xhci_wait_for_event(ctrl, TRB_COMPLETION);
+	BUG_ON(TRB_TO_SLOT_ID(le32_to_cpu(event->event_cmd.flags))
+		!= udev->slot_id || GET_COMP_CODE(le32_to_cpu(
+		event->event_cmd.status)) != COMP_SUCCESS);
+	xhci_acknowledge_event(ctrl);
+}
+
 /*
  * Stops transfer processing for an endpoint and throws away all unprocessed
  * TRBs by setting the xHC's dequeue pointer to our enqueue pointer. The next
@@ -480,11 +530,12 @@ union xhci_trb *xhci_wait_for_event(struct xhci_ctrl *ctrl, trb_type expected)
  * ring the doorbell, causing this endpoint to start working again.
  * (Careful: This will BUG() when there was no transfer in progress. Shouldn't
  * happen in practice for current uses and is too complicated to fix right now.)
+ * On an endpoint with streams only the ring of @stream_id is moved on.
  */
-static void abort_td(struct usb_device *udev, int ep_index)
+static void abort_td(struct usb_device *udev, int ep_index,
+		     unsigned int stream_id)
 {
 	struct xhci_ctrl *ctrl = xhci_get_ctrl(udev);
-	struct xhci_ring *ring =  ctrl->devs[udev->slot_id]->eps[ep_index].ring;
 	union xhci_trb *event;
 	u32 field;
 
@@ -504,13 +555,7 @@ static void abort_td(struct usb_device *udev, int ep_index)
 		event->event_cmd.status)) != COMP_SUCCESS);
 	xhci_acknowledge_event(ctrl);
 
-	xhci_queue_command(ctrl, (void *)((uintptr_t)ring->enqueue |
-		ring->cycle_state), udev->slot_id, ep_index, TRB_SET_DEQ);
-	event = xhci_wait_for_event(ctrl, TRB_COMPLETION);
-	BUG_ON(TRB_TO_SLOT_ID(le32_to_cpu(event->event_cmd.flags))
-		!= udev->slot_id || GET_COMP_CODE(le32_to_cpu(
-		event->event_cmd.status)) != COMP_SUCCESS);
-	xhci_acknowledge_event(ctrl);
+	set_tr_deq(udev, ep_index, stream_id);
 }
 
 static void record_transfer_result(struct usb_device *udev,
@@ -542,17 +587,475 @@ static void record_transfer_result(struct usb_device *udev,
 }
 
 /**** Bulk and Control transfer methods ****/
+#ifdef CONFIG_USB_XHCI_BULK_BATCH
+
+/* The TRBs of a bulk TD on its ring, from first to last */
+struct xhci_bulk_td {
+	union xhci_trb *first;
+	union xhci_trb *last;
+};
+
+/**
+ * Finds the transfer ring a bulk request goes on
+ *
+ * @param virt_dev	the xHCI device the request is for
+ * @param req		the bulk request
+ * @return the ring, NULL if the stream ID does not fit the endpoint
+ */
+static struct xhci_ring *xhci_bulk_ring(struct xhci_virt_device *virt_dev,
+					struct usb_bulk_req *req)
+{
+	struct xhci_virt_ep *ep = &virt_dev->eps[usb_pipe_ep_index(req->pipe)];
+
+	/* Once an endpoint has streams, every TD goes on one of their rings */
+	if (!(ep->ep_state & EP_HAS_STREAMS) != !req->stream_id ||
+	    (req->stream_id && req->stream_id >= ep->num_streams))
+		return NULL;
+
+	return req->stream_id ? ep->stream_rings[req->stream_id] : ep->ring;
+}
+
+/**
+ * Counts the TRBs needed for a bulk TD.
+ * XHCI Spec puts restriction( TABLE 49 and 6.4.1 section of XHCI Spec)
+ * that the buffer should not span 64KB boundary. if so
+ * we send request in more than 1 TRB by chaining them.
+ *
+ * @param buffer	buffer of the TD
+ * @param length	length of the buffer
+ * @return number of TRBs
+ */
+static unsigned int xhci_bulk_num_trbs(void *buffer, int length)
+{
+	unsigned int num_trbs = 0;
+	int running_total;
+
+	/* How much data is (potentially) left before the 64KB boundary? */
+	running_total = TRB_MAX_BUFF_SIZE -
+			(lower_32_bits((uintptr_t)buffer) &
+			 (TRB_MAX_BUFF_SIZE - 1));
+	running_total &= TRB_MAX_BUFF_SIZE - 1;
+
+	/*
+	 * If there's some data on this 64KB chunk, or we have to send a
+	 * zero-length transfer, we need at least one TRB
+	 */
+	if (running_total != 0 || length == 0)
+		num_trbs++;
+
+	/* How many more 64KB chunks to transfer, how many more TRBs? */
+	while (running_total < length) {
+		num_trbs++;
+		running_total += TRB_MAX_BUFF_SIZE;
+	}
+
+	return num_trbs;
+}
+
+/**
+ * Checks whether a TRB belongs to a TD, by walking the TD's TRBs and
+ * following the link TRB between two segments.
+ *
+ * @param td	the TD
+ * @param addr	address of the TRB, as given by a transfer event
+ * @return true if the TRB is one of the TD's, else false
+ */
+static bool trb_in_td(struct xhci_bulk_td *td, u64 addr)
+{
+	union xhci_trb *trb = td->first;
+
+	for (;;) {
+		if ((uintptr_t)trb == addr)
+			return true;
+		if (trb == td->last)
+			return false;
+		if (TRB_TYPE_LINK_LE32(trb->link.control))
+			trb = (union xhci_trb *)(uintptr_t)
+			      le64_to_cpu(trb->link.segment_ptr);
+		else
+			trb++;
+	}
+}
+
+/**
+ * Queues the TRBs of one bulk TD. The ring must have room for them.
+ *
+ * @param ctrl		Host controller data structure
+ * @param ring		transfer ring to queue the TD on
+ * @param req		the bulk request
+ * @param td		returns where the TRBs of the TD are on the ring
+ * @param maxpacketsize	max packet size of the endpoint
+ * @param first_td	true if this is the first TD queued on the ring, whose
+ *			first TRB is given to the hardware by
+ *			giveback_first_trb() once all TDs are queued
+ * @param more_tds	true if another TD follows on the ring
+ * @return none
+ */
+static void queue_bulk_td(struct xhci_ctrl *ctrl, struct xhci_ring *ring,
+			  struct usb_bulk_req *req, struct xhci_bulk_td *td,
+			  int maxpacketsize, bool first_td, bool more_tds)
+{
+	int length = req->length;
+	int num_trbs = xhci_bulk_num_trbs(req->buffer, length);
+	unsigned int total_packet_count = DIV_ROUND_UP(length, maxpacketsize);
+	bool v1_0 = HC_VERSION(xhci_readl(&ctrl->hccr->cr_capbase)) >= 0x100;
+	int running_total = 0;
+	int trb_buff_len;
+	u64 addr = (uintptr_t)req->buffer;
+	u32 field, remainder;
+	u32 trb_fields[4];
+
+	/* How much data is in the first TRB? */
+	trb_buff_len = TRB_MAX_BUFF_SIZE -
+		       (lower_32_bits(addr) & (TRB_MAX_BUFF_SIZE - 1));
+	if (trb_buff_len > length)
+		trb_buff_len = length;
+
+	/* flush the buffer before use */
+	xhci_flush_cache((uintptr_t)req->buffer, length);
+
+	td->first = ring->enqueue;
+
+	/* Queue the first TRB, even if it's zero-length */
+	do {
+		/* Don't change the cycle bit of the first TRB until later */
+		if (first_td) {
+			first_td = false;
+			field = ring->cycle_state ? 0 : TRB_CYCLE;
+		} else {
+			field = ring->cycle_state;
+		}
+
+		/*
+		 * Chain all the TRBs together; clear the chain bit in the last
+		 * TRB to indicate it's the last TRB in the chain.
+		 */
+		if (num_trbs > 1)
+			field |= TRB_CHAIN;
+		else
+			field |= TRB_IOC;
+
+		/* Only set interrupt on short packet for IN endpoints */
+		if (usb_pipein(req->pipe))
+			field |= TRB_ISP;
+
+		/* Set the TRB length, TD size, and interrupter fields. */
+		if (!v1_0)
+			remainder = xhci_td_remainder(length - running_total);
+		else
+			remainder = xhci_v1_0_td_remainder(running_total,
+							   trb_buff_len,
+							   total_packet_count,
+							   maxpacketsize,
+							   num_trbs - 1);
+
+		trb_fields[0] = lower_32_bits(addr);
+		trb_fields[1] = upper_32_bits(addr);
+		trb_fields[2] = (trb_buff_len & TRB_LEN_MASK) | remainder |
+				((0 & TRB_INTR_TARGET_MASK) <<
+				 TRB_INTR_TARGET_SHIFT);
+		trb_fields[3] = field | (TRB_NORMAL << TRB_TYPE_SHIFT);
+
+		td->last = (union xhci_trb *)queue_trb(ctrl, ring,
+						       num_trbs > 1 || more_tds,
+						       trb_fields);
+
+		--num_trbs;
+
+		running_total += trb_buff_len;
+
+		/* Calculate length for next transfer */
+		addr += trb_buff_len;
+		trb_buff_len = min((length - running_total), TRB_MAX_BUFF_SIZE);
+	} while (running_total < length);
+}
+
+/*
+ * Gives up on the requests of a batch which are still queued: each endpoint
+ * they are on is stopped once and each of their rings is moved on.
+ */
+static void abort_bulk_batch(struct usb_device *udev,
+			     struct usb_bulk_req *reqs, int count)
+{
+	bool stopped, moved;
+	int ep_index;
+	int i, j;
+
+	for (i = 0; i < count; i++) {
+		if (reqs[i].act_len >= 0)
+			continue;
+		ep_index = usb_pipe_ep_index(reqs[i].pipe);
+		stopped = false;
+		moved = false;
+		for (j = 0; j < i; j++) {
+			if (reqs[j].status != USB_ST_NAK_REC ||
+			    usb_pipe_ep_index(reqs[j].pipe) != ep_index)
+				continue;
+			stopped = true;
+			if (reqs[j].stream_id == reqs[i].stream_id)
+				moved = true;
+		}
+		if (!stopped)
+			abort_td(udev, ep_index, reqs[i].stream_id);
+		else if (!moved)
+			set_tr_deq(udev, ep_index, reqs[i].stream_id);
+		/* closest thing to a timeout */
+		reqs[i].status = USB_ST_NAK_REC;
+		reqs[i].act_len = 0;
+	}
+}
+
+/*
+ * Recovers an endpoint on which a TD of a batch failed: a halted endpoint is
+ * reset, then each of its rings used by the batch is moved past the TRBs
+ * left on it.
+ */
+static void reset_bulk_ep(struct usb_device *udev, struct usb_bulk_req *reqs,
+			  int count, int ep_index)
+{
+	struct xhci_ctrl *ctrl = xhci_get_ctrl(udev);
+	struct xhci_virt_device *virt_dev = ctrl->devs[udev->slot_id];
+	struct xhci_ep_ctx *ep_ctx;
+	union xhci_trb *event;
+	u32 ep_state;
+	int i, j;
+
+	xhci_inval_cache((uintptr_t)virt_dev->out_ctx->bytes,
+			 virt_dev->out_ctx->size);
+	ep_ctx = xhci_get_ep_ctx(ctrl, virt_dev->out_ctx, ep_index);
+	ep_state = le32_to_cpu(ep_ctx->ep_info) & EP_STATE_MASK;
+	if (ep_state == EP_STATE_HALTED) {
+		xhci_queue_command(ctrl, NULL, udev->slot_id, ep_index,
+				   TRB_RESET_EP);
+		event = xhci_wait_for_event(ctrl, TRB_COMPLETION);
+		BUG_ON(TRB_TO_SLOT_ID(le32_to_cpu(event->event_cmd.flags))
+			!= udev->slot_id || GET_COMP_CODE(le32_to_cpu(
+			event->event_cmd.status)) != COMP_SUCCESS);
+		xhci_acknowledge_event(ctrl);
+	} else if (ep_state != EP_STATE_STOPPED && ep_state != EP_STATE_ERROR) {
+		debug("XHCI endpoint %d not stopped after error (state %d)\n",
+		      ep_index, ep_state);
+		return;
+	}
+
+	for (i = 0; i < count; i++) {
+		if (usb_pipe_ep_index(reqs[i].pipe) != ep_index)
+			continue;
+		for (j = 0; j < i; j++)
+			if (usb_pipe_ep_index(reqs[j].pipe) == ep_index &&
+			    reqs[j].stream_id == reqs[i].stream_id)
+				break;
+		if (j == i)
+			set_tr_deq(udev, ep_index, reqs[i].stream_id);
+	}
+}
+
+/**
+ * Queues up a batch of BULK Requests and waits for all of them.
+ *
+ * A request can be of any length: the transfer ring grows to hold its TD.
+ * All TDs going on the same ring are queued before its doorbell is rung, so
+ * the controller moves from one to the next without waiting for us, and
+ * the transfer events are then picked up in whatever order they come in.
+ * A TD that fails halts its endpoint, so the requests behind it on that
+ * endpoint are left unprocessed. Once all events are in, that endpoint is
+ * reset and its rings are moved past their unprocessed TRBs.
+ *
+ * @param udev		pointer to the USB device structure
+ * @param reqs		requests to queue, act_len and status are filled in
+ * @param count		number of requests
+ * @return 0 if every request was handled (see their status), -ETIMEDOUT if
+ *	   the controller stopped answering, -ENOMEM if out of memory, other
+ *	   -ve if a request could not be queued
+ */
+int xhci_bulk_tx_batch(struct usb_device *udev, struct usb_bulk_req *reqs,
+		       int count)
+{
+	struct xhci_ctrl *ctrl = xhci_get_ctrl(udev);
+	int slot_id = udev->slot_id;
+	struct xhci_virt_device *virt_dev = ctrl->devs[slot_id];
+	struct xhci_generic_trb *start_trb;
+	struct xhci_bulk_td *tds;
+	struct xhci_ep_ctx *ep_ctx;
+	struct xhci_ring *ring;
+	union xhci_trb *event;
+	unsigned int num_trbs;
+	u64 addr;
+	int start_cycle;
+	int ep_index;
+	int pending;
+	int i, j, next;
+	u32 field;
+	int ret;
+
+	xhci_inval_cache((uintptr_t)virt_dev->out_ctx->bytes,
+			 virt_dev->out_ctx->size);
+
+	for (i = 0; i < count; i++) {
+		reqs[i].status = USB_ST_NOT_PROC;
+		reqs[i].act_len = 0;
+	}
+
+	/*
+	 * Check all rings before queueing anything, and make each of them
+	 * big enough for all the TDs going on it
+	 */
+	for (i = 0; i < count; i++) {
+		ring = xhci_bulk_ring(virt_dev, &reqs[i]);
+		if (!ring)
+			return -EINVAL;
+		for (j = 0; j < i; j++)
+			if (xhci_bulk_ring(virt_dev, &reqs[j]) == ring)
+				break;
+		if (j < i)
+			continue;
+
+		ep_index = usb_pipe_ep_index(reqs[i].pipe);
+		ep_ctx = xhci_get_ep_ctx(ctrl, virt_dev->out_ctx, ep_index);
+		ret = prepare_ring(ctrl, ring,
+				   le32_to_cpu(ep_ctx->ep_info) &
+				   EP_STATE_MASK);
+		if (ret < 0)
+			return ret;
+
+		num_trbs = 0;
+		for (j = i; j < count; j++)
+			if (xhci_bulk_ring(virt_dev, &reqs[j]) == ring)
+				num_trbs += xhci_bulk_num_trbs(reqs[j].buffer,
+							       reqs[j].length);
+		xhci_ring_expand(ring, num_trbs);
+	}
+
+	tds = calloc(count, sizeof(*tds));
+	if (!tds)
+		return -ENOMEM;
+
+	for (i = 0; i < count; i++) {
+		ring = xhci_bulk_ring(virt_dev, &reqs[i]);
+		if (reqs[i].act_len < 0)
+			continue;
+
+		/*
+		 * Don't give the first TRB to the hardware (by toggling the
+		 * cycle bit) until we've finished creating all the other TRBs.
+		 * The ring's cycle state may change as we enqueue the other
+		 * TRBs, so save it too.
+		 */
+		start_trb = &ring->enqueue->generic;
+		start_cycle = ring->cycle_state;
+
+		for (j = i; j < count; j = next) {
+			for (next = j + 1; next < count; next++)
+				if (xhci_bulk_ring(virt_dev,
+						   &reqs[next]) == ring)
+					break;
+			queue_bulk_td(ctrl, ring, &reqs[j], &tds[j],
+				      usb_maxpacket(udev, reqs[j].pipe),
+				      j == i, next < count);
+			reqs[j].act_len = -1;
+		}
+
+		giveback_first_trb(udev, usb_pipe_ep_index(reqs[i].pipe),
+				   reqs[i].stream_id, start_cycle, start_trb);
+	}
+
+	for (pending = count; pending;) {
+		event = xhci_wait_for_event(ctrl, TRB_TRANSFER);
+		if (!event) {
+			debug("XHCI bulk transfer timed out, aborting...\n");
+			abort_bulk_batch(udev, reqs, count);
+			free(tds);
+			return -ETIMEDOUT;
+		}
+		field = le32_to_cpu(event->trans_event.flags);
+		BUG_ON(TRB_TO_SLOT_ID(field) != slot_id);
+		ep_index = TRB_TO_EP_INDEX(field);
+
+		/* Find the TD which the TRB the event is for belongs to */
+		addr = le64_to_cpu(event->trans_event.buffer);
+		for (i = 0; i < count; i++)
+			if (reqs[i].act_len < 0 &&
+			    usb_pipe_ep_index(reqs[i].pipe) == ep_index &&
+			    trb_in_td(&tds[i], addr))
+				break;
+		BUG_ON(i == count);
+
+		record_transfer_result(udev, event, reqs[i].length);
+		xhci_acknowledge_event(ctrl);
+		xhci_inval_cache((uintptr_t)reqs[i].buffer, reqs[i].length);
+		reqs[i].act_len = udev->act_len;
+		reqs[i].status = udev->status;
+		pending--;
+		if (!reqs[i].status)
+			continue;
+
+		for (j = 0; j < count; j++) {
+			if (reqs[j].act_len < 0 &&
+			    usb_pipe_ep_index(reqs[j].pipe) == ep_index) {
+				reqs[j].act_len = 0;
+				pending--;
+			}
+		}
+	}
+	free(tds);
+
+	/*
+	 * Only now that no more events are due, as waiting for a command
+	 * completion throws away any other event
+	 */
+	for (i = 0; i < count; i++)
+		if (reqs[i].status && reqs[i].status != USB_ST_NOT_PROC)
+			reset_bulk_ep(udev, reqs, count,
+				      usb_pipe_ep_index(reqs[i].pipe));
+
+	return 0;
+}
+
+/**
+ * Queues up the BULK Request
+ *
+ * @param udev		pointer to the USB device structure
+ * @param pipe		contains the DIR_IN or OUT , devnum
+ * @param stream_id	stream to queue the request on, 0 if none
+ * @param length	length of the buffer
+ * @param buffer	buffer to be read/written based on the request
+ * @return returns 0 if successful else -1 on failure
+ */
+int xhci_bulk_tx(struct usb_device *udev, unsigned long pipe,
+		 unsigned int stream_id, int length, void *buffer)
+{
+	struct usb_bulk_req req = {
+		.pipe = pipe,
+		.stream_id = stream_id,
+		.buffer = buffer,
+		.length = length,
+	};
+	int ret;
+
+	debug("dev=%p, pipe=%lx, buffer=%p, length=%d\n",
+		udev, pipe, buffer, length);
+
+	ret = xhci_bulk_tx_batch(udev, &req, 1);
+	udev->status = req.status;
+	udev->act_len = req.act_len;
+	if (ret)
+		return ret;
+
+	return (udev->status != USB_ST_NOT_PROC) ? 0 : -1;
+}
+#else
 /**
  * Queues up the BULK Request
  *
  * @param udev		pointer to the USB device structure
  * @param pipe		contains the DIR_IN or OUT , devnum
+ * @param stream_id	stream to queue the request on, 0 if none
  * @param length	length of the buffer
  * @param buffer	buffer to be read/written based on the request
  * @return returns 0 if successful else -1 on failure
  */
 int xhci_bulk_tx(struct usb_device *udev, unsigned long pipe,
-			int length, void *buffer)
+		 unsigned int stream_id, int length, void *buffer)
 {
 	int num_trbs = 0;
 	struct xhci_generic_trb *start_trb;
@@ -564,6 +1067,7 @@ int xhci_bulk_tx(struct usb_device *udev, unsigned long pipe,
 	int slot_id = udev->slot_id;
 	int ep_index;
 	struct xhci_virt_device *virt_dev;
+	struct xhci_virt_ep *ep;
 	struct xhci_ep_ctx *ep_ctx;
 	struct xhci_ring *ring;		/* EP transfer ring */
 	union xhci_trb *event;
@@ -587,7 +1091,12 @@ int xhci_bulk_tx(struct usb_device *udev, unsigned long pipe,
 
 	ep_ctx = xhci_get_ep_ctx(ctrl, virt_dev->out_ctx, ep_index);
 
-	ring = virt_dev->eps[ep_index].ring;
+	/* Once an endpoint has streams, every TD goes on one of their rings */
+	ep = &virt_dev->eps[ep_index];
+	if (!(ep->ep_state & EP_HAS_STREAMS) != !stream_id ||
+	    (stream_id && stream_id >= ep->num_streams))
+		return -EINVAL;
+	ring = stream_id ? ep->stream_rings[stream_id] : ep->ring;
 	/*
 	 * How much data is (potentially) left before the 64KB boundary?
 	 * XHCI Spec puts restriction( TABLE 49 and 6.4.1 section of XHCI Spec)
@@ -709,12 +1218,12 @@ int xhci_bulk_tx(struct usb_device *udev, unsigned long pipe,
 		trb_buff_len = min((length - running_total), TRB_MAX_BUFF_SIZE);
 	} while (running_total < length);
 
-	giveback_first_trb(udev, ep_index, start_cycle, start_trb);
+	giveback_first_trb(udev, ep_index, stream_id, start_cycle, start_trb);
 
 	event = xhci_wait_for_event(ctrl, TRB_TRANSFER);
 	if (!event) {
 		debug("XHCI bulk transfer timed out, aborting...\n");
-		abort_td(udev, ep_index);
+		abort_td(udev, ep_index, stream_id);
 		udev->status = USB_ST_NAK_REC;  /* closest thing to a timeout */
 		udev->act_len = 0;
 		return -ETIMEDOUT;
@@ -732,6 +1241,7 @@ int xhci_bulk_tx(struct usb_device *udev, unsigned long pipe,
 
 	return (udev->status != USB_ST_NOT_PROC) ? 0 : -1;
 }
+#endif
 
 /**
  * Queues up the Control Transfer Request
@@ -906,7 +1416,7 @@ int xhci_ctrl_tx(struct usb_device *udev, unsigned long pipe,
 
 	queue_trb(ctrl, ep_ring, false, trb_fields);
 
-	giveback_first_trb(udev, ep_index, start_cycle, start_trb);
+	giveback_first_trb(udev, ep_index, 0, start_cycle, start_trb);
 
 	event = xhci_wait_for_event(ctrl, TRB_TRANSFER);
 	if (!event)
@@ -938,7 +1448,7 @@ int xhci_ctrl_tx(struct usb_device *udev, unsigned long pipe,
 
 abort:
 	debug("XHCI control transfer timed out, aborting...\n");
-	abort_td(udev, ep_index);
+	abort_td(udev, ep_index, 0);
 	udev->status = USB_ST_NAK_REC;
 	udev->act_len = 0;
 	return -ETIMEDOUT;
@@ -28,6 +28,7 @@
 #include <asm/cache.h>
 #include <asm/unaligned.h>
 #include <linux/errno.h>
+#include <linux/log2.h>
 #include "xhci.h"
 
 #ifndef CONFIG_USB_MAX_CONTROLLER_COUNT
@@ -1122,7 +1123,7 @@ static int _xhci_submit_int_msg(struct usb_device *udev, unsigned long pipe,
 	 * (at most) one TD. A TD (comprised of sg list entries) can
 	 * take several service intervals to transmit.
 	 */
-	return xhci_bulk_tx(udev, pipe, length, buffer);
+	return xhci_bulk_tx(udev, pipe, 0, length, buffer);
 }
 
 /**
@@ -1142,7 +1143,7 @@ static int _xhci_submit_bulk_msg(struct usb_device *udev, unsigned long pipe,
 		return -EINVAL;
 	}
 
-	return xhci_bulk_tx(udev, pipe, length, buffer);
+	return xhci_bulk_tx(udev, pipe, 0, length, buffer);
 }
 
 /**
@@ -1384,6 +1385,41 @@ static int xhci_submit_bulk_msg(struct udevice *dev, struct usb_device *udev,
 	return _xhci_submit_bulk_msg(udev, pipe, buffer, length);
 }
 
+static int xhci_submit_bulk_stream(struct udevice *dev,
+				   struct usb_device *udev, unsigned long pipe,
+				   unsigned int stream_id, void *buffer,
+				   int length)
+{
+	debug("%s: dev='%s', udev=%p, stream=%u\n", __func__, dev->name, udev,
+	      stream_id);
+	if (usb_pipetype(pipe) != PIPE_BULK) {
+		printf("non-bulk pipe (type=%lu)", usb_pipetype(pipe));
+		return -EINVAL;
+	}
+
+	return xhci_bulk_tx(udev, pipe, stream_id, length, buffer);
+}
+
+#ifdef CONFIG_USB_XHCI_BULK_BATCH
+static int xhci_submit_bulk_batch(struct udevice *dev, struct usb_device *udev,
+				  struct usb_bulk_req *reqs, int count)
+{
+	int i;
+
+	debug("%s: dev='%s', udev=%p, count=%d\n", __func__, dev->name, udev,
+	      count);
+	for (i = 0; i < count; i++) {
+		if (usb_pipetype(reqs[i].pipe) != PIPE_BULK) {
+			printf("non-bulk pipe (type=%lu)",
+			       usb_pipetype(reqs[i].pipe));
+			return -EINVAL;
+		}
+	}
+
+	return xhci_bulk_tx_batch(udev, reqs, count);
+}
+#endif
+
 static int xhci_submit_int_msg(struct udevice *dev, struct usb_device *udev,
 			       unsigned long pipe, void *buffer, int length,
 			       int interval)
@@ -1464,8 +1500,132 @@ static int xhci_update_hub_device(struct udevice *dev, struct usb_device *udev)
 	return xhci_configure_endpoints(udev, false);
 }
 
+/**
+ * Find the SuperSpeed endpoint companion descriptor of the endpoint that a
+ * pipe refers to, in the alternate setting selected for its interface
+ *
+ * @param udev	pointer to the USB device
+ * @param pipe	pipe of the endpoint
+ * @return pointer to the companion descriptor, NULL if there is none
+ */
+static struct usb_ss_ep_comp_descriptor *
+xhci_find_ss_ep_comp(struct usb_device *udev, unsigned long pipe)
+{
+	struct usb_endpoint_descriptor *desc;
+	struct usb_interface *ifdesc;
+	int i, j;
+
+	for (i = 0; i < udev->config.no_of_if; i++) {
+		ifdesc = &udev->config.if_desc[i];
+		for (j = 0; j < ifdesc->no_of_ep; j++) {
+			desc = &ifdesc->ep_desc[j];
+			/* Alternate settings may share endpoint numbers */
+			if (ifdesc->ep_altsetting[j] != ifdesc->act_altsetting)
+				continue;
+			if (usb_endpoint_num(desc) != usb_pipeendpoint(pipe) ||
+			    !usb_endpoint_dir_in(desc) != !usb_pipein(pipe))
+				continue;
+			if (ifdesc->ss_ep_comp_desc[j].bDescriptorType !=
+			    USB_DT_SS_ENDPOINT_COMP)
+				return NULL;
+			return &ifdesc->ss_ep_comp_desc[j];
+		}
+	}
+
+	return NULL;
+}
+
+static int xhci_alloc_streams(struct udevice *dev, struct usb_device *udev,
+			      unsigned long *pipes, int num_pipes,
+			      int num_streams)
+{
+	struct xhci_ctrl *ctrl = dev_get_priv(dev);
+	struct xhci_virt_device *virt_dev = ctrl->devs[udev->slot_id];
+	struct xhci_container_ctx *in_ctx = virt_dev->in_ctx;
+	struct xhci_container_ctx *out_ctx = virt_dev->out_ctx;
+	struct xhci_input_control_ctx *ctrl_ctx;
+	struct usb_ss_ep_comp_descriptor *comp;
+	struct xhci_virt_ep *ep;
+	struct xhci_ep_ctx *ep_ctx;
+	unsigned int size;
+	u32 hcc_params;
+	int ep_index;
+	int i, ret;
+
+	debug("%s: dev='%s', udev=%p, streams=%d\n", __func__, dev->name, udev,
+	      num_streams);
+	hcc_params = xhci_readl(&ctrl->hccr->cr_hccparams);
+	if (!((hcc_params >> 12) & 0xf) || udev->speed < USB_SPEED_SUPER)
+		return -EOPNOTSUPP;
+	if (num_streams < 1 || num_pipes < 1)
+		return -EINVAL;
+
+	/* Stream ID 0 is reserved, the array size must be a power of two */
+	size = min_t(unsigned int, roundup_pow_of_two(num_streams + 1),
+		     HCC_MAX_PSA(hcc_params));
+	for (i = 0; i < num_pipes; i++) {
+		comp = xhci_find_ss_ep_comp(udev, pipes[i]);
+		if (!comp || !(comp->bmAttributes & 0x1f))
+			return -EOPNOTSUPP;
+		size = min(size, 1U << (comp->bmAttributes & 0x1f));
+	}
+
+	xhci_inval_cache((uintptr_t)out_ctx->bytes, out_ctx->size);
+
+	ctrl_ctx = xhci_get_input_control_ctx(in_ctx);
+	ctrl_ctx->add_flags = cpu_to_le32(SLOT_FLAG);
+	ctrl_ctx->drop_flags = 0;
+	xhci_slot_copy(ctrl, in_ctx, out_ctx);
+
+	for (i = 0; i < num_pipes; i++) {
+		ep_index = usb_pipe_ep_index(pipes[i]);
+		ep = &virt_dev->eps[ep_index];
+		ret = xhci_alloc_stream_info(ep, size);
+		if (ret)
+			goto err;
+
+		/*
+		 * Drop and re-add the endpoint so that the xHC picks up the
+		 * stream context array in place of the endpoint's ring
+		 */
+		xhci_endpoint_copy(ctrl, in_ctx, out_ctx, ep_index);
+		ep_ctx = xhci_get_ep_ctx(ctrl, in_ctx, ep_index);
+		ep_ctx->ep_info &= cpu_to_le32(~(EP_MAXPSTREAMS_MASK |
+						 EP_STATE_MASK));
+		ep_ctx->ep_info |= cpu_to_le32(EP_MAXPSTREAMS(ilog2(size) - 1) |
+					       EP_HAS_LSA);
+		ep_ctx->deq = cpu_to_le64((uintptr_t)ep->stream_ctx);
+		ctrl_ctx->add_flags |= cpu_to_le32(1 << (ep_index + 1));
+		ctrl_ctx->drop_flags |= cpu_to_le32(1 << (ep_index + 1));
+	}
+
+	ret = xhci_configure_endpoints(udev, false);
+	if (ret)
+		goto err;
+
+	for (i = 0; i < num_pipes; i++)
+		virt_dev->eps[usb_pipe_ep_index(pipes[i])].ep_state |=
+			EP_HAS_STREAMS;
+
+	return size - 1;
+err:
+	for (i = 0; i < num_pipes; i++)
+		xhci_free_stream_info(&virt_dev->eps[usb_pipe_ep_index(pipes[i])]);
+
+	return ret;
+}
+
 static int xhci_get_max_xfer_size(struct udevice *dev, size_t *size)
 {
+#ifdef CONFIG_USB_XHCI_BULK_BATCH
+	/*
+	 * Each TRB can transfer up to 64K bytes and the transfer ring of an
+	 * endpoint grows by another segment of 64 TRBs whenever a TD needs
+	 * more, so any transfer length works as long as there is enough free
+	 * heap space left for the ring.
+	 */
+	*size = INT_MAX;
+#else
 	/*
 	 * xHCD allocates one segment which includes 64 TRBs for each endpoint
 	 * and the last TRB in this segment is configured as a link TRB to form
@@ -1474,6 +1634,7 @@ static int xhci_get_max_xfer_size(struct udevice *dev, size_t *size)
 	 * Hence the maximum number of TRBs we can use in one transfer is 62.
 	 */
 	*size = (TRBS_PER_SEGMENT - 2) * TRB_MAX_BUFF_SIZE;
+#endif
 
 	return 0;
 }
@@ -1532,6 +1693,11 @@ struct dm_usb_ops xhci_usb_ops = {
 	.alloc_device = xhci_alloc_device,
 	.update_hub_device = xhci_update_hub_device,
 	.get_max_xfer_size  = xhci_get_max_xfer_size,
+	.alloc_streams = xhci_alloc_streams,
+	.bulk_stream = xhci_submit_bulk_stream,
+#ifdef CONFIG_USB_XHCI_BULK_BATCH
+	.bulk_batch = xhci_submit_bulk_batch,
+#endif
 };
 
 #endif
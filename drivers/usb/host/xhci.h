@@ -670,6 +670,23 @@ struct xhci_ep_ctx {
 /* deq bitmasks */
 #define EP_CTX_CYCLE_MASK		(1 << 0)
 
+/**
+ * struct xhci_stream_ctx
+ * Stream context; see section 6.2.4.1.
+ *
+ * @stream_ring:	dequeue pointer of the stream's transfer ring, with the
+ *			stream context type and dequeue cycle state
+ */
+struct xhci_stream_ctx {
+	__le64	stream_ring;
+	__le32	reserved[2];
+};
+
+/* Stream Context Types (section 6.4.1) - bits 3:1 of stream ctx deq ptr */
+#define SCT_FOR_CTX(p)		(((p) << 1) & 0xe)
+/* Primary stream array type, dequeue pointer is to a transfer ring */
+#define SCT_PRI_TR		1
+
 
 /**
  * struct xhci_input_control_context
@@ -1067,6 +1084,10 @@ struct xhci_virt_ep {
 #define EP_HAS_STREAMS		(1 << 4)
 /* Transitioning the endpoint to not using streams, don't enqueue URBs */
 #define EP_GETTING_NO_STREAMS	(1 << 5)
+	/* Linear primary stream array, only valid with EP_HAS_STREAMS */
+	struct xhci_stream_ctx		*stream_ctx;
+	struct xhci_ring		**stream_rings;
+	unsigned int			num_streams;
 };
 
 #define CTX_SIZE(_hcc) (HCC_64BYTE_CONTEXT(_hcc) ? 64 : 32)
@@ -1254,7 +1275,9 @@ void xhci_queue_command(struct xhci_ctrl *ctrl, u8 *ptr,
 void xhci_acknowledge_event(struct xhci_ctrl *ctrl);
 union xhci_trb *xhci_wait_for_event(struct xhci_ctrl *ctrl, trb_type expected);
 int xhci_bulk_tx(struct usb_device *udev, unsigned long pipe,
-		 int length, void *buffer);
+		 unsigned int stream_id, int length, void *buffer);
+int xhci_bulk_tx_batch(struct usb_device *udev, struct usb_bulk_req *reqs,
+		       int count);
 int xhci_ctrl_tx(struct usb_device *udev, unsigned long pipe,
 		 struct devrequest *req, int length, void *buffer);
 int xhci_check_maxpacket(struct usb_device *udev);
@@ -1262,6 +1285,9 @@ void xhci_flush_cache(uintptr_t addr, u32 type_len);
 void xhci_inval_cache(uintptr_t addr, u32 type_len);
 void xhci_cleanup(struct xhci_ctrl *ctrl);
 struct xhci_ring *xhci_ring_alloc(unsigned int num_segs, bool link_trbs);
+void xhci_ring_expand(struct xhci_ring *ring, unsigned int num_trbs);
+int xhci_alloc_stream_info(struct xhci_virt_ep *ep, unsigned int num_streams);
+void xhci_free_stream_info(struct xhci_virt_ep *ep);
 int xhci_alloc_virt_device(struct xhci_ctrl *ctrl, unsigned int slot_id);
 int xhci_mem_init(struct xhci_ctrl *ctrl, struct xhci_hccr *hccr,
 		  struct xhci_hcor *hcor);
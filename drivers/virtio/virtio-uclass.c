@@ -19,6 +19,7 @@
 #include <dm.h>
 #include <virtio_types.h>
 #include <virtio.h>
+#include <virtio_ring.h>
 #include <dm/lists.h>
 
 static const char *const virtio_drv_name[VIRTIO_ID_MAX_NUM] = {
@@ -330,10 +331,25 @@ static int virtio_uclass_child_pre_probe(struct udevice *vdev)
 	}
 
 	/* Transport features always preserved to pass to finalize_features */
-	for (i = VIRTIO_TRANSPORT_F_START; i < VIRTIO_TRANSPORT_F_END; i++)
-		if ((device_features & (1ULL << i)) &&
-		    (i == VIRTIO_F_VERSION_1))
+	for (i = VIRTIO_TRANSPORT_F_START; i < VIRTIO_TRANSPORT_F_END; i++) {
+		if (!(device_features & (1ULL << i)))
+			continue;
+
+		switch (i) {
+		case VIRTIO_RING_F_INDIRECT_DESC:
+		case VIRTIO_RING_F_EVENT_IDX:
+		case VIRTIO_F_VERSION_1:
 			__virtio_set_bit(vdev->parent, i);
+			break;
+		case VIRTIO_F_RING_PACKED:
+			/* The packed ring layout requires a v1.0 device */
+			if (!uc_priv->legacy)
+				__virtio_set_bit(vdev->parent, i);
+			break;
+		default:
+			break;
+		}
+	}
 
 	debug("(%s) final negotiated features supported %016llx\n",
 	      vdev->name, uc_priv->features);
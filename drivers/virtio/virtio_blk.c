@@ -12,46 +12,197 @@
 #include <virtio_ring.h>
 #include "virtio_blk.h"
 
+/*
+ * Maximum number of requests kept in flight, and maximum number of data
+ * segments in a single request.
+ */
+#define VIRTIO_BLK_NUM_REQS	16
+#define VIRTIO_BLK_MAX_SEGS	32
+
+/*
+ * Per-request state. The header and status byte are read/written by the
+ * device, so every request in flight needs its own copy.
+ */
+struct virtio_blk_req {
+	struct virtio_blk_outhdr out_hdr;
+	struct virtio_blk_discard_write_zeroes range;
+	lbaint_t blkcnt;
+	bool busy;
+	u8 status;
+};
+
 struct virtio_blk_priv {
 	struct virtqueue *vq;
+	struct virtio_blk_req reqs[VIRTIO_BLK_NUM_REQS];
+	u32 seg_max;
+	u32 size_max;
+	u32 max_discard_sectors;
+	u32 max_write_zeroes_sectors;
 };
 
-static ulong virtio_blk_do_req(struct udevice *dev, u64 sector,
-			       lbaint_t blkcnt, void *buffer, u32 type)
+static const u32 feature[] = {
+	VIRTIO_BLK_F_SIZE_MAX,
+	VIRTIO_BLK_F_SEG_MAX,
+	VIRTIO_BLK_F_DISCARD,
+	VIRTIO_BLK_F_WRITE_ZEROES
+};
+
+static const u32 feature_legacy[] = {
+	VIRTIO_BLK_F_SIZE_MAX,
+	VIRTIO_BLK_F_SEG_MAX,
+	VIRTIO_BLK_F_DISCARD,
+	VIRTIO_BLK_F_WRITE_ZEROES
+};
+
+static struct virtio_blk_req *virtio_blk_get_req(struct virtio_blk_priv *priv)
+{
+	int i;
+
+	for (i = 0; i < VIRTIO_BLK_NUM_REQS; i++) {
+		if (!priv->reqs[i].busy)
+			return &priv->reqs[i];
+	}
+
+	return NULL;
+}
+
+static lbaint_t virtio_blk_max_blocks(struct virtio_blk_priv *priv, u32 type)
+{
+	switch (type) {
+	case VIRTIO_BLK_T_DISCARD:
+		return priv->max_discard_sectors;
+	case VIRTIO_BLK_T_WRITE_ZEROES:
+		return priv->max_write_zeroes_sectors;
+	default:
+		return (u64)priv->seg_max * (priv->size_max / 512);
+	}
+}
+
+/*
+ * Add one request to the virtqueue without waiting for it. Read and write
+ * data is split into segments of at most size_max bytes, while discard and
+ * write zeroes requests carry a single range descriptor instead.
+ */
+static int virtio_blk_queue_req(struct udevice *dev,
+				struct virtio_blk_req *req, u32 type,
+				u64 sector, lbaint_t blkcnt, void *buffer)
 {
 	struct virtio_blk_priv *priv = dev_get_priv(dev);
-	unsigned int num_out = 0, num_in = 0;
-	struct virtio_sg *sgs[3];
-	u8 status;
+	struct virtio_sg sg[VIRTIO_BLK_MAX_SEGS + 2];
+	struct virtio_sg *sgs[VIRTIO_BLK_MAX_SEGS + 2];
+	unsigned int num_out = 0, num_in = 0, i, n = 0;
+	size_t len = blkcnt * 512;
 	int ret;
 
-	struct virtio_blk_outhdr out_hdr = {
-		.type = cpu_to_virtio32(dev, type),
-		.sector = cpu_to_virtio64(dev, sector),
-	};
-	struct virtio_sg hdr_sg = { &out_hdr, sizeof(out_hdr) };
-	struct virtio_sg data_sg = { buffer, blkcnt * 512 };
-	struct virtio_sg status_sg = { &status, sizeof(status) };
+	req->out_hdr.type = cpu_to_virtio32(dev, type);
+	req->out_hdr.ioprio = 0;
+	req->out_hdr.sector = cpu_to_virtio64(dev, sector);
+	sg[n].addr = &req->out_hdr;
+	sg[n++].length = sizeof(req->out_hdr);
+	num_out++;
 
-	sgs[num_out++] = &hdr_sg;
+	if (type == VIRTIO_BLK_T_DISCARD || type == VIRTIO_BLK_T_WRITE_ZEROES) {
+		req->out_hdr.sector = 0;
+		req->range.sector = cpu_to_le64(sector);
+		req->range.num_sectors = cpu_to_le32(blkcnt);
+		req->range.flags = 0;
+		sg[n].addr = &req->range;
+		sg[n++].length = sizeof(req->range);
+		num_out++;
+	} else {
+		while (len) {
+			sg[n].addr = buffer;
+			sg[n].length = min_t(size_t, len, priv->size_max);
+			buffer += sg[n].length;
+			len -= sg[n++].length;
+			if (type & VIRTIO_BLK_T_OUT)
+				num_out++;
+			else
+				num_in++;
+		}
+	}
 
-	if (type & VIRTIO_BLK_T_OUT)
-		sgs[num_out++] = &data_sg;
-	else
-		sgs[num_out + num_in++] = &data_sg;
+	sg[n].addr = &req->status;
+	sg[n++].length = sizeof(req->status);
+	num_in++;
 
-	sgs[num_out + num_in++] = &status_sg;
+	for (i = 0; i < n; i++)
+		sgs[i] = &sg[i];
 
 	ret = virtqueue_add(priv->vq, sgs, num_out, num_in);
 	if (ret)
 		return ret;
 
-	virtqueue_kick(priv->vq);
+	req->blkcnt = blkcnt;
+	req->busy = true;
 
-	while (!virtqueue_get_buf(priv->vq, NULL))
-		;
+	return 0;
+}
 
-	return status == VIRTIO_BLK_S_OK ? blkcnt : -EIO;
+/*
+ * Split the transfer into requests the device accepts and keep up to
+ * VIRTIO_BLK_NUM_REQS of them queued, so that the device always has the
+ * next request available while the current one completes.
+ */
+static ulong virtio_blk_do_req(struct udevice *dev, u64 sector,
+			       lbaint_t blkcnt, void *buffer, u32 type)
+{
+	struct virtio_blk_priv *priv = dev_get_priv(dev);
+	lbaint_t max = virtio_blk_max_blocks(priv, type);
+	lbaint_t queued = 0;
+	unsigned int inflight = 0;
+	struct virtio_blk_outhdr *hdr;
+	struct virtio_blk_req *req;
+	bool failed = false;
+	int ret = 0;
+
+	do {
+		bool added = false;
+
+		while (!failed && queued < blkcnt) {
+			lbaint_t n = min(blkcnt - queued, max);
+
+			req = virtio_blk_get_req(priv);
+			if (!req)
+				break;
+
+			ret = virtio_blk_queue_req(dev, req, type,
+						   sector + queued, n, buffer);
+			if (ret)
+				break;
+
+			queued += n;
+			inflight++;
+			added = true;
+			if (buffer)
+				buffer += n * 512;
+		}
+
+		if (added)
+			virtqueue_kick(priv->vq);
+
+		if (!inflight)
+			break;
+
+		while (!(hdr = virtqueue_get_buf(priv->vq, NULL)))
+			;
+
+		req = container_of(hdr, struct virtio_blk_req, out_hdr);
+		req->busy = false;
+		inflight--;
+		if (req->status != VIRTIO_BLK_S_OK) {
+			debug("(%s): request type %u failed with status %u\n",
+			      dev->name, type, req->status);
+			failed = true;
+		}
+	} while (inflight || (!failed && queued < blkcnt));
+
+	if (failed)
+		return -EIO;
+	if (queued < blkcnt)
+		return ret ? ret : -EIO;
+
+	return blkcnt;
 }
 
 static ulong virtio_blk_read(struct udevice *dev, lbaint_t start,
@@ -68,6 +219,41 @@ static ulong virtio_blk_write(struct udevice *dev, lbaint_t start,
 				 VIRTIO_BLK_T_OUT);
 }
 
+static ulong virtio_blk_erase(struct udevice *dev, lbaint_t start,
+			      lbaint_t blkcnt)
+{
+	u32 type;
+
+	if (virtio_has_feature(dev, VIRTIO_BLK_F_DISCARD))
+		type = VIRTIO_BLK_T_DISCARD;
+	else if (virtio_has_feature(dev, VIRTIO_BLK_F_WRITE_ZEROES))
+		type = VIRTIO_BLK_T_WRITE_ZEROES;
+	else
+		return -ENOSYS;
+
+	return virtio_blk_do_req(dev, start, blkcnt, NULL, type);
+}
+
+static ulong virtio_blk_discard(struct udevice *dev, lbaint_t start,
+				lbaint_t blkcnt)
+{
+	if (!virtio_has_feature(dev, VIRTIO_BLK_F_DISCARD))
+		return -ENOSYS;
+
+	return virtio_blk_do_req(dev, start, blkcnt, NULL,
+				 VIRTIO_BLK_T_DISCARD);
+}
+
+static ulong virtio_blk_write_zeroes(struct udevice *dev, lbaint_t start,
+				     lbaint_t blkcnt)
+{
+	if (!virtio_has_feature(dev, VIRTIO_BLK_F_WRITE_ZEROES))
+		return -ENOSYS;
+
+	return virtio_blk_do_req(dev, start, blkcnt, NULL,
+				 VIRTIO_BLK_T_WRITE_ZEROES);
+}
+
 static int virtio_blk_bind(struct udevice *dev)
 {
 	struct virtio_dev_priv *uc_priv = dev_get_uclass_priv(dev->parent);
@@ -97,7 +283,8 @@ static int virtio_blk_bind(struct udevice *dev)
 	desc->bdev = dev;
 
 	/* Indicate what driver features we support */
-	virtio_driver_features_init(uc_priv, NULL, 0, NULL, 0);
+	virtio_driver_features_init(uc_priv, feature, ARRAY_SIZE(feature),
+				    feature_legacy, ARRAY_SIZE(feature_legacy));
 
 	return 0;
 }
@@ -117,12 +304,48 @@ static int virtio_blk_probe(struct udevice *dev)
 	virtio_cread(dev, struct virtio_blk_config, capacity, &cap);
 	desc->lba = cap;
 
+	/*
+	 * Work out how large a single request can be. Each data segment
+	 * takes a descriptor, and without indirect descriptors the header
+	 * and status need two more from the same ring.
+	 */
+	if (virtio_cread_feature(dev, VIRTIO_BLK_F_SEG_MAX,
+				 struct virtio_blk_config, seg_max,
+				 &priv->seg_max) || !priv->seg_max)
+		priv->seg_max = 1;
+	priv->seg_max = min_t(u32, priv->seg_max, VIRTIO_BLK_MAX_SEGS);
+	if (!priv->vq->indirect)
+		priv->seg_max = min(priv->seg_max,
+				    virtqueue_get_vring_size(priv->vq) - 2);
+
+	if (virtio_cread_feature(dev, VIRTIO_BLK_F_SIZE_MAX,
+				 struct virtio_blk_config, size_max,
+				 &priv->size_max))
+		priv->size_max = U32_MAX;
+	priv->size_max = max_t(u32, round_down(priv->size_max, 512), 512);
+
+	if (virtio_cread_feature(dev, VIRTIO_BLK_F_DISCARD,
+				 struct virtio_blk_config, max_discard_sectors,
+				 &priv->max_discard_sectors) ||
+	    !priv->max_discard_sectors)
+		priv->max_discard_sectors = U32_MAX;
+
+	if (virtio_cread_feature(dev, VIRTIO_BLK_F_WRITE_ZEROES,
+				 struct virtio_blk_config,
+				 max_write_zeroes_sectors,
+				 &priv->max_write_zeroes_sectors) ||
+	    !priv->max_write_zeroes_sectors)
+		priv->max_write_zeroes_sectors = U32_MAX;
+
 	return 0;
 }
 
 static const struct blk_ops virtio_blk_ops = {
 	.read	= virtio_blk_read,
 	.write	= virtio_blk_write,
+	.erase	= virtio_blk_erase,
+	.discard	= virtio_blk_discard,
+	.write_zeroes	= virtio_blk_write_zeroes,
 };
 
 U_BOOT_DRIVER(virtio_blk) = {
@@ -13,21 +13,58 @@
 #include <virtio.h>
 #include <virtio_ring.h>
 
-int virtqueue_add(struct virtqueue *vq, struct virtio_sg *sgs[],
-		  unsigned int out_sgs, unsigned int in_sgs)
+/*
+ * Split ring
+ */
+
+static struct vring_desc *alloc_indirect_split(struct virtqueue *vq,
+					       unsigned int total_sg)
+{
+	struct vring_desc *desc;
+	unsigned int i;
+
+	desc = memalign(VRING_DESC_ALIGN_SIZE, total_sg * sizeof(*desc));
+	if (!desc)
+		return NULL;
+
+	/* Chain the whole table so that it can be walked like the ring */
+	for (i = 0; i < total_sg; i++)
+		desc[i].next = cpu_to_virtio16(vq->vdev, i + 1);
+
+	return desc;
+}
+
+static int virtqueue_add_split(struct virtqueue *vq, struct virtio_sg *sgs[],
+			       unsigned int out_sgs, unsigned int in_sgs)
 {
 	struct vring_desc *desc;
 	unsigned int total_sg = out_sgs + in_sgs;
 	unsigned int i, n, avail, descs_used, uninitialized_var(prev);
+	bool indirect;
 	int head;
 
-	WARN_ON(total_sg == 0);
-
 	head = vq->free_head;
 
-	desc = vq->vring.desc;
-	i = head;
-	descs_used = total_sg;
+	/*
+	 * If the host supports indirect descriptor tables, and we have
+	 * multiple buffers, then go indirect so that the whole request
+	 * only takes one slot in the ring.
+	 */
+	if (vq->indirect && total_sg > 1 && vq->num_free)
+		desc = alloc_indirect_split(vq, total_sg);
+	else
+		desc = NULL;
+
+	if (desc) {
+		indirect = true;
+		i = 0;
+		descs_used = 1;
+	} else {
+		indirect = false;
+		desc = vq->vring.desc;
+		i = head;
+		descs_used = total_sg;
+	}
 
 	if (vq->num_free < descs_used) {
 		debug("Can't add buf len %i - avail = %i\n",
@@ -39,6 +76,8 @@ int virtqueue_add(struct virtqueue *vq, struct virtio_sg *sgs[],
 		 */
 		if (out_sgs)
 			virtio_notify(vq->vdev, vq);
+		if (indirect)
+			free(desc);
 		return -ENOSPC;
 	}
 
@@ -67,11 +106,29 @@ int virtqueue_add(struct virtqueue *vq, struct virtio_sg *sgs[],
 	/* Last one doesn't continue */
 	desc[prev].flags &= cpu_to_virtio16(vq->vdev, ~VRING_DESC_F_NEXT);
 
+	if (indirect) {
+		/* Now that the indirect table is filled in, map it */
+		vq->vring.desc[head].flags = cpu_to_virtio16(vq->vdev,
+							     VRING_DESC_F_INDIRECT);
+		vq->vring.desc[head].addr = cpu_to_virtio64(vq->vdev,
+							    (u64)(uintptr_t)desc);
+		vq->vring.desc[head].len = cpu_to_virtio32(vq->vdev,
+							   total_sg * sizeof(*desc));
+	}
+
 	/* We're using some buffers from the free list. */
 	vq->num_free -= descs_used;
 
 	/* Update free pointer */
-	vq->free_head = i;
+	if (indirect)
+		vq->free_head = virtio16_to_cpu(vq->vdev,
+						vq->vring.desc[head].next);
+	else
+		vq->free_head = i;
+
+	/* Store token and indirect buffer state. */
+	vq->desc_state[head].data = sgs[0]->addr;
+	vq->desc_state[head].indir_desc = indirect ? desc : NULL;
 
 	/*
 	 * Put entry in available array (but don't update avail->idx
@@ -99,7 +156,7 @@ int virtqueue_add(struct virtqueue *vq, struct virtio_sg *sgs[],
 	return 0;
 }
 
-static bool virtqueue_kick_prepare(struct virtqueue *vq)
+static bool virtqueue_kick_prepare_split(struct virtqueue *vq)
 {
 	u16 new, old;
 	bool needs_kick;
@@ -125,17 +182,14 @@ static bool virtqueue_kick_prepare(struct virtqueue *vq)
 	return needs_kick;
 }
 
-void virtqueue_kick(struct virtqueue *vq)
-{
-	if (virtqueue_kick_prepare(vq))
-		virtio_notify(vq->vdev, vq);
-}
-
-static void detach_buf(struct virtqueue *vq, unsigned int head)
+static void detach_buf_split(struct virtqueue *vq, unsigned int head)
 {
 	unsigned int i;
 	__virtio16 nextflag = cpu_to_virtio16(vq->vdev, VRING_DESC_F_NEXT);
 
+	/* Clear data ptr */
+	vq->desc_state[head].data = NULL;
+
 	/* Put back on free list: unmap first-level descriptors and find end */
 	i = head;
 
@@ -149,20 +203,25 @@ static void detach_buf(struct virtqueue *vq, unsigned int head)
 
 	/* Plus final descriptor */
 	vq->num_free++;
+
+	/* Free the indirect table, if any */
+	free(vq->desc_state[head].indir_desc);
+	vq->desc_state[head].indir_desc = NULL;
 }
 
-static inline bool more_used(const struct virtqueue *vq)
+static inline bool more_used_split(const struct virtqueue *vq)
 {
 	return vq->last_used_idx != virtio16_to_cpu(vq->vdev,
 			vq->vring.used->idx);
 }
 
-void *virtqueue_get_buf(struct virtqueue *vq, unsigned int *len)
+static void *virtqueue_get_buf_split(struct virtqueue *vq, unsigned int *len)
 {
 	unsigned int i;
 	u16 last_used;
+	void *ret;
 
-	if (!more_used(vq)) {
+	if (!more_used_split(vq)) {
 		debug("(%s.%d): No more buffers in queue\n",
 		      vq->vdev->name, vq->index);
 		return NULL;
@@ -185,8 +244,15 @@ void *virtqueue_get_buf(struct virtqueue *vq, unsigned int *len)
 		       vq->vdev->name, vq->index, i);
 		return NULL;
 	}
+	if (unlikely(!vq->desc_state[i].data)) {
+		printf("(%s.%d): id %u is not a head!\n",
+		       vq->vdev->name, vq->index, i);
+		return NULL;
+	}
 
-	detach_buf(vq, i);
+	/* detach_buf_split clears data, so grab it now */
+	ret = vq->desc_state[i].data;
+	detach_buf_split(vq, i);
 	vq->last_used_idx++;
 	/*
 	 * If we expect an interrupt for the next entry, tell host
@@ -197,52 +263,418 @@ void *virtqueue_get_buf(struct virtqueue *vq, unsigned int *len)
 		virtio_store_mb(&vring_used_event(&vq->vring),
 				cpu_to_virtio16(vq->vdev, vq->last_used_idx));
 
-	return (void *)(uintptr_t)virtio64_to_cpu(vq->vdev,
-						  vq->vring.desc[i].addr);
+	return ret;
+}
+
+/*
+ * Packed ring
+ *
+ * The packed ring is only available on virtio 1.0+ devices, hence it is
+ * always little-endian and does not need the virtio16/32/64 accessors.
+ */
+
+static struct vring_packed_desc *alloc_indirect_packed(unsigned int total_sg)
+{
+	return memalign(VRING_DESC_ALIGN_SIZE,
+			total_sg * sizeof(struct vring_packed_desc));
+}
+
+static int virtqueue_add_indirect_packed(struct virtqueue *vq,
+					 struct virtio_sg *sgs[],
+					 unsigned int total_sg,
+					 unsigned int out_sgs,
+					 unsigned int in_sgs)
+{
+	struct vring_packed_desc *desc;
+	u16 head, id, n;
+
+	head = vq->next_avail_idx;
+	desc = alloc_indirect_packed(total_sg);
+	if (!desc)
+		return -ENOMEM;
+
+	if (unlikely(vq->num_free < 1)) {
+		debug("Can't add buf len 1 - avail = 0\n");
+		free(desc);
+		return -ENOSPC;
+	}
+
+	for (n = 0; n < out_sgs + in_sgs; n++) {
+		struct virtio_sg *sg = sgs[n];
+
+		desc[n].flags = cpu_to_le16(n < out_sgs ?
+					    0 : VRING_DESC_F_WRITE);
+		desc[n].addr = cpu_to_le64((u64)(uintptr_t)sg->addr);
+		desc[n].len = cpu_to_le32(sg->length);
+	}
+
+	/* Now that the indirect table is filled in, map it */
+	id = vq->free_head;
+	vq->vring_packed.desc[head].addr = cpu_to_le64((u64)(uintptr_t)desc);
+	vq->vring_packed.desc[head].len = cpu_to_le32(total_sg *
+						      sizeof(*desc));
+	vq->vring_packed.desc[head].id = cpu_to_le16(id);
+
+	/*
+	 * The descriptor must be complete before the device sees the
+	 * avail/used bits flip.
+	 */
+	virtio_wmb();
+	vq->vring_packed.desc[head].flags = cpu_to_le16(VRING_DESC_F_INDIRECT |
+							vq->avail_used_flags);
+
+	/* We're using some buffers from the free list. */
+	vq->num_free -= 1;
+
+	/* Update free pointer */
+	n = head + 1;
+	if (n >= vq->vring_packed.num) {
+		n = 0;
+		vq->avail_wrap_counter ^= 1;
+		vq->avail_used_flags ^= 1 << VRING_PACKED_DESC_F_AVAIL |
+					1 << VRING_PACKED_DESC_F_USED;
+	}
+	vq->next_avail_idx = n;
+	vq->free_head = vq->desc_state[id].next;
+
+	/* Store token and indirect buffer state. */
+	vq->desc_state[id].num = 1;
+	vq->desc_state[id].data = sgs[0]->addr;
+	vq->desc_state[id].indir_desc = desc;
+	vq->desc_state[id].last = id;
+
+	vq->num_added += 1;
+
+	return 0;
+}
+
+static int virtqueue_add_packed(struct virtqueue *vq, struct virtio_sg *sgs[],
+				unsigned int out_sgs, unsigned int in_sgs)
+{
+	struct vring_packed_desc *desc;
+	unsigned int total_sg = out_sgs + in_sgs;
+	unsigned int i, n;
+	u16 head, id, uninitialized_var(prev), curr, head_flags = 0;
+
+	/*
+	 * If the host supports indirect descriptor tables, and we have
+	 * multiple buffers, then go indirect so that the whole request
+	 * only takes one slot in the ring.
+	 */
+	if (vq->indirect && total_sg > 1 && vq->num_free) {
+		if (!virtqueue_add_indirect_packed(vq, sgs, total_sg,
+						   out_sgs, in_sgs))
+			return 0;
+		/* Fall back on direct descriptors if out of memory */
+	}
+
+	if (vq->num_free < total_sg) {
+		debug("Can't add buf len %i - avail = %i\n",
+		      total_sg, vq->num_free);
+		if (out_sgs)
+			virtio_notify(vq->vdev, vq);
+		return -ENOSPC;
+	}
+
+	desc = vq->vring_packed.desc;
+	head = vq->next_avail_idx;
+	i = head;
+	id = vq->free_head;
+	curr = id;
+
+	for (n = 0; n < total_sg; n++) {
+		struct virtio_sg *sg = sgs[n];
+		u16 flags = vq->avail_used_flags;
+
+		if (n >= out_sgs)
+			flags |= VRING_DESC_F_WRITE;
+		if (n + 1 < total_sg)
+			flags |= VRING_DESC_F_NEXT;
+
+		desc[i].addr = cpu_to_le64((u64)(uintptr_t)sg->addr);
+		desc[i].len = cpu_to_le32(sg->length);
+		desc[i].id = cpu_to_le16(id);
+
+		/* The head flags are written last to publish the chain */
+		if (i == head)
+			head_flags = flags;
+		else
+			desc[i].flags = cpu_to_le16(flags);
+
+		prev = curr;
+		curr = vq->desc_state[curr].next;
+
+		if (++i >= vq->vring_packed.num) {
+			i = 0;
+			vq->avail_used_flags ^= 1 << VRING_PACKED_DESC_F_AVAIL |
+						1 << VRING_PACKED_DESC_F_USED;
+		}
+	}
+
+	if (i < head)
+		vq->avail_wrap_counter ^= 1;
+
+	/* We're using some buffers from the free list. */
+	vq->num_free -= total_sg;
+
+	/* Update free pointer */
+	vq->next_avail_idx = i;
+	vq->free_head = curr;
+
+	/* Store token. */
+	vq->desc_state[id].num = total_sg;
+	vq->desc_state[id].data = sgs[0]->addr;
+	vq->desc_state[id].indir_desc = NULL;
+	vq->desc_state[id].last = prev;
+
+	/*
+	 * A driver MUST NOT make the first descriptor in the list
+	 * available before all subsequent descriptors comprising
+	 * the list are made available.
+	 */
+	virtio_wmb();
+	desc[head].flags = cpu_to_le16(head_flags);
+	vq->num_added += total_sg;
+
+	return 0;
+}
+
+static bool virtqueue_kick_prepare_packed(struct virtqueue *vq)
+{
+	u16 new, old, off_wrap, flags, wrap_counter, event_idx;
+
+	/*
+	 * We need to expose the new flags value before checking notification
+	 * suppressions.
+	 */
+	virtio_mb();
+
+	old = vq->next_avail_idx - vq->num_added;
+	new = vq->next_avail_idx;
+	vq->num_added = 0;
+
+	off_wrap = le16_to_cpu(READ_ONCE(vq->vring_packed.device->off_wrap));
+	flags = le16_to_cpu(READ_ONCE(vq->vring_packed.device->flags));
+
+	if (flags != VRING_PACKED_EVENT_FLAG_DESC)
+		return flags != VRING_PACKED_EVENT_FLAG_DISABLE;
+
+	wrap_counter = off_wrap >> VRING_PACKED_EVENT_F_WRAP_CTR;
+	event_idx = off_wrap & ~(1 << VRING_PACKED_EVENT_F_WRAP_CTR);
+	if (wrap_counter != vq->avail_wrap_counter)
+		event_idx -= vq->vring_packed.num;
+
+	return vring_need_event(event_idx, new, old);
+}
+
+static void detach_buf_packed(struct virtqueue *vq, unsigned int id)
+{
+	struct vring_desc_state *state = &vq->desc_state[id];
+
+	/* Clear data ptr */
+	state->data = NULL;
+
+	/* Put the buffer ids back on the free list */
+	vq->desc_state[state->last].next = vq->free_head;
+	vq->free_head = id;
+	vq->num_free += state->num;
+
+	/* Free the indirect table, if any */
+	free(state->indir_desc);
+	state->indir_desc = NULL;
+}
+
+static inline bool is_used_desc_packed(const struct virtqueue *vq,
+				       u16 idx, bool used_wrap_counter)
+{
+	bool avail, used;
+	u16 flags;
+
+	flags = le16_to_cpu(vq->vring_packed.desc[idx].flags);
+	avail = !!(flags & (1 << VRING_PACKED_DESC_F_AVAIL));
+	used = !!(flags & (1 << VRING_PACKED_DESC_F_USED));
+
+	return avail == used && used == used_wrap_counter;
+}
+
+static inline bool more_used_packed(const struct virtqueue *vq)
+{
+	return is_used_desc_packed(vq, vq->last_used_idx,
+				   vq->used_wrap_counter);
+}
+
+static void *virtqueue_get_buf_packed(struct virtqueue *vq, unsigned int *len)
+{
+	u16 last_used, id;
+	void *ret;
+
+	if (!more_used_packed(vq)) {
+		debug("(%s.%d): No more buffers in queue\n",
+		      vq->vdev->name, vq->index);
+		return NULL;
+	}
+
+	/* Only get used elements after they have been exposed by host */
+	virtio_rmb();
+
+	last_used = vq->last_used_idx;
+	id = le16_to_cpu(vq->vring_packed.desc[last_used].id);
+	if (len) {
+		*len = le32_to_cpu(vq->vring_packed.desc[last_used].len);
+		debug("(%s.%d): last used idx %u with len %u\n",
+		      vq->vdev->name, vq->index, id, *len);
+	}
+
+	if (unlikely(id >= vq->vring_packed.num)) {
+		printf("(%s.%d): id %u out of range\n",
+		       vq->vdev->name, vq->index, id);
+		return NULL;
+	}
+	if (unlikely(!vq->desc_state[id].data)) {
+		printf("(%s.%d): id %u is not a head!\n",
+		       vq->vdev->name, vq->index, id);
+		return NULL;
+	}
+
+	/* detach_buf_packed clears data, so grab it now */
+	ret = vq->desc_state[id].data;
+
+	vq->last_used_idx += vq->desc_state[id].num;
+	if (vq->last_used_idx >= vq->vring_packed.num) {
+		vq->last_used_idx -= vq->vring_packed.num;
+		vq->used_wrap_counter ^= 1;
+	}
+
+	detach_buf_packed(vq, id);
+
+	return ret;
+}
+
+/*
+ * Generic functions
+ */
+
+int virtqueue_add(struct virtqueue *vq, struct virtio_sg *sgs[],
+		  unsigned int out_sgs, unsigned int in_sgs)
+{
+	WARN_ON(out_sgs + in_sgs == 0);
+
+	return vq->packed ? virtqueue_add_packed(vq, sgs, out_sgs, in_sgs) :
+			    virtqueue_add_split(vq, sgs, out_sgs, in_sgs);
+}
+
+void virtqueue_kick(struct virtqueue *vq)
+{
+	bool needs_kick;
+
+	if (vq->packed)
+		needs_kick = virtqueue_kick_prepare_packed(vq);
+	else
+		needs_kick = virtqueue_kick_prepare_split(vq);
+
+	if (needs_kick)
+		virtio_notify(vq->vdev, vq);
+}
+
+void *virtqueue_get_buf(struct virtqueue *vq, unsigned int *len)
+{
+	return vq->packed ? virtqueue_get_buf_packed(vq, len) :
+			    virtqueue_get_buf_split(vq, len);
 }
 
 static struct virtqueue *__vring_new_virtqueue(unsigned int index,
-					       struct vring vring,
+					       unsigned int num,
 					       struct udevice *udev)
 {
-	unsigned int i;
 	struct virtqueue *vq;
 	struct virtio_dev_priv *uc_priv = dev_get_uclass_priv(udev);
 	struct udevice *vdev = uc_priv->vdev;
 
-	vq = malloc(sizeof(*vq));
+	vq = calloc(1, sizeof(*vq));
 	if (!vq)
 		return NULL;
 
+	vq->desc_state = calloc(num, sizeof(struct vring_desc_state));
+	if (!vq->desc_state) {
+		free(vq);
+		return NULL;
+	}
+
 	vq->vdev = vdev;
 	vq->index = index;
-	vq->num_free = vring.num;
-	vq->vring = vring;
+	vq->num_free = num;
 	vq->last_used_idx = 0;
-	vq->avail_flags_shadow = 0;
-	vq->avail_idx_shadow = 0;
 	vq->num_added = 0;
+	vq->free_head = 0;
 	list_add_tail(&vq->list, &uc_priv->vqs);
 
+	vq->indirect = virtio_has_feature(vdev, VIRTIO_RING_F_INDIRECT_DESC);
 	vq->event = virtio_has_feature(vdev, VIRTIO_RING_F_EVENT_IDX);
 
+	return vq;
+}
+
+static struct virtqueue *vring_new_virtqueue_split(unsigned int index,
+						   struct vring vring,
+						   struct udevice *udev)
+{
+	unsigned int i;
+	struct virtqueue *vq;
+
+	vq = __vring_new_virtqueue(index, vring.num, udev);
+	if (!vq)
+		return NULL;
+
+	vq->vring = vring;
+	vq->avail_flags_shadow = 0;
+	vq->avail_idx_shadow = 0;
+
 	/* Tell other side not to bother us */
 	vq->avail_flags_shadow |= VRING_AVAIL_F_NO_INTERRUPT;
 	if (!vq->event)
-		vq->vring.avail->flags = cpu_to_virtio16(vdev,
+		vq->vring.avail->flags = cpu_to_virtio16(vq->vdev,
 				vq->avail_flags_shadow);
 
 	/* Put everything in free lists */
-	vq->free_head = 0;
 	for (i = 0; i < vring.num - 1; i++)
-		vq->vring.desc[i].next = cpu_to_virtio16(vdev, i + 1);
+		vq->vring.desc[i].next = cpu_to_virtio16(vq->vdev, i + 1);
 
 	return vq;
 }
 
-struct virtqueue *vring_create_virtqueue(unsigned int index, unsigned int num,
-					 unsigned int vring_align,
-					 struct udevice *udev)
+static struct virtqueue *vring_new_virtqueue_packed(unsigned int index,
+						    struct vring_packed vring,
+						    struct udevice *udev)
+{
+	unsigned int i;
+	struct virtqueue *vq;
+
+	vq = __vring_new_virtqueue(index, vring.num, udev);
+	if (!vq)
+		return NULL;
+
+	vq->vring_packed = vring;
+	vq->packed = true;
+	vq->next_avail_idx = 0;
+	vq->avail_wrap_counter = 1;
+	vq->used_wrap_counter = 1;
+	vq->avail_used_flags = 1 << VRING_PACKED_DESC_F_AVAIL;
+
+	/* Tell other side not to bother us */
+	vq->vring_packed.driver->flags =
+		cpu_to_le16(VRING_PACKED_EVENT_FLAG_DISABLE);
+
+	/* Put everything in free lists */
+	for (i = 0; i < vring.num - 1; i++)
+		vq->desc_state[i].next = i + 1;
+
+	return vq;
+}
+
+static struct virtqueue *vring_create_virtqueue_split(unsigned int index,
+						      unsigned int num,
+						      unsigned int vring_align,
+						      struct udevice *udev)
 {
 	struct virtqueue *vq;
 	void *queue = NULL;
@@ -274,7 +706,7 @@ struct virtqueue *vring_create_virtqueue(unsigned int index, unsigned int num,
 	memset(queue, 0, vring_size(num, vring_align));
 	vring_init(&vring, num, queue, vring_align);
 
-	vq = __vring_new_virtqueue(index, vring, udev);
+	vq = vring_new_virtqueue_split(index, vring, udev);
 	if (!vq) {
 		free(queue);
 		return NULL;
@@ -285,31 +717,96 @@ struct virtqueue *vring_create_virtqueue(unsigned int index, unsigned int num,
 	return vq;
 }
 
+static struct virtqueue *vring_create_virtqueue_packed(unsigned int index,
+						       unsigned int num,
+						       struct udevice *udev)
+{
+	struct virtqueue *vq;
+	void *queue = NULL;
+	struct vring_packed vring;
+
+	/* Try smaller rings if we cannot get a big enough chunk */
+	for (; num && vring_packed_size(num) > PAGE_SIZE; num /= 2) {
+		queue = memalign(PAGE_SIZE, vring_packed_size(num));
+		if (queue)
+			break;
+	}
+
+	if (!num)
+		return NULL;
+
+	if (!queue)
+		queue = memalign(PAGE_SIZE, vring_packed_size(num));
+	if (!queue)
+		return NULL;
+
+	memset(queue, 0, vring_packed_size(num));
+	vring_packed_init(&vring, num, queue);
+
+	vq = vring_new_virtqueue_packed(index, vring, udev);
+	if (!vq) {
+		free(queue);
+		return NULL;
+	}
+	debug("(%s): created packed vring @ %p for vq @ %p with num %u\n",
+	      udev->name, queue, vq, num);
+
+	return vq;
+}
+
+struct virtqueue *vring_create_virtqueue(unsigned int index, unsigned int num,
+					 unsigned int vring_align,
+					 struct udevice *udev)
+{
+	if (__virtio_test_bit(udev, VIRTIO_F_RING_PACKED))
+		return vring_create_virtqueue_packed(index, num, udev);
+
+	return vring_create_virtqueue_split(index, num, vring_align, udev);
+}
+
 void vring_del_virtqueue(struct virtqueue *vq)
 {
-	free(vq->vring.desc);
+	unsigned int i;
+
+	for (i = 0; i < virtqueue_get_vring_size(vq); i++)
+		free(vq->desc_state[i].indir_desc);
+	free(vq->desc_state);
+
+	if (vq->packed)
+		free(vq->vring_packed.desc);
+	else
+		free(vq->vring.desc);
 	list_del(&vq->list);
 	free(vq);
 }
 
 unsigned int virtqueue_get_vring_size(struct virtqueue *vq)
 {
-	return vq->vring.num;
+	return vq->packed ? vq->vring_packed.num : vq->vring.num;
 }
 
 ulong virtqueue_get_desc_addr(struct virtqueue *vq)
 {
+	if (vq->packed)
+		return (ulong)vq->vring_packed.desc;
+
 	return (ulong)vq->vring.desc;
 }
 
 ulong virtqueue_get_avail_addr(struct virtqueue *vq)
 {
+	if (vq->packed)
+		return (ulong)vq->vring_packed.driver;
+
 	return (ulong)vq->vring.desc +
 	       ((char *)vq->vring.avail - (char *)vq->vring.desc);
 }
 
 ulong virtqueue_get_used_addr(struct virtqueue *vq)
 {
+	if (vq->packed)
+		return (ulong)vq->vring_packed.device;
+
 	return (ulong)vq->vring.desc +
 	       ((char *)vq->vring.used - (char *)vq->vring.desc);
 }
@@ -318,21 +815,63 @@ bool virtqueue_poll(struct virtqueue *vq, u16 last_used_idx)
 {
 	virtio_mb();
 
+	if (vq->packed) {
+		bool wrap_counter;
+		u16 used_idx;
+
+		wrap_counter = last_used_idx >> VRING_PACKED_EVENT_F_WRAP_CTR;
+		used_idx = last_used_idx & ~(1 << VRING_PACKED_EVENT_F_WRAP_CTR);
+
+		return is_used_desc_packed(vq, used_idx, wrap_counter);
+	}
+
 	return last_used_idx != virtio16_to_cpu(vq->vdev, vq->vring.used->idx);
 }
 
+static void virtqueue_dump_packed(struct virtqueue *vq)
+{
+	struct vring_packed *vr = &vq->vring_packed;
+	unsigned int i;
+
+	printf("\tnext_avail_idx %u, avail_wrap_counter %u, used_wrap_counter %u\n",
+	       vq->next_avail_idx, vq->avail_wrap_counter,
+	       vq->used_wrap_counter);
+
+	printf("Descriptor dump:\n");
+	for (i = 0; i < vr->num; i++) {
+		printf("\tdesc[%u] = { 0x%llx, len %u, id %u, flags %u }\n",
+		       i, le64_to_cpu(vr->desc[i].addr),
+		       le32_to_cpu(vr->desc[i].len),
+		       le16_to_cpu(vr->desc[i].id),
+		       le16_to_cpu(vr->desc[i].flags));
+	}
+
+	printf("Driver event: off_wrap %u, flags %u\n",
+	       le16_to_cpu(vr->driver->off_wrap),
+	       le16_to_cpu(vr->driver->flags));
+	printf("Device event: off_wrap %u, flags %u\n",
+	       le16_to_cpu(vr->device->off_wrap),
+	       le16_to_cpu(vr->device->flags));
+}
+
 void virtqueue_dump(struct virtqueue *vq)
 {
 	unsigned int i;
 
 	printf("virtqueue %p for dev %s:\n", vq, vq->vdev->name);
-	printf("\tindex %u, phys addr %p num %u\n",
-	       vq->index, vq->vring.desc, vq->vring.num);
+	printf("\tindex %u, phys addr %p num %u%s\n",
+	       vq->index, (void *)virtqueue_get_desc_addr(vq),
+	       virtqueue_get_vring_size(vq), vq->packed ? " (packed)" : "");
 	printf("\tfree_head %u, num_added %u, num_free %u\n",
 	       vq->free_head, vq->num_added, vq->num_free);
 	printf("\tlast_used_idx %u, avail_flags_shadow %u, avail_idx_shadow %u\n",
 	       vq->last_used_idx, vq->avail_flags_shadow, vq->avail_idx_shadow);
 
+	if (vq->packed) {
+		virtqueue_dump_packed(vq);
+		return;
+	}
+
 	printf("Descriptor dump:\n");
 	for (i = 0; i < vq->vring.num; i++) {
 		printf("\tdesc[%u] = { 0x%llx, len %u, flags %u, next %u }\n",
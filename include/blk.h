@@ -240,6 +240,39 @@ struct blk_ops {
 	unsigned long (*erase)(struct udevice *dev, lbaint_t start,
 			       lbaint_t blkcnt);
 
+	/**
+	 * discard() - tell the device a section is no longer in use
+	 *
+	 * Unlike erase(), the contents of the discarded blocks are undefined
+	 * afterwards. The device may unmap them lazily, so this is usually
+	 * much cheaper than an erase on managed flash.
+	 *
+	 * @dev:	Device to discard blocks on
+	 * @start:	Start block number to discard (0=first)
+	 * @blkcnt:	Number of blocks to discard
+	 * @return number of blocks discarded, or -ve error number (see the
+	 * IS_ERR_VALUE() macro
+	 */
+	unsigned long (*discard)(struct udevice *dev, lbaint_t start,
+				 lbaint_t blkcnt);
+
+	/**
+	 * write_zeroes() - make a section of a block device read back as zero
+	 *
+	 * This should only be implemented where the device can do this
+	 * without transferring the data, e.g. when discarded blocks are
+	 * guaranteed to read as zero. Callers fall back to writing zeroes
+	 * themselves when this returns an error.
+	 *
+	 * @dev:	Device to zero
+	 * @start:	Start block number to zero (0=first)
+	 * @blkcnt:	Number of blocks to zero
+	 * @return number of blocks zeroed, or -ve error number (see the
+	 * IS_ERR_VALUE() macro
+	 */
+	unsigned long (*write_zeroes)(struct udevice *dev, lbaint_t start,
+				      lbaint_t blkcnt);
+
 	/**
 	 * select_hwpart() - select a particular hardware partition
 	 *
@@ -274,6 +307,10 @@ unsigned long blk_dwrite(struct blk_desc *block_dev, lbaint_t start,
 			 lbaint_t blkcnt, const void *buffer);
 unsigned long blk_derase(struct blk_desc *block_dev, lbaint_t start,
 			 lbaint_t blkcnt);
+unsigned long blk_ddiscard(struct blk_desc *block_dev, lbaint_t start,
+			   lbaint_t blkcnt);
+unsigned long blk_dwrite_zeroes(struct blk_desc *block_dev, lbaint_t start,
+				lbaint_t blkcnt);
 
 /**
  * blk_find_device() - Find a block device
@@ -460,6 +497,19 @@ static inline ulong blk_derase(struct blk_desc *block_dev, lbaint_t start,
 	return block_dev->block_erase(block_dev, start, blkcnt);
 }
 
+/* Legacy block drivers have no discard or zeroing support */
+static inline ulong blk_ddiscard(struct blk_desc *block_dev, lbaint_t start,
+				 lbaint_t blkcnt)
+{
+	return -ENOSYS;
+}
+
+static inline ulong blk_dwrite_zeroes(struct blk_desc *block_dev,
+				      lbaint_t start, lbaint_t blkcnt)
+{
+	return -ENOSYS;
+}
+
 /**
  * struct blk_driver - Driver for block interface types
  *
@@ -199,6 +199,8 @@ enum bootstage_id {
 	BOOTSTATE_ID_ACCUM_DM_SPL,
 	BOOTSTATE_ID_ACCUM_DM_F,
 	BOOTSTATE_ID_ACCUM_DM_R,
+	BOOTSTAGE_ID_ACCUM_DM_BIND_F,
+	BOOTSTAGE_ID_ACCUM_DM_BIND_R,
 
 	/* a few spare for the user, from here */
 	BOOTSTAGE_ID_USER,
@@ -304,6 +306,18 @@ uint32_t bootstage_start(enum bootstage_id id, const char *name);
  */
 uint32_t bootstage_accum(enum bootstage_id id);
 
+/**
+ * Add an accumulator which has been timed elsewhere
+ *
+ * This allocates a new id and records the given time against it, as if it
+ * had been measured with bootstage_start() and bootstage_accum().
+ *
+ * @param name		Textual name to display in the report
+ * @param duration	Time spent in the activity, in microseconds
+ * @return duration, or 0 if there is no space for the record
+ */
+uint32_t bootstage_add_accum(const char *name, uint32_t duration);
+
 /* Print a report about boot time */
 void bootstage_report(void);
 
@@ -403,6 +417,12 @@ static inline uint32_t bootstage_accum(enum bootstage_id id)
 	return 0;
 }
 
+static inline uint32_t bootstage_add_accum(const char *name,
+					   uint32_t duration)
+{
+	return 0;
+}
+
 static inline int bootstage_stash(void *base, int size)
 {
 	return 0;	/* Pretend to succeed */
@@ -296,6 +296,20 @@ int clk_disable_bulk(struct clk_bulk *bulk);
 
 int soc_clk_dump(void);
 
+#if CONFIG_IS_ENABLED(CLK_RATE_CACHE)
+/**
+ * clk_invalidate_rates() - Drop all cached clock rates
+ *
+ * This is done automatically when a clock is changed through this API. A
+ * driver which changes clocks in some other way must call it afterwards.
+ */
+void clk_invalidate_rates(void);
+#else
+static inline void clk_invalidate_rates(void)
+{
+}
+#endif
+
 /**
  * clk_valid() - check if clk is valid
  *
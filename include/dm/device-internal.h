@@ -184,6 +184,53 @@ fdt_addr_t simple_bus_translate(struct udevice *dev, fdt_addr_t addr);
 #define DM_ROOT_NON_CONST		(((gd_t *)gd)->dm_root)
 #define DM_UCLASS_ROOT_NON_CONST	(((gd_t *)gd)->uclass_root)
 
+/**
+ * struct dm_timing_mark - Start of a timed driver-model operation
+ *
+ * @start_us: Time at which the operation started
+ * @outer_us: Time already charged to nested operations of the caller
+ * @valid: true if the operation is being timed
+ */
+struct dm_timing_mark {
+	ulong start_us;
+	ulong outer_us;
+	bool valid;
+};
+
+#if CONFIG_IS_ENABLED(DM_TIMING)
+/**
+ * dm_timing_start() - Start timing a driver-model operation
+ *
+ * Operations are only timed after relocation, once a timer is available.
+ * Every call must be paired with a call to dm_timing_end().
+ *
+ * @mark:	Returns the start of the operation
+ */
+void dm_timing_start(struct dm_timing_mark *mark);
+
+/**
+ * dm_timing_end() - Finish timing a driver-model operation
+ *
+ * The time taken, less any time taken by operations nested inside this one,
+ * is added to the device's timing record.
+ *
+ * @dev:	Device to charge the time to, or NULL to discard it
+ * @op:		Operation which was performed
+ * @mark:	Start of the operation, from dm_timing_start()
+ */
+void dm_timing_end(struct udevice *dev, int op,
+		   struct dm_timing_mark *mark);
+#else
+static inline void dm_timing_start(struct dm_timing_mark *mark)
+{
+}
+
+static inline void dm_timing_end(struct udevice *dev, int op,
+				 struct dm_timing_mark *mark)
+{
+}
+#endif
+
 /* device resource management */
 #ifdef CONFIG_DEVRES
 
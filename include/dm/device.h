@@ -61,6 +61,12 @@ struct driver_info;
  */
 #define DM_FLAG_OS_PREPARE		(1 << 10)
 
+/* Device storage was instantiated at build time and must not be freed */
+#define DM_FLAG_INST			(1 << 11)
+
+/* Binding the build-time storage failed, so it is not tried again */
+#define DM_FLAG_INST_FAILED		(1 << 12)
+
 /*
  * One or multiple of these flags are passed to device_remove() so that
  * a selective device removal as specified by the remove-stage and the
@@ -82,6 +88,29 @@ enum {
 	DM_REMOVE_ACTIVE_ALL = DM_REMOVE_ACTIVE_DMA | DM_REMOVE_OS_PREPARE,
 };
 
+/* Driver-model operations which are timed with CONFIG_DM_TIMING */
+enum dm_timing_op {
+	DM_TIMING_BIND,
+	DM_TIMING_PROBE,
+	DM_TIMING_REMOVE,
+
+	DM_TIMING_COUNT,
+};
+
+/**
+ * struct dm_timing - Time spent in driver-model operations on a device
+ *
+ * Time spent in operations on other devices (e.g. probing the parent, or a
+ * regulator that the driver's probe() method enables) is not included.
+ *
+ * @time_us: Total time taken by each operation, in microseconds
+ * @count: Number of times each operation has been performed
+ */
+struct dm_timing {
+	ulong time_us[DM_TIMING_COUNT];
+	uint count[DM_TIMING_COUNT];
+};
+
 /**
  * struct udevice - An instance of a driver
  *
@@ -123,6 +152,9 @@ enum {
  *		When CONFIG_DEVRES is enabled, devm_kmalloc() and friends will
  *		add to this list. Memory so-allocated will be freed
  *		automatically when the device is removed / unbound
+ * @timing: Time spent binding, probing and removing this device, when
+ *		CONFIG_DM_TIMING is enabled. This is allocated when the device
+ *		is first timed, or NULL if it has not been
  */
 struct udevice {
 	const struct driver *driver;
@@ -146,6 +178,9 @@ struct udevice {
 #ifdef CONFIG_DEVRES
 	struct list_head devres_head;
 #endif
+#if CONFIG_IS_ENABLED(DM_TIMING)
+	struct dm_timing *timing;
+#endif
 };
 
 /* Maximum sequence number supported */
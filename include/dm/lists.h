@@ -23,6 +23,20 @@
  */
 struct driver *lists_driver_lookup_name(const char *name);
 
+/**
+ * lists_driver_lookup_compat() - Find the driver for a compatible string
+ *
+ * After relocation this uses a hash table of the compatible strings of all
+ * drivers. Where several drivers have the same compatible string, the first
+ * one in the linker list is found, as with a linear search.
+ *
+ * @compat:	Compatible string to look up
+ * @of_idp:	Returns the match entry of the driver
+ * @return driver, or NULL if none has the compatible string
+ */
+struct driver *lists_driver_lookup_compat(const char *compat,
+					  const struct udevice_id **of_idp);
+
 /**
  * lists_uclass_lookup() - Return uclass_driver based on ID of the class
  * id:		ID of the class
@@ -61,6 +75,50 @@ int lists_bind_drivers(struct udevice *parent, bool pre_reloc_only);
 int lists_bind_fdt(struct udevice *parent, ofnode node, struct udevice **devp,
 		   bool pre_reloc_only);
 
+/**
+ * lists_defer_bind_fdt() - bind a device tree node when its uclass is used
+ *
+ * This notes the uclass of the driver that lists_bind_fdt() would bind the
+ * node to, and those of the drivers for its enabled subnodes, so that
+ * lists_bind_deferred() can bind the node when any of them is needed.
+ * Nothing is noted if there is no driver for the node.
+ *
+ * @parent: parent device (root)
+ * @node: device tree node to bind
+ * @return 0 if OK, -ENOMEM if out of memory
+ */
+int lists_defer_bind_fdt(struct udevice *parent, ofnode node);
+
+/**
+ * lists_bind_deferred() - bind the nodes noted by lists_defer_bind_fdt()
+ *
+ * The nodes are bound in the order they were noted, with lists_bind_fdt().
+ * This returns straight away if no node was noted for the uclass.
+ *
+ * @id: uclass whose nodes to bind, or UCLASS_INVALID to bind them all
+ * @return 0 if OK, or the first error from lists_bind_fdt()
+ */
+int lists_bind_deferred(enum uclass_id id);
+
+/**
+ * lists_bind_deferred_node() - bind the noted node which holds a node
+ *
+ * This binds the node noted by lists_defer_bind_fdt() which is @node or one
+ * of its parents, if there is one, so that a device can be looked up by its
+ * node without going through its uclass.
+ *
+ * @node: device tree node to look for
+ * @return 0 if OK, or the error from lists_bind_fdt()
+ */
+int lists_bind_deferred_node(ofnode node);
+
+/**
+ * lists_drop_deferred() - forget the nodes noted by lists_defer_bind_fdt()
+ *
+ * This is used when driver model starts again, since their parent is gone.
+ */
+void lists_drop_deferred(void);
+
 /**
  * device_bind_driver() - bind a device to a driver
  *
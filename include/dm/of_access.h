@@ -218,6 +218,19 @@ struct device_node *of_find_node_by_prop_value(struct device_node *from,
  */
 struct device_node *of_find_node_by_phandle(phandle handle);
 
+/**
+ * of_phandle_cache_build() - Set up the cache used to look up phandles
+ *
+ * This indexes the nodes of a live tree by phandle, so that
+ * of_find_node_by_phandle() does not need to search the tree. It is used
+ * while @root is the root of the live tree (gd->of_root). The tree must not
+ * change afterwards, except that new nodes may be added.
+ *
+ * @root:	Root of the live tree
+ * @return 0 if OK, -ENOMEM if out of memory
+ */
+int of_phandle_cache_build(struct device_node *root);
+
 /**
  * of_read_u32() - Find and read a 32-bit integer from a property
  *
@@ -12,6 +12,8 @@
 
 #include <linker_lists.h>
 
+struct udevice;
+
 /**
  * struct driver_info - Information required to instantiate a device
  *
@@ -22,6 +24,9 @@
  * @name:	Driver name
  * @platdata:	Driver-specific platform data
  * @platdata_size: Size of platform data structure
+ * @dev:	Storage for the device, if it is instantiated at build time
+ * @parent:	Parent device, or NULL if the device is a child of the root
+ * @req_seq:	Requested sequence number for the device (-1 for any)
  */
 struct driver_info {
 	const char *name;
@@ -29,6 +34,11 @@ struct driver_info {
 #if CONFIG_IS_ENABLED(OF_PLATDATA)
 	uint platdata_size;
 #endif
+#if CONFIG_IS_ENABLED(OF_PLATDATA_INST)
+	struct udevice *dev;
+	const struct driver_info *parent;
+	int req_seq;
+#endif
 };
 
 /**
@@ -39,6 +49,10 @@ struct driver_info {
 #define U_BOOT_DEVICE(__name)						\
 	ll_entry_declare(struct driver_info, __name, driver_info)
 
+/* Refer to a device declared earlier with U_BOOT_DEVICE() */
+#define U_BOOT_DEVICE_REF(__name)					\
+	ll_entry_ref(struct driver_info, __name, driver_info)
+
 /* Declare a list of devices. The argument is a driver_info[] array */
 #define U_BOOT_DEVICES(__name)						\
 	ll_entry_declare_list(struct driver_info, __name, driver_info)
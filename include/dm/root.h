@@ -114,6 +114,27 @@ int dm_init(bool of_live);
  */
 int dm_uninit(void);
 
+/**
+ * dm_probe_async() - Start probing the devices in some uclasses in parallel
+ *
+ * Each device in the listed uclasses is probed in its own thread, so that
+ * their hardware waits overlap. Devices which share a bus other than a
+ * simple bus are probed one after another in the same thread. Sequence
+ * numbers are assigned before the threads start, so they do not depend on
+ * the order the threads run in.
+ *
+ * The threads run until their first wait before this returns, and then
+ * whenever the caller waits for them. Any device is still probed as usual
+ * if it is needed before its thread has finished. Use thread_join_all() to
+ * wait for all of them.
+ *
+ * @uclasses:	Space-separated list of uclass names, e.g. "mmc eth". Names
+ *		of uclasses which are not built in are ignored
+ * @return 0 if OK, -ENOMEM if out of memory, in which case some devices
+ *	are left to be probed in the normal way
+ */
+int dm_probe_async(const char *uclasses);
+
 #if CONFIG_IS_ENABLED(DM_DEVICE_REMOVE)
 /**
  * dm_remove_devices_flags - Call remove function of all drivers with
@@ -143,6 +143,7 @@ struct dm_test_state {
 	int force_fail_alloc;
 	int skip_post_probe;
 	struct udevice *removed;
+	struct udevice *slow_dev;
 };
 
 /* Test flags for each test */
@@ -211,6 +211,18 @@ static inline int uclass_pre_remove_device(struct udevice *dev) { return 0; }
  */
 struct uclass *uclass_find(enum uclass_id key);
 
+/**
+ * uclass_find_or_add() - Find a uclass by its id, creating it if needed
+ *
+ * Unlike uclass_get(), this does not bind any deferred device tree nodes,
+ * so it is safe to use while binding a device.
+ *
+ * @id:		Id to search for
+ * @ucp:	Returns pointer to uclass (there is only one per ID)
+ * @return 0 if OK, -ve on error
+ */
+int uclass_find_or_add(enum uclass_id id, struct uclass **ucp);
+
 /**
  * uclass_destroy() - Destroy a uclass
  *
@@ -39,6 +39,30 @@ static inline void dm_dump_devres(void)
 }
 #endif
 
+#if CONFIG_IS_ENABLED(DM_TIMING)
+/* Dump out the time spent in each device, slowest first */
+void dm_dump_timing(void);
+
+/**
+ * dm_timing_add_bootstage() - Add the slowest devices to the bootstage report
+ *
+ * Each device is added as an accumulated-time record, so that it appears in
+ * bootstage_report() and in the report added to the device tree passed to
+ * the OS.
+ *
+ * @count:	Maximum number of devices to add
+ */
+void dm_timing_add_bootstage(int count);
+#else
+static inline void dm_dump_timing(void)
+{
+}
+
+static inline void dm_timing_add_bootstage(int count)
+{
+}
+#endif
+
 /**
  * Check if a dt node should be or was bound before relocation.
  *
@@ -6,7 +6,7 @@
 #ifndef __DT_STRUCTS
 #define __DT_STRUCTS
 
-/* These structures may only be used in SPL */
+/* These structures may only be used with of-platdata */
 #if CONFIG_IS_ENABLED(OF_PLATDATA)
 struct phandle_0_arg {
 	const void *node;
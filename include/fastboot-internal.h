@@ -33,4 +33,11 @@ extern void (*fastboot_progress_callback)(const char *msg);
  */
 void fastboot_getvar(char *cmd_parameter, char *response);
 
+/**
+ * fastboot_stream_armed() - Check whether downloads are streamed to flash
+ *
+ * Return: true if 'oem stream' selected a partition for the next downloads
+ */
+bool fastboot_stream_armed(void);
+
 #endif
@@ -6,6 +6,8 @@
 #ifndef _FB_MMC_H_
 #define _FB_MMC_H_
 
+struct sparse_storage;
+
 /**
  * fastboot_mmc_get_part_info() - Lookup eMMC partion by name
  *
@@ -34,4 +36,16 @@ void fastboot_mmc_flash_write(const char *cmd, void *download_buffer,
  * @response: Pointer to fastboot response buffer
  */
 void fastboot_mmc_erase(const char *cmd, char *response);
+
+/**
+ * fastboot_mmc_stream_start() - Prepare streaming an image to eMMC
+ *
+ * @cmd: Named partition to write image to
+ * @sparse: Storage description to fill in for sparse_stream_init()
+ * @response: Pointer to fastboot response buffer
+ *
+ * Return: 0 on success, or negative error code (response is then set)
+ */
+int fastboot_mmc_stream_start(const char *cmd, struct sparse_storage *sparse,
+			      char *response);
 #endif
@@ -9,6 +9,8 @@
 
 #include <jffs2/load_kernel.h>
 
+struct sparse_storage;
+
 /**
  * fastboot_nand_get_part_info() - Lookup NAND partion by name
  *
@@ -37,4 +39,16 @@ void fastboot_nand_flash_write(const char *cmd, void *download_buffer,
  * @response: Pointer to fastboot response buffer
  */
 void fastboot_nand_erase(const char *cmd, char *response);
+
+/**
+ * fastboot_nand_stream_start() - Prepare streaming an image to NAND
+ *
+ * @cmd: Named device to write image to
+ * @sparse: Storage description to fill in for sparse_stream_init()
+ * @response: Pointer to fastboot response buffer
+ *
+ * Return: 0 on success, or negative error code (response is then set)
+ */
+int fastboot_nand_stream_start(const char *cmd, struct sparse_storage *sparse,
+			       char *response);
 #endif
@@ -664,6 +664,20 @@ const char *fdtdec_get_compatible(enum fdt_compat_id id);
  */
 int fdtdec_lookup_phandle(const void *blob, int node, const char *prop_name);
 
+/**
+ * fdtdec_node_offset_by_phandle() - Find the node with a given phandle
+ *
+ * This works like fdt_node_offset_by_phandle(), but after relocation it
+ * remembers the offset of each node found, so that later lookups of the same
+ * phandle do not need to search the tree. A remembered offset is checked
+ * before use, so the tree may be changed at any time.
+ *
+ * @blob:	FDT blob
+ * @phandle:	phandle to look for
+ * @return node offset if found, -ve error code on error
+ */
+int fdtdec_node_offset_by_phandle(const void *blob, uint32_t phandle);
+
 /**
  * Look up a property in a node and return its contents in an integer
  * array of given length. The property must have at least enough data for
@@ -23,6 +23,11 @@ struct sparse_storage {
 				 lbaint_t blk,
 				 lbaint_t blkcnt);
 
+	/* Optional: zero blocks without writing them, returns blocks zeroed */
+	lbaint_t	(*write_zeroes)(struct sparse_storage *info,
+				 lbaint_t blk,
+				 lbaint_t blkcnt);
+
 	void		(*mssg)(const char *str, char *response);
 };
 
@@ -39,3 +44,67 @@ static inline int is_sparse_image(void *buf)
 
 int write_sparse_image(struct sparse_storage *info, const char *part_name,
 		       void *data, char *response);
+
+/**
+ * struct sparse_stream - an image written to storage while it is received
+ *
+ * @info:		Storage the image is written to
+ * @header:		Copy of the sparse image header
+ * @started:		The first bytes of the image have been seen
+ * @sparse:		The image is a sparse image (otherwise raw)
+ * @chunk:		Number of sparse chunks handled so far
+ * @blk:		Next block to write
+ * @raw_left:		Bytes of the current RAW chunk not yet written
+ * @skip:		Bytes of the input to skip before the next header
+ * @total_blocks:	Blocks of the output image covered so far
+ * @bytes_written:	Bytes written to the storage so far
+ */
+struct sparse_stream {
+	struct sparse_storage	*info;
+	sparse_header_t		header;
+	bool			started;
+	bool			sparse;
+	u32			chunk;
+	lbaint_t		blk;
+	u64			raw_left;
+	u32			skip;
+	u32			total_blocks;
+	u64			bytes_written;
+};
+
+/**
+ * sparse_stream_init() - start writing a raw or sparse image piecewise
+ *
+ * @stream:	Stream state to set up
+ * @info:	Storage to write to, which must stay valid during the stream
+ */
+void sparse_stream_init(struct sparse_stream *stream,
+			struct sparse_storage *info);
+
+/**
+ * sparse_stream_write() - write the next part of the image
+ *
+ * Only whole blocks and complete chunk headers are consumed; the caller
+ * must pass the unconsumed tail again, followed by more data, on the next
+ * call. When @last is set, a raw image is padded to a whole block.
+ *
+ * @stream:	Stream state
+ * @data:	Image data following what has been consumed so far
+ * @len:	Length of @data
+ * @last:	@data ends with the end of the image
+ * @response:	Buffer for the error message, passed to @info->mssg
+ * @return number of bytes consumed, or -1 on error
+ */
+long sparse_stream_write(struct sparse_stream *stream, void *data, u32 len,
+			 bool last, char *response);
+
+/**
+ * sparse_stream_finish() - check that the whole image has been written
+ *
+ * @stream:	Stream state
+ * @part_name:	Name of the partition, for the log message
+ * @response:	Buffer for the error message, passed to @info->mssg
+ * @return 0 on success, -1 on error
+ */
+int sparse_stream_finish(struct sparse_stream *stream, const char *part_name,
+			 char *response);
@@ -210,6 +210,30 @@
 		_ll_result;						\
 	})
 
+/**
+ * ll_entry_ref() - Refer to an entry in a linker-generated array by name
+ * @_type:	Data type of the entry
+ * @_name:	Name of the entry
+ * @_list:	Name of the list in which this entry is placed
+ *
+ * This is like ll_entry_get() but is a constant expression, so it can be used
+ * in a static initialiser. The entry must already have been declared in the
+ * same file.
+ *
+ * Example:
+ *
+ * ::
+ *
+ *   ll_entry_declare(struct my_sub_cmd, my_sub_cmd, cmd_sub) = {
+ *           .x = 3,
+ *           .y = 4,
+ *   };
+ *   static struct my_sub_cmd *c = ll_entry_ref(struct my_sub_cmd, my_sub_cmd,
+ *                                              cmd_sub);
+ */
+#define ll_entry_ref(_type, _name, _list)				\
+	((_type *)&_u_boot_list_2_##_list##_2_##_name)
+
 /**
  * ll_start() - Point to first entry of first linker-generated array
  * @_type:	Data type of the entry
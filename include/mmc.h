@@ -70,9 +70,13 @@
 #define MMC_MODE_4BIT		BIT(29)
 #define MMC_MODE_1BIT		BIT(28)
 #define MMC_MODE_SPI		BIT(27)
+/* Multi-block transfers may be bounded by SET_BLOCK_COUNT (CMD23) */
+#define MMC_CAP_CMD23		BIT(26)
 
 
 #define SD_DATA_4BIT	0x00040000
+#define SD_CMD23_SUPPORT	0x00000002
+#define SD_DATA_STAT_AFTER_ERASE	0x00800000
 
 #define IS_SD(x)	((x)->version & SD_VERSION_SD)
 #define IS_MMC(x)	((x)->version & MMC_VERSION_MMC)
@@ -212,12 +216,14 @@ static inline bool mmc_is_tuning_cmd(uint cmdidx)
 #define EXT_CSD_PARTITIONING_SUPPORT	160	/* RO */
 #define EXT_CSD_RST_N_FUNCTION		162	/* R/W */
 #define EXT_CSD_BKOPS_EN		163	/* R/W & R/W/E */
+#define EXT_CSD_SANITIZE_START		165	/* W */
 #define EXT_CSD_WR_REL_PARAM		166	/* R */
 #define EXT_CSD_WR_REL_SET		167	/* R/W */
 #define EXT_CSD_RPMB_MULT		168	/* RO */
 #define EXT_CSD_ERASE_GROUP_DEF		175	/* R/W */
 #define EXT_CSD_BOOT_BUS_WIDTH		177
 #define EXT_CSD_PART_CONF		179	/* R/W */
+#define EXT_CSD_ERASED_MEM_CONT		181	/* RO */
 #define EXT_CSD_BUS_WIDTH		183	/* R/W */
 #define EXT_CSD_HS_TIMING		185	/* R/W */
 #define EXT_CSD_REV			192	/* RO */
@@ -226,6 +232,7 @@ static inline bool mmc_is_tuning_cmd(uint cmdidx)
 #define EXT_CSD_HC_WP_GRP_SIZE		221	/* RO */
 #define EXT_CSD_HC_ERASE_GRP_SIZE	224	/* RO */
 #define EXT_CSD_BOOT_MULT		226	/* RO */
+#define EXT_CSD_SEC_FEATURE_SUPPORT	231	/* RO */
 #define EXT_CSD_BKOPS_SUPPORT		502	/* RO */
 
 /*
@@ -254,6 +261,9 @@ static inline bool mmc_is_tuning_cmd(uint cmdidx)
 #define EXT_CSD_CARD_TYPE_HS400		(EXT_CSD_CARD_TYPE_HS400_1_8V | \
 					 EXT_CSD_CARD_TYPE_HS400_1_2V)
 
+#define EXT_CSD_SEC_GB_CL_EN	BIT(4)	/* Card supports TRIM and DISCARD */
+#define EXT_CSD_SEC_SANITIZE	BIT(6)	/* Card supports SANITIZE */
+
 #define EXT_CSD_BUS_WIDTH_1	0	/* Card is in 1 bit mode */
 #define EXT_CSD_BUS_WIDTH_4	1	/* Card is in 4 bit mode */
 #define EXT_CSD_BUS_WIDTH_8	2	/* Card is in 8 bit mode */
@@ -561,6 +571,21 @@ static inline bool supports_uhs(uint caps)
 #endif
 }
 
+/**
+ * struct mmc_mode_cache - bus setup that last worked for a card
+ *
+ * @cid: CID of the card
+ * @mode: bus mode (enum bus_mode)
+ * @bus_width: bus width in bits, 0 if the entry is unused
+ * @spare: padding, zero
+ */
+struct mmc_mode_cache {
+	u32 cid[4];
+	u8 mode;
+	u8 bus_width;
+	u8 spare[2];
+};
+
 /*
  * With CONFIG_DM_MMC enabled, struct mmc can be accessed from the MMC device
  * with mmc_get_mmc_dev().
@@ -639,6 +664,9 @@ struct mmc {
 				  * accessing the boot partitions
 				  */
 	u32 quirks;
+#ifdef CONFIG_MMC_MODE_CACHE
+	struct mmc_mode_cache mode_cache;
+#endif
 };
 
 struct mmc_hwpart_conf {
@@ -752,6 +780,8 @@ int mmc_set_part_conf(struct mmc *mmc, u8 ack, u8 part_num, u8 access);
 int mmc_set_boot_bus_width(struct mmc *mmc, u8 width, u8 reset, u8 mode);
 /* Function to modify the RST_n_FUNCTION field of EXT_CSD */
 int mmc_set_rst_n_function(struct mmc *mmc, u8 enable);
+/* Function to purge all unmapped data from an eMMC */
+int mmc_sanitize(struct mmc *mmc);
 /* Functions to read / write the RPMB partition */
 int mmc_rpmb_set_key(struct mmc *mmc, void *key);
 int mmc_rpmb_get_counter(struct mmc *mmc, unsigned long *counter);
@@ -803,6 +833,17 @@ int mmc_get_op_cond(struct mmc *mmc);
  */
 int mmc_start_init(struct mmc *mmc);
 
+/**
+ * Initialise the device in a new thread and return immediately.
+ *
+ * The card's power-up and the rest of mmc_init() then overlap with other
+ * work. A later mmc_init() waits for the thread to finish.
+ *
+ * @param mmc	Pointer to a MMC device struct
+ * @return 0 on success, -ENOMEM if the thread could not be created
+ */
+int mmc_init_async(struct mmc *mmc);
+
 /**
  * Set preinit flag of mmc device.
  *
@@ -638,6 +638,20 @@ void net_set_udp_handler(rxhand_f *);	/* Set UDP RX packet handler */
 rxhand_f *net_get_arp_handler(void);	/* Get ARP RX packet handler */
 void net_set_arp_handler(rxhand_f *);	/* Set ARP RX packet handler */
 bool arp_is_waiting(void);		/* Waiting for ARP reply? */
+#ifdef CONFIG_NET_ARP_CACHE
+/* Fill in ethaddr for ip (or its gateway) from the ARP cache, if possible */
+bool arp_cache_lookup(struct in_addr ip, uchar *ethaddr);
+void arp_cache_flush(void);		/* Forget all learnt addresses */
+#else
+static inline bool arp_cache_lookup(struct in_addr ip, uchar *ethaddr)
+{
+	return false;
+}
+
+static inline void arp_cache_flush(void)
+{
+}
+#endif
 void net_set_icmp_handler(rxhand_icmp_f *f); /* Set ICMP RX handler */
 void net_set_timeout_handler(ulong, thand_f *);/* Set timeout handler */
 
@@ -15,6 +15,7 @@
 #include <linux/ethtool.h>
 #include <linux/mdio.h>
 #include <phy_interface.h>
+#include <thread.h>
 
 #define PHY_FIXED_ID		0xa5a55a5a
 
@@ -149,19 +150,33 @@ struct fixed_link {
 	int asym_pause;
 };
 
+/*
+ * A PHY may be started in a thread, so claim the bus while a transfer is in
+ * progress. This keeps out other PHYs on the same bus.
+ */
 static inline int phy_read(struct phy_device *phydev, int devad, int regnum)
 {
 	struct mii_dev *bus = phydev->bus;
+	int ret;
 
-	return bus->read(bus, phydev->addr, devad, regnum);
+	thread_claim(bus);
+	ret = bus->read(bus, phydev->addr, devad, regnum);
+	thread_release(bus);
+
+	return ret;
 }
 
 static inline int phy_write(struct phy_device *phydev, int devad, int regnum,
 			u16 val)
 {
 	struct mii_dev *bus = phydev->bus;
+	int ret;
+
+	thread_claim(bus);
+	ret = bus->write(bus, phydev->addr, devad, regnum, val);
+	thread_release(bus);
 
-	return bus->write(bus, phydev->addr, devad, regnum, val);
+	return ret;
 }
 
 #ifdef CONFIG_PHYLIB_10G
@@ -202,6 +217,7 @@ static inline ofnode phy_get_ofnode(struct phy_device *phydev)
 }
 #endif
 int phy_startup(struct phy_device *phydev);
+int phy_startup_async(struct phy_device *phydev);
 int phy_config(struct phy_device *phydev);
 int phy_shutdown(struct phy_device *phydev);
 int phy_register(struct phy_driver *drv);
@@ -32,6 +32,9 @@
  *
  * Currently, only a bare "mem" backend for regmaps is supported, which
  * accesses the register map as regular IO-mapped memory.
+ *
+ * With CONFIG_REGMAP_CACHE the 32-bit registers in the first range can be
+ * cached, see regmap_cache_init().
  */
 
 /**
@@ -73,15 +76,32 @@ struct regmap_range {
 	ulong size;
 };
 
+/**
+ * struct regmap_volatile - a range of registers which must not be cached
+ *
+ * @start:	Offset of the first register in the range
+ * @size:	Size in bytes
+ */
+struct regmap_volatile {
+	uint start;
+	uint size;
+};
+
+struct regmap_cache;
+
 /**
  * struct regmap - a way of accessing hardware/bus registers
  *
  * @range_count:	Number of ranges available within the map
+ * @cache:		Register cache, or NULL if none
  * @ranges:		Array of ranges
  */
 struct regmap {
 	enum regmap_endianness_t endianness;
 	int range_count;
+#if CONFIG_IS_ENABLED(REGMAP_CACHE)
+	struct regmap_cache *cache;
+#endif
 	struct regmap_range ranges[0];
 };
 
@@ -250,6 +270,71 @@ int regmap_raw_read_range(struct regmap *map, uint range_num, uint offset,
  */
 int regmap_update_bits(struct regmap *map, uint offset, uint mask, uint val);
 
+/**
+ * regmap_bulk_write() - Write a number of consecutive 32-bit registers
+ *
+ * @map:	Regmap to write to
+ * @offset:	Offset in the regmap of the first register
+ * @vals:	Values to write
+ * @count:	Number of registers to write
+ *
+ * With a register cache, registers which already hold the value being
+ * written are skipped.
+ *
+ * Return: 0 if OK, -ve on error
+ */
+int regmap_bulk_write(struct regmap *map, uint offset, const uint *vals,
+		      uint count);
+
+#if CONFIG_IS_ENABLED(REGMAP_CACHE)
+/**
+ * regmap_cache_init() - Cache the registers of a regmap
+ *
+ * This caches the 32-bit registers at aligned offsets in the first range of
+ * the regmap. regmap_read() returns a cached value if there is one, and
+ * regmap_write() and regmap_update_bits() keep the cache up to date. Other
+ * accesses go to the hardware, with writes invalidating any registers they
+ * overlap.
+ *
+ * @map:	Regmap to cache
+ * @size:	Number of bytes to cache from the start of the first range, or
+ *		0 for the whole range
+ * @vol:	Ranges of volatile registers, which are never cached
+ * @vol_count:	Number of volatile ranges
+ * Return: 0 if OK, -ve on error
+ */
+int regmap_cache_init(struct regmap *map, uint size,
+		      const struct regmap_volatile *vol, int vol_count);
+
+/**
+ * regmap_cache_only() - Hold back writes to the hardware
+ *
+ * While this is enabled, writes to cached registers only update the cache.
+ * Use regmap_cache_sync() to write them out afterwards.
+ *
+ * @map:	Regmap to update
+ * @enable:	true to only write to the cache, false to write through
+ */
+void regmap_cache_only(struct regmap *map, bool enable);
+
+/**
+ * regmap_cache_sync() - Write out registers changed only in the cache
+ *
+ * @map:	Regmap to sync
+ * Return: 0 if OK, -ve on error
+ */
+int regmap_cache_sync(struct regmap *map);
+
+/**
+ * regmap_cache_drop() - Discard all cached values
+ *
+ * Use this when the hardware has been reset. Unwritten values are lost.
+ *
+ * @map:	Regmap whose cache to drop
+ */
+void regmap_cache_drop(struct regmap *map);
+#endif
+
 /**
  * regmap_init_mem() - Set up a new register map that uses memory access
  *
@@ -18,6 +18,7 @@
  */
 
 #define SDHCI_DMA_ADDRESS	0x00
+#define SDHCI_ARGUMENT2		SDHCI_DMA_ADDRESS
 
 #define SDHCI_BLOCK_SIZE	0x04
 #define  SDHCI_MAKE_BLKSZ(dma, blksz) (((dma & 0x7) << 12) | (blksz & 0xFFF))
@@ -30,6 +31,7 @@
 #define  SDHCI_TRNS_DMA		BIT(0)
 #define  SDHCI_TRNS_BLK_CNT_EN	BIT(1)
 #define  SDHCI_TRNS_ACMD12	BIT(2)
+#define  SDHCI_TRNS_AUTO_CMD23	BIT(3)
 #define  SDHCI_TRNS_READ	BIT(4)
 #define  SDHCI_TRNS_MULTI	BIT(5)
 
@@ -186,6 +188,7 @@
 /* 55-57 reserved */
 
 #define SDHCI_ADMA_ADDRESS	0x58
+#define SDHCI_ADMA_ADDRESS_HI	0x5C
 
 /* 60-FB reserved */
 
@@ -226,6 +229,10 @@
 #define SDHCI_QUIRK_WAIT_SEND_CMD	(1 << 6)
 #define SDHCI_QUIRK_USE_WIDE8		(1 << 8)
 #define SDHCI_QUIRK_NO_1_8_V		(1 << 9)
+/* Auto CMD12 works on this host */
+#define SDHCI_QUIRK_USE_AUTO_CMD12	(1 << 10)
+/* CMD23 is not to be used, even though the host is v3.00 or later */
+#define SDHCI_QUIRK_BROKEN_CMD23	(1 << 11)
 
 /* to make gcc happy */
 struct sdhci_host;
@@ -235,6 +242,50 @@ struct sdhci_host;
  */
 #define SDHCI_DEFAULT_BOUNDARY_SIZE	(512 * 1024)
 #define SDHCI_DEFAULT_BOUNDARY_ARG	(7)
+
+/*
+ * ADMA2 descriptors. A descriptor's length field is 16 bits wide; we keep
+ * each one to a multiple of 512 bytes so that the following descriptor
+ * stays aligned.
+ */
+#define ADMA_DESC_ATTR_VALID	BIT(0)
+#define ADMA_DESC_ATTR_END	BIT(1)
+#define ADMA_DESC_ATTR_INT	BIT(2)
+#define ADMA_DESC_ATTR_ACT1	BIT(4)
+#define ADMA_DESC_ATTR_ACT2	BIT(5)
+#define ADMA_DESC_TRANSFER_DATA	ADMA_DESC_ATTR_ACT2
+#define ADMA_DESC_LINK_DESC	(ADMA_DESC_ATTR_ACT1 | ADMA_DESC_ATTR_ACT2)
+
+#define ADMA_MAX_LEN		(64 * 1024 - 512)
+#define ADMA32_DESC_LEN		8
+#define ADMA64_DESC_LEN		12
+#define ADMA_TABLE_NO_ENTRIES	DIV_ROUND_UP(CONFIG_SYS_MMC_MAX_BLK_COUNT * \
+					     MMC_MAX_BLOCK_LEN, ADMA_MAX_LEN)
+#define ADMA_TABLE_SZ		(ADMA_TABLE_NO_ENTRIES * ADMA64_DESC_LEN)
+
+/* 32-bit descriptors end after addr_lo */
+struct sdhci_adma_desc {
+	__le16 attr;
+	__le16 len;
+	__le32 addr_lo;
+	__le32 addr_hi;
+} __packed;
+
+/* host->flags: the DMA mode and features picked by sdhci_setup_cfg() */
+#define USE_SDMA	BIT(0)
+#define USE_ADMA	BIT(1)
+#define USE_ADMA64	BIT(2)
+#define USE_DMA		(USE_SDMA | USE_ADMA | USE_ADMA64)
+#define USE_AUTO_CMD12	BIT(3)
+#define USE_AUTO_CMD23	BIT(4)
+
+/* host->sbc: how the next multi-block transfer is bounded */
+enum sdhci_sbc {
+	SDHCI_SBC_NONE,		/* open-ended, stopped by CMD12 */
+	SDHCI_SBC_SENT,		/* CMD23 was sent to the card */
+	SDHCI_SBC_AUTO,		/* CMD23 goes out with the transfer */
+};
+
 struct sdhci_ops {
 #ifdef CONFIG_MMC_SDHCI_IO_ACCESSORS
 	u32	(*read_l)(struct sdhci_host *host, int reg);
@@ -257,6 +308,7 @@ struct sdhci_host {
 	void *ioaddr;
 	unsigned int quirks;
 	unsigned int host_caps;
+	unsigned int flags;
 	unsigned int version;
 	unsigned int max_clk;   /* Maximum Base Clock frequency */
 	unsigned int clk_mul;   /* Clock Multiplier value */
@@ -272,6 +324,10 @@ struct sdhci_host {
 	uint	voltages;
 
 	struct mmc_config cfg;
+	void *adma_desc_table;	/* ADMA_TABLE_NO_ENTRIES descriptors */
+	enum sdhci_sbc sbc;
+	u32 sbc_arg;		/* CMD23 argument for SDHCI_SBC_AUTO */
+	bool auto_cmd12;	/* the last transfer was stopped by the host */
 };
 
 #ifdef CONFIG_MMC_SDHCI_IO_ACCESSORS
@@ -0,0 +1,166 @@
+/* SPDX-License-Identifier: GPL-2.0+ */
+/*
+ * Cooperative threads
+ *
+ * Threads let slow hardware waits overlap, for example so that several
+ * devices can be probed at the same time. Each thread has its own stack.
+ * There is no preemption: a thread only gives up the CPU at a wait point,
+ * i.e. a long udelay(), a polling loop or an explicit thread_yield().
+ *
+ * The main thread does not give up the CPU at these wait points, so it is
+ * never suspended half-way through a bus transfer and code outside the
+ * threads keeps its timing. The other threads run between the steps of the
+ * init sequence, when the main thread waits for one of them with
+ * thread_join(), or when it needs something which one of them has claimed.
+ *
+ * Threads are only available in U-Boot proper after relocation. Before
+ * that, and when no threads exist, the wait points behave as usual.
+ */
+
+#ifndef __THREAD_H
+#define __THREAD_H
+
+struct thread;
+struct udevice;
+
+/* Waits shorter than this do not switch threads */
+#define THREAD_WAIT_MIN_US	100
+
+#if CONFIG_IS_ENABLED(THREAD)
+
+/**
+ * thread_create() - Create a new thread
+ *
+ * The thread is runnable straight away, but first runs when the current
+ * thread reaches a wait point.
+ *
+ * @name:	Name of the thread, for debugging (must remain valid)
+ * @func:	Function to run in the thread. Its return value is returned
+ *		by thread_join()
+ * @arg:	Argument to pass to @func
+ * @return new thread, or NULL if out of memory or called before relocation
+ */
+struct thread *thread_create(const char *name, int (*func)(void *arg),
+			     void *arg);
+
+/**
+ * thread_run_others() - Let other threads run, even from the main thread
+ *
+ * Each other runnable thread runs until it reaches a wait point or finishes.
+ * The main thread can use this to let new threads start their hardware waits
+ * before it carries on.
+ */
+void thread_run_others(void);
+
+/**
+ * thread_yield() - Let other threads run
+ *
+ * This returns once all other runnable threads have had a turn. It returns
+ * immediately if there are no other threads, or if called from the main
+ * thread.
+ */
+void thread_yield(void);
+
+/**
+ * thread_wait_us() - Let other threads run while waiting
+ *
+ * This yields until @usec microseconds have passed or there are no other
+ * threads left. In the main thread it does nothing.
+ *
+ * @usec:	Number of microseconds to wait
+ * @return number of microseconds still to wait, which the caller must
+ *	spend itself
+ */
+ulong thread_wait_us(ulong usec);
+
+/**
+ * thread_join() - Wait for a thread to finish and free it
+ *
+ * @thread:	Thread to wait for
+ * @return value returned by the thread's function
+ */
+int thread_join(struct thread *thread);
+
+/**
+ * thread_join_all() - Wait for all threads to finish and free them
+ *
+ * This must only be called from the main thread.
+ *
+ * @return 0 if all threads returned 0, else the first non-zero value
+ */
+int thread_join_all(void);
+
+/**
+ * thread_claim() - Claim an object for the current thread
+ *
+ * This first waits until no other thread has claimed @obj, so that two
+ * threads never use it at once. The object may be a device being probed or
+ * a bus with a transfer in progress. Claims nest and must be paired with
+ * thread_release().
+ *
+ * @obj:	Object to claim
+ */
+void thread_claim(const void *obj);
+
+/**
+ * thread_release() - Release an object claimed by the current thread
+ *
+ * @obj:	Object which was passed to thread_claim()
+ */
+void thread_release(const void *obj);
+
+#else
+
+static inline void thread_run_others(void)
+{
+}
+
+static inline void thread_yield(void)
+{
+}
+
+static inline ulong thread_wait_us(ulong usec)
+{
+	return usec;
+}
+
+static inline int thread_join_all(void)
+{
+	return 0;
+}
+
+static inline void thread_claim(const void *obj)
+{
+}
+
+static inline void thread_release(const void *obj)
+{
+}
+
+#endif /* THREAD */
+
+/**
+ * thread_probe_start() - Note that the current thread is probing a device
+ *
+ * This waits until no other thread is probing @dev, so that a device is
+ * never probed by two threads at once. It must be paired with
+ * thread_probe_end().
+ *
+ * @dev:	Device about to be probed
+ */
+static inline void thread_probe_start(struct udevice *dev)
+{
+	thread_claim(dev);
+}
+
+/**
+ * thread_probe_end() - Note that the current thread has finished a probe
+ *
+ * @dev:	Device which was passed to thread_probe_start()
+ */
+static inline void thread_probe_end(struct udevice *dev)
+{
+	thread_release(dev);
+}
+
+#endif
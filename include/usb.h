@@ -70,6 +70,8 @@ struct usb_interface {
 	 * Revision 1.0 June 6th 2011
 	 */
 	struct usb_ss_ep_comp_descriptor ss_ep_comp_desc[USB_MAXENDPOINTS];
+	/* Alternate setting which each entry of ep_desc belongs to */
+	__u8	ep_altsetting[USB_MAXENDPOINTS];
 } __attribute__ ((packed));
 
 /* Configuration information.. */
@@ -156,6 +158,25 @@ struct usb_device {
 
 struct int_queue;
 
+/**
+ * struct usb_bulk_req - one bulk transfer of a batch, see usb_bulk_batch()
+ *
+ * @pipe:	Bulk pipe to transfer on
+ * @stream_id:	Stream to transfer on, 0 if the endpoint has no streams
+ * @buffer:	Data to send / buffer to receive into
+ * @length:	Length of @buffer in bytes
+ * @act_len:	Returns the number of bytes transferred
+ * @status:	Returns the status of the transfer (USB_ST_...), 0 if OK
+ */
+struct usb_bulk_req {
+	unsigned long pipe;
+	unsigned int stream_id;
+	void *buffer;
+	int length;
+	int act_len;
+	unsigned long status;
+};
+
 /*
  * You can initialize platform's USB host or device
  * ports by passing this enum as an argument to
@@ -185,6 +206,13 @@ int submit_control_msg(struct usb_device *dev, unsigned long pipe, void *buffer,
 			int transfer_len, struct devrequest *setup);
 int submit_int_msg(struct usb_device *dev, unsigned long pipe, void *buffer,
 			int transfer_len, int interval);
+#if CONFIG_IS_ENABLED(DM_USB)
+int submit_bulk_stream_msg(struct usb_device *dev, unsigned long pipe,
+			   unsigned int stream_id, void *buffer,
+			   int transfer_len);
+int submit_bulk_batch(struct usb_device *dev, struct usb_bulk_req *reqs,
+		      int count);
+#endif
 
 #if defined CONFIG_USB_EHCI_HCD || defined CONFIG_USB_MUSB_HOST \
 	|| CONFIG_IS_ENABLED(DM_USB)
@@ -649,6 +677,7 @@ struct usb_bus_priv {
 	int next_addr;
 	bool desc_before_addr;
 	bool companion;
+	int scan_ret;		/* result of scanning the root hub */
 };
 
 /**
@@ -785,6 +814,49 @@ struct dm_usb_ops {
 	 * in a USB transfer. USB class driver needs to be aware of this.
 	 */
 	int (*get_max_xfer_size)(struct udevice *bus, size_t *size);
+
+	/**
+	 * alloc_streams() - Allocate bulk streams on a set of endpoints
+	 *
+	 * USB 3.0 bulk endpoints can multiplex several transfers onto one
+	 * endpoint by tagging them with a stream ID (used by UAS). Stream
+	 * ID 0 is reserved.
+	 *
+	 * @pipes: Pipes of the endpoints which should get streams
+	 * @num_pipes: Number of pipes in @pipes
+	 * @num_streams: Number of stream IDs wanted, starting at 1
+	 * @return number of stream IDs set up (which may be fewer than
+	 * requested), or -ve on error
+	 */
+	int (*alloc_streams)(struct udevice *bus, struct usb_device *udev,
+			     unsigned long *pipes, int num_pipes,
+			     int num_streams);
+
+	/**
+	 * bulk_stream() - Send a bulk message on a stream
+	 *
+	 * This is the same as bulk() but for an endpoint set up with
+	 * alloc_streams().
+	 */
+	int (*bulk_stream)(struct udevice *bus, struct usb_device *udev,
+			   unsigned long pipe, unsigned int stream_id,
+			   void *buffer, int length);
+
+	/**
+	 * bulk_batch() - Send several bulk messages at once
+	 *
+	 * All the requests are queued before waiting for any of them, so
+	 * that the controller can work through them back to back. Requests
+	 * on the same endpoint (and stream) are carried out in order. This
+	 * waits until all the requests are done.
+	 *
+	 * @reqs: Requests to send, whose @act_len and @status are filled in
+	 * @count: Number of requests in @reqs
+	 * @return 0 if all requests were handled (each may still have
+	 * failed, see its @status), -ve on error
+	 */
+	int (*bulk_batch)(struct udevice *bus, struct usb_device *udev,
+			  struct usb_bulk_req *reqs, int count);
 };
 
 #define usb_get_ops(dev)	((struct dm_usb_ops *)(dev)->driver->ops)
@@ -923,6 +995,25 @@ bool usb_device_has_child_on_port(struct usb_device *parent, int port);
 int usb_hub_probe(struct usb_device *dev, int ifnum);
 void usb_hub_reset(void);
 
+/**
+ * usb_hub_scan_start() - Start collecting hub ports to scan
+ *
+ * Until usb_hub_scan_finish() is called, hubs which are configured power up
+ * their ports and queue them for scanning, but do not scan them yet. This
+ * lets the hubs of several controllers share one power-good delay and
+ * connect timeout.
+ */
+void usb_hub_scan_start(void);
+
+/**
+ * usb_hub_scan_finish() - Scan all hub ports queued since usb_hub_scan_start()
+ *
+ * This includes the ports of any hubs found along the way.
+ *
+ * @return 0 if OK, -ve on error
+ */
+int usb_hub_scan_finish(void);
+
 /*
  * usb_find_usb2_hub_address_port() - Get hub address and port for TT setting
  *
@@ -980,6 +1071,59 @@ int usb_update_hub_device(struct usb_device *dev);
  */
 int usb_get_max_xfer_size(struct usb_device *dev, size_t *size);
 
+/**
+ * usb_alloc_streams() - Allocate bulk streams on a set of endpoints
+ *
+ * Sets up stream IDs 1..n on each of the given bulk endpoints, so that
+ * usb_bulk_stream_msg() can be used on them.
+ *
+ * @dev:		USB device
+ * @pipes:		Pipes of the bulk endpoints to set up
+ * @num_pipes:		Number of pipes in @pipes
+ * @num_streams:	Number of stream IDs wanted
+ * @return number of stream IDs available (which may be fewer than
+ * requested), -ENOSYS if the HCD does not support streams, other -ve on error
+ */
+int usb_alloc_streams(struct usb_device *dev, unsigned long *pipes,
+		      int num_pipes, int num_streams);
+
+/**
+ * usb_bulk_stream_msg() - Send a bulk message on a stream
+ *
+ * This works like usb_bulk_msg() but queues the transfer on @stream_id of an
+ * endpoint set up with usb_alloc_streams().
+ *
+ * @dev:		USB device
+ * @pipe:		Bulk pipe
+ * @stream_id:		Stream ID, from 1
+ * @data:		Data to send / buffer to receive into
+ * @len:		Length of @data in bytes
+ * @actual_length:	Returns the number of bytes transferred
+ * @timeout:		Timeout in milliseconds
+ * @return 0 if OK, -ve on error
+ */
+int usb_bulk_stream_msg(struct usb_device *dev, unsigned int pipe,
+			unsigned int stream_id, void *data, int len,
+			int *actual_length, int timeout);
+
+/**
+ * usb_bulk_batch() - Send several bulk messages at once
+ *
+ * The requests are all handed to the HCD before waiting for any of them, if
+ * it supports that, otherwise they are sent one after the other. Requests on
+ * the same endpoint and stream are carried out in order and stop at the first
+ * one that fails; the ones not carried out are left with status
+ * USB_ST_NOT_PROC.
+ *
+ * @dev:		USB device
+ * @reqs:		Requests to send
+ * @count:		Number of requests in @reqs
+ * @timeout:		Timeout in milliseconds, for each request
+ * @return 0 if all requests succeeded, -ve on error
+ */
+int usb_bulk_batch(struct usb_device *dev, struct usb_bulk_req *reqs,
+		   int count, int timeout);
+
 /**
  * usb_emul_setup_device() - Set up a new USB device emulation
  *
@@ -45,6 +45,7 @@
 #define US_PR_CB               1		/* Control/Bulk w/o interrupt */
 #define US_PR_CBI              0		/* Control/Bulk/Interrupt */
 #define US_PR_BULK             0x50		/* bulk only */
+#define US_PR_UAS              0x62		/* USB Attached SCSI */
 
 /* USB types */
 #define USB_TYPE_STANDARD   (0x00 << 5)
@@ -362,4 +363,85 @@ struct umass_bbb_csw {
 #define US_BBB_RESET		0xff
 #define US_BBB_GET_MAX_LUN	0xfe
 
+/*
+ * USB Attached SCSI (UAS)
+ */
+
+/* Pipe usage descriptor, follows each endpoint descriptor of a UAS alt */
+struct usb_pipe_usage_descriptor {
+	__u8		bLength;
+	__u8		bDescriptorType;	/* USB_DT_PIPE_USAGE */
+	__u8		bPipeID;
+#	define UAS_CMD_PIPE_ID		1
+#	define UAS_STATUS_PIPE_ID	2
+#	define UAS_DATA_IN_PIPE_ID	3
+#	define UAS_DATA_OUT_PIPE_ID	4
+	__u8		Reserved;
+} __packed;
+
+/* Information unit IDs */
+#define UAS_IU_ID_COMMAND	0x01
+#define UAS_IU_ID_STATUS	0x03
+#define UAS_IU_ID_RESPONSE	0x04
+#define UAS_IU_ID_TASK_MGMT	0x05
+#define UAS_IU_ID_READ_READY	0x06
+#define UAS_IU_ID_WRITE_READY	0x07
+
+/* Command IU, sent on the command pipe */
+struct uas_command_iu {
+	__u8		iu_id;
+	__u8		rsvd1;
+	__be16		tag;
+	__u8		prio_attr;
+#	define UAS_SIMPLE_TAG	0
+	__u8		rsvd5;
+	__u8		len;		/* additional CDB bytes beyond 16, in dwords */
+	__u8		rsvd7;
+	__u8		lun[8];
+	__u8		cdb[16];
+} __packed;
+
+/* Common header of the IUs returned on the status pipe */
+struct uas_iu {
+	__u8		iu_id;
+	__u8		rsvd1;
+	__be16		tag;
+} __packed;
+
+/* Sense IU, completes a command */
+struct uas_sense_iu {
+	__u8		iu_id;
+	__u8		rsvd1;
+	__be16		tag;
+	__be16		status_qual;
+	__u8		status;
+	__u8		rsvd7[7];
+	__be16		len;
+	__u8		sense[96];
+} __packed;
+#define UAS_SENSE_IU_HDR_SIZE	16
+
+/* Task management IU, sent on the command pipe */
+struct uas_task_mgmt_iu {
+	__u8		iu_id;
+	__u8		rsvd1;
+	__be16		tag;
+	__u8		function;
+#	define UAS_TMF_LUN_RESET	0x08
+	__u8		rsvd5;
+	__be16		task_tag;
+	__u8		lun[8];
+} __packed;
+
+/* Response IU, completes a task management function */
+struct uas_response_iu {
+	__u8		iu_id;
+	__u8		rsvd1;
+	__be16		tag;
+	__u8		add_response_info[3];
+	__u8		response_code;
+#	define UAS_RC_TMF_COMPLETE	0x00
+#	define UAS_RC_TMF_SUCCEEDED	0x08
+} __packed;
+
 #endif /*_USB_DEFS_H_ */
@@ -73,6 +73,9 @@
  */
 #define VIRTIO_F_IOMMU_PLATFORM		33
 
+/* This feature indicates support for the packed virtqueue layout */
+#define VIRTIO_F_RING_PACKED		34
+
 /* Does the device support Single Root I/O Virtualization? */
 #define VIRTIO_F_SR_IOV			37
 
@@ -43,6 +43,30 @@
  */
 #define VIRTIO_RING_F_EVENT_IDX		29
 
+/*
+ * Mark a descriptor as available or used in packed ring.
+ * Notice: they are defined as shifts instead of shifted values.
+ */
+#define VRING_PACKED_DESC_F_AVAIL	7
+#define VRING_PACKED_DESC_F_USED	15
+
+/* Enable events in packed ring */
+#define VRING_PACKED_EVENT_FLAG_ENABLE	0x0
+/* Disable events in packed ring */
+#define VRING_PACKED_EVENT_FLAG_DISABLE	0x1
+/*
+ * Enable events for a specific descriptor in packed ring.
+ * (as specified by Descriptor Ring Change Event Offset/Wrap Counter).
+ * Only valid if VIRTIO_RING_F_EVENT_IDX has been negotiated.
+ */
+#define VRING_PACKED_EVENT_FLAG_DESC	0x2
+
+/*
+ * Wrap counter bit shift in event suppression structure
+ * of packed ring.
+ */
+#define VRING_PACKED_EVENT_F_WRAP_CTR	15
+
 /* Virtio ring descriptors: 16 bytes. These can chain together via "next". */
 struct vring_desc {
 	/* Address (guest-physical) */
@@ -81,6 +105,48 @@ struct vring {
 	struct vring_used *used;
 };
 
+struct vring_packed_desc_event {
+	/* Descriptor Ring Change Event Offset/Wrap Counter */
+	__le16 off_wrap;
+	/* Descriptor Ring Change Event Flags */
+	__le16 flags;
+};
+
+struct vring_packed_desc {
+	/* Buffer Address */
+	__le64 addr;
+	/* Buffer Length */
+	__le32 len;
+	/* Buffer ID */
+	__le16 id;
+	/* The flags depending on descriptor type */
+	__le16 flags;
+};
+
+struct vring_packed {
+	unsigned int num;
+	struct vring_packed_desc *desc;
+	struct vring_packed_desc_event *driver;
+	struct vring_packed_desc_event *device;
+};
+
+/**
+ * vring_desc_state - per-buffer bookkeeping of a virtqueue
+ *
+ * @data: the buffer address handed back by virtqueue_get_buf()
+ * @indir_desc: the indirect descriptor table, or NULL if not indirect
+ * @num: number of ring descriptors used by the buffer (packed ring only)
+ * @next: next free buffer id (packed ring only)
+ * @last: last ring descriptor of the buffer (packed ring only)
+ */
+struct vring_desc_state {
+	void *data;
+	void *indir_desc;
+	u16 num;
+	u16 next;
+	u16 last;
+};
+
 /**
  * virtqueue - a queue to register buffers for sending or receiving.
  *
@@ -88,13 +154,21 @@ struct vring {
  * @vdev: the virtio device this queue was created for
  * @index: the zero-based ordinal number for this queue
  * @num_free: number of elements we expect to be able to fit
- * @vring: actual memory layout for this queue
+ * @vring: actual memory layout for this queue (split ring)
+ * @vring_packed: actual memory layout for this queue (packed ring)
+ * @packed: is this a packed ring?
+ * @indirect: can we use indirect descriptors?
  * @event: host publishes avail event idx
+ * @desc_state: per-buffer state, indexed by head (split) or id (packed)
  * @free_head: head of free buffer list
  * @num_added: number we've added since last sync
  * @last_used_idx: last used index we've seen
  * @avail_flags_shadow: last written value to avail->flags
  * @avail_idx_shadow: last written value to avail->idx in guest byte order
+ * @next_avail_idx: next descriptor slot to fill in (packed ring only)
+ * @avail_wrap_counter: driver ring wrap counter (packed ring only)
+ * @used_wrap_counter: device ring wrap counter (packed ring only)
+ * @avail_used_flags: avail/used flags of the current wrap (packed ring only)
  */
 struct virtqueue {
 	struct list_head list;
@@ -102,12 +176,20 @@ struct virtqueue {
 	unsigned int index;
 	unsigned int num_free;
 	struct vring vring;
+	struct vring_packed vring_packed;
+	bool packed;
+	bool indirect;
 	bool event;
+	struct vring_desc_state *desc_state;
 	unsigned int free_head;
 	unsigned int num_added;
 	u16 last_used_idx;
 	u16 avail_flags_shadow;
 	u16 avail_idx_shadow;
+	u16 next_avail_idx;
+	bool avail_wrap_counter;
+	bool used_wrap_counter;
+	u16 avail_used_flags;
 };
 
 /*
@@ -142,6 +224,25 @@ static inline unsigned int vring_size(unsigned int num, unsigned long align)
 		sizeof(__virtio16) * 3 + sizeof(struct vring_used_elem) * num;
 }
 
+/*
+ * The packed ring is laid out as the descriptor ring followed by the
+ * driver and device event suppression areas, all in a single chunk.
+ */
+static inline void vring_packed_init(struct vring_packed *vr, unsigned int num,
+				     void *p)
+{
+	vr->num = num;
+	vr->desc = p;
+	vr->driver = p + num * sizeof(struct vring_packed_desc);
+	vr->device = (void *)vr->driver + sizeof(struct vring_packed_desc_event);
+}
+
+static inline unsigned int vring_packed_size(unsigned int num)
+{
+	return sizeof(struct vring_packed_desc) * num +
+	       sizeof(struct vring_packed_desc_event) * 2;
+}
+
 /*
  * The following is used with USED_EVENT_IDX and AVAIL_EVENT_IDX.
  * Assuming a given event_idx value from the other side, if we have just
@@ -223,6 +324,12 @@ void *virtqueue_get_buf(struct virtqueue *vq, unsigned int *len);
  * device. The caller should query virtqueue_get_ring_size() to learn the
  * actual size of the ring.
  *
+ * A packed ring is created if VIRTIO_F_RING_PACKED has been negotiated,
+ * otherwise a split ring is created. In the packed case the avail and used
+ * addresses returned by virtqueue_get_avail_addr() and
+ * virtqueue_get_used_addr() are those of the driver and device event
+ * suppression areas.
+ *
  * This API is supposed to be called by the virtio transport driver in the
  * virtio find_vqs() uclass method.
  */
@@ -10,6 +10,7 @@
 
 #include <common.h>
 #include <console.h>
+#include <thread.h>
 #include <watchdog.h>
 #include <linux/errno.h>
 #include <asm/io.h>
@@ -62,6 +63,7 @@ static inline int wait_for_bit_##sfx(const void *reg,			\
 									\
 		udelay(1);						\
 		WATCHDOG_RESET();					\
+		thread_yield();						\
 	}								\
 									\
 	debug("%s: Timeout (reg=%p mask=%x wait_set=%i)\n", __func__,	\
@@ -11,10 +11,12 @@
 #include <errno.h>
 #include <fdtdec.h>
 #include <fdt_support.h>
+#include <malloc.h>
 #include <linux/libfdt.h>
 #include <serial.h>
 #include <asm/sections.h>
 #include <linux/ctype.h>
+#include <linux/log2.h>
 #include <linux/lzo.h>
 
 DECLARE_GLOBAL_DATA_PTR;
@@ -616,6 +618,57 @@ int fdtdec_prepare_fdt(void)
 	return 0;
 }
 
+/*
+ * Node offsets indexed by phandle & phandle_cache_mask, for phandle_cache_blob,
+ * with -1 for an empty slot
+ */
+static const void *phandle_cache_blob;
+static int *phandle_cache;
+static uint phandle_cache_mask;
+
+static void fdtdec_phandle_cache_init(const void *blob)
+{
+	uint32_t max = fdt_get_max_phandle(blob);
+
+	free(phandle_cache);
+	phandle_cache_blob = blob;
+
+	/* Phandles are usually numbered from 1, so give each its own slot */
+	if (max == (uint32_t)-1 || max > 1023)
+		max = 1023;
+	phandle_cache_mask = roundup_pow_of_two(max + 1) - 1;
+	phandle_cache = malloc((phandle_cache_mask + 1) * sizeof(int));
+	if (phandle_cache)
+		memset(phandle_cache, 0xff,
+		       (phandle_cache_mask + 1) * sizeof(int));
+}
+
+int fdtdec_node_offset_by_phandle(const void *blob, uint32_t phandle)
+{
+	int *slot;
+	int node;
+
+	/* BSS and enough malloc() space are only available after relocation */
+	if (!(gd->flags & GD_FLG_RELOC) || !phandle || phandle == -1)
+		return fdt_node_offset_by_phandle(blob, phandle);
+
+	if (blob != phandle_cache_blob)
+		fdtdec_phandle_cache_init(blob);
+	if (!phandle_cache)
+		return fdt_node_offset_by_phandle(blob, phandle);
+
+	/* The tree may have changed since the offset was recorded */
+	slot = &phandle_cache[phandle & phandle_cache_mask];
+	if (*slot >= 0 && fdt_get_phandle(blob, *slot) == phandle)
+		return *slot;
+
+	node = fdt_node_offset_by_phandle(blob, phandle);
+	if (node >= 0)
+		*slot = node;
+
+	return node;
+}
+
 int fdtdec_lookup_phandle(const void *blob, int node, const char *prop_name)
 {
 	const u32 *phandle;
@@ -626,7 +679,7 @@ int fdtdec_lookup_phandle(const void *blob, int node, const char *prop_name)
 	if (!phandle)
 		return -FDT_ERR_NOTFOUND;
 
-	lookup = fdt_node_offset_by_phandle(blob, fdt32_to_cpu(*phandle));
+	lookup = fdtdec_node_offset_by_phandle(blob, fdt32_to_cpu(*phandle));
 	return lookup;
 }
 
@@ -757,8 +810,8 @@ int fdtdec_parse_phandle_with_args(const void *blob, int src_node,
 			 * below.
 			 */
 			if (cells_name || cur_index == index) {
-				node = fdt_node_offset_by_phandle(blob,
-								  phandle);
+				node = fdtdec_node_offset_by_phandle(blob,
+								     phandle);
 				if (!node) {
 					debug("%s: could not find phandle\n",
 					      fdt_get_name(blob, src_node,
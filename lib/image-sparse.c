@@ -38,6 +38,7 @@
 #include <common.h>
 #include <image-sparse.h>
 #include <div64.h>
+#include <asm/unaligned.h>
 #include <malloc.h>
 #include <part.h>
 #include <sparse_format.h>
@@ -46,6 +47,68 @@
 
 static void default_log(const char *ignored, char *response) {}
 
+/*
+ * Write blkcnt blocks of fill_val starting at blk. Returns the number of
+ * blocks consumed on the device (which may exceed blkcnt, e.g. NAND bad
+ * blocks) or -1 on error.
+ */
+static long write_sparse_fill(struct sparse_storage *info, lbaint_t blk,
+			      lbaint_t blkcnt, uint32_t fill_val,
+			      char *response)
+{
+	int fill_buf_num_blks;
+	uint32_t *fill_buf;
+	lbaint_t start = blk;
+	lbaint_t blks;
+	int i;
+	int j;
+
+	if (blk + blkcnt > info->start + info->size) {
+		printf("%s: Request would exceed partition size!\n", __func__);
+		info->mssg("Request would exceed partition size!", response);
+		return -1;
+	}
+
+	/* Let the device zero the range itself if it can */
+	if (!fill_val && info->write_zeroes &&
+	    info->write_zeroes(info, blk, blkcnt) == blkcnt)
+		return blkcnt;
+
+	fill_buf_num_blks = CONFIG_IMAGE_SPARSE_FILLBUF_SIZE / info->blksz;
+	fill_buf = (uint32_t *)
+		   memalign(ARCH_DMA_MINALIGN,
+			    ROUNDUP(info->blksz * fill_buf_num_blks,
+				    ARCH_DMA_MINALIGN));
+	if (!fill_buf) {
+		info->mssg("Malloc failed for: CHUNK_TYPE_FILL", response);
+		return -1;
+	}
+
+	for (i = 0; i < (info->blksz * fill_buf_num_blks / sizeof(fill_val));
+	     i++)
+		fill_buf[i] = fill_val;
+
+	for (i = 0; i < blkcnt;) {
+		j = blkcnt - i;
+		if (j > fill_buf_num_blks)
+			j = fill_buf_num_blks;
+		blks = info->write(info, blk, j, fill_buf);
+		/* blks might be > j (eg. NAND bad-blocks) */
+		if (blks < j) {
+			printf("%s: %s " LBAFU " [%d]\n", __func__,
+			       "Write failed, block #", blk, j);
+			info->mssg("flash write failure", response);
+			free(fill_buf);
+			return -1;
+		}
+		blk += blks;
+		i += j;
+	}
+	free(fill_buf);
+
+	return blk - start;
+}
+
 int write_sparse_image(struct sparse_storage *info,
 		       const char *part_name, void *data, char *response)
 {
@@ -56,16 +119,11 @@ int write_sparse_image(struct sparse_storage *info,
 	unsigned int chunk;
 	unsigned int offset;
 	unsigned int chunk_data_sz;
-	uint32_t *fill_buf = NULL;
 	uint32_t fill_val;
+	long fill_blks;
 	sparse_header_t *sparse_header;
 	chunk_header_t *chunk_header;
 	uint32_t total_blocks = 0;
-	int fill_buf_num_blks;
-	int i;
-	int j;
-
-	fill_buf_num_blks = CONFIG_IMAGE_SPARSE_FILLBUF_SIZE / info->blksz;
 
 	/* Read and skip over sparse image header */
 	sparse_header = (sparse_header_t *)data;
@@ -171,57 +229,16 @@ int write_sparse_image(struct sparse_storage *info,
 				return -1;
 			}
 
-			fill_buf = (uint32_t *)
-				   memalign(ARCH_DMA_MINALIGN,
-					    ROUNDUP(
-						info->blksz * fill_buf_num_blks,
-						ARCH_DMA_MINALIGN));
-			if (!fill_buf) {
-				info->mssg("Malloc failed for: CHUNK_TYPE_FILL",
-					   response);
-				return -1;
-			}
-
 			fill_val = *(uint32_t *)data;
 			data = (char *)data + sizeof(uint32_t);
 
-			for (i = 0;
-			     i < (info->blksz * fill_buf_num_blks /
-				  sizeof(fill_val));
-			     i++)
-				fill_buf[i] = fill_val;
-
-			if (blk + blkcnt > info->start + info->size) {
-				printf(
-				    "%s: Request would exceed partition size!\n",
-				    __func__);
-				info->mssg("Request would exceed partition size!",
-					   response);
+			fill_blks = write_sparse_fill(info, blk, blkcnt,
+						      fill_val, response);
+			if (fill_blks < 0)
 				return -1;
-			}
-
-			for (i = 0; i < blkcnt;) {
-				j = blkcnt - i;
-				if (j > fill_buf_num_blks)
-					j = fill_buf_num_blks;
-				blks = info->write(info, blk, j, fill_buf);
-				/* blks might be > j (eg. NAND bad-blocks) */
-				if (blks < j) {
-					printf("%s: %s " LBAFU " [%d]\n",
-					       __func__,
-					       "Write failed, block #",
-					       blk, j);
-					info->mssg("flash write failure",
-						   response);
-					free(fill_buf);
-					return -1;
-				}
-				blk += blks;
-				i += j;
-			}
+			blk += fill_blks;
 			bytes_written += blkcnt * info->blksz;
 			total_blocks += chunk_data_sz / sparse_header->blk_sz;
-			free(fill_buf);
 			break;
 
 		case CHUNK_TYPE_DONT_CARE:
@@ -259,3 +276,255 @@ int write_sparse_image(struct sparse_storage *info,
 
 	return 0;
 }
+
+void sparse_stream_init(struct sparse_stream *stream,
+			struct sparse_storage *info)
+{
+	memset(stream, 0, sizeof(*stream));
+	stream->info = info;
+	stream->blk = info->start;
+	if (!info->mssg)
+		info->mssg = default_log;
+}
+
+static long sparse_stream_write_raw(struct sparse_stream *stream, void *data,
+				    u32 len, bool last, char *response)
+{
+	struct sparse_storage *info = stream->info;
+	lbaint_t blkcnt = len / info->blksz;
+	void *pad_buf = NULL;
+	lbaint_t blks;
+
+	/* the tail of the image is padded to a whole block */
+	if (last && len % info->blksz) {
+		pad_buf = memalign(ARCH_DMA_MINALIGN,
+				   ROUNDUP(info->blksz, ARCH_DMA_MINALIGN));
+		if (!pad_buf) {
+			info->mssg("Malloc failed for the last block",
+				   response);
+			return -1;
+		}
+		memset(pad_buf, 0, info->blksz);
+		memcpy(pad_buf, data + blkcnt * info->blksz,
+		       len % info->blksz);
+	}
+
+	if (stream->blk + blkcnt + !!pad_buf > info->start + info->size) {
+		printf("%s: Request would exceed partition size!\n", __func__);
+		info->mssg("Request would exceed partition size!", response);
+		free(pad_buf);
+		return -1;
+	}
+
+	if (blkcnt) {
+		blks = info->write(info, stream->blk, blkcnt, data);
+		if (blks < blkcnt)
+			goto err;
+		stream->blk += blks;
+	}
+	if (pad_buf) {
+		blks = info->write(info, stream->blk, 1, pad_buf);
+		if (blks < 1)
+			goto err;
+		stream->blk += blks;
+		free(pad_buf);
+		blkcnt++;
+	}
+	stream->bytes_written += blkcnt * info->blksz;
+
+	return pad_buf ? len : blkcnt * info->blksz;
+
+err:
+	printf("%s: Write failed, block #" LBAFU "\n", __func__, stream->blk);
+	info->mssg("flash write failure", response);
+	free(pad_buf);
+	return -1;
+}
+
+long sparse_stream_write(struct sparse_stream *stream, void *data, u32 len,
+			 bool last, char *response)
+{
+	struct sparse_storage *info = stream->info;
+	sparse_header_t *sparse_header = &stream->header;
+	chunk_header_t *chunk_header;
+	void *start = data;
+	u64 chunk_data_sz;
+	lbaint_t blkcnt;
+	lbaint_t blks;
+	long fill_blks;
+	u32 n;
+
+	if (!stream->started) {
+		/* wait for enough data to tell a sparse image from a raw one */
+		if (len < sizeof(sparse_header_t) && !last)
+			return 0;
+		stream->started = true;
+		stream->sparse = len >= sizeof(sparse_header_t) &&
+				 is_sparse_image(data);
+		if (!stream->sparse) {
+			puts("Flashing Raw Image\n");
+		} else {
+			memcpy(sparse_header, data, sizeof(*sparse_header));
+			if (!sparse_header->blk_sz ||
+			    sparse_header->blk_sz % info->blksz ||
+			    sparse_header->file_hdr_sz <
+					sizeof(sparse_header_t) ||
+			    sparse_header->chunk_hdr_sz <
+					sizeof(chunk_header_t)) {
+				printf("%s: Sparse image block size issue [%u]\n",
+				       __func__, sparse_header->blk_sz);
+				info->mssg("sparse image block size issue",
+					   response);
+				return -1;
+			}
+			stream->skip = sparse_header->file_hdr_sz;
+			puts("Flashing Sparse Image\n");
+		}
+	}
+
+	if (!stream->sparse)
+		return sparse_stream_write_raw(stream, data, len, last,
+					       response);
+
+	while (len) {
+		/* header tail or chunk payload we have no use for */
+		if (stream->skip) {
+			n = min(stream->skip, len);
+			stream->skip -= n;
+			data += n;
+			len -= n;
+			continue;
+		}
+
+		/* data of a RAW chunk goes straight to the device */
+		if (stream->raw_left) {
+			n = min_t(u64, stream->raw_left, len);
+			blkcnt = n / info->blksz;
+			if (!blkcnt)
+				break;	/* wait for a whole block */
+			blks = info->write(info, stream->blk, blkcnt, data);
+			/* blks might be > blkcnt (eg. NAND bad-blocks) */
+			if (blks < blkcnt) {
+				printf("%s: %s" LBAFU " [" LBAFU "]\n",
+				       __func__, "Write failed, block #",
+				       stream->blk, blks);
+				info->mssg("flash write failure", response);
+				return -1;
+			}
+			n = blkcnt * info->blksz;
+			stream->blk += blks;
+			stream->bytes_written += n;
+			stream->raw_left -= n;
+			data += n;
+			len -= n;
+			continue;
+		}
+
+		if (stream->chunk == sparse_header->total_chunks)
+			break;
+
+		/* the whole chunk header is needed before going further */
+		if (len < sparse_header->chunk_hdr_sz)
+			break;
+		chunk_header = data;
+		chunk_data_sz = (u64)sparse_header->blk_sz *
+				chunk_header->chunk_sz;
+		blkcnt = chunk_data_sz / info->blksz;
+
+		switch (chunk_header->chunk_type) {
+		case CHUNK_TYPE_RAW:
+			if (chunk_header->total_sz !=
+			    (sparse_header->chunk_hdr_sz + chunk_data_sz)) {
+				info->mssg("Bogus chunk size for chunk type Raw",
+					   response);
+				return -1;
+			}
+			if (stream->blk + blkcnt > info->start + info->size) {
+				printf("%s: Request would exceed partition size!\n",
+				       __func__);
+				info->mssg("Request would exceed partition size!",
+					   response);
+				return -1;
+			}
+			stream->raw_left = chunk_data_sz;
+			n = sparse_header->chunk_hdr_sz;
+			break;
+
+		case CHUNK_TYPE_FILL:
+			if (chunk_header->total_sz !=
+			    (sparse_header->chunk_hdr_sz + sizeof(uint32_t))) {
+				info->mssg("Bogus chunk size for chunk type FILL",
+					   response);
+				return -1;
+			}
+			n = chunk_header->total_sz;
+			if (len < n)
+				return data - start;	/* need fill value */
+			fill_blks = write_sparse_fill(info, stream->blk, blkcnt,
+				get_unaligned((uint32_t *)(data +
+					sparse_header->chunk_hdr_sz)),
+				response);
+			if (fill_blks < 0)
+				return -1;
+			stream->blk += fill_blks;
+			stream->bytes_written += blkcnt * info->blksz;
+			break;
+
+		case CHUNK_TYPE_DONT_CARE:
+			stream->blk += info->reserve(info, stream->blk, blkcnt);
+			n = sparse_header->chunk_hdr_sz;
+			break;
+
+		case CHUNK_TYPE_CRC32:
+			if (chunk_header->total_sz <
+			    sparse_header->chunk_hdr_sz) {
+				info->mssg("Bogus chunk size for chunk type CRC32",
+					   response);
+				return -1;
+			}
+			/* the checksum itself is not verified */
+			stream->skip = chunk_header->total_sz -
+				       sparse_header->chunk_hdr_sz;
+			n = sparse_header->chunk_hdr_sz;
+			break;
+
+		default:
+			printf("%s: Unknown chunk type: %x\n", __func__,
+			       chunk_header->chunk_type);
+			info->mssg("Unknown chunk type", response);
+			return -1;
+		}
+
+		stream->total_blocks += chunk_header->chunk_sz;
+		stream->chunk++;
+		data += n;
+		len -= n;
+	}
+
+	return data - start;
+}
+
+int sparse_stream_finish(struct sparse_stream *stream, const char *part_name,
+			 char *response)
+{
+	struct sparse_storage *info = stream->info;
+
+	if (stream->sparse &&
+	    (stream->chunk != stream->header.total_chunks ||
+	     stream->raw_left || stream->skip)) {
+		printf("%s: Sparse image is truncated\n", __func__);
+		info->mssg("sparse image is truncated", response);
+		return -1;
+	}
+
+	printf("........ wrote %llu bytes to '%s'\n", stream->bytes_written,
+	       part_name);
+
+	if (stream->sparse &&
+	    stream->total_blocks != stream->header.total_blks) {
+		info->mssg("sparse image write failure", response);
+		return -1;
+	}
+
+	return 0;
+}
@@ -6,6 +6,7 @@
 #include <common.h>
 #include <initcall.h>
 #include <efi.h>
+#include <thread.h>
 
 DECLARE_GLOBAL_DATA_PTR;
 
@@ -34,6 +35,12 @@ int initcall_run_list(const init_fnc_t init_sequence[])
 			       (char *)*init_fnc_ptr - reloc_ofs, ret);
 			return -1;
 		}
+
+		/*
+		 * Between steps no bus transfer is half-done, so let any
+		 * threads carry on with their hardware waits
+		 */
+		thread_run_others();
 	}
 	return 0;
 }
@@ -27,24 +27,91 @@ static void *unflatten_dt_alloc(void **mem, unsigned long size,
 	return res;
 }
 
+/**
+ * unflatten_dt_size() - Work out the memory needed to unflatten a node
+ *
+ * This walks the tags of the flat tree directly, without looking at property
+ * names or values, so is much cheaper than unflattening. The result is an
+ * upper bound: space is always reserved for a "name" property, in case the
+ * node does not have one.
+ *
+ * @blob: The device tree blob
+ * @offset: Offset of the node in the flat tree
+ * @fpsize: Size of the node path up at the current depth (0 for the root)
+ * @sizep: Size needed so far, updated on exit
+ * @return offset of the tag after the end of the node, or -ve FDT error
+ */
+static int unflatten_dt_size(const void *blob, int offset,
+			     unsigned long fpsize, unsigned long *sizep)
+{
+	const char *pathp;
+	unsigned int allocl;
+	int nextoffset;
+	int l;
+
+	pathp = fdt_get_name(blob, offset, &l);
+	if (!pathp)
+		return l;
+	if (*pathp == '/') {
+		allocl = l + 1;
+	} else if (!fpsize) {
+		fpsize = 1;
+		allocl = 2;
+	} else {
+		fpsize += l + 1;
+		allocl = fpsize;
+	}
+	*sizep += ALIGN(sizeof(struct device_node) + allocl,
+			__alignof__(struct device_node));
+	*sizep += ALIGN(sizeof(struct property) + l + 1,
+			__alignof__(struct property));
+
+	fdt_next_tag(blob, offset, &nextoffset);
+	while (1) {
+		offset = nextoffset;
+		switch (fdt_next_tag(blob, offset, &nextoffset)) {
+		case FDT_PROP:
+			*sizep += ALIGN(sizeof(struct property),
+					__alignof__(struct property));
+			break;
+		case FDT_NOP:
+			break;
+		case FDT_BEGIN_NODE:
+			nextoffset = unflatten_dt_size(blob, offset, fpsize,
+						       sizep);
+			if (nextoffset < 0)
+				return nextoffset;
+			break;
+		case FDT_END_NODE:
+			return nextoffset;
+		default:
+			return nextoffset < 0 ? nextoffset :
+				-FDT_ERR_BADSTRUCTURE;
+		}
+	}
+}
+
 /**
  * unflatten_dt_node() - Alloc and populate a device_node from the flat tree
+ *
+ * Property names and values, and the "name" property where the node has no
+ * unit address, point into the flat tree rather than being copied, so the
+ * blob must remain in place for as long as the live tree is used.
+ *
  * @blob: The parent device tree blob
  * @mem: Memory chunk to use for allocating device nodes and properties
  * @poffset: pointer to node in flat tree
  * @dad: Parent struct device_node
  * @nodepp: The device_node tree created by the call
  * @fpsize: Size of the node path up at t05he current depth.
- * @dryrun: If true, do not allocate device nodes but still calculate needed
- * memory size
  */
 static void *unflatten_dt_node(const void *blob, void *mem, int *poffset,
 			       struct device_node *dad,
 			       struct device_node **nodepp,
-			       unsigned long fpsize, bool dryrun)
+			       unsigned long fpsize)
 {
 	const __be32 *p;
-	struct device_node *np;
+	struct device_node *np, *child, **next_child;
 	struct property *pp, **prev_pp = NULL;
 	const char *pathp;
 	int l;
@@ -54,10 +121,11 @@ static void *unflatten_dt_node(const void *blob, void *mem, int *poffset,
 	int offset;
 	int has_name = 0;
 	int new_format = 0;
+	char *fn;
 
 	pathp = fdt_get_name(blob, *poffset, &l);
 	if (!pathp)
-		return mem;
+		return NULL;
 
 	allocl = ++l;
 
@@ -92,35 +160,31 @@ static void *unflatten_dt_node(const void *blob, void *mem, int *poffset,
 
 	np = unflatten_dt_alloc(&mem, sizeof(struct device_node) + allocl,
 				__alignof__(struct device_node));
-	if (!dryrun) {
-		char *fn;
-
-		fn = (char *)np + sizeof(*np);
-		np->full_name = fn;
-		if (new_format) {
-			/* rebuild full path for new format */
-			if (dad && dad->parent) {
-				strcpy(fn, dad->full_name);
+	fn = (char *)np + sizeof(*np);
+	np->full_name = fn;
+	if (new_format) {
+		/* rebuild full path for new format */
+		if (dad && dad->parent) {
+			strcpy(fn, dad->full_name);
 #ifdef DEBUG
-				if ((strlen(fn) + l + 1) != allocl) {
-					debug("%s: p: %d, l: %d, a: %d\n",
-					      pathp, (int)strlen(fn), l,
-					      allocl);
-				}
-#endif
-				fn += strlen(fn);
+			if ((strlen(fn) + l + 1) != allocl) {
+				debug("%s: p: %d, l: %d, a: %d\n",
+				      pathp, (int)strlen(fn), l,
+				      allocl);
 			}
-			*(fn++) = '/';
-		}
-		memcpy(fn, pathp, l);
-
-		prev_pp = &np->properties;
-		if (dad != NULL) {
-			np->parent = dad;
-			np->sibling = dad->child;
-			dad->child = np;
+#endif
+			fn += strlen(fn);
 		}
+		*(fn++) = '/';
 	}
+	memcpy(fn, pathp, l);
+
+	prev_pp = &np->properties;
+	np->phandle = 0;
+	np->parent = dad;
+	np->child = NULL;
+	np->sibling = NULL;
+
 	/* process properties */
 	for (offset = fdt_first_property_offset(blob, *poffset);
 	     (offset >= 0);
@@ -142,30 +206,28 @@ static void *unflatten_dt_node(const void *blob, void *mem, int *poffset,
 			has_name = 1;
 		pp = unflatten_dt_alloc(&mem, sizeof(struct property),
 					__alignof__(struct property));
-		if (!dryrun) {
-			/*
-			 * We accept flattened tree phandles either in
-			 * ePAPR-style "phandle" properties, or the
-			 * legacy "linux,phandle" properties.  If both
-			 * appear and have different values, things
-			 * will get weird.  Don't do that. */
-			if ((strcmp(pname, "phandle") == 0) ||
-			    (strcmp(pname, "linux,phandle") == 0)) {
-				if (np->phandle == 0)
-					np->phandle = be32_to_cpup(p);
-			}
-			/*
-			 * And we process the "ibm,phandle" property
-			 * used in pSeries dynamic device tree
-			 * stuff */
-			if (strcmp(pname, "ibm,phandle") == 0)
+		/*
+		 * We accept flattened tree phandles either in
+		 * ePAPR-style "phandle" properties, or the
+		 * legacy "linux,phandle" properties.  If both
+		 * appear and have different values, things
+		 * will get weird.  Don't do that. */
+		if ((strcmp(pname, "phandle") == 0) ||
+		    (strcmp(pname, "linux,phandle") == 0)) {
+			if (np->phandle == 0)
 				np->phandle = be32_to_cpup(p);
-			pp->name = (char *)pname;
-			pp->length = sz;
-			pp->value = (__be32 *)p;
-			*prev_pp = pp;
-			prev_pp = &pp->next;
 		}
+		/*
+		 * And we process the "ibm,phandle" property
+		 * used in pSeries dynamic device tree
+		 * stuff */
+		if (strcmp(pname, "ibm,phandle") == 0)
+			np->phandle = be32_to_cpup(p);
+		pp->name = (char *)pname;
+		pp->length = sz;
+		pp->value = (__be32 *)p;
+		*prev_pp = pp;
+		prev_pp = &pp->next;
 	}
 	/*
 	 * with version 0x10 we may not have the name property, recreate
@@ -185,39 +247,48 @@ static void *unflatten_dt_node(const void *blob, void *mem, int *poffset,
 		if (pa < ps)
 			pa = p1;
 		sz = (pa - ps) + 1;
-		pp = unflatten_dt_alloc(&mem, sizeof(struct property) + sz,
-					__alignof__(struct property));
-		if (!dryrun) {
-			pp->name = "name";
-			pp->length = sz;
+		if (pa == p1) {
+			/* No unit address, so use the name in place */
+			pp = unflatten_dt_alloc(&mem, sizeof(struct property),
+						__alignof__(struct property));
+			pp->value = (void *)ps;
+		} else {
+			pp = unflatten_dt_alloc(&mem,
+						sizeof(struct property) + sz,
+						__alignof__(struct property));
 			pp->value = pp + 1;
-			*prev_pp = pp;
-			prev_pp = &pp->next;
 			memcpy(pp->value, ps, sz - 1);
 			((char *)pp->value)[sz - 1] = 0;
-			debug("fixed up name for %s -> %s\n", pathp,
-			      (char *)pp->value);
 		}
+		pp->name = "name";
+		pp->length = sz;
+		*prev_pp = pp;
+		prev_pp = &pp->next;
+		debug("fixed up name for %s -> %s\n", pathp,
+		      (char *)pp->value);
 	}
-	if (!dryrun) {
-		*prev_pp = NULL;
-		np->name = of_get_property(np, "name", NULL);
-		np->type = of_get_property(np, "device_type", NULL);
+	*prev_pp = NULL;
+	np->name = of_get_property(np, "name", NULL);
+	np->type = of_get_property(np, "device_type", NULL);
 
-		if (!np->name)
-			np->name = "<NULL>";
-		if (!np->type)
-			np->type = "<NULL>";	}
+	if (!np->name)
+		np->name = "<NULL>";
+	if (!np->type)
+		np->type = "<NULL>";
 
+	/* Add children at the tail, so that node order matches .dts order */
+	next_child = &np->child;
 	old_depth = depth;
 	*poffset = fdt_next_node(blob, *poffset, &depth);
 	if (depth < 0)
 		depth = 0;
 	while (*poffset > 0 && depth > old_depth) {
-		mem = unflatten_dt_node(blob, mem, poffset, np, NULL,
-					fpsize, dryrun);
+		mem = unflatten_dt_node(blob, mem, poffset, np, &child,
+					fpsize);
 		if (!mem)
 			return NULL;
+		*next_child = child;
+		next_child = &child->sibling;
 	}
 
 	if (*poffset < 0 && *poffset != -FDT_ERR_NOTFOUND) {
@@ -225,22 +296,6 @@ static void *unflatten_dt_node(const void *blob, void *mem, int *poffset,
 		return NULL;
 	}
 
-	/*
-	 * Reverse the child list. Some drivers assumes node order matches .dts
-	 * node order
-	 */
-	if (!dryrun && np->child) {
-		struct device_node *child = np->child;
-		np->child = NULL;
-		while (child) {
-			struct device_node *next = child->sibling;
-
-			child->sibling = np->child;
-			np->child = child;
-			child = next;
-		}
-	}
-
 	if (nodepp)
 		*nodepp = np;
 
@@ -261,9 +316,10 @@ static void *unflatten_dt_node(const void *blob, void *mem, int *poffset,
 static int unflatten_device_tree(const void *blob,
 				 struct device_node **mynodes)
 {
-	unsigned long size;
+	unsigned long size = 0;
+	void *mem, *end;
 	int start;
-	void *mem;
+	int ret;
 
 	debug(" -> unflatten_device_tree()\n");
 
@@ -282,28 +338,30 @@ static int unflatten_device_tree(const void *blob,
 		return -EINVAL;
 	}
 
-	/* First pass, scan for size */
-	start = 0;
-	size = (unsigned long)unflatten_dt_node(blob, NULL, &start, NULL, NULL,
-						0, true);
-	if (!size)
+	/* Scan the tags for the size, then unflatten in a single pass */
+	ret = unflatten_dt_size(blob, 0, 0, &size);
+	if (ret < 0) {
+		debug("unflatten: error %d sizing FDT\n", ret);
 		return -EFAULT;
+	}
 	size = ALIGN(size, 4);
 
 	debug("  size is %lx, allocating...\n", size);
 
 	/* Allocate memory for the expanded device tree */
 	mem = malloc(size + 4);
-	memset(mem, '\0', size);
+	if (!mem)
+		return -ENOMEM;
 
 	*(__be32 *)(mem + size) = cpu_to_be32(0xdeadbeef);
 
 	debug("  unflattening %p...\n", mem);
 
-	/* Second pass, do actual unflattening */
 	start = 0;
-	unflatten_dt_node(blob, mem, &start, NULL, mynodes, 0, false);
-	if (be32_to_cpup(mem + size) != 0xdeadbeef) {
+	end = unflatten_dt_node(blob, mem, &start, NULL, mynodes, 0);
+	if (!end)
+		return -EFAULT;
+	if (be32_to_cpup(mem + size) != 0xdeadbeef || end > mem + size) {
 		debug("End of tree marker overwritten: %08x\n",
 		      be32_to_cpup(mem + size));
 		return -ENOSPC;
@@ -324,6 +382,11 @@ int of_live_build(const void *fdt_blob, struct device_node **rootp)
 		debug("Failed to create live tree: err=%d\n", ret);
 		return ret;
 	}
+	ret = of_phandle_cache_build(*rootp);
+	if (ret) {
+		debug("Failed to create phandle cache: err=%d\n", ret);
+		return ret;
+	}
 	ret = of_alias_scan();
 	if (ret) {
 		debug("Failed to scan live tree aliases: err=%d\n", ret);
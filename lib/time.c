@@ -7,6 +7,7 @@
 #include <common.h>
 #include <dm.h>
 #include <errno.h>
+#include <thread.h>
 #include <timer.h>
 #include <watchdog.h>
 #include <div64.h>
@@ -163,6 +164,8 @@ void udelay(unsigned long usec)
 {
 	ulong kv;
 
+	/* Let other threads run during most of a long wait */
+	usec = thread_wait_us(usec);
 	do {
 		WATCHDOG_RESET();
 		kv = usec > CONFIG_WD_PERIOD ? CONFIG_WD_PERIOD : usec;
@@ -78,23 +78,132 @@ void arp_raw_request(struct in_addr source_ip, const uchar *target_ethaddr,
 	net_send_packet(arp_tx_packet, eth_hdr_size + ARP_HDR_SIZE);
 }
 
+/* Return the address whose MAC is needed to reach ip: itself or gateway */
+static struct in_addr arp_next_hop(struct in_addr ip)
+{
+	if ((ip.s_addr & net_netmask.s_addr) !=
+	    (net_ip.s_addr & net_netmask.s_addr) && net_gateway.s_addr)
+		return net_gateway;
+
+	return ip;
+}
+
 void arp_request(void)
 {
 	if ((net_arp_wait_packet_ip.s_addr & net_netmask.s_addr) !=
-	    (net_ip.s_addr & net_netmask.s_addr)) {
-		if (net_gateway.s_addr == 0) {
-			puts("## Warning: gatewayip needed but not set\n");
-			net_arp_wait_reply_ip = net_arp_wait_packet_ip;
-		} else {
-			net_arp_wait_reply_ip = net_gateway;
+	    (net_ip.s_addr & net_netmask.s_addr) && net_gateway.s_addr == 0)
+		puts("## Warning: gatewayip needed but not set\n");
+	net_arp_wait_reply_ip = arp_next_hop(net_arp_wait_packet_ip);
+
+	arp_raw_request(net_ip, net_null_ethaddr, net_arp_wait_reply_ip);
+}
+
+#ifdef CONFIG_NET_ARP_CACHE
+struct arp_cache_entry {
+	struct in_addr ip;	/* 0 if the entry is free */
+	uchar ethaddr[ARP_HLEN];
+	int dev_index;		/* Ethernet device the entry was learnt on */
+	ulong updated;		/* get_timer() value when last confirmed */
+	ulong used;		/* get_timer() value when last used, for LRU */
+};
+
+static struct arp_cache_entry arp_cache[CONFIG_NET_ARP_CACHE_SIZE];
+
+static struct arp_cache_entry *arp_cache_find(struct in_addr ip)
+{
+	int dev_index = eth_get_dev_index();
+	int i;
+
+	for (i = 0; i < CONFIG_NET_ARP_CACHE_SIZE; i++) {
+		struct arp_cache_entry *entry = &arp_cache[i];
+
+		if (entry->ip.s_addr != ip.s_addr ||
+		    entry->dev_index != dev_index)
+			continue;
+		if (get_timer(entry->updated) >
+		    CONFIG_NET_ARP_CACHE_TIMEOUT * 1000UL) {
+			/* too old to be trusted, ask again */
+			entry->ip.s_addr = 0;
+			return NULL;
 		}
-	} else {
-		net_arp_wait_reply_ip = net_arp_wait_packet_ip;
+		return entry;
 	}
 
-	arp_raw_request(net_ip, net_null_ethaddr, net_arp_wait_reply_ip);
+	return NULL;
+}
+
+static void arp_cache_update(struct in_addr ip, const uchar *ethaddr,
+			     bool create)
+{
+	struct arp_cache_entry *entry;
+	int i;
+
+	entry = arp_cache_find(ip);
+	if (!entry) {
+		if (!create)
+			return;
+		/* take a free entry, or else recycle the least recently used */
+		entry = &arp_cache[0];
+		for (i = 0; i < CONFIG_NET_ARP_CACHE_SIZE; i++) {
+			if (!arp_cache[i].ip.s_addr) {
+				entry = &arp_cache[i];
+				break;
+			}
+			if ((long)(arp_cache[i].used - entry->used) < 0)
+				entry = &arp_cache[i];
+		}
+		entry->ip = ip;
+		entry->dev_index = eth_get_dev_index();
+		entry->used = get_timer(0);
+	}
+
+	debug_cond(DEBUG_DEV_PKT, "ARP cache: %pI4 is at %pM\n", &ip, ethaddr);
+	memcpy(entry->ethaddr, ethaddr, ARP_HLEN);
+	entry->updated = get_timer(0);
 }
 
+bool arp_cache_lookup(struct in_addr ip, uchar *ethaddr)
+{
+	struct arp_cache_entry *entry;
+
+	entry = arp_cache_find(arp_next_hop(ip));
+	if (!entry)
+		return false;
+
+	entry->used = get_timer(0);
+	memcpy(ethaddr, entry->ethaddr, ARP_HLEN);
+
+	return true;
+}
+
+void arp_cache_flush(void)
+{
+	memset(arp_cache, 0, sizeof(arp_cache));
+}
+
+/*
+ * Learn from any ARP packet we see. Hosts asking for or answering to us
+ * get an entry; for anything else (e.g. a gratuitous ARP announcing a
+ * new MAC address) only entries we already have are refreshed.
+ */
+static void arp_cache_learn(struct arp_hdr *arp)
+{
+	struct in_addr sender_ip = net_read_ip(&arp->ar_spa);
+	struct in_addr target_ip = net_read_ip(&arp->ar_tpa);
+
+	if (!sender_ip.s_addr || sender_ip.s_addr == net_ip.s_addr ||
+	    !is_valid_ethaddr(&arp->ar_sha))
+		return;
+
+	arp_cache_update(sender_ip, &arp->ar_sha,
+			 target_ip.s_addr == net_ip.s_addr);
+}
+#else
+static inline void arp_cache_learn(struct arp_hdr *arp)
+{
+}
+#endif
+
 int arp_timeout_check(void)
 {
 	ulong t;
@@ -155,6 +264,8 @@ void arp_receive(struct ethernet_hdr *et, struct ip_udp_hdr *ip, int len)
 	if (net_ip.s_addr == 0)
 		return;
 
+	arp_cache_learn(arp);
+
 	if (net_read_ip(&arp->ar_tpa).s_addr != net_ip.s_addr)
 		return;
 
@@ -24,17 +24,42 @@ struct __packed fastboot_header {
 	unsigned short seq;
 };
 
+/*
+ * Largest packet we accept, announced to the host in the INIT reply. Bigger
+ * packets mean fewer round trips during downloads, but exceed the Ethernet
+ * MTU and so need IP fragments to be reassembled.
+ */
+#if defined(CONFIG_IP_DEFRAG) && (!defined(CONFIG_NET_MAXDEFRAG) || \
+	CONFIG_NET_MAXDEFRAG >= 8192 + 64)
+#define PACKET_SIZE 8192
+#else
 #define PACKET_SIZE 1024
+#endif
 #define DATA_SIZE (PACKET_SIZE - sizeof(struct fastboot_header))
+/* Our packets only ever carry a response */
+#define TX_PACKET_SIZE (sizeof(struct fastboot_header) + FASTBOOT_RESPONSE_LEN)
+
+#define WINDOW CONFIG_UDP_FASTBOOT_WINDOW
 
 /* Sequence number sent for every packet */
 static unsigned short sequence_number = 1;
 static const unsigned short packet_size = PACKET_SIZE;
 static const unsigned short udp_version = 1;
 
-/* Keep track of last packet for resubmission */
-static uchar last_packet[PACKET_SIZE];
-static unsigned int last_packet_len;
+/* Packets received ahead of sequence_number, indexed by seq % WINDOW */
+static struct {
+	bool valid;
+	struct fastboot_header header;
+	unsigned int len;
+	uchar data[DATA_SIZE];
+} rx_window[WINDOW];
+
+/* Our last replies for resubmission, indexed by the request's seq % WINDOW */
+static struct {
+	unsigned short seq;
+	unsigned int len;
+	uchar data[TX_PACKET_SIZE];
+} tx_window[WINDOW];
 
 static struct in_addr fastboot_remote_ip;
 /* The UDP port at their end */
@@ -76,10 +101,6 @@ static void fastboot_udp_send_info(const char *msg)
 
 	len = packet - packet_base;
 
-	/* Save packet for retransmitting */
-	last_packet_len = len;
-	memcpy(last_packet, packet_base, last_packet_len);
-
 	net_send_udp_packet(net_server_ethaddr, fastboot_remote_ip,
 			    fastboot_remote_port, fastboot_our_port, len);
 }
@@ -129,6 +150,8 @@ static void fastboot_send(struct fastboot_header header, char *fastboot_data,
 	static int cmd = -1;
 	static bool pending_command;
 	char response[FASTBOOT_RESPONSE_LEN] = {0};
+	bool deferred_download = false;
+	unsigned int i;
 
 	/*
 	 * We will always be sending some sort of packet, so
@@ -137,12 +160,15 @@ static void fastboot_send(struct fastboot_header header, char *fastboot_data,
 	packet = net_tx_packet + net_eth_hdr_size() + IP_UDP_HDR_SIZE;
 	packet_base = packet;
 
-	/* Resend last packet */
+	/* Resend our reply to this packet, if we still have it */
 	if (retransmit) {
-		memcpy(packet, last_packet, last_packet_len);
+		i = header.seq % WINDOW;
+		if (tx_window[i].seq != header.seq || !tx_window[i].len)
+			return;
+		memcpy(packet, tx_window[i].data, tx_window[i].len);
 		net_send_udp_packet(net_server_ethaddr, fastboot_remote_ip,
 				    fastboot_remote_port, fastboot_our_port,
-				    last_packet_len);
+				    tx_window[i].len);
 		return;
 	}
 
@@ -172,15 +198,26 @@ static void fastboot_send(struct fastboot_header header, char *fastboot_data,
 		if (cmd == FASTBOOT_COMMAND_DOWNLOAD) {
 			if (!fastboot_data_len && !fastboot_data_remaining()) {
 				fastboot_data_complete(response);
+			} else if (fastboot_data_len &&
+				   fastboot_data_len <=
+				   fastboot_data_remaining()) {
+				/*
+				 * Acknowledge first and store the data once
+				 * the reply is on its way, so that the host
+				 * sends the next packet while we copy or
+				 * flash this one.
+				 */
+				deferred_download = true;
 			} else {
 				fastboot_data_download(fastboot_data,
 						       fastboot_data_len,
 						       response);
 			}
 		} else if (!pending_command) {
-			strlcpy(command, fastboot_data,
-				min((size_t)fastboot_data_len + 1,
-				    sizeof(command)));
+			i = min((size_t)fastboot_data_len,
+				sizeof(command) - 1);
+			memcpy(command, fastboot_data, i);
+			command[i] = '\0';
 			pending_command = true;
 		} else {
 			cmd = fastboot_handle_command(command, response);
@@ -207,12 +244,27 @@ static void fastboot_send(struct fastboot_header header, char *fastboot_data,
 	len = packet - packet_base;
 
 	/* Save packet for retransmitting */
-	last_packet_len = len;
-	memcpy(last_packet, packet_base, last_packet_len);
+	i = header.seq % WINDOW;
+	tx_window[i].seq = header.seq;
+	tx_window[i].len = len;
+	memcpy(tx_window[i].data, packet_base, len);
 
 	net_send_udp_packet(net_server_ethaddr, fastboot_remote_ip,
 			    fastboot_remote_port, fastboot_our_port, len);
 
+	if (deferred_download) {
+#if CONFIG_IS_ENABLED(FASTBOOT_FLASH)
+		/* INFO packets would upset the sequence numbers here */
+		fastboot_set_progress_callback(NULL);
+#endif
+		fastboot_data_download(fastboot_data, fastboot_data_len,
+				       response);
+#if CONFIG_IS_ENABLED(FASTBOOT_FLASH)
+		fastboot_set_progress_callback(fastboot_timed_send_info);
+#endif
+		return;
+	}
+
 	/* Continue boot process after sending response */
 	if (!strncmp("OKAY", response, 4)) {
 		switch (cmd) {
@@ -244,6 +296,53 @@ static void boot_downloaded_image(void)
 	net_set_state(NETLOOP_SUCCESS);
 }
 
+/**
+ * fastboot_receive() - Handle a numbered packet from the host
+ *
+ * @header: Header of the packet, in host byte order
+ * @fastboot_data: Pointer to received fastboot data
+ * @fastboot_data_len: Length of received fastboot data
+ *
+ * Packets are handled strictly in sequence number order. Those that arrive
+ * up to WINDOW - 1 numbers early are kept until their turn comes, and those
+ * up to WINDOW numbers late get our previous reply again.
+ */
+static void fastboot_receive(struct fastboot_header header,
+			     char *fastboot_data,
+			     unsigned int fastboot_data_len)
+{
+	unsigned short ahead = header.seq - sequence_number;
+	unsigned short behind = sequence_number - header.seq;
+	unsigned int i;
+
+	if (!ahead) {
+		fastboot_send(header, fastboot_data, fastboot_data_len, 0);
+		sequence_number++;
+
+		/* Handle the packets that were waiting for this one */
+		for (;;) {
+			i = sequence_number % WINDOW;
+			if (!rx_window[i].valid ||
+			    rx_window[i].header.seq != sequence_number)
+				break;
+			rx_window[i].valid = false;
+			fastboot_send(rx_window[i].header,
+				      (char *)rx_window[i].data,
+				      rx_window[i].len, 0);
+			sequence_number++;
+		}
+	} else if (ahead < WINDOW) {
+		i = header.seq % WINDOW;
+		rx_window[i].header = header;
+		rx_window[i].len = fastboot_data_len;
+		memcpy(rx_window[i].data, fastboot_data, fastboot_data_len);
+		rx_window[i].valid = true;
+	} else if (behind && behind <= WINDOW) {
+		/* Retransmit our reply to that packet */
+		fastboot_send(header, fastboot_data, fastboot_data_len, 1);
+	}
+}
+
 /**
  * fastboot_handler() - Incoming UDP packet handler.
  *
@@ -258,8 +357,6 @@ static void fastboot_handler(uchar *packet, unsigned int dport,
 			     unsigned int len)
 {
 	struct fastboot_header header;
-	char fastboot_data[DATA_SIZE] = {0};
-	unsigned int fastboot_data_len = 0;
 
 	if (dport != fastboot_our_port)
 		return;
@@ -277,27 +374,16 @@ static void fastboot_handler(uchar *packet, unsigned int dport,
 
 	switch (header.id) {
 	case FASTBOOT_QUERY:
-		fastboot_send(header, fastboot_data, 0, 0);
+		fastboot_send(header, (char *)packet, 0, 0);
 		break;
 	case FASTBOOT_INIT:
 	case FASTBOOT_FASTBOOT:
-		fastboot_data_len = len;
-		if (len > 0)
-			memcpy(fastboot_data, packet, len);
-		if (header.seq == sequence_number) {
-			fastboot_send(header, fastboot_data,
-				      fastboot_data_len, 0);
-			sequence_number++;
-		} else if (header.seq == sequence_number - 1) {
-			/* Retransmit last sent packet */
-			fastboot_send(header, fastboot_data,
-				      fastboot_data_len, 1);
-		}
+		fastboot_receive(header, (char *)packet, len);
 		break;
 	default:
 		pr_err("ID %d not implemented.\n", header.id);
 		header.id = FASTBOOT_ERROR;
-		fastboot_send(header, fastboot_data, 0, 0);
+		fastboot_send(header, (char *)packet, 0, 0);
 		break;
 	}
 }
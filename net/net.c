@@ -691,6 +691,9 @@ int net_start_again(void)
 	unsigned long retrycnt = 0;
 	int ret;
 
+	/* A stale ARP entry may be what made us fail, so learn them again */
+	arp_cache_flush();
+
 	nretry = env_get("netretry");
 	if (nretry) {
 		if (!strcmp(nretry, "yes"))
@@ -834,6 +837,8 @@ int net_send_ip_packet(uchar *ether, struct in_addr dest, int dport, int sport,
 	/* if broadcast, make the ether address a broadcast and don't do ARP */
 	if (dest.s_addr == 0xFFFFFFFF)
 		ether = (uchar *)net_bcast_ethaddr;
+	else if (is_zero_ethaddr(ether))
+		arp_cache_lookup(dest, ether);
 
 	pkt = (uchar *)net_tx_packet;
 
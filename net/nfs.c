@@ -26,30 +26,50 @@
  * NFSv2 is still used by default. But if server does not support NFSv2, then
  * NFSv3 is used, if available on NFS server. */
 
+/* NOTE 5: The file is read with up to NFS_READ_WINDOW READ calls in flight,
+ * each tracked by its own RPC id, so the link is not idle while waiting for
+ * the server.  With NFSv3 the read size is taken from the server's FSINFO
+ * reply, capped to what IP fragment reassembly can handle (see nfs.h). */
+
 #include <common.h>
 #include <command.h>
 #include <net.h>
 #include <malloc.h>
 #include <mapmem.h>
+#include <linux/log2.h>
 #include "nfs.h"
 #include "bootp.h"
 
 #define HASHES_PER_LINE 65	/* Number of "loading" hashes per line	*/
+#define NFS_HASH_BYTES	(NFS_READ_SIZE / 2 * 10)	/* Bytes per hash */
 #define NFS_RETRY_COUNT 30
 #ifndef CONFIG_NFS_TIMEOUT
 # define NFS_TIMEOUT 2000UL
 #else
 # define NFS_TIMEOUT CONFIG_NFS_TIMEOUT
 #endif
+#define NFS_READ_WINDOW CONFIG_NFS_READ_WINDOW
 
 #define NFS_RPC_ERR	1
 #define NFS_RPC_DROP	124
 
 static int fs_mounted;
 static unsigned long rpc_id;
-static int nfs_offset = -1;
-static int nfs_len;
+static int nfs_offset = -1;	/* next file offset to request */
+static int nfs_eof_offset;	/* lowest offset known to be past EOF */
+static int nfs_read_size = NFS_READ_SIZE;
 static ulong nfs_timeout = NFS_TIMEOUT;
+static unsigned int nfs_hash_bytes;
+static unsigned int nfs_hash_count;
+
+/* One outstanding READ call */
+struct nfs_read_slot {
+	unsigned long xid;	/* RPC id of the call, 0 if the slot is idle */
+	int offset;		/* file offset requested */
+	int len;		/* number of bytes requested */
+};
+
+static struct nfs_read_slot nfs_read_slots[NFS_READ_WINDOW];
 
 static char dirfh[NFS_FHSIZE];	/* NFSv2 / NFSv3 file handle of directory */
 static char filefh[NFS3_FHSIZE]; /* NFSv2 / NFSv3 file handle */
@@ -69,6 +89,7 @@ static int nfs_state;
 #define STATE_LOOKUP_REQ		5
 #define STATE_READ_REQ			6
 #define STATE_READLINK_REQ		7
+#define STATE_FSINFO_REQ		8
 
 static char *nfs_filename;
 static char *nfs_path;
@@ -386,6 +407,91 @@ static void nfs_read_req(int offset, int readlen)
 	rpc_req(PROG_NFS, NFS_READ, data, len);
 }
 
+/**************************************************************************
+NFS3_FSINFO - Get static file system information (NFSv3 only)
+**************************************************************************/
+static void nfs_fsinfo_req(void)
+{
+	uint32_t data[1024];
+	uint32_t *p;
+	int len;
+
+	p = &(data[0]);
+	p = rpc_add_credentials(p);
+
+	*p++ = htonl(filefh3_length);
+	memcpy(p, filefh, filefh3_length);
+	p += (filefh3_length / 4);
+
+	len = (uint32_t *)p - (uint32_t *)&(data[0]);
+
+	rpc_req(PROG_NFS, NFS3PROC_FSINFO, data, len);
+}
+
+/**************************************************************************
+READ window management
+**************************************************************************/
+static void nfs_read_slot_send(struct nfs_read_slot *slot)
+{
+	nfs_read_req(slot->offset, slot->len);
+	slot->xid = rpc_id;
+}
+
+static struct nfs_read_slot *nfs_read_slot_find(unsigned long xid)
+{
+	int i;
+
+	for (i = 0; i < NFS_READ_WINDOW; i++) {
+		if (nfs_read_slots[i].xid && nfs_read_slots[i].xid == xid)
+			return &nfs_read_slots[i];
+	}
+
+	return NULL;
+}
+
+static bool nfs_read_busy(void)
+{
+	int i;
+
+	for (i = 0; i < NFS_READ_WINDOW; i++) {
+		if (nfs_read_slots[i].xid)
+			return true;
+	}
+
+	return false;
+}
+
+/* Issue new READ calls until the window is full or EOF has been seen */
+static void nfs_read_fill_window(void)
+{
+	int i;
+
+	for (i = 0; i < NFS_READ_WINDOW; i++) {
+		struct nfs_read_slot *slot = &nfs_read_slots[i];
+
+		if (slot->xid)
+			continue;
+		if (nfs_offset >= nfs_eof_offset)
+			break;
+		slot->offset = nfs_offset;
+		slot->len = nfs_read_size;
+		nfs_offset += nfs_read_size;
+		nfs_read_slot_send(slot);
+	}
+}
+
+/* (Re)send every outstanding READ call, then top up the window */
+static void nfs_read_send(void)
+{
+	int i;
+
+	for (i = 0; i < NFS_READ_WINDOW; i++) {
+		if (nfs_read_slots[i].xid)
+			nfs_read_slot_send(&nfs_read_slots[i]);
+	}
+	nfs_read_fill_window();
+}
+
 /**************************************************************************
 RPC request dispatcher
 **************************************************************************/
@@ -416,11 +522,14 @@ static void nfs_send(void)
 		nfs_lookup_req(nfs_filename);
 		break;
 	case STATE_READ_REQ:
-		nfs_read_req(nfs_offset, nfs_len);
+		nfs_read_send();
 		break;
 	case STATE_READLINK_REQ:
 		nfs_readlink_req();
 		break;
+	case STATE_FSINFO_REQ:
+		nfs_fsinfo_req();
+		break;
 	}
 }
 
@@ -652,21 +761,78 @@ static int nfs_readlink_reply(uchar *pkt, unsigned len)
 	return 0;
 }
 
-static int nfs_read_reply(uchar *pkt, unsigned len)
+static int nfs_fsinfo_reply(uchar *pkt, unsigned len)
 {
 	struct rpc_t rpc_pkt;
-	int rlen;
-	uchar *data_ptr;
+	int nfsv3_data_offset;
+	unsigned int rtmax, rtpref, size;
 
 	debug("%s\n", __func__);
 
-	memcpy(&rpc_pkt.u.data[0], pkt, sizeof(rpc_pkt.u.reply));
+	memcpy(&rpc_pkt.u.data[0], pkt, len);
 
 	if (ntohl(rpc_pkt.u.reply.id) > rpc_id)
 		return -NFS_RPC_ERR;
 	else if (ntohl(rpc_pkt.u.reply.id) < rpc_id)
 		return -NFS_RPC_DROP;
 
+	if (rpc_pkt.u.reply.rstatus  ||
+	    rpc_pkt.u.reply.verifier ||
+	    rpc_pkt.u.reply.astatus  ||
+	    rpc_pkt.u.reply.data[0])
+		return -1;
+
+	nfsv3_data_offset = nfs3_get_attributes_offset(rpc_pkt.u.reply.data);
+	rtmax = ntohl(rpc_pkt.u.reply.data[1 + nfsv3_data_offset]);
+	rtpref = ntohl(rpc_pkt.u.reply.data[2 + nfsv3_data_offset]);
+
+	/* Prefer the server's preferred size, within its maximum and ours */
+	size = rtpref ? rtpref : rtmax;
+	if (rtmax && size > rtmax)
+		size = rtmax;
+	if (!size || size > NFS3_MAX_READ_SIZE)
+		size = NFS3_MAX_READ_SIZE;
+	nfs_read_size = rounddown_pow_of_two(size);
+	debug("NFS rtmax %u rtpref %u: using read size %d\n", rtmax, rtpref,
+	      nfs_read_size);
+
+	return 0;
+}
+
+static void nfs_show_progress(int rlen)
+{
+	nfs_hash_bytes += rlen;
+	while (nfs_hash_bytes >= NFS_HASH_BYTES) {
+		nfs_hash_bytes -= NFS_HASH_BYTES;
+		if (nfs_hash_count && !(nfs_hash_count % HASHES_PER_LINE))
+			puts("\n\t ");
+		nfs_hash_count++;
+		putc('#');
+	}
+}
+
+static int nfs_read_reply(uchar *pkt, unsigned len,
+			  struct nfs_read_slot **slotp)
+{
+	struct rpc_t rpc_pkt;
+	struct nfs_read_slot *slot;
+	int rlen;
+	unsigned int data_offset;
+
+	debug("%s\n", __func__);
+
+	/*
+	 * Only the RPC header and attributes are copied; the data itself is
+	 * stored straight from the (possibly reassembled) packet.
+	 */
+	memcpy(&rpc_pkt.u.data[0], pkt, min_t(unsigned int, len,
+					      sizeof(rpc_pkt.u.reply)));
+
+	slot = nfs_read_slot_find(ntohl(rpc_pkt.u.reply.id));
+	if (!slot)
+		return -NFS_RPC_DROP;
+	*slotp = slot;
+
 	if (rpc_pkt.u.reply.rstatus  ||
 	    rpc_pkt.u.reply.verifier ||
 	    rpc_pkt.u.reply.astatus  ||
@@ -678,15 +844,10 @@ static int nfs_read_reply(uchar *pkt, unsigned len)
 		return -ntohl(rpc_pkt.u.reply.data[0]);
 	}
 
-	if ((nfs_offset != 0) && !((nfs_offset) %
-			(NFS_READ_SIZE / 2 * 10 * HASHES_PER_LINE)))
-		puts("\n\t ");
-	if (!(nfs_offset % ((NFS_READ_SIZE / 2) * 10)))
-		putc('#');
-
 	if (supported_nfs_versions & NFSV2_FLAG) {
 		rlen = ntohl(rpc_pkt.u.reply.data[18]);
-		data_ptr = (uchar *)&(rpc_pkt.u.reply.data[19]);
+		data_offset = (uchar *)&(rpc_pkt.u.reply.data[19]) -
+			(uchar *)&rpc_pkt;
 	} else {  /* NFSV3_FLAG */
 		int nfsv3_data_offset =
 			nfs3_get_attributes_offset(rpc_pkt.u.reply.data);
@@ -697,16 +858,31 @@ static int nfs_read_reply(uchar *pkt, unsigned len)
 			EOF:		32 bits value,
 			data_size:	32 bits value,
 		*/
-		data_ptr = (uchar *)
-			&(rpc_pkt.u.reply.data[4 + nfsv3_data_offset]);
+		data_offset = (uchar *)
+			&(rpc_pkt.u.reply.data[4 + nfsv3_data_offset]) -
+			(uchar *)&rpc_pkt;
 	}
 
-	if (store_block(data_ptr, nfs_offset, rlen))
+	if (rlen < 0 || rlen > slot->len || data_offset + rlen > len)
+		return -9999;
+
+	if (store_block(pkt + data_offset, slot->offset, rlen))
 			return -9999;
 
+	nfs_show_progress(rlen);
+
 	return rlen;
 }
 
+static void nfs_read_start(void)
+{
+	memset(nfs_read_slots, 0, sizeof(nfs_read_slots));
+	nfs_offset = 0;
+	nfs_eof_offset = INT_MAX;
+	nfs_state = STATE_READ_REQ;
+	nfs_send();
+}
+
 /**************************************************************************
 Interfaces of U-BOOT
 **************************************************************************/
@@ -727,6 +903,7 @@ static void nfs_timeout_handler(void)
 static void nfs_handler(uchar *pkt, unsigned dest, struct in_addr sip,
 			unsigned src, unsigned len)
 {
+	struct nfs_read_slot *slot = NULL;
 	int rlen;
 	int reply;
 
@@ -735,6 +912,10 @@ static void nfs_handler(uchar *pkt, unsigned dest, struct in_addr sip,
 	if (dest != nfs_our_port)
 		return;
 
+	/* Only READ replies may be larger than an RPC packet */
+	if (nfs_state != STATE_READ_REQ && len > sizeof(struct rpc_t))
+		return;
+
 	switch (nfs_state) {
 	case STATE_PRCLOOKUP_PROG_MOUNT_REQ:
 		if (rpc_lookup_reply(PROG_MOUNT, pkt, len) == -NFS_RPC_DROP)
@@ -795,13 +976,26 @@ static void nfs_handler(uchar *pkt, unsigned dest, struct in_addr sip,
 			nfs_state = STATE_PRCLOOKUP_PROG_MOUNT_REQ;
 			nfs_send();
 		} else {
-			nfs_state = STATE_READ_REQ;
-			nfs_offset = 0;
-			nfs_len = NFS_READ_SIZE;
-			nfs_send();
+			nfs_read_size = NFS_READ_SIZE;
+			if (!(supported_nfs_versions & NFSV2_FLAG) &&
+			    NFS3_MAX_READ_SIZE > NFS_READ_SIZE) {
+				nfs_state = STATE_FSINFO_REQ;
+				nfs_send();
+			} else {
+				nfs_read_start();
+			}
 		}
 		break;
 
+	case STATE_FSINFO_REQ:
+		reply = nfs_fsinfo_reply(pkt, len);
+		if (reply == -NFS_RPC_DROP)
+			break;
+		if (reply)
+			debug("NFS FSINFO failed, using default read size\n");
+		nfs_read_start();
+		break;
+
 	case STATE_READLINK_REQ:
 		reply = nfs_readlink_reply(pkt, len);
 		if (reply == -NFS_RPC_DROP) {
@@ -821,22 +1015,31 @@ static void nfs_handler(uchar *pkt, unsigned dest, struct in_addr sip,
 		break;
 
 	case STATE_READ_REQ:
-		rlen = nfs_read_reply(pkt, len);
+		rlen = nfs_read_reply(pkt, len, &slot);
 		if (rlen == -NFS_RPC_DROP)
 			break;
 		net_set_timeout_handler(nfs_timeout, nfs_timeout_handler);
-		if (rlen > 0) {
-			nfs_offset += rlen;
-			nfs_send();
+		if (rlen > 0 && rlen < slot->len) {
+			/* short read: ask for the rest of this chunk */
+			slot->offset += rlen;
+			slot->len -= rlen;
+			nfs_read_slot_send(slot);
+		} else if (rlen >= 0) {
+			slot->xid = 0;
+			if (!rlen && slot->offset < nfs_eof_offset)
+				nfs_eof_offset = slot->offset;
+			nfs_read_fill_window();
+			if (!nfs_read_busy()) {
+				nfs_download_state = NETLOOP_SUCCESS;
+				nfs_state = STATE_UMOUNT_REQ;
+				nfs_send();
+			}
 		} else if ((rlen == -NFSERR_ISDIR) || (rlen == -NFSERR_INVAL)) {
 			/* symbolic link */
 			nfs_state = STATE_READLINK_REQ;
 			nfs_send();
 		} else {
-			if (!rlen)
-				nfs_download_state = NETLOOP_SUCCESS;
-			if (rlen < 0)
-				debug("NFS READ error (%d)\n", rlen);
+			debug("NFS READ error (%d)\n", rlen);
 			nfs_state = STATE_UMOUNT_REQ;
 			nfs_send();
 		}
@@ -903,6 +1106,8 @@ void nfs_start(void)
 	net_set_udp_handler(nfs_handler);
 
 	nfs_timeout_count = 0;
+	nfs_hash_bytes = 0;
+	nfs_hash_count = 0;
 	nfs_state = STATE_PRCLOOKUP_PROG_MOUNT_REQ;
 
 	/*nfs_our_port = 4096 + (get_ticks() % 3072);*/
@@ -25,6 +25,7 @@
 #define NFS_READ        6
 
 #define NFS3PROC_LOOKUP 3
+#define NFS3PROC_FSINFO 19
 
 #define NFS_FHSIZE      32
 #define NFS3_FHSIZE     64
@@ -42,6 +43,22 @@
  * case, most NFS servers are optimized for a power of 2.
  */
 #define NFS_READ_SIZE	1024	/* biggest power of two that fits Ether frame */
+
+/*
+ * Upper bound for the NFSv3 read size negotiated through FSINFO.  A READ
+ * reply this big spans several IP fragments, so it is only used when they
+ * can be reassembled (CONFIG_IP_DEFRAG) into a buffer that is large enough
+ * to hold the data plus the IP/UDP/RPC headers and the file attributes.
+ */
+#if defined(CONFIG_IP_DEFRAG) && defined(CONFIG_NET_MAXDEFRAG) && \
+	CONFIG_NET_MAXDEFRAG >= 32768 + 512
+#define NFS3_MAX_READ_SIZE	32768
+#elif defined(CONFIG_IP_DEFRAG) && (!defined(CONFIG_NET_MAXDEFRAG) || \
+	CONFIG_NET_MAXDEFRAG >= 8192 + 512)
+#define NFS3_MAX_READ_SIZE	8192
+#else
+#define NFS3_MAX_READ_SIZE	NFS_READ_SIZE
+#endif
 #define NFS_MAX_ATTRS	26
 
 /* Values for Accept State flag on RPC answers (See: rfc1831) */
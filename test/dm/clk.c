@@ -138,3 +138,57 @@ static int dm_test_clk_bulk(struct unit_test_state *uts)
 	return 0;
 }
 DM_TEST(dm_test_clk_bulk, DM_TESTF_SCAN_FDT);
+
+#if CONFIG_IS_ENABLED(CLK_RATE_CACHE)
+/* Test that rates are cached until a clock changes */
+static int dm_test_clk_rate_cache(struct unit_test_state *uts)
+{
+	struct udevice *dev_clk, *dev_test;
+	int count;
+
+	ut_assertok(uclass_get_device_by_name(UCLASS_CLK, "clk-sbox",
+					      &dev_clk));
+	ut_assertok(uclass_get_device_by_name(UCLASS_MISC, "clk-test",
+					      &dev_test));
+	ut_assertok(sandbox_clk_test_get(dev_test));
+	ut_asserteq(0, sandbox_clk_test_set_rate(dev_test,
+						 SANDBOX_CLK_TEST_ID_SPI,
+						 1000));
+
+	count = sandbox_clk_query_get_rate_count(dev_clk);
+	ut_asserteq(1000, sandbox_clk_test_get_rate(dev_test,
+						    SANDBOX_CLK_TEST_ID_SPI));
+	ut_asserteq(1000, sandbox_clk_test_get_rate(dev_test,
+						    SANDBOX_CLK_TEST_ID_SPI));
+	ut_asserteq(count + 1, sandbox_clk_query_get_rate_count(dev_clk));
+
+	/* Each clock is cached separately */
+	ut_asserteq(0, sandbox_clk_test_get_rate(dev_test,
+						 SANDBOX_CLK_TEST_ID_I2C));
+	ut_asserteq(count + 2, sandbox_clk_query_get_rate_count(dev_clk));
+
+	/*
+	 * Changing any clock drops the cache, including the old rate which
+	 * the driver reads while setting the new one
+	 */
+	ut_asserteq(0, sandbox_clk_test_set_rate(dev_test,
+						 SANDBOX_CLK_TEST_ID_I2C,
+						 2000));
+	ut_asserteq(1000, sandbox_clk_test_get_rate(dev_test,
+						    SANDBOX_CLK_TEST_ID_SPI));
+	ut_asserteq(count + 3, sandbox_clk_query_get_rate_count(dev_clk));
+	ut_asserteq(2000, sandbox_clk_test_get_rate(dev_test,
+						    SANDBOX_CLK_TEST_ID_I2C));
+	ut_asserteq(count + 4, sandbox_clk_query_get_rate_count(dev_clk));
+
+	ut_assertok(sandbox_clk_test_enable(dev_test, SANDBOX_CLK_TEST_ID_SPI));
+	ut_asserteq(1000, sandbox_clk_test_get_rate(dev_test,
+						    SANDBOX_CLK_TEST_ID_SPI));
+	ut_asserteq(count + 5, sandbox_clk_query_get_rate_count(dev_clk));
+
+	ut_assertok(sandbox_clk_test_free(dev_test));
+
+	return 0;
+}
+DM_TEST(dm_test_clk_rate_cache, DM_TESTF_SCAN_FDT);
+#endif
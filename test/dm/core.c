@@ -11,6 +11,7 @@
 #include <fdtdec.h>
 #include <malloc.h>
 #include <dm/device-internal.h>
+#include <dm/lists.h>
 #include <dm/root.h>
 #include <dm/util.h>
 #include <dm/test.h>
@@ -92,6 +93,10 @@ int dm_leak_check_end(struct unit_test_state *uts)
 		ut_assertok(uclass_destroy(uc));
 	}
 
+	/* Nodes still waiting to be bound are not leaked */
+	if (CONFIG_IS_ENABLED(DM_DEFERRED_BIND))
+		lists_drop_deferred();
+
 	end = mallinfo();
 	diff = end.uordblks - uts->start.uordblks;
 	if (diff > 0)
@@ -901,3 +906,86 @@ static int dm_test_inactive_child(struct unit_test_state *uts)
 	return 0;
 }
 DM_TEST(dm_test_inactive_child, DM_TESTF_SCAN_PDATA);
+
+/* Look up a uclass by walking the list of uclasses, as uclass_find() did */
+static struct uclass *uclass_find_by_list(enum uclass_id id)
+{
+	struct uclass *uc;
+
+	list_for_each_entry(uc, &gd->uclass_root, sibling_node) {
+		if (uc->uc_drv->id == id)
+			return uc;
+	}
+
+	return NULL;
+}
+
+/* Check that uclass_find() finds the same uclass as walking the list */
+static int dm_test_uclass_find(struct unit_test_state *uts)
+{
+	int count, i;
+
+	for (count = 0, i = 0; i < UCLASS_COUNT; i++) {
+		ut_asserteq_ptr(uclass_find_by_list(i), uclass_find(i));
+		if (uclass_find(i))
+			count++;
+	}
+	ut_assert(count > 1);
+
+	return 0;
+}
+DM_TEST(dm_test_uclass_find, DM_TESTF_SCAN_PDATA | DM_TESTF_SCAN_FDT);
+
+#if CONFIG_IS_ENABLED(DM_TIMING)
+/* Test that binding, probing and removing are timed for each device */
+static int dm_test_timing(struct unit_test_state *uts)
+{
+	struct dm_test_state *dms = uts->priv;
+	struct udevice *parent, *child;
+
+	/* We don't care about the numbering for this test */
+	dms->skip_post_probe = 1;
+
+	ut_assertok(create_children(uts, dms->root, 1, 0, &parent));
+	ut_assertok(create_children(uts, parent, 1, 10, &child));
+	ut_asserteq(1, parent->timing->count[DM_TIMING_BIND]);
+	ut_asserteq(1, child->timing->count[DM_TIMING_BIND]);
+	ut_asserteq(0, child->timing->count[DM_TIMING_PROBE]);
+
+	/*
+	 * Probing the child probes its parent, which is counted separately.
+	 * The parent's probe takes 10ms, which is not charged to the child.
+	 */
+	dms->slow_dev = parent;
+	ut_assertok(device_probe(child));
+	ut_asserteq(1, parent->timing->count[DM_TIMING_PROBE]);
+	ut_asserteq(1, child->timing->count[DM_TIMING_PROBE]);
+	ut_assert(parent->timing->time_us[DM_TIMING_PROBE] >= 10000);
+	ut_assert(child->timing->time_us[DM_TIMING_PROBE] < 10000);
+
+	/* A device which is already active is not probed again */
+	ut_assertok(device_probe(child));
+	ut_asserteq(1, child->timing->count[DM_TIMING_PROBE]);
+
+	/*
+	 * Removing the parent removes the child first. The child's remove
+	 * takes 10ms, which is not charged to the parent.
+	 */
+	dms->slow_dev = child;
+	ut_assertok(device_remove(parent, DM_REMOVE_NORMAL));
+	ut_asserteq(1, parent->timing->count[DM_TIMING_REMOVE]);
+	ut_asserteq(1, child->timing->count[DM_TIMING_REMOVE]);
+	ut_assert(parent->timing->time_us[DM_TIMING_REMOVE] < 10000);
+	ut_assert(child->timing->time_us[DM_TIMING_REMOVE] >= 10000);
+
+	/* Now only the child's probe is slow */
+	ut_assertok(device_probe(child));
+	ut_asserteq(2, parent->timing->count[DM_TIMING_PROBE]);
+	ut_asserteq(2, child->timing->count[DM_TIMING_PROBE]);
+	ut_assert(parent->timing->time_us[DM_TIMING_PROBE] < 20000);
+	ut_assert(child->timing->time_us[DM_TIMING_PROBE] >= 10000);
+
+	return 0;
+}
+DM_TEST(dm_test_timing, 0);
+#endif
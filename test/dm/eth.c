@@ -428,3 +428,61 @@ static int dm_test_eth_async_ping_reply(struct unit_test_state *uts)
 }
 
 DM_TEST(dm_test_eth_async_ping_reply, DM_TESTF_SCAN_FDT);
+
+static int dm_test_eth_arp_cache(struct unit_test_state *uts)
+{
+	const uchar new_hwaddr[ARP_HLEN] = { 0x02, 0, 0x11, 0x22, 0x33, 0x44 };
+	uchar pkt[ETHER_HDR_SIZE + ARP_HDR_SIZE] __aligned(4);
+	struct eth_sandbox_priv *priv;
+	struct ethernet_hdr *eth;
+	struct arp_hdr *arp;
+	struct udevice *dev;
+	uchar ethaddr[ARP_HLEN];
+
+	arp_cache_flush();
+	net_ping_ip = string_to_ip("1.1.2.2");
+
+	env_set("ethact", "eth@10002000");
+	ut_assertok(net_loop(PING));
+	ut_assertok(uclass_get_device_by_name(UCLASS_ETH, "eth@10002000",
+					      &dev));
+	priv = dev_get_priv(dev);
+
+	/* The ARP reply seen by ping must have been remembered */
+	ut_assert(arp_cache_lookup(net_ping_ip, ethaddr));
+	ut_assert(memcmp(ethaddr, priv->fake_host_hwaddr, ARP_HLEN) == 0);
+	ut_assert(!arp_cache_lookup(string_to_ip("1.1.2.3"), ethaddr));
+
+	/* A gratuitous ARP from that host updates its entry */
+	eth = (struct ethernet_hdr *)pkt;
+	memcpy(eth->et_dest, net_bcast_ethaddr, ARP_HLEN);
+	memcpy(eth->et_src, new_hwaddr, ARP_HLEN);
+	eth->et_protlen = htons(PROT_ARP);
+	arp = (struct arp_hdr *)(pkt + ETHER_HDR_SIZE);
+	arp->ar_hrd = htons(ARP_ETHER);
+	arp->ar_pro = htons(PROT_IP);
+	arp->ar_hln = ARP_HLEN;
+	arp->ar_pln = ARP_PLEN;
+	arp->ar_op = htons(ARPOP_REQUEST);
+	memcpy(&arp->ar_sha, new_hwaddr, ARP_HLEN);
+	net_write_ip(&arp->ar_spa, net_ping_ip);
+	memcpy(&arp->ar_tha, net_null_ethaddr, ARP_HLEN);
+	net_write_ip(&arp->ar_tpa, net_ping_ip);
+	net_process_received_packet(pkt, sizeof(pkt));
+
+	ut_assert(arp_cache_lookup(net_ping_ip, ethaddr));
+	ut_assert(memcmp(ethaddr, new_hwaddr, ARP_HLEN) == 0);
+
+	/* ...but does not add hosts we never talked to */
+	net_write_ip(&arp->ar_spa, string_to_ip("1.1.2.3"));
+	net_write_ip(&arp->ar_tpa, string_to_ip("1.1.2.3"));
+	net_process_received_packet(pkt, sizeof(pkt));
+	ut_assert(!arp_cache_lookup(string_to_ip("1.1.2.3"), ethaddr));
+
+	arp_cache_flush();
+	ut_assert(!arp_cache_lookup(net_ping_ip, ethaddr));
+
+	return 0;
+}
+
+DM_TEST(dm_test_eth_arp_cache, DM_TESTF_SCAN_FDT);
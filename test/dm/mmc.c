@@ -6,6 +6,7 @@
 #include <common.h>
 #include <dm.h>
 #include <mmc.h>
+#include <thread.h>
 #include <dm/test.h>
 #include <test/ut.h>
 
@@ -41,3 +42,114 @@ static int dm_test_mmc_blk(struct unit_test_state *uts)
 	return 0;
 }
 DM_TEST(dm_test_mmc_blk, DM_TESTF_SCAN_PDATA | DM_TESTF_SCAN_FDT);
+
+static int dm_test_mmc_cmd23(struct unit_test_state *uts)
+{
+	struct udevice *dev;
+	struct blk_desc *dev_desc;
+	struct mmc *mmc;
+	char buf[1536];
+
+	ut_assertok(uclass_get_device(UCLASS_MMC, 0, &dev));
+	ut_assertok(blk_get_device_by_str("mmc", "0", &dev_desc));
+	mmc = mmc_get_mmc_dev(dev);
+
+	/* The card announces CMD23, so no CMD12 follows a transfer */
+	ut_assert(mmc->card_caps & MMC_CAP_CMD23);
+	memset(buf, '\0', sizeof(buf));
+	ut_asserteq(3, blk_dwrite(dev_desc, 0, 3, buf));
+	ut_asserteq(2, blk_dread(dev_desc, 0, 2, buf));
+	ut_assertok(strcmp(buf, "this is a test"));
+
+	/* Without it, transfers are open-ended again */
+	mmc->card_caps &= ~MMC_CAP_CMD23;
+	memset(buf, '\0', sizeof(buf));
+	ut_asserteq(3, blk_dwrite(dev_desc, 0, 3, buf));
+	ut_asserteq(2, blk_dread(dev_desc, 0, 2, buf));
+	ut_assertok(strcmp(buf, "this is a test"));
+	mmc->card_caps |= MMC_CAP_CMD23;
+
+	return 0;
+}
+DM_TEST(dm_test_mmc_cmd23, DM_TESTF_SCAN_PDATA | DM_TESTF_SCAN_FDT);
+
+static int dm_test_mmc_mode_cache(struct unit_test_state *uts)
+{
+	struct udevice *dev;
+	struct mmc *mmc;
+	enum bus_mode best;
+
+	ut_assertok(uclass_get_device(UCLASS_MMC, 0, &dev));
+	mmc = mmc_get_mmc_dev(dev);
+	ut_assertok(mmc_init(mmc));
+	best = mmc->selected_mode;
+	ut_assert(best != SD_LEGACY);
+	ut_asserteq(best, mmc->mode_cache.mode);
+	ut_asserteq(mmc->bus_width, mmc->mode_cache.bus_width);
+
+	/* A re-init goes straight for the cached mode */
+	mmc->mode_cache.mode = SD_LEGACY;
+	mmc->mode_cache.bus_width = 1;
+	mmc->has_init = 0;
+	ut_assertok(mmc_init(mmc));
+	ut_asserteq(SD_LEGACY, mmc->selected_mode);
+	ut_asserteq(1, mmc->bus_width);
+
+	/* but not for another card */
+	mmc->mode_cache.cid[0]++;
+	mmc->has_init = 0;
+	ut_assertok(mmc_init(mmc));
+	ut_asserteq(best, mmc->selected_mode);
+	ut_assert(!memcmp(mmc->cid, mmc->mode_cache.cid, sizeof(mmc->cid)));
+
+	return 0;
+}
+DM_TEST(dm_test_mmc_mode_cache, DM_TESTF_SCAN_PDATA | DM_TESTF_SCAN_FDT);
+
+static int dm_test_mmc_discard(struct unit_test_state *uts)
+{
+	struct blk_desc *dev_desc;
+	struct mmc *mmc;
+
+	ut_assertok(blk_get_device_by_str("mmc", "0", &dev_desc));
+	mmc = mmc_get_mmc_dev(dev_get_parent(dev_desc->bdev));
+
+	/* SD cards erase single blocks and these ones read back as zero */
+	ut_asserteq(3, blk_ddiscard(dev_desc, 1, 3));
+	ut_asserteq(3, blk_dwrite_zeroes(dev_desc, 1, 3));
+
+	/* Cards which erase to ones must be written instead */
+	mmc->scr[0] |= SD_DATA_STAT_AFTER_ERASE;
+	ut_assert(IS_ERR_VALUE(blk_dwrite_zeroes(dev_desc, 1, 3)));
+	mmc->scr[0] &= ~SD_DATA_STAT_AFTER_ERASE;
+
+	/* Only eMMC can sanitize */
+	ut_asserteq(-EOPNOTSUPP, mmc_sanitize(mmc));
+
+	return 0;
+}
+DM_TEST(dm_test_mmc_discard, DM_TESTF_SCAN_PDATA | DM_TESTF_SCAN_FDT);
+
+#if CONFIG_IS_ENABLED(MMC_INIT_ASYNC)
+/* Test that a card initialised in a thread is waited for by mmc_init() */
+static int dm_test_mmc_init_async(struct unit_test_state *uts)
+{
+	struct udevice *dev;
+	struct mmc *mmc;
+
+	ut_assertok(uclass_get_device(UCLASS_MMC, 0, &dev));
+	mmc = mmc_get_mmc_dev(dev);
+	mmc->has_init = 0;
+	ut_assertok(mmc_init_async(mmc));
+
+	/* The thread stops at the card's power-up delay */
+	thread_run_others();
+	ut_assert(!mmc->has_init);
+	ut_assertok(mmc_init(mmc));
+	ut_assert(mmc->has_init);
+	ut_assertok(thread_join_all());
+
+	return 0;
+}
+DM_TEST(dm_test_mmc_init_async, DM_TESTF_SCAN_PDATA | DM_TESTF_SCAN_FDT);
+#endif
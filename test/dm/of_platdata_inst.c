@@ -0,0 +1,47 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Tests for devices instantiated at build time (CONFIG_OF_PLATDATA_INST)
+ *
+ * These use the devices in arch/sandbox/dts/sandbox_inst.dts
+ */
+
+#include <common.h>
+#include <dm.h>
+#include <dt-structs.h>
+#include <dm/test.h>
+#include <dm/uclass-internal.h>
+#include <dm/util.h>
+#include <test/ut.h>
+
+/* Test that devices are bound in the device-tree hierarchy, with their seq */
+static int dm_test_of_platdata_inst(struct unit_test_state *uts)
+{
+	struct dtd_test_drv *plat;
+	struct udevice *bus, *dev;
+
+	ut_assertok(uclass_find_device_by_seq(UCLASS_TEST, 3, true, &dev));
+	ut_assert(dev->flags & DM_FLAG_INST);
+	plat = dev_get_platdata(dev);
+	ut_asserteq(3, plat->ping_add);
+
+	/* Its parent is the simple-bus, which dtoc names by its driver */
+	bus = dev_get_parent(dev);
+	ut_asserteq_str("generic_simple_bus", bus->driver->name);
+	ut_assert(bus->flags & DM_FLAG_INST);
+	ut_asserteq_ptr(dm_root(), dev_get_parent(bus));
+	ut_asserteq(2, list_count_items(&bus->child_head));
+
+	/* The other device on the bus has no alias */
+	dev = list_last_entry(&bus->child_head, struct udevice, sibling_node);
+	ut_assert(dev->flags & DM_FLAG_INST);
+	ut_asserteq(-1, dev->req_seq);
+	plat = dev_get_platdata(dev);
+	ut_asserteq(4, plat->ping_add);
+
+	/* A device whose parent has no driver is not bound anywhere */
+	ut_asserteq(-ENODEV,
+		    uclass_find_device_by_seq(UCLASS_TEST, 7, true, &dev));
+
+	return 0;
+}
+DM_TEST(dm_test_of_platdata_inst, DM_TESTF_SCAN_PDATA);
@@ -58,3 +58,38 @@ static int dm_test_ofnode_fmap(struct unit_test_state *uts)
 	return 0;
 }
 DM_TEST(dm_test_ofnode_fmap, DM_TESTF_SCAN_PDATA | DM_TESTF_SCAN_FDT);
+
+/* Check that each node with a phandle below @parent is found by it */
+static int check_phandles(struct unit_test_state *uts, ofnode parent,
+			  int *countp)
+{
+	ofnode node;
+	uint phandle;
+
+	ofnode_for_each_subnode(node, parent) {
+		phandle = ofnode_read_u32_default(node, "phandle", 0);
+		if (phandle) {
+			/* The second lookup comes from the cache */
+			ut_assert(ofnode_equal(node,
+					       ofnode_get_by_phandle(phandle)));
+			ut_assert(ofnode_equal(node,
+					       ofnode_get_by_phandle(phandle)));
+			(*countp)++;
+		}
+		ut_assertok(check_phandles(uts, node, countp));
+	}
+
+	return 0;
+}
+
+static int dm_test_ofnode_get_by_phandle(struct unit_test_state *uts)
+{
+	int count = 0;
+
+	ut_assertok(check_phandles(uts, ofnode_path("/"), &count));
+	ut_assert(count > 1);
+	ut_assert(!ofnode_valid(ofnode_get_by_phandle(0xfffffffe)));
+
+	return 0;
+}
+DM_TEST(dm_test_ofnode_get_by_phandle, DM_TESTF_SCAN_FDT);
@@ -144,3 +144,71 @@ static int dm_test_regmap_getset(struct unit_test_state *uts)
 }
 
 DM_TEST(dm_test_regmap_getset, DM_TESTF_SCAN_PDATA | DM_TESTF_SCAN_FDT);
+
+#if CONFIG_IS_ENABLED(REGMAP_CACHE)
+/* Register cache test, relying on sandbox register reads returning 0 */
+static int dm_test_regmap_cache(struct unit_test_state *uts)
+{
+	static const struct regmap_volatile vol[] = {
+		{ .start = 0xc, .size = 4 },
+	};
+	const uint vals[] = { 0x11111111, 0x22222222, 0x33333333 };
+	struct udevice *dev;
+	struct regmap *map;
+	uint reg;
+
+	ut_assertok(uclass_get_device(UCLASS_SYSCON, 0, &dev));
+	map = syscon_get_regmap(dev);
+	ut_assertok_ptr(map);
+	ut_assertok(regmap_cache_init(map, 0, vol, ARRAY_SIZE(vol)));
+
+	/* A cached register is not read back from the hardware */
+	ut_assertok(regmap_write(map, 0, 0xcafe));
+	ut_assertok(regmap_read(map, 0, &reg));
+	ut_asserteq(0xcafe, reg);
+
+	/* ...but volatile and unaligned registers are */
+	ut_assertok(regmap_write(map, 0xc, 0x5678));
+	ut_assertok(regmap_read(map, 0xc, &reg));
+	ut_asserteq(0, reg);
+	ut_assertok(regmap_write(map, 3, 0x5678));
+	ut_assertok(regmap_read(map, 3, &reg));
+	ut_asserteq(0, reg);
+
+	/* A raw write drops the registers it overlaps */
+	ut_assertok(regmap_write(map, 4, 0xbeef));
+	reg = 0x4321;
+	ut_assertok(regmap_raw_write(map, 2, &reg, REGMAP_SIZE_16));
+	ut_assertok(regmap_read(map, 0, &reg));
+	ut_asserteq(0, reg);
+	ut_assertok(regmap_read(map, 4, &reg));
+	ut_asserteq(0xbeef, reg);
+
+	ut_assertok(regmap_update_bits(map, 0, 0xff, 0x12));
+	ut_assertok(regmap_read(map, 0, &reg));
+	ut_asserteq(0x12, reg);
+
+	ut_assertok(regmap_bulk_write(map, 0, vals, ARRAY_SIZE(vals)));
+	ut_assertok(regmap_read(map, 4, &reg));
+	ut_asserteq(0x22222222, reg);
+
+	/* Writes can be held back until the cache is synced */
+	regmap_cache_only(map, true);
+	ut_assertok(regmap_write(map, 8, 0x44));
+	ut_assertok(regmap_read(map, 8, &reg));
+	ut_asserteq(0x44, reg);
+	regmap_cache_only(map, false);
+	ut_assertok(regmap_cache_sync(map));
+	ut_assertok(regmap_read(map, 8, &reg));
+	ut_asserteq(0x44, reg);
+
+	/* Dropping the cache reads the hardware again */
+	regmap_cache_drop(map);
+	ut_assertok(regmap_read(map, 8, &reg));
+	ut_asserteq(0, reg);
+
+	return 0;
+}
+
+DM_TEST(dm_test_regmap_cache, DM_TESTF_SCAN_PDATA | DM_TESTF_SCAN_FDT);
+#endif
@@ -13,6 +13,7 @@
 #include <dm/test.h>
 #include <test/ut.h>
 #include <asm/io.h>
+#include <asm/test.h>
 
 int dm_testdrv_op_count[DM_TEST_OP_COUNT];
 static struct unit_test_state *uts = &global_dm_test_state;
@@ -116,6 +117,9 @@ static int test_manual_probe(struct udevice *dev)
 	struct dm_test_state *dms = uts->priv;
 
 	dm_testdrv_op_count[DM_TEST_OP_PROBE]++;
+	/* Pretend that this probe takes 10ms */
+	if (dev == dms->slow_dev)
+		sandbox_timer_add_offset(10);
 	if (!dms->force_fail_alloc)
 		dev->priv = calloc(1, sizeof(struct dm_test_priv));
 	if (!dev->priv)
@@ -126,7 +130,11 @@ static int test_manual_probe(struct udevice *dev)
 
 static int test_manual_remove(struct udevice *dev)
 {
+	struct dm_test_state *dms = uts->priv;
+
 	dm_testdrv_op_count[DM_TEST_OP_REMOVE]++;
+	if (dev == dms->slow_dev)
+		sandbox_timer_add_offset(10);
 	return 0;
 }
 
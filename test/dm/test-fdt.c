@@ -241,6 +241,132 @@ static int dm_test_fdt_pre_reloc(struct unit_test_state *uts)
 }
 DM_TEST(dm_test_fdt_pre_reloc, 0);
 
+#if !CONFIG_IS_ENABLED(OF_PLATDATA)
+static bool drv_has_compat(struct driver *drv, const char *compat)
+{
+	const struct udevice_id *of_id;
+
+	for (of_id = drv->of_match; of_id && of_id->compatible; of_id++) {
+		if (!strcmp(of_id->compatible, compat))
+			return true;
+	}
+
+	return false;
+}
+
+/* Test looking up drivers by compatible string */
+static int dm_test_fdt_compat_lookup(struct unit_test_state *uts)
+{
+	struct driver *drv = ll_entry_start(struct driver, driver);
+	const int n_ents = ll_entry_count(struct driver, driver);
+	const struct udevice_id *of_id, *found_id;
+	struct driver *entry, *first, *found;
+
+	/* After relocation the lookup uses the hash table */
+	ut_assert(gd->flags & GD_FLG_RELOC);
+
+	/* A driver with several compatible strings is found by each of them */
+	ut_asserteq_ptr(lists_driver_lookup_name("testfdt_drv"),
+			lists_driver_lookup_compat("denx,u-boot-fdt-test",
+						   &found_id));
+	ut_asserteq(DM_TEST_TYPE_FIRST, found_id->data);
+	ut_asserteq_ptr(lists_driver_lookup_name("testfdt_drv"),
+			lists_driver_lookup_compat("google,another-fdt-test",
+						   &found_id));
+	ut_asserteq(DM_TEST_TYPE_SECOND, found_id->data);
+	ut_asserteq_ptr(lists_driver_lookup_name("testfdt1_drv"),
+			lists_driver_lookup_compat("denx,u-boot-fdt-test1",
+						   &found_id));
+	ut_asserteq_str("denx,u-boot-fdt-test1", found_id->compatible);
+
+	/* Strings which no driver has, including a prefix of one */
+	ut_assertnull(lists_driver_lookup_compat("denx,u-boot-fdt-test2",
+						 &found_id));
+	ut_assertnull(lists_driver_lookup_compat("denx,u-boot-fdt-tes",
+						 &found_id));
+	ut_assertnull(lists_driver_lookup_compat("", &found_id));
+
+	/* Every string finds the first driver with it, as a list walk does */
+	for (entry = drv; entry != drv + n_ents; entry++) {
+		for (of_id = entry->of_match; of_id && of_id->compatible;
+		     of_id++) {
+			for (first = drv; first != entry; first++) {
+				if (drv_has_compat(first, of_id->compatible))
+					break;
+			}
+			found = lists_driver_lookup_compat(of_id->compatible,
+							   &found_id);
+			ut_asserteq_ptr(first, found);
+			ut_asserteq_str(of_id->compatible,
+					found_id->compatible);
+		}
+	}
+
+	return 0;
+}
+DM_TEST(dm_test_fdt_compat_lookup, 0);
+
+/* Test that deferred nodes are bound when their uclass is asked for */
+static int dm_test_fdt_deferred_bind(struct unit_test_state *uts)
+{
+	struct udevice *root = gd->dm_root;
+	struct udevice *dev;
+	struct uclass *uc;
+	ofnode node;
+
+	ut_assertok(lists_defer_bind_fdt(root, ofnode_path("/b-test")));
+	ut_assertok(lists_defer_bind_fdt(root, ofnode_path("/probing")));
+	ut_assertok(lists_defer_bind_fdt(root, ofnode_path("/a-test")));
+	ut_asserteq(0, list_count_items(&root->child_head));
+
+	/* Nothing is bound for a uclass without deferred nodes */
+	ut_assertok(lists_bind_deferred(UCLASS_TEST_DUMMY));
+	ut_asserteq(0, list_count_items(&root->child_head));
+
+	/* Looking up a subnode binds the deferred node holding it */
+	node = ofnode_path("/probing/test2");
+	ut_assertok(lists_bind_deferred_node(node));
+	ut_asserteq(1, list_count_items(&root->child_head));
+	ut_assertok(device_find_global_by_ofnode(node, &dev));
+
+	/* The rest are bound in the order they were deferred */
+	ut_assertok(lists_bind_deferred(UCLASS_TEST_FDT));
+	ut_asserteq(3, list_count_items(&root->child_head));
+	ut_assertok(uclass_get(UCLASS_TEST_FDT, &uc));
+	ut_asserteq(2, list_count_items(&uc->dev_head));
+	ut_assertok(device_find_first_child(root, &dev));
+	ut_assertok(device_find_next_child(&dev));
+	ut_asserteq_str("b-test", dev->name);
+
+	ut_assertok(lists_bind_deferred(UCLASS_INVALID));
+	ut_asserteq(3, list_count_items(&root->child_head));
+
+	return 0;
+}
+DM_TEST(dm_test_fdt_deferred_bind, 0);
+
+/* Test that a bus is bound when the uclass of a device on it is used */
+static int dm_test_fdt_deferred_bind_bus(struct unit_test_state *uts)
+{
+	struct udevice *root = gd->dm_root;
+	struct udevice *dev;
+
+	ut_assertok(lists_defer_bind_fdt(root, ofnode_path("/b-test")));
+	ut_assertok(lists_defer_bind_fdt(root, ofnode_path("/probing")));
+
+	/* The simple bus itself is in another uclass */
+	ut_assertok(lists_bind_deferred(UCLASS_TEST_PROBE));
+	ut_asserteq(1, list_count_items(&root->child_head));
+	ut_assertok(uclass_find_first_device(UCLASS_TEST_PROBE, &dev));
+	ut_assertnonnull(dev);
+	ut_asserteq_str("test1", dev->name);
+	ut_asserteq_str("probing", dev->parent->name);
+
+	return 0;
+}
+DM_TEST(dm_test_fdt_deferred_bind_bus, 0);
+#endif
+
 /* Test that sequence numbers are allocated properly */
 static int dm_test_fdt_uclass_seq(struct unit_test_state *uts)
 {
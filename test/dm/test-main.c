@@ -20,6 +20,26 @@ DECLARE_GLOBAL_DATA_PTR;
 struct unit_test_state global_dm_test_state;
 static struct dm_test_state _global_priv_dm_test_state;
 
+/*
+ * Devices instantiated at build time are still marked as bound when the tree
+ * they are in is dropped, so mark them unbound to bind them into the new tree
+ */
+static void dm_test_release_inst(void)
+{
+#if CONFIG_IS_ENABLED(OF_PLATDATA_INST)
+	struct driver_info *info =
+		ll_entry_start(struct driver_info, driver_info);
+	const int n_ents = ll_entry_count(struct driver_info, driver_info);
+	struct driver_info *entry;
+
+	for (entry = info; entry != info + n_ents; entry++) {
+		if (entry->dev)
+			entry->dev->flags &= ~(DM_FLAG_BOUND |
+					       DM_FLAG_INST_FAILED);
+	}
+#endif
+}
+
 /* Get ready for testing */
 static int dm_test_init(struct unit_test_state *uts, bool of_live)
 {
@@ -27,6 +47,7 @@ static int dm_test_init(struct unit_test_state *uts, bool of_live)
 
 	memset(dms, '\0', sizeof(*dms));
 	gd->dm_root = NULL;
+	dm_test_release_inst();
 	memset(dm_testdrv_op_count, '\0', sizeof(dm_testdrv_op_count));
 	state_reset_for_test(state_get_current());
 
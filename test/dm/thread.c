@@ -0,0 +1,237 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Tests for cooperative threads and parallel probing
+ */
+
+#include <common.h>
+#include <dm.h>
+#include <thread.h>
+#include <dm/device-internal.h>
+#include <dm/root.h>
+#include <dm/test.h>
+#include <dm/uclass-internal.h>
+#include <test/ut.h>
+
+static char thread_trace[20];
+static int thread_trace_len;
+
+static int thread_trace_func(void *arg)
+{
+	const char *ch = arg;
+	int i;
+
+	for (i = 0; i < 3; i++) {
+		thread_trace[thread_trace_len++] = *ch;
+		thread_yield();
+	}
+
+	return *ch;
+}
+
+/* Test that threads take turns at each yield */
+static int dm_test_thread(struct unit_test_state *uts)
+{
+	struct thread *ta, *tb;
+
+	thread_trace_len = 0;
+	ta = thread_create("a", thread_trace_func, "a");
+	ut_assertnonnull(ta);
+	tb = thread_create("b", thread_trace_func, "b");
+	ut_assertnonnull(tb);
+
+	/* Nothing runs until the main thread waits */
+	ut_asserteq(0, thread_trace_len);
+	ut_asserteq('a', thread_join(ta));
+	ut_asserteq('b', thread_join(tb));
+	thread_trace[thread_trace_len] = '\0';
+	ut_asserteq_str("ababab", thread_trace);
+
+	/* With no other threads, yielding does nothing */
+	thread_yield();
+	ut_asserteq(0, thread_join_all());
+
+	return 0;
+}
+DM_TEST(dm_test_thread, 0);
+
+static bool thread_other_ran;
+
+static int thread_delay_func(void *arg)
+{
+	thread_other_ran = false;
+	udelay(1000);
+
+	/* The other thread should have run during the delay */
+	return thread_other_ran ? 0 : -EBUSY;
+}
+
+static int thread_other_func(void *arg)
+{
+	thread_other_ran = true;
+
+	return 0;
+}
+
+/* Test that a long udelay() lets other threads run */
+static int dm_test_thread_udelay(struct unit_test_state *uts)
+{
+	ulong start;
+
+	ut_assertnonnull(thread_create("delay", thread_delay_func, NULL));
+	ut_assertnonnull(thread_create("other", thread_other_func, NULL));
+	start = timer_get_us();
+	ut_assertok(thread_join_all());
+
+	/* The delay must still be honoured */
+	ut_assert(timer_get_us() - start >= 1000);
+
+	/* A delay in the main thread does not run the other threads */
+	thread_other_ran = false;
+	ut_assertnonnull(thread_create("other", thread_other_func, NULL));
+	udelay(1000);
+	thread_yield();
+	ut_assert(!thread_other_ran);
+	ut_assertok(thread_join_all());
+	ut_assert(thread_other_ran);
+
+	return 0;
+}
+DM_TEST(dm_test_thread_udelay, 0);
+
+static bool thread_probe_done;
+
+static int thread_probe_func(void *dev)
+{
+	thread_probe_start(dev);
+	thread_yield();
+	thread_probe_done = true;
+	thread_probe_end(dev);
+
+	return 0;
+}
+
+static int thread_probe_wait_func(void *dev)
+{
+	int ret;
+
+	ret = device_probe(dev);
+	if (ret)
+		return ret;
+
+	/* The probe must have waited for the other thread */
+	return thread_probe_done ? 0 : -EBUSY;
+}
+
+/* Test that a device being probed in another thread is waited for */
+static int dm_test_thread_probe_wait(struct unit_test_state *uts)
+{
+	struct udevice *dev;
+
+	ut_assertok(uclass_find_first_device(UCLASS_TEST_FDT, &dev));
+	ut_assertnonnull(dev);
+	thread_probe_done = false;
+	ut_assertnonnull(thread_create("probe", thread_probe_func, dev));
+	ut_assertnonnull(thread_create("wait", thread_probe_wait_func, dev));
+	ut_assertok(thread_join_all());
+	ut_assert(device_active(dev));
+
+	/* The main thread waits too */
+	ut_assertok(device_remove(dev, DM_REMOVE_NORMAL));
+	thread_probe_done = false;
+	ut_assertnonnull(thread_create("probe", thread_probe_func, dev));
+	thread_run_others();
+	ut_assert(!thread_probe_done);
+	ut_assertok(device_probe(dev));
+	ut_assert(thread_probe_done);
+	ut_assertok(thread_join_all());
+
+	return 0;
+}
+DM_TEST(dm_test_thread_probe_wait, DM_TESTF_SCAN_PDATA | DM_TESTF_SCAN_FDT);
+
+static bool thread_hold;
+
+static int thread_claim_func(void *obj)
+{
+	thread_claim(obj);
+	thread_yield();
+	thread_probe_done = true;
+	thread_release(obj);
+
+	return 0;
+}
+
+static int thread_hold_func(void *arg)
+{
+	while (thread_hold)
+		thread_yield();
+
+	return 0;
+}
+
+/* Test that a bus claimed by another thread is waited for */
+static int dm_test_thread_claim(struct unit_test_state *uts)
+{
+	int bus, other;
+
+	/* Keep a thread running so that the main thread's claims count */
+	thread_hold = true;
+	ut_assertnonnull(thread_create("hold", thread_hold_func, NULL));
+	thread_probe_done = false;
+	ut_assertnonnull(thread_create("claim", thread_claim_func, &bus));
+	thread_run_others();
+	ut_assert(!thread_probe_done);
+
+	/* The main thread waits for the bus, but not for something else */
+	thread_claim(&other);
+	ut_assert(!thread_probe_done);
+	thread_claim(&bus);
+	ut_assert(thread_probe_done);
+
+	/* Claims can be released out of order */
+	thread_release(&other);
+	thread_probe_done = false;
+	ut_assertnonnull(thread_create("claim", thread_claim_func, &bus));
+	thread_run_others();
+	thread_run_others();
+	ut_assert(!thread_probe_done);
+	thread_release(&bus);
+	thread_hold = false;
+	ut_assertok(thread_join_all());
+	ut_assert(thread_probe_done);
+
+	return 0;
+}
+DM_TEST(dm_test_thread_claim, 0);
+
+/* Test probing all the devices in a uclass in parallel */
+static int dm_test_probe_async(struct unit_test_state *uts)
+{
+	struct udevice *dev;
+	struct uclass *uc;
+	int seq[8];
+	int i;
+
+	ut_assertok(uclass_get(UCLASS_TEST_FDT, &uc));
+	ut_assertok(dm_probe_async("testfdt not-a-uclass"));
+
+	/* Sequence numbers are given out before any thread runs, by alias */
+	i = 0;
+	uclass_foreach_dev(dev, uc) {
+		ut_assert(i < ARRAY_SIZE(seq));
+		ut_assert(dev->seq != -1);
+		if (dev->req_seq != -1)
+			ut_asserteq(dev->req_seq, dev->seq);
+		seq[i++] = dev->seq;
+	}
+
+	ut_assertok(thread_join_all());
+	i = 0;
+	uclass_foreach_dev(dev, uc) {
+		ut_assert(device_active(dev));
+		ut_asserteq(seq[i++], dev->seq);
+	}
+
+	return 0;
+}
+DM_TEST(dm_test_probe_async, DM_TESTF_SCAN_PDATA | DM_TESTF_SCAN_FDT);
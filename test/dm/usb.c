@@ -71,6 +71,85 @@ static int dm_test_usb_multi(struct unit_test_state *uts)
 }
 DM_TEST(dm_test_usb_multi, DM_TESTF_SCAN_PDATA | DM_TESTF_SCAN_FDT);
 
+/* Check that each block of @buf is filled with the low byte of its LBA */
+static int check_uas_blocks(struct unit_test_state *uts, const u8 *buf,
+			    lbaint_t start, lbaint_t count)
+{
+	lbaint_t blk;
+	int i;
+
+	for (blk = 0; blk < count; blk++) {
+		for (i = 0; i < 512; i++)
+			ut_asserteq((u8)(start + blk), buf[blk * 512 + i]);
+	}
+
+	return 0;
+}
+
+/*
+ * Test a UAS device. Reads and writes go out as several commands which are
+ * queued together, and the emulator completes them in reverse order.
+ */
+static int dm_test_usb_uas(struct unit_test_state *uts)
+{
+	struct udevice *dev, *blk, *emul;
+	struct blk_desc *dev_desc;
+	u8 *buf, *cmp;
+	int i;
+
+	state_set_skip_delays(true);
+	ut_assertok(usb_init());
+	ut_assertok(uclass_get_device(UCLASS_MASS_STORAGE, 3, &dev));
+	ut_assertok(device_find_first_child(dev, &blk));
+	ut_assertnonnull(blk);
+	dev_desc = dev_get_uclass_platdata(blk);
+	ut_asserteq_str("uas", dev_desc->product);
+	ut_asserteq(512, dev_desc->blksz);
+	ut_asserteq(2048, dev_desc->lba);
+
+	buf = malloc(100 * 512);
+	cmp = malloc(100 * 512);
+	ut_assertnonnull(buf);
+	ut_assertnonnull(cmp);
+
+	/* Each block holds its LBA, so misordered data shows up */
+	ut_asserteq(100, blk_dread(dev_desc, 0, 100, buf));
+	ut_assertok(check_uas_blocks(uts, buf, 0, 100));
+	ut_asserteq(3, blk_dread(dev_desc, 1001, 3, buf));
+	ut_assertok(check_uas_blocks(uts, buf, 1001, 3));
+
+	/* Write something else, read it back and then restore the blocks */
+	memset(buf, 0xa5, 90 * 512);
+	ut_asserteq(90, blk_dwrite(dev_desc, 1000, 90, buf));
+	ut_asserteq(90, blk_dread(dev_desc, 1000, 90, cmp));
+	ut_assert(!memcmp(buf, cmp, 90 * 512));
+	for (i = 0; i < 90; i++)
+		memset(buf + i * 512, (u8)(1000 + i), 512);
+	ut_asserteq(90, blk_dwrite(dev_desc, 1000, 90, buf));
+	ut_asserteq(90, blk_dread(dev_desc, 1000, 90, cmp));
+	ut_assertok(check_uas_blocks(uts, cmp, 1000, 90));
+
+	/* Only the commands before the one running off the end count */
+	ut_asserteq(40, blk_dread(dev_desc, 2000, 60, buf));
+	ut_assertok(check_uas_blocks(uts, buf, 2000, 40));
+
+	/*
+	 * A transport error leaves the other commands queued on the device.
+	 * The reset must abort them, else their tags clash with the retry.
+	 */
+	ut_assertok(usb_emul_find_for_dev(dev, &emul));
+	sandbox_uas_fail_next_data(emul);
+	ut_asserteq(100, blk_dread(dev_desc, 500, 100, buf));
+	ut_assertok(check_uas_blocks(uts, buf, 500, 100));
+
+	free(cmp);
+	free(buf);
+	ut_assertok(usb_stop());
+
+	return 0;
+}
+DM_TEST(dm_test_usb_uas, DM_TESTF_SCAN_PDATA | DM_TESTF_SCAN_FDT);
+
 static int count_usb_devices(void)
 {
 	struct udevice *hub;
@@ -107,7 +186,7 @@ static int dm_test_usb_stop(struct unit_test_state *uts)
 	ut_assertok(uclass_get_device(UCLASS_MASS_STORAGE, 0, &dev));
 	ut_assertok(uclass_get_device(UCLASS_MASS_STORAGE, 1, &dev));
 	ut_assertok(uclass_get_device(UCLASS_MASS_STORAGE, 2, &dev));
-	ut_asserteq(6, count_usb_devices());
+	ut_asserteq(7, count_usb_devices());
 	ut_assertok(usb_stop());
 	ut_asserteq(0, count_usb_devices());
 
@@ -120,3 +120,121 @@ static int dm_test_virtio_remove(struct unit_test_state *uts)
 	return 0;
 }
 DM_TEST(dm_test_virtio_remove, DM_TESTF_SCAN_PDATA | DM_TESTF_SCAN_FDT);
+
+/* Test the split ring with indirect descriptors */
+static int dm_test_virtio_ring_indirect(struct unit_test_state *uts)
+{
+	struct udevice *bus, *dev;
+	struct virtio_dev_priv *uc_priv;
+	struct virtqueue *vq;
+	u8 hdr[16], data[512], status;
+	struct virtio_sg hdr_sg = { hdr, sizeof(hdr) };
+	struct virtio_sg data_sg = { data, sizeof(data) };
+	struct virtio_sg status_sg = { &status, sizeof(status) };
+	struct virtio_sg *sgs[] = { &hdr_sg, &data_sg, &status_sg };
+	struct vring_desc *desc;
+	unsigned int len;
+
+	ut_assertok(uclass_first_device(UCLASS_VIRTIO, &bus));
+	ut_assertok(device_find_first_child(bus, &dev));
+	uc_priv = dev_get_uclass_priv(bus);
+	uc_priv->vdev = dev;
+	__virtio_set_bit(bus, VIRTIO_RING_F_INDIRECT_DESC);
+
+	ut_assertok(virtio_find_vqs(dev, 1, &vq));
+	ut_asserteq(false, vq->packed);
+	ut_asserteq(true, vq->indirect);
+
+	/* a three-element request only takes one slot in the ring */
+	ut_assertok(virtqueue_add(vq, sgs, 1, 2));
+	ut_asserteq(virtqueue_get_vring_size(vq) - 1, vq->num_free);
+	ut_asserteq(VRING_DESC_F_INDIRECT, vq->vring.desc[0].flags);
+	ut_asserteq(3 * sizeof(struct vring_desc), vq->vring.desc[0].len);
+	desc = (struct vring_desc *)(uintptr_t)vq->vring.desc[0].addr;
+	ut_asserteq_ptr(hdr, (void *)(uintptr_t)desc[0].addr);
+	ut_asserteq(VRING_DESC_F_NEXT, desc[0].flags);
+	ut_asserteq(VRING_DESC_F_NEXT | VRING_DESC_F_WRITE, desc[1].flags);
+	ut_asserteq(VRING_DESC_F_WRITE, desc[2].flags);
+
+	/* nothing consumed by the device yet */
+	ut_assertnull(virtqueue_get_buf(vq, &len));
+
+	/* fake the device consuming the request */
+	vq->vring.used->ring[0].id = 0;
+	vq->vring.used->ring[0].len = 1;
+	vq->vring.used->idx = 1;
+	ut_asserteq_ptr(hdr, virtqueue_get_buf(vq, &len));
+	ut_asserteq(1, len);
+	ut_asserteq(virtqueue_get_vring_size(vq), vq->num_free);
+
+	ut_assertok(virtio_del_vqs(dev));
+
+	return 0;
+}
+DM_TEST(dm_test_virtio_ring_indirect, DM_TESTF_SCAN_PDATA | DM_TESTF_SCAN_FDT);
+
+/* Test the packed ring, with and without indirect descriptors */
+static int dm_test_virtio_ring_packed(struct unit_test_state *uts)
+{
+	struct udevice *bus, *dev;
+	struct virtio_dev_priv *uc_priv;
+	struct virtqueue *vq;
+	u8 hdr[16], data[512], status;
+	struct virtio_sg hdr_sg = { hdr, sizeof(hdr) };
+	struct virtio_sg data_sg = { data, sizeof(data) };
+	struct virtio_sg status_sg = { &status, sizeof(status) };
+	struct virtio_sg *sgs[] = { &hdr_sg, &data_sg, &status_sg };
+	struct vring_packed_desc *desc;
+	u16 avail = 1 << VRING_PACKED_DESC_F_AVAIL;
+	u16 used = 1 << VRING_PACKED_DESC_F_USED;
+	unsigned int len;
+
+	ut_assertok(uclass_first_device(UCLASS_VIRTIO, &bus));
+	ut_assertok(device_find_first_child(bus, &dev));
+	uc_priv = dev_get_uclass_priv(bus);
+	uc_priv->vdev = dev;
+	__virtio_set_bit(bus, VIRTIO_F_RING_PACKED);
+
+	ut_assertok(virtio_find_vqs(dev, 1, &vq));
+	ut_asserteq(true, vq->packed);
+	ut_asserteq(false, vq->indirect);
+	ut_asserteq(virtqueue_get_desc_addr(vq) + 4 * sizeof(*desc),
+		    virtqueue_get_avail_addr(vq));
+	desc = vq->vring_packed.desc;
+
+	/* direct descriptors: three slots, head published last */
+	ut_assertok(virtqueue_add(vq, sgs, 1, 2));
+	ut_asserteq(1, vq->num_free);
+	ut_asserteq(avail | VRING_DESC_F_NEXT, desc[0].flags);
+	ut_asserteq(avail | VRING_DESC_F_NEXT | VRING_DESC_F_WRITE,
+		    desc[1].flags);
+	ut_asserteq(avail | VRING_DESC_F_WRITE, desc[2].flags);
+	ut_asserteq(desc[0].id, desc[2].id);
+	ut_assertnull(virtqueue_get_buf(vq, &len));
+
+	/* fake the device consuming the request */
+	desc[0].len = 1;
+	desc[0].flags = avail | used;
+	ut_asserteq_ptr(hdr, virtqueue_get_buf(vq, &len));
+	ut_asserteq(1, len);
+	ut_asserteq(4, vq->num_free);
+	ut_assertok(virtio_del_vqs(dev));
+
+	/* indirect descriptors: one slot for the whole request */
+	__virtio_set_bit(bus, VIRTIO_RING_F_INDIRECT_DESC);
+	ut_assertok(virtio_find_vqs(dev, 1, &vq));
+	ut_asserteq(true, vq->indirect);
+	desc = vq->vring_packed.desc;
+	ut_assertok(virtqueue_add(vq, sgs, 1, 2));
+	ut_asserteq(3, vq->num_free);
+	ut_asserteq(avail | VRING_DESC_F_INDIRECT, desc[0].flags);
+	ut_asserteq(3 * sizeof(*desc), desc[0].len);
+
+	desc[0].flags = avail | used;
+	ut_asserteq_ptr(hdr, virtqueue_get_buf(vq, &len));
+	ut_asserteq(4, vq->num_free);
+	ut_assertok(virtio_del_vqs(dev));
+
+	return 0;
+}
+DM_TEST(dm_test_virtio_ring_packed, DM_TESTF_SCAN_PDATA | DM_TESTF_SCAN_FDT);
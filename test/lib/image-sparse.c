@@ -0,0 +1,180 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Tests for writing sparse images while they are received
+ */
+
+#include <common.h>
+#include <image-sparse.h>
+#include <malloc.h>
+#include <dm/test.h>
+#include <test/ut.h>
+#include <asm/unaligned.h>
+
+/* Block size of the storage, smaller than that of the image */
+#define STORE_BLKSZ	512
+#define STORE_BLKS	12
+#define IMAGE_BLKSZ	1024
+#define IMAGE_BLKS	5
+#define FILL_VALUE	0x12345678
+
+/* Untouched storage, so that blocks which are not written can be seen */
+#define STORE_FILL	0xee
+
+/* Room for the staged data, as with fastboot's download buffer */
+#define STAGE_SIZE	1536
+
+#define SPARSE_MSG_LEN	64
+
+static u8 sparse_store[STORE_BLKS * STORE_BLKSZ];
+
+static lbaint_t sparse_test_write(struct sparse_storage *info, lbaint_t blk,
+				  lbaint_t blkcnt, const void *buffer)
+{
+	memcpy(sparse_store + blk * STORE_BLKSZ, buffer, blkcnt * STORE_BLKSZ);
+
+	return blkcnt;
+}
+
+static lbaint_t sparse_test_reserve(struct sparse_storage *info,
+				    lbaint_t blk, lbaint_t blkcnt)
+{
+	return blkcnt;
+}
+
+static void sparse_test_mssg(const char *str, char *response)
+{
+	strlcpy(response, str, SPARSE_MSG_LEN);
+}
+
+static void *sparse_add_chunk(void *ptr, u16 type, u32 blks, u32 data_sz)
+{
+	chunk_header_t *chunk = ptr;
+
+	chunk->chunk_type = type;
+	chunk->chunk_sz = blks;
+	chunk->total_sz = sizeof(*chunk) + data_sz;
+
+	return ptr + sizeof(*chunk);
+}
+
+/*
+ * Build an image with a two-block RAW chunk, a FILL chunk, a DONT_CARE
+ * chunk, a one-block RAW chunk and a CRC32 chunk. Returns its size.
+ */
+static int sparse_make_image(u8 *image)
+{
+	sparse_header_t *header = (sparse_header_t *)image;
+	u8 *ptr = image + sizeof(*header);
+	int i;
+
+	header->magic = SPARSE_HEADER_MAGIC;
+	header->major_version = 1;
+	header->file_hdr_sz = sizeof(sparse_header_t);
+	header->chunk_hdr_sz = sizeof(chunk_header_t);
+	header->blk_sz = IMAGE_BLKSZ;
+	header->total_blks = IMAGE_BLKS;
+	header->total_chunks = 5;
+
+	ptr = sparse_add_chunk(ptr, CHUNK_TYPE_RAW, 2, 2 * IMAGE_BLKSZ);
+	for (i = 0; i < 2 * IMAGE_BLKSZ; i++)
+		*ptr++ = i * 7;
+	ptr = sparse_add_chunk(ptr, CHUNK_TYPE_FILL, 1, sizeof(u32));
+	put_unaligned(FILL_VALUE, (u32 *)ptr);
+	ptr += sizeof(u32);
+	ptr = sparse_add_chunk(ptr, CHUNK_TYPE_DONT_CARE, 1, 0);
+	ptr = sparse_add_chunk(ptr, CHUNK_TYPE_RAW, 1, IMAGE_BLKSZ);
+	for (i = 0; i < IMAGE_BLKSZ; i++)
+		*ptr++ = i * 3 + 1;
+	ptr = sparse_add_chunk(ptr, CHUNK_TYPE_CRC32, 0, sizeof(u32));
+	put_unaligned(0, (u32 *)ptr);
+	ptr += sizeof(u32);
+
+	return ptr - image;
+}
+
+/*
+ * Send @image in pieces of @piece bytes, writing after each one. What cannot
+ * be written yet is kept at the start of @stage, as fastboot does.
+ */
+static int sparse_send(struct unit_test_state *uts, u8 *image, int size,
+		       int piece, u8 *stage)
+{
+	struct sparse_storage info = {
+		.blksz		= STORE_BLKSZ,
+		.start		= 0,
+		.size		= STORE_BLKS,
+		.write		= sparse_test_write,
+		.reserve	= sparse_test_reserve,
+		.mssg		= sparse_test_mssg,
+	};
+	char response[SPARSE_MSG_LEN] = "";
+	struct sparse_stream stream;
+	int fill = 0;
+	long consumed;
+	int pos, n;
+
+	memset(sparse_store, STORE_FILL, sizeof(sparse_store));
+	sparse_stream_init(&stream, &info);
+	for (pos = 0; pos < size; pos += n) {
+		n = min(piece, size - pos);
+		n = min(n, STAGE_SIZE - fill);
+		memcpy(stage + fill, image + pos, n);
+		fill += n;
+		consumed = sparse_stream_write(&stream, stage, fill, false,
+					       response);
+		ut_assert(consumed >= 0);
+		/* A full buffer always holds something which can be written */
+		ut_assert(consumed || fill < STAGE_SIZE);
+		fill -= consumed;
+		memmove(stage, stage + consumed, fill);
+	}
+	ut_asserteq(fill, sparse_stream_write(&stream, stage, fill, true,
+					      response));
+	ut_assertok(sparse_stream_finish(&stream, "test", response));
+	ut_asserteq_str("", response);
+
+	return 0;
+}
+
+/* Check that a sparse image sent in small, misaligned pieces is written */
+static int lib_test_sparse_stream(struct unit_test_state *uts)
+{
+	static const int pieces[] = { 1, 37, 500, 4096 };
+	u8 *image, *stage, *blk;
+	int size, i, j;
+
+	image = malloc(IMAGE_BLKS * IMAGE_BLKSZ);
+	ut_assertnonnull(image);
+	stage = malloc(STAGE_SIZE);
+	ut_assertnonnull(stage);
+	size = sparse_make_image(image);
+
+	for (i = 0; i < ARRAY_SIZE(pieces); i++) {
+		ut_assertok(sparse_send(uts, image, size, pieces[i], stage));
+
+		/* Blocks 0-1 and 4 are raw, 2 is filled and 3 is skipped */
+		blk = sparse_store;
+		for (j = 0; j < 2 * IMAGE_BLKSZ; j++)
+			ut_asserteq((u8)(j * 7), blk[j]);
+		blk += 2 * IMAGE_BLKSZ;
+		for (j = 0; j < IMAGE_BLKSZ / sizeof(u32); j++) {
+			ut_asserteq(FILL_VALUE, get_unaligned((u32 *)blk));
+			blk += sizeof(u32);
+		}
+		for (j = 0; j < IMAGE_BLKSZ; j++)
+			ut_asserteq(STORE_FILL, blk[j]);
+		blk += IMAGE_BLKSZ;
+		for (j = 0; j < IMAGE_BLKSZ; j++)
+			ut_asserteq((u8)(j * 3 + 1), blk[j]);
+		blk += IMAGE_BLKSZ;
+
+		/* Nothing is written past the end of the image */
+		for (; blk < sparse_store + sizeof(sparse_store); blk++)
+			ut_asserteq(STORE_FILL, *blk);
+	}
+	free(stage);
+	free(image);
+
+	return 0;
+}
+DM_TEST(lib_test_sparse_stream, 0);
@@ -15,6 +15,12 @@ def test_ut_dm_init(u_boot_console):
         with open(fn, 'wb') as fh:
             fh.write(data)
 
+    fn = u_boot_console.config.source_dir + '/testuas.bin'
+    if not os.path.exists(fn):
+        data = ''.join(chr(blk & 0xff) * 512 for blk in range(2048))
+        with open(fn, 'wb') as fh:
+            fh.write(data)
+
     fn = u_boot_console.config.source_dir + '/spi.bin'
     if not os.path.exists(fn):
         data = '\x00' * (2 * 1024 * 1024)
@@ -13,6 +13,7 @@ static data.
 
 import collections
 import copy
+import re
 import sys
 
 import fdt
@@ -41,8 +42,16 @@ TYPE_NAMES = {
     fdt.TYPE_INT64: 'fdt64_t',
 }
 
+# Compatible strings whose driver is not named after the string in C form.
+# A device is bound by driver name, so U_BOOT_DEVICE() must use these names.
+COMPAT_DRIVER_NAMES = {
+    'simple-bus': 'generic_simple_bus',
+    'simple-mfd': 'generic_simple_bus',
+}
+
 STRUCT_PREFIX = 'dtd_'
 VAL_PREFIX = 'dtv_'
+INST_PREFIX = 'dti_'
 
 # This holds information about a property which includes phandles.
 #
@@ -124,6 +133,19 @@ def get_compat_name(node):
         compat, aliases = compat[0], compat[1:]
     return conv_name_to_c(compat), [conv_name_to_c(a) for a in aliases]
 
+def get_driver_name(node):
+    """Get the name of the driver for a node
+
+    Args:
+        node: Node object to check
+    Return:
+        Name of the driver for the node's first compatible string
+    """
+    compat = node.props['compatible'].value
+    if isinstance(compat, list):
+        compat = compat[0]
+    return COMPAT_DRIVER_NAMES.get(compat, conv_name_to_c(compat))
+
 
 class DtbPlatdata(object):
     """Provide a means to convert device tree binary data to platform data
@@ -139,8 +161,11 @@ class DtbPlatdata(object):
         _include_disabled: true to include nodes marked status = "disabled"
         _outfile: The current output file (sys.stdout or a real file)
         _lines: Stashed list of output lines for outputting in the future
+        _instantiate: true to output storage, parent and sequence number for
+            each device, for CONFIG_OF_PLATDATA_INST
+        _seq: Dict of sequence numbers from the /aliases node, keyed by Node
     """
-    def __init__(self, dtb_fname, include_disabled):
+    def __init__(self, dtb_fname, include_disabled, instantiate=False):
         self._fdt = None
         self._dtb_fname = dtb_fname
         self._valid_nodes = None
@@ -148,6 +173,8 @@ class DtbPlatdata(object):
         self._outfile = None
         self._lines = []
         self._aliases = {}
+        self._instantiate = instantiate
+        self._seq = {}
 
     def setup_output(self, fname):
         """Set up the output destination
@@ -278,6 +305,43 @@ class DtbPlatdata(object):
         self._valid_nodes = []
         return self.scan_node(self._fdt.GetRoot())
 
+    def scan_seq(self):
+        """Scan the /aliases node to find the sequence number of each device
+
+        An alias such as 'serial2' gives its target node sequence number 2. If
+        several aliases refer to a node, the one that sorts first is used.
+
+        This fills in the following properties:
+            _seq: Dict of sequence numbers, keyed by Node
+        """
+        self._seq = {}
+        aliases = self._fdt.GetNode('/aliases')
+        if not aliases:
+            return
+        for name in sorted(aliases.props):
+            prop = aliases.props[name]
+            match = re.match(r'^(.*?)(\d+)$', name)
+            if not match or prop.type != fdt.TYPE_STRING:
+                continue
+            node = self._fdt.GetNode(prop.value)
+            if node in self._valid_nodes and node not in self._seq:
+                self._seq[node] = int(match.group(2))
+
+    def get_parent(self, node):
+        """Get the parent device of a node
+
+        Args:
+            node: Node to check
+
+        Returns:
+            The nearest ancestor of the node which is a device, or None if
+            there is none, in which case the device is a child of the root
+        """
+        parent = node.parent
+        while parent and parent not in self._valid_nodes:
+            parent = parent.parent
+        return parent
+
     @staticmethod
     def get_num_cells(node):
         """Get the number of cells in addresses and sizes for this node
@@ -506,17 +570,37 @@ class DtbPlatdata(object):
                 self.buf(get_value(prop.type, prop.value))
             self.buf(',\n')
         self.buf('};\n')
+        if not self._instantiate:
+            self.output_device(node)
+
+        self.out(''.join(self.get_buf()))
+
+    def output_device(self, node):
+        """Output the device declaration for a node
 
-        # Add a device declaration
+        With instantiation, this also declares storage for the device and
+        refers to the parent device, which must have been output already.
+
+        Args:
+            node: node to output
+        """
+        var_name = conv_name_to_c(node.name)
+        if self._instantiate:
+            self.buf('static struct udevice %s%s;\n' % (INST_PREFIX, var_name))
         self.buf('U_BOOT_DEVICE(%s) = {\n' % var_name)
-        self.buf('\t.name\t\t= "%s",\n' % struct_name)
+        self.buf('\t.name\t\t= "%s",\n' % get_driver_name(node))
         self.buf('\t.platdata\t= &%s%s,\n' % (VAL_PREFIX, var_name))
         self.buf('\t.platdata_size\t= sizeof(%s%s),\n' % (VAL_PREFIX, var_name))
+        if self._instantiate:
+            self.buf('\t.dev\t\t= &%s%s,\n' % (INST_PREFIX, var_name))
+            parent = self.get_parent(node)
+            if parent:
+                self.buf('\t.parent\t\t= U_BOOT_DEVICE_REF(%s),\n' %
+                         conv_name_to_c(parent.name))
+            self.buf('\t.req_seq\t= %d,\n' % self._seq.get(node, -1))
         self.buf('};\n')
         self.buf('\n')
 
-        self.out(''.join(self.get_buf()))
-
     def generate_tables(self):
         """Generate device defintions for the platform data
 
@@ -524,6 +608,10 @@ class DtbPlatdata(object):
         U_BOOT_DEVICE() declarations for each valid node. Where a node has
         multiple compatible strings, a #define is used to make them equivalent.
 
+        With instantiation the U_BOOT_DEVICE() declarations follow all the
+        platform data, in device-tree order, so that each parent comes before
+        its children.
+
         See the documentation in doc/driver-model/of-plat.txt for more
         information.
         """
@@ -545,8 +633,13 @@ class DtbPlatdata(object):
             self.output_node(node)
             nodes_to_output.remove(node)
 
+        if self._instantiate:
+            for node in self._valid_nodes:
+                self.output_device(node)
+            self.out(''.join(self.get_buf()))
+
 
-def run_steps(args, dtb_file, include_disabled, output):
+def run_steps(args, dtb_file, include_disabled, output, instantiate=False):
     """Run all the steps of the dtoc tool
 
     Args:
@@ -554,13 +647,16 @@ def run_steps(args, dtb_file, include_disabled, output):
         dtb_file: Filename of dtb file to process
         include_disabled: True to include disabled nodes
         output: Name of output file
+        instantiate: True to generate device storage, parents and sequence
+            numbers (CONFIG_OF_PLATDATA_INST)
     """
     if not args:
         raise ValueError('Please specify a command: struct, platdata')
 
-    plat = DtbPlatdata(dtb_file, include_disabled)
+    plat = DtbPlatdata(dtb_file, include_disabled, instantiate)
     plat.scan_dtb()
     plat.scan_tree()
+    plat.scan_seq()
     plat.scan_reg_sizes()
     plat.setup_output(output)
     structs = plat.scan_structs()
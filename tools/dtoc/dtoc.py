@@ -87,6 +87,8 @@ parser.add_option('-d', '--dtb-file', action='store',
                   help='Specify the .dtb input file')
 parser.add_option('--include-disabled', action='store_true',
                   help='Include disabled nodes')
+parser.add_option('-i', '--instantiate', action='store_true',
+                  help='Instantiate devices, with their parents and sequence numbers')
 parser.add_option('-o', '--output', action='store', default='-',
                   help='Select output filename')
 parser.add_option('-P', '--processes', type=int,
@@ -106,4 +108,4 @@ elif options.test_coverage:
 
 else:
     dtb_platdata.run_steps(args, options.dtb_file, options.include_disabled,
-                           options.output)
+                           options.output, options.instantiate)
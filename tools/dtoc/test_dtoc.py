@@ -685,6 +685,65 @@ U_BOOT_DEVICE(spl_test2) = {
 \t.platdata_size\t= sizeof(dtv_spl_test2),
 };
 
+''', data)
+
+    def test_instantiate(self):
+        """Test output of device storage, parents and sequence numbers"""
+        dtb_file = get_dtb_file('dtoc_test_inst.dts')
+        output = tools.GetOutputFilename('output')
+        dtb_platdata.run_steps(['platdata'], dtb_file, False, output, True)
+        with open(output) as infile:
+            data = infile.read()
+        self._CheckStrings(C_HEADER + '''
+static struct dtd_sandbox_i2c_test dtv_i2c_at_0 = {
+};
+static struct dtd_sandbox_pmic_test dtv_pmic_at_9 = {
+\t.low_power\t\t= true,
+\t.reg\t\t\t= {0x9, 0x0},
+};
+static struct dtd_simple_bus dtv_board = {
+};
+static struct dtd_sandbox_serial_test dtv_serial = {
+\t.intval\t\t\t= 0x3,
+};
+static struct udevice dti_i2c_at_0;
+U_BOOT_DEVICE(i2c_at_0) = {
+\t.name\t\t= "sandbox_i2c_test",
+\t.platdata\t= &dtv_i2c_at_0,
+\t.platdata_size\t= sizeof(dtv_i2c_at_0),
+\t.dev\t\t= &dti_i2c_at_0,
+\t.req_seq\t= 1,
+};
+
+static struct udevice dti_pmic_at_9;
+U_BOOT_DEVICE(pmic_at_9) = {
+\t.name\t\t= "sandbox_pmic_test",
+\t.platdata\t= &dtv_pmic_at_9,
+\t.platdata_size\t= sizeof(dtv_pmic_at_9),
+\t.dev\t\t= &dti_pmic_at_9,
+\t.parent\t\t= U_BOOT_DEVICE_REF(i2c_at_0),
+\t.req_seq\t= -1,
+};
+
+static struct udevice dti_board;
+U_BOOT_DEVICE(board) = {
+\t.name\t\t= "generic_simple_bus",
+\t.platdata\t= &dtv_board,
+\t.platdata_size\t= sizeof(dtv_board),
+\t.dev\t\t= &dti_board,
+\t.req_seq\t= -1,
+};
+
+static struct udevice dti_serial;
+U_BOOT_DEVICE(serial) = {
+\t.name\t\t= "sandbox_serial_test",
+\t.platdata\t= &dtv_serial,
+\t.platdata_size\t= sizeof(dtv_serial),
+\t.dev\t\t= &dti_serial,
+\t.parent\t\t= U_BOOT_DEVICE_REF(board),
+\t.req_seq\t= 0,
+};
+
 ''', data)
 
     def testStdout(self):